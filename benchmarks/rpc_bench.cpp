@@ -0,0 +1,406 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "rpc_client_wrapper.h"
+#include "rpc_errors.h"
+#include "rpc_stats.h"
+#include "rpc_utils.h"
+
+// rpc_bench：基于RPCClientWrapper的闭环/开环负载生成器
+//
+// 闭环模式下每个并发槽位在收到响应后立即发送下一个请求；
+// 开环模式下按固定速率安排发送时间，延迟从计划发送时间开始计算，
+// 以修正协调遗漏（coordinated omission）。
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string host = "localhost";
+    uint16_t port = 8080;
+    size_t connections = 1;
+    size_t concurrency = 1;
+    size_t payload = 64;
+    std::string mix = "echo";
+    double duration_sec = 10.0;
+    double warmup_sec = 1.0;
+    double rate = 0.0;              // 总请求速率（次/秒），大于0时为开环模式
+    int64_t timeout_ms = 5000;
+    std::string json_path;          // JSON输出路径，"-"表示标准输出
+};
+
+struct MixEntry {
+    std::string method;
+    unsigned weight;
+};
+
+/**
+ * @brief 单个方法的结果统计
+ */
+struct MethodResult {
+    std::string method;
+    rpc_utils::LatencyHistogram latency;
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> overloaded{0};    // errors中收到OverloadedError的部分
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [OPTIONS]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --host=<host>          Server host (default localhost)\n"
+              << "  --port=<port>          Server port (default 8080)\n"
+              << "  --connections=<n>      Number of client connections (default 1)\n"
+              << "  --concurrency=<n>      Concurrent request slots (default 1)\n"
+              << "  --payload=<bytes>      Payload size for echo/sink (default 64)\n"
+              << "  --mix=<m:w,...>        Method mix, e.g. echo:8,add:1,sink:1 (default echo)\n"
+              << "                         Methods: noop, echo, sink, add\n"
+              << "  --duration=<sec>       Measurement duration (default 10)\n"
+              << "  --warmup=<sec>         Warmup duration, not recorded (default 1)\n"
+              << "  --rate=<req/s>         Open-loop fixed total rate; 0 = closed loop (default 0)\n"
+              << "  --timeout=<ms>         Per-call timeout (default 5000)\n"
+              << "  --json=<file>          Also write JSON report to file ('-' for stdout)\n"
+              << "  -h, --help             Show this help message\n";
+}
+
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+std::vector<MixEntry> parse_mix(const std::string& mix) {
+    std::vector<MixEntry> entries;
+    std::stringstream ss(mix);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        MixEntry entry;
+        size_t colon = item.find(':');
+        entry.method = item.substr(0, colon);
+        entry.weight = colon == std::string::npos
+            ? 1u
+            : static_cast<unsigned>(std::stoul(item.substr(colon + 1)));
+        if (entry.method != "noop" && entry.method != "echo" &&
+            entry.method != "sink" && entry.method != "add") {
+            throw std::invalid_argument("Unknown method in mix: " + entry.method);
+        }
+        if (entry.weight > 0) {
+            entries.push_back(entry);
+        }
+    }
+    if (entries.empty()) {
+        throw std::invalid_argument("Method mix is empty");
+    }
+    return entries;
+}
+
+/**
+ * @brief 每个工作线程独立的xorshift随机数，用于按权重选择方法
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    uint64_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+
+private:
+    uint64_t state_;
+};
+
+/**
+ * @brief 发送一次请求
+ */
+void invoke(rpc_utils::RPCClientWrapper& client, const std::string& method,
+            const std::string& payload) {
+    if (method == "echo") {
+        client.call<std::string>("echo", payload);
+    } else if (method == "sink") {
+        client.call<uint64_t>("sink", payload);
+    } else if (method == "add") {
+        client.call<double>("add", 1.5, 2.5);
+    } else {
+        client.call<int>("noop");
+    }
+}
+
+double to_us(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+struct Summary {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t overloaded = 0;
+    double throughput = 0;
+    rpc_utils::HistogramSnapshot latency;
+};
+
+void write_latency_json(std::ostream& out, const rpc_utils::HistogramSnapshot& h) {
+    out << "{\"mean\": " << h.mean() / 1000.0
+        << ", \"p50\": " << to_us(h.percentile(0.50))
+        << ", \"p90\": " << to_us(h.percentile(0.90))
+        << ", \"p99\": " << to_us(h.percentile(0.99))
+        << ", \"p999\": " << to_us(h.percentile(0.999))
+        << ", \"p9999\": " << to_us(h.percentile(0.9999))
+        << ", \"max\": " << to_us(h.max()) << "}";
+}
+
+void write_json(std::ostream& out, const BenchOptions& options, const Summary& summary,
+                const std::vector<std::unique_ptr<MethodResult>>& methods) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n"
+        << "  \"mode\": \"" << (options.rate > 0 ? "open-loop" : "closed-loop") << "\",\n"
+        << "  \"config\": {\"host\": \"" << options.host << "\", \"port\": " << options.port
+        << ", \"connections\": " << options.connections
+        << ", \"concurrency\": " << options.concurrency
+        << ", \"payload\": " << options.payload
+        << ", \"mix\": \"" << options.mix << "\""
+        << ", \"duration_sec\": " << options.duration_sec
+        << ", \"rate\": " << options.rate << "},\n"
+        << "  \"requests\": " << summary.requests << ",\n"
+        << "  \"errors\": " << summary.errors << ",\n"
+        << "  \"overloaded\": " << summary.overloaded << ",\n"
+        << "  \"throughput_rps\": " << summary.throughput << ",\n"
+        << "  \"latency_us\": ";
+    write_latency_json(out, summary.latency);
+    out << ",\n  \"methods\": {";
+    for (size_t i = 0; i < methods.size(); ++i) {
+        rpc_utils::HistogramSnapshot h = methods[i]->latency.snapshot();
+        out << (i == 0 ? "\n" : ",\n")
+            << "    \"" << methods[i]->method << "\": {\"requests\": " << h.count()
+            << ", \"errors\": " << methods[i]->errors.load()
+            << ", \"overloaded\": " << methods[i]->overloaded.load()
+            << ", \"latency_us\": ";
+        write_latency_json(out, h);
+        out << "}";
+    }
+    out << "\n  }\n}\n";
+}
+
+void write_text(std::ostream& out, const BenchOptions& options, const Summary& summary,
+                const std::vector<std::unique_ptr<MethodResult>>& methods) {
+    const rpc_utils::HistogramSnapshot& h = summary.latency;
+    out << std::fixed << std::setprecision(1);
+    out << "rpc_bench: " << (options.rate > 0 ? "open-loop" : "closed-loop")
+        << " connections=" << options.connections
+        << " concurrency=" << options.concurrency
+        << " payload=" << options.payload << "B"
+        << " mix=" << options.mix
+        << " duration=" << options.duration_sec << "s";
+    if (options.rate > 0) {
+        out << " rate=" << options.rate << "/s";
+    }
+    out << "\n"
+        << "  requests:   " << summary.requests << " (errors " << summary.errors
+        << ", overloaded " << summary.overloaded << ")\n"
+        << "  throughput: " << summary.throughput << " req/s\n"
+        << "  latency(us) mean " << h.mean() / 1000.0
+        << "  p50 " << to_us(h.percentile(0.50))
+        << "  p90 " << to_us(h.percentile(0.90))
+        << "  p99 " << to_us(h.percentile(0.99))
+        << "  p99.9 " << to_us(h.percentile(0.999))
+        << "  p99.99 " << to_us(h.percentile(0.9999))
+        << "  max " << to_us(h.max()) << "\n";
+
+    if (methods.size() > 1) {
+        for (const auto& method : methods) {
+            rpc_utils::HistogramSnapshot mh = method->latency.snapshot();
+            out << "    " << std::left << std::setw(6) << method->method << std::right
+                << " requests " << mh.count()
+                << "  errors " << method->errors.load()
+                << "  overloaded " << method->overloaded.load()
+                << "  p50 " << to_us(mh.percentile(0.50))
+                << "  p99 " << to_us(mh.percentile(0.99))
+                << "  p99.9 " << to_us(mh.percentile(0.999)) << "\n";
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            std::string value;
+            if (arg == "-h" || arg == "--help") {
+                print_usage(argv[0]);
+                return 0;
+            } else if (parse_option(arg, "host", value)) {
+                options.host = value;
+            } else if (parse_option(arg, "port", value)) {
+                options.port = static_cast<uint16_t>(std::stoi(value));
+            } else if (parse_option(arg, "connections", value)) {
+                options.connections = std::max<size_t>(1, std::stoul(value));
+            } else if (parse_option(arg, "concurrency", value)) {
+                options.concurrency = std::max<size_t>(1, std::stoul(value));
+            } else if (parse_option(arg, "payload", value)) {
+                options.payload = std::stoul(value);
+            } else if (parse_option(arg, "mix", value)) {
+                options.mix = value;
+            } else if (parse_option(arg, "duration", value)) {
+                options.duration_sec = std::stod(value);
+            } else if (parse_option(arg, "warmup", value)) {
+                options.warmup_sec = std::stod(value);
+            } else if (parse_option(arg, "rate", value)) {
+                options.rate = std::stod(value);
+            } else if (parse_option(arg, "timeout", value)) {
+                options.timeout_ms = std::stoll(value);
+            } else if (parse_option(arg, "json", value)) {
+                options.json_path = value;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+
+        std::vector<MixEntry> mix = parse_mix(options.mix);
+        unsigned total_weight = 0;
+        std::vector<std::unique_ptr<MethodResult>> methods;
+        for (const auto& entry : mix) {
+            total_weight += entry.weight;
+            methods.push_back(std::make_unique<MethodResult>());
+            methods.back()->method = entry.method;
+        }
+
+        std::vector<std::unique_ptr<rpc_utils::RPCClientWrapper>> clients;
+        for (size_t i = 0; i < options.connections; ++i) {
+            clients.push_back(std::make_unique<rpc_utils::RPCClientWrapper>(
+                options.host, options.port, options.timeout_ms));
+        }
+
+        const std::string payload(options.payload, 'x');
+        const auto start = Clock::now() + std::chrono::milliseconds(50);
+        const auto measure_start = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.warmup_sec));
+        const auto measure_end = measure_start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.duration_sec));
+
+        // 开环模式：每个槽位按 concurrency / rate 的间隔发送，槽位之间错开 1 / rate
+        const bool open_loop = options.rate > 0;
+        const auto interval = open_loop
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                  static_cast<double>(options.concurrency) / options.rate))
+            : Clock::duration::zero();
+        const auto stagger = open_loop
+            ? std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(1.0 / options.rate))
+            : Clock::duration::zero();
+
+        std::vector<std::thread> workers;
+        for (size_t slot = 0; slot < options.concurrency; ++slot) {
+            workers.emplace_back([&, slot]() {
+                rpc_utils::RPCClientWrapper& client = *clients[slot % clients.size()];
+                Random random(slot + 1);
+                auto intended = start + stagger * static_cast<long>(slot);
+                std::this_thread::sleep_until(start);
+
+                while (true) {
+                    auto send_time = Clock::now();
+                    if (open_loop) {
+                        if (intended >= measure_end) {
+                            break;
+                        }
+                        if (send_time < intended) {
+                            std::this_thread::sleep_until(intended);
+                        }
+                        // 延迟从计划发送时间算起，落后于计划的时间也计入延迟
+                        send_time = intended;
+                        intended += interval;
+                    } else if (send_time >= measure_end) {
+                        break;
+                    }
+
+                    unsigned pick = static_cast<unsigned>(random.next() % total_weight);
+                    size_t index = 0;
+                    while (pick >= mix[index].weight) {
+                        pick -= mix[index].weight;
+                        ++index;
+                    }
+
+                    bool ok = true;
+                    bool overloaded = false;
+                    try {
+                        invoke(client, mix[index].method, payload);
+                    } catch (const rpc_utils::OverloadedError&) {
+                        ok = false;
+                        overloaded = true;
+                    } catch (const std::exception&) {
+                        ok = false;
+                    }
+                    auto done = Clock::now();
+
+                    if (send_time >= measure_start) {
+                        MethodResult& result = *methods[index];
+                        if (ok) {
+                            result.latency.record(static_cast<uint64_t>(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    done - send_time).count()));
+                        } else {
+                            result.errors.fetch_add(1, std::memory_order_relaxed);
+                            if (overloaded) {
+                                result.overloaded.fetch_add(1, std::memory_order_relaxed);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        Summary summary;
+        for (const auto& method : methods) {
+            method->latency.merge_into(summary.latency);
+            summary.errors += method->errors.load();
+            summary.overloaded += method->overloaded.load();
+        }
+        summary.requests = summary.latency.count() + summary.errors;
+        summary.throughput = options.duration_sec > 0
+            ? static_cast<double>(summary.latency.count()) / options.duration_sec
+            : 0.0;
+
+        write_text(std::cout, options, summary, methods);
+        if (!options.json_path.empty()) {
+            if (options.json_path == "-") {
+                write_json(std::cout, options, summary, methods);
+            } else {
+                std::ofstream out(options.json_path);
+                if (!out) {
+                    throw std::runtime_error("Cannot open JSON output file: " + options.json_path);
+                }
+                write_json(out, options, summary, methods);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "rpc_bench error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "rpc_server_wrapper.h"
+#include "rpc_utils.h"
+
+// rpc_bench 配套的回显/接收服务器
+
+namespace {
+
+rpc_utils::RPCServerWrapper* g_server = nullptr;
+
+void signal_handler(int signal) {
+    if ((signal == SIGINT || signal == SIGTERM) && g_server) {
+        g_server->stop();
+    }
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [OPTIONS]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --port=<port>        Listen port (default 8080)\n"
+              << "  --threads=<n>        Worker threads (default 1)\n"
+              << "  --stats              Enable per-method stats (queryable via __stats)\n"
+              << "  --limit              Enable the adaptive concurrency limit\n"
+              << "  --work-us=<n>        Occupy the handler thread for n us per request (default 0)\n"
+              << "  --reactors=<n>       Serve --port with n SO_REUSEPORT event loops pinned to CPUs\n"
+              << "                       instead of rpclib (0 = one per CPU)\n"
+              << "  -h, --help           Show this help message\n";
+}
+
+/**
+ * @brief 模拟处理耗时，使少量线程即可被压满
+ */
+void simulate_work(int64_t work_us) {
+    if (work_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(work_us));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint16_t port = 8080;
+    size_t threads = 1;
+    bool stats = false;
+    bool limit = false;
+    int64_t work_us = 0;
+    bool reactors = false;
+    size_t reactor_threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--port=") == 0) {
+            port = static_cast<uint16_t>(std::stoi(arg.substr(7)));
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            threads = static_cast<size_t>(std::stoul(arg.substr(10)));
+        } else if (arg.compare(0, 11, "--reactors=") == 0) {
+            reactors = true;
+            reactor_threads = static_cast<size_t>(std::stoul(arg.substr(11)));
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--limit") {
+            limit = true;
+        } else if (arg.compare(0, 10, "--work-us=") == 0) {
+            work_us = std::stoll(arg.substr(10));
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::WARNING);
+
+    try {
+        // 多事件循环模式下由事件循环监听--port，rpclib端口由系统分配
+        rpc_utils::RPCServerWrapper server(reactors ? 0 : port);
+        g_server = &server;
+        if (stats) {
+            server.enable_stats();
+        }
+        if (limit) {
+            server.enable_concurrency_limit();
+        }
+
+        server.bind("noop", [work_us]() {
+            simulate_work(work_us);
+            return 0;
+        });
+        server.bind("echo", [work_us](const std::string& payload) {
+            simulate_work(work_us);
+            return payload;
+        });
+        server.bind("sink", [work_us](const std::string& payload) {
+            simulate_work(work_us);
+            return payload.size();
+        });
+        server.bind("add", [work_us](double a, double b) {
+            simulate_work(work_us);
+            return a + b;
+        });
+
+        if (reactors) {
+            rpc_utils::ReactorOptions options;
+            options.threads = reactor_threads;
+            server.listen_reactors("", port, options);
+            std::cout << "rpc_bench_server listening on port " << server.reactor_port()
+                      << " with " << server.reactor_stats().size() << " event loop(s)" << std::endl;
+        } else {
+            std::cout << "rpc_bench_server listening on port " << server.port()
+                      << " with " << threads << " thread(s)" << std::endl;
+        }
+
+        if (threads <= 1) {
+            server.run();
+        } else {
+            server.async_run(threads);
+            while (server.is_running()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Server error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
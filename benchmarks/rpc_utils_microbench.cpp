@@ -0,0 +1,629 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <memory>
+#include <future>
+#include <stdexcept>
+#include <atomic>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include "rpc/client.h"
+#include "rpc_client_wrapper.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_utils.h"
+
+// rpc_utils_microbench：逐项测量封装层各部分开销的进程内微基准
+//
+// 覆盖：回环服务器上的封装调用开销、不同参数形态的msgpack编解码、
+// LZ4负载压缩、缓冲区与内存区池、Logger在级别开启/关闭时的吞吐、RPCUtils校验函数。
+// 每项同时统计平均每次操作的堆分配次数（含服务器线程），以及rpc_utils自己实现的传输
+// （unix://、shm://）上平均每次操作的系统调用数。
+// 结果可输出为JSON，并与之前保存的基线JSON对比。
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 进程内的堆分配次数；glibc下替换malloc族函数计数，operator new与msgpack内存区都经过这里
+std::atomic<uint64_t> g_allocations(0);
+
+#if defined(__GLIBC__)
+const bool kCountsAllocations = true;
+#else
+const bool kCountsAllocations = false;
+#endif
+
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief 单项基准：body执行iterations次
+ */
+struct Benchmark {
+    std::string name;
+    std::function<void(size_t iterations)> body;
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double syscalls_per_op;     // 只统计rpc_utils自己的传输，rpclib的TCP连接不计
+};
+
+/**
+ * @brief 自适应迭代次数，直到单轮运行时间达到min_time
+ */
+BenchResult run_benchmark(const Benchmark& bench, double min_time_sec) {
+    size_t iterations = 1;
+    while (true) {
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        uint64_t syscalls = rpc_utils::io_stats().syscalls();
+        auto start = Clock::now();
+        bench.body(iterations);
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+        syscalls = rpc_utils::io_stats().syscalls() - syscalls;
+        if (elapsed >= min_time_sec || iterations >= (size_t(1) << 30)) {
+            return {bench.name, iterations, elapsed * 1e9 / static_cast<double>(iterations),
+                    static_cast<double>(allocations) / static_cast<double>(iterations),
+                    static_cast<double>(syscalls) / static_cast<double>(iterations)};
+        }
+        double scale = elapsed > 0 ? min_time_sec * 1.2 / elapsed : 100.0;
+        iterations = static_cast<size_t>(static_cast<double>(iterations) *
+                                         std::min(100.0, std::max(2.0, scale)));
+    }
+}
+
+/**
+ * @brief 临时把标准输出重定向到/dev/null，用于测量日志吞吐
+ */
+class StdoutSilencer {
+public:
+    StdoutSilencer() {
+        std::fflush(stdout);
+        std::cout.flush();
+        saved_ = dup(STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    ~StdoutSilencer() {
+        rpc_utils::Logger::flush();
+        std::fflush(stdout);
+        std::cout.flush();
+        dup2(saved_, STDOUT_FILENO);
+        close(saved_);
+    }
+
+private:
+    int saved_;
+};
+
+/**
+ * @brief 生成约size字节、形如JSON报表的可压缩文本
+ */
+std::string make_report(size_t size) {
+    std::string report = "[";
+    for (size_t i = 0; report.size() < size; ++i) {
+        report += "{\"id\":" + std::to_string(i) + ",\"name\":\"user_" + std::to_string(i % 97) +
+                  "\",\"active\":" + (i % 3 != 0 ? "true" : "false") +
+                  ",\"score\":" + std::to_string((i * 7919) % 1000) + "},";
+    }
+    report.back() = ']';
+    return report;
+}
+
+// msgpack 编解码基准
+template<typename T>
+void add_codec_benchmarks(std::vector<Benchmark>& benches, const std::string& shape, T value) {
+    benches.push_back({"msgpack/encode/" + shape, [value](size_t n) {
+        RPCLIB_MSGPACK::sbuffer buffer;
+        for (size_t i = 0; i < n; ++i) {
+            buffer.clear();
+            RPCLIB_MSGPACK::pack(buffer, value);
+            do_not_optimize(buffer.data());
+        }
+    }});
+
+    auto encoded = std::make_shared<RPCLIB_MSGPACK::sbuffer>();
+    RPCLIB_MSGPACK::pack(*encoded, value);
+    benches.push_back({"msgpack/decode/" + shape, [encoded](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            RPCLIB_MSGPACK::object_handle handle =
+                RPCLIB_MSGPACK::unpack(encoded->data(), encoded->size());
+            T decoded = handle.get().as<T>();
+            do_not_optimize(decoded);
+        }
+    }});
+}
+
+void add_wrapper_benchmarks(std::vector<Benchmark>& benches, uint16_t port) {
+    auto raw = std::make_shared<rpc::client>("127.0.0.1", port);
+    auto wrapper = std::make_shared<rpc_utils::RPCClientWrapper>("127.0.0.1", port);
+    auto name = std::make_shared<std::string>("noop");
+
+    benches.push_back({"call/rpclib_client/noop", [raw](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(raw->call("noop").as<int>());
+        }
+    }});
+    benches.push_back({"call/wrapper/noop_literal", [wrapper](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(wrapper->call<int>("noop"));
+        }
+    }});
+    benches.push_back({"call/wrapper/noop_string", [wrapper, name](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(wrapper->call<int>(*name));
+        }
+    }});
+    benches.push_back({"call/wrapper/add", [wrapper](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(wrapper->call<double>("add", 1.5, 2.5));
+        }
+    }});
+    benches.push_back({"call/wrapper/error_path", [wrapper](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            try {
+                wrapper->call<int>("fail");
+            } catch (const std::exception& e) {
+                do_not_optimize(e.what());
+            }
+        }
+    }});
+    auto compressed = std::make_shared<rpc_utils::RPCClientWrapper>("127.0.0.1", port);
+    compressed->enable_compression();
+    benches.push_back({"call/wrapper/report_256k", [wrapper](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(wrapper->call<std::string>("report"));
+        }
+    }});
+    benches.push_back({"call/wrapper/report_256k_lz4", [compressed](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(compressed->call<std::string>("report"));
+        }
+    }});
+    benches.push_back({"call/wrapper/async_x16", [wrapper](size_t n) {
+        std::vector<std::future<RPCLIB_MSGPACK::object_handle>> futures;
+        futures.reserve(16);
+        for (size_t i = 0; i < n; i += 16) {
+            futures.clear();
+            for (size_t j = 0; j < 16; ++j) {
+                futures.push_back(wrapper->async_call("noop"));
+            }
+            for (auto& future : futures) {
+                do_not_optimize(future.get().as<int>());
+            }
+        }
+    }});
+}
+
+// 同主机传输的往返基准，与 call/wrapper/* 对照
+void add_local_benchmarks(std::vector<Benchmark>& benches, const std::vector<std::string>& endpoints) {
+    for (const auto& endpoint : endpoints) {
+        std::string scheme = endpoint.substr(0, endpoint.find(':'));
+        auto client = std::make_shared<rpc_utils::RPCClientWrapper>(endpoint);
+        benches.push_back({"call/" + scheme + "/noop", [client](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                do_not_optimize(client->call<int>("noop"));
+            }
+        }});
+        benches.push_back({"call/" + scheme + "/add", [client](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                do_not_optimize(client->call<double>("add", 1.5, 2.5));
+            }
+        }});
+        auto add_stub = std::make_shared<rpc_utils::RPCStub<double(double, double)>>(
+            client->stub<double(double, double)>("add"));
+        benches.push_back({"call/" + scheme + "/add_stub", [add_stub](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                do_not_optimize((*add_stub)(1.5, 2.5));
+            }
+        }});
+        benches.push_back({"call/" + scheme + "/report_256k", [client](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                do_not_optimize(client->call<std::string>("report"));
+            }
+        }});
+    }
+}
+
+// 写合并：每轮连续发起16个异步调用再取结果，对照未启用写合并的端点（每次操作为一个调用）
+void add_coalescing_benchmarks(std::vector<Benchmark>& benches, const std::string& plain_endpoint,
+                               const std::string& coalesced_endpoint) {
+    auto plain = std::make_shared<rpc_utils::RPCClientWrapper>(plain_endpoint);
+    auto coalesced = std::make_shared<rpc_utils::RPCClientWrapper>(coalesced_endpoint);
+    rpc_utils::CoalesceOptions options;
+    options.enabled = true;
+    coalesced->set_write_coalescing(options);
+    auto burst = [](std::shared_ptr<rpc_utils::RPCClientWrapper> client) {
+        return [client](size_t n) {
+            std::vector<std::future<RPCLIB_MSGPACK::object_handle>> futures;
+            futures.reserve(16);
+            for (size_t i = 0; i < n; i += 16) {
+                futures.clear();
+                for (size_t j = 0; j < 16; ++j) {
+                    futures.push_back(client->async_call("add", 1.5, 2.5));
+                }
+                for (auto& future : futures) {
+                    do_not_optimize(future.get().as<double>());
+                }
+            }
+        };
+    };
+    benches.push_back({"coalesce/unix/add_async_x16/off", burst(plain)});
+    benches.push_back({"coalesce/unix/add_async_x16/on", burst(coalesced)});
+}
+
+// LZ4 压缩基准（每次处理 256KB 文本）
+void add_compression_benchmarks(std::vector<Benchmark>& benches) {
+    auto input = std::make_shared<std::string>(make_report(256 * 1024));
+    auto output = std::make_shared<std::vector<char>>(
+        rpc_utils::detail::lz4_compress_bound(input->size()));
+    size_t compressed_size = rpc_utils::detail::lz4_compress(
+        input->data(), input->size(), output->data(), 1);
+    output->resize(compressed_size);
+
+    for (int acceleration : {1, 4}) {
+        benches.push_back({"lz4/compress/json_256k/accel_" + std::to_string(acceleration),
+                           [input, acceleration](size_t n) {
+            std::vector<char> buffer(rpc_utils::detail::lz4_compress_bound(input->size()));
+            for (size_t i = 0; i < n; ++i) {
+                do_not_optimize(rpc_utils::detail::lz4_compress(
+                    input->data(), input->size(), buffer.data(), acceleration));
+            }
+        }});
+    }
+    benches.push_back({"lz4/decompress/json_256k", [input, output](size_t n) {
+        std::vector<char> buffer(input->size());
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::detail::lz4_decompress(output->data(), output->size(),
+                                              buffer.data(), buffer.size());
+            do_not_optimize(buffer.data());
+        }
+    }});
+}
+
+// 缓冲区与内存区池基准，与直接分配对照
+void add_pool_benchmarks(std::vector<Benchmark>& benches) {
+    benches.push_back({"pool/zone/new_delete", [](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            auto zone = std::make_unique<RPCLIB_MSGPACK::zone>();
+            do_not_optimize(zone->allocate_align(64));
+        }
+    }});
+    benches.push_back({"pool/zone/acquire_recycle", [](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::detail::PooledZone zone;
+            do_not_optimize(zone->allocate_align(64));
+        }
+    }});
+    benches.push_back({"pool/buffer/sbuffer_256", [](size_t n) {
+        const std::string payload(256, 'x');
+        for (size_t i = 0; i < n; ++i) {
+            RPCLIB_MSGPACK::sbuffer buffer;
+            RPCLIB_MSGPACK::pack(buffer, payload);
+            do_not_optimize(buffer.data());
+        }
+    }});
+    benches.push_back({"pool/buffer/scratch_256", [](size_t n) {
+        const std::string payload(256, 'x');
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::detail::ScratchBuffer buffer;
+            RPCLIB_MSGPACK::pack(buffer, payload);
+            do_not_optimize(buffer.data());
+        }
+    }});
+
+    auto encoded = std::make_shared<RPCLIB_MSGPACK::sbuffer>();
+    RPCLIB_MSGPACK::pack(*encoded, std::make_tuple(1.5, 2.5));
+    benches.push_back({"pool/unpack/double_pair", [encoded](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(rpc_utils::detail::take_result<std::tuple<double, double>>(
+                rpc_utils::detail::pooled_unpack(encoded->data(), encoded->size())));
+        }
+    }});
+}
+
+void add_logger_benchmarks(std::vector<Benchmark>& benches) {
+    const double a = 1.5;
+    const double b = 2.5;
+
+    benches.push_back({"logger/filtered/debug_concat", [a, b](size_t n) {
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::INFO);
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::Logger::debug("add(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+        }
+    }});
+    benches.push_back({"logger/filtered/debugf", [a, b](size_t n) {
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::INFO);
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::Logger::debugf("add(%f, %f)", a, b);
+        }
+    }});
+    benches.push_back({"logger/filtered/macro", [a, b](size_t n) {
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::INFO);
+        for (size_t i = 0; i < n; ++i) {
+            RPC_LOG_DEBUG("add(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+        }
+    }});
+    benches.push_back({"logger/enabled/sync_info", [](size_t n) {
+        StdoutSilencer silence;
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::INFO);
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::Logger::info("request handled");
+        }
+    }});
+    benches.push_back({"logger/enabled/async_infof", [a, b](size_t n) {
+        StdoutSilencer silence;
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::INFO);
+        rpc_utils::Logger::set_log_mode(rpc_utils::LogMode::ASYNC);
+        for (size_t i = 0; i < n; ++i) {
+            rpc_utils::Logger::infof("add(%f, %f)", a, b);
+        }
+        rpc_utils::Logger::set_log_mode(rpc_utils::LogMode::SYNC);
+    }});
+}
+
+void add_utils_benchmarks(std::vector<Benchmark>& benches) {
+    benches.push_back({"utils/is_valid_host/ipv4", [](size_t n) {
+        const std::string host = "192.168.100.200";
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(rpc_utils::RPCUtils::is_valid_host(host));
+        }
+    }});
+    benches.push_back({"utils/is_valid_host/hostname", [](size_t n) {
+        const std::string host = "rpc-backend-01.internal.example.com";
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(rpc_utils::RPCUtils::is_valid_host(host));
+        }
+    }});
+    benches.push_back({"utils/is_valid_port", [](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(rpc_utils::RPCUtils::is_valid_port(static_cast<uint16_t>(i)));
+        }
+    }});
+    benches.push_back({"utils/format_error", [](size_t n) {
+        const std::string func = "add";
+        const std::string error = "Division by zero";
+        for (size_t i = 0; i < n; ++i) {
+            do_not_optimize(rpc_utils::RPCUtils::format_error(func, error));
+        }
+    }});
+}
+
+void write_json(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << std::fixed << std::setprecision(2);
+    out << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << results[i].name << "\", \"iterations\": "
+            << results[i].iterations << ", \"ns_per_op\": " << results[i].ns_per_op;
+        if (kCountsAllocations) {
+            out << ", \"allocs_per_op\": " << results[i].allocs_per_op;
+        }
+        out << ", \"syscalls_per_op\": " << results[i].syscalls_per_op;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ * @brief 读取本程序写出的基线JSON，返回 name -> ns_per_op
+ */
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open baseline file: " + path);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    const std::string name_key = "\"name\": \"";
+    const std::string ns_key = "\"ns_per_op\": ";
+    while (std::getline(in, line)) {
+        size_t name_pos = line.find(name_key);
+        size_t ns_pos = line.find(ns_key);
+        if (name_pos == std::string::npos || ns_pos == std::string::npos) {
+            continue;
+        }
+        name_pos += name_key.size();
+        std::string name = line.substr(name_pos, line.find('"', name_pos) - name_pos);
+        baseline[name] = std::stod(line.substr(ns_pos + ns_key.size()));
+    }
+    return baseline;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [OPTIONS]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --filter=<substr>      Only run benchmarks whose name contains substr\n"
+              << "  --min-time=<sec>       Minimum time per benchmark (default 0.5)\n"
+              << "  --json=<file>          Write results as JSON ('-' for stdout)\n"
+              << "  --baseline=<file>      Compare against a JSON file written by --json\n"
+              << "  --no-network           Skip loopback call benchmarks\n"
+              << "  -h, --help             Show this help message\n";
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// 转发给glibc的实现；free不计数
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string json_path;
+    std::string baseline_path;
+    double min_time = 0.5;
+    bool network = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            filter = arg.substr(9);
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            min_time = std::stod(arg.substr(11));
+        } else if (arg.compare(0, 7, "--json=") == 0) {
+            json_path = arg.substr(7);
+        } else if (arg.compare(0, 11, "--baseline=") == 0) {
+            baseline_path = arg.substr(11);
+        } else if (arg == "--no-network") {
+            network = false;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::WARNING);
+
+        // 回环服务器（端口0表示由系统分配）
+        std::unique_ptr<rpc_utils::RPCServerWrapper> server;
+        std::vector<Benchmark> benches;
+        if (network) {
+            server = std::make_unique<rpc_utils::RPCServerWrapper>("127.0.0.1", 0);
+            server->bind("noop", []() { return 0; });
+            server->bind("add", [](double a, double b) { return a + b; });
+            server->bind("fail", []() -> int { throw std::runtime_error("expected failure"); });
+            auto report = std::make_shared<std::string>(make_report(256 * 1024));
+            server->bind("report", [report]() { return rpc_utils::BinaryView(*report); });
+            std::string suffix = "rpc_utils_microbench." + std::to_string(::getpid());
+            std::vector<std::string> local_endpoints = {
+                "unix:///tmp/" + suffix + ".sock", "shm://" + suffix};
+            for (const auto& endpoint : local_endpoints) {
+                server->listen(endpoint);
+            }
+            std::string coalesced_endpoint = "unix:///tmp/" + suffix + ".coalesced.sock";
+            rpc_utils::CoalesceOptions coalesce;
+            coalesce.enabled = true;
+            server->set_write_coalescing(coalesce);
+            server->listen(coalesced_endpoint);
+            server->async_run(1);
+            add_wrapper_benchmarks(benches, server->port());
+            add_local_benchmarks(benches, local_endpoints);
+            add_coalescing_benchmarks(benches, local_endpoints[0], coalesced_endpoint);
+        }
+
+        add_codec_benchmarks(benches, "int", 42);
+        add_codec_benchmarks(benches, "double_pair", std::make_tuple(1.5, 2.5));
+        add_codec_benchmarks(benches, "string_16", std::string(16, 'x'));
+        add_codec_benchmarks(benches, "string_1k", std::string(1024, 'x'));
+        add_codec_benchmarks(benches, "string_64k", std::string(64 * 1024, 'x'));
+        add_codec_benchmarks(benches, "binary_64k",
+                             rpc_utils::Blob(std::vector<char>(64 * 1024, 'x')).view());
+        add_codec_benchmarks(benches, "vector_int_1k", std::vector<int>(1024, 7));
+        {
+            std::map<std::string, int> small_map;
+            for (int i = 0; i < 16; ++i) {
+                small_map["key_" + std::to_string(i)] = i;
+            }
+            add_codec_benchmarks(benches, "map_16", small_map);
+        }
+        add_compression_benchmarks(benches);
+        add_pool_benchmarks(benches);
+        add_logger_benchmarks(benches);
+        add_utils_benchmarks(benches);
+
+        std::map<std::string, double> baseline;
+        if (!baseline_path.empty()) {
+            baseline = read_baseline(baseline_path);
+        }
+
+        std::vector<BenchResult> results;
+        std::cout << std::left << std::setw(36) << "benchmark" << std::right
+                  << std::setw(14) << "ns/op" << std::setw(14) << "iterations"
+                  << std::setw(12) << "allocs/op" << std::setw(12) << "syscalls/op"
+                  << (baseline.empty() ? "" : "      vs baseline") << "\n";
+        for (const auto& bench : benches) {
+            if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            BenchResult result = run_benchmark(bench, min_time);
+            results.push_back(result);
+
+            std::cout << std::left << std::setw(36) << result.name << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(14) << result.ns_per_op
+                      << std::setw(14) << result.iterations;
+            if (kCountsAllocations) {
+                std::cout << std::setprecision(2) << std::setw(12) << result.allocs_per_op
+                          << std::setprecision(1);
+            } else {
+                std::cout << std::setw(12) << "n/a";
+            }
+            std::cout << std::setprecision(2) << std::setw(12) << result.syscalls_per_op << std::setprecision(1);
+            auto it = baseline.find(result.name);
+            if (it != baseline.end() && it->second > 0) {
+                double delta = (result.ns_per_op - it->second) / it->second * 100.0;
+                std::cout << std::setw(12) << std::showpos << delta << "%" << std::noshowpos;
+            }
+            std::cout << std::endl;
+        }
+
+        rpc_utils::PoolStats pool = rpc_utils::pool_stats();
+        std::cout << "\npool hit rate: buffers " << std::setprecision(1)
+                  << pool.buffer_hit_rate() * 100.0 << "%, zones "
+                  << pool.zone_hit_rate() * 100.0 << "%" << std::endl;
+
+        if (server) {
+            server->stop();
+        }
+
+        if (!json_path.empty()) {
+            if (json_path == "-") {
+                write_json(std::cout, results);
+            } else {
+                std::ofstream out(json_path);
+                if (!out) {
+                    throw std::runtime_error("Cannot open JSON output file: " + json_path);
+                }
+                write_json(out, results);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "rpc_utils_microbench error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -194,6 +194,12 @@ print_info "    * librpc_utils_server.a"
 print_info "  - Examples:"
 print_info "    * example_server"
 print_info "    * example_client"
+print_info "  - Benchmarks:"
+print_info "    * rpc_bench"
+print_info "    * rpc_bench_server"
+print_info "    * rpc_utils_microbench"
+print_info "  - Tests (run with ctest):"
+print_info "    * test_*"
 print_info ""
 print_info "To run the examples:"
 print_info "  1. Start server: ./example_server"
@@ -1,5 +1,9 @@
 #include <iostream>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <mutex>
 #include "rpc_client_wrapper.h"
 #include "rpc_utils.h"
 
@@ -92,6 +96,53 @@ int main(int argc, char* argv[]) {
         rpc_utils::Logger::info("  All async calls took " + 
                                 std::to_string(timer.elapsed_ms()) + " ms total");
 
+        // 回调形式：调用线程不阻塞等待，响应到达后在客户端的完成线程上执行回调
+        timer.reset();
+        const int callback_calls = 100;
+        std::atomic<int> remaining(callback_calls);
+        std::mutex sum_mutex;
+        double callback_sum = 0;
+        std::promise<void> all_done;
+        for (int i = 1; i <= callback_calls; ++i) {
+            client.async_call("square", static_cast<double>(i),
+                [&](RPCLIB_MSGPACK::object_handle result, std::exception_ptr error) {
+                    if (!error) {
+                        std::lock_guard<std::mutex> lock(sum_mutex);
+                        callback_sum += result.get().as<double>();
+                    }
+                    if (--remaining == 0) {
+                        all_done.set_value();
+                    }
+                });
+        }
+        all_done.get_future().wait();
+        rpc_utils::Logger::info("  sum of square(1..100) via callbacks = " + std::to_string(callback_sum));
+        rpc_utils::Logger::info("  " + std::to_string(callback_calls) + " callback calls took " +
+                                std::to_string(timer.elapsed_ms()) + " ms total");
+
+        print_separator();
+
+        // 测试批量调用
+        rpc_utils::Logger::info("Testing batch calls:");
+
+        timer.reset();
+        rpc_utils::RPCBatch batch;
+        for (int i = 1; i <= 100; ++i) {
+            batch.add("square", static_cast<double>(i));
+        }
+        batch.add("divide", 1.0, 0.0);
+        rpc_utils::BatchResults batch_results = client.call_batch(batch);
+
+        double sum_of_squares = 0;
+        for (size_t i = 0; i + 1 < batch_results.size(); ++i) {
+            sum_of_squares += batch_results.get<double>(i);
+        }
+        rpc_utils::Logger::info("  sum of square(1..100) = " + std::to_string(sum_of_squares));
+        rpc_utils::Logger::info("  divide(1.0, 0.0) ok = " +
+                                std::string(batch_results.ok(100) ? "true" : "false"));
+        rpc_utils::Logger::info("  " + std::to_string(batch.size()) + " batched calls took " +
+                                std::to_string(timer.elapsed_ms()) + " ms total");
+
         print_separator();
 
         // 测试通知（无返回值）
@@ -101,6 +152,43 @@ int main(int argc, char* argv[]) {
 
         print_separator();
 
+        // 测试二进制数据（发送时借用本地缓冲区，接收时视图持有读缓冲区）
+        rpc_utils::Logger::info("Testing binary payloads:");
+        std::vector<char> payload(4 * 1024 * 1024, 1);
+        uint64_t checksum = client.call<uint64_t>("checksum", rpc_utils::BinaryView(payload));
+        rpc_utils::Logger::info("checksum(4 MiB) = " + std::to_string(checksum));
+        rpc_utils::BinaryView blob = client.call<rpc_utils::BinaryView>("make_blob", 1024 * 1024);
+        rpc_utils::Logger::info("make_blob(1 MiB) returned " + std::to_string(blob.size()) + " bytes");
+
+        print_separator();
+
+        // 测试结果缓存：第二次调用命中服务端缓存
+        rpc_utils::Logger::info("Testing cached function:");
+        for (int attempt = 1; attempt <= 2; ++attempt) {
+            rpc_utils::Timer timer;
+            uint64_t fib = client.call<uint64_t>("fibonacci", 32);
+            rpc_utils::Logger::info("fibonacci(32) = " + std::to_string(fib) + " (attempt " +
+                                    std::to_string(attempt) + ", " +
+                                    std::to_string(timer.elapsed_ms()) + " ms)");
+        }
+
+        print_separator();
+
+        // 测试流式调用
+        rpc_utils::Logger::info("Testing streaming:");
+        long long stream_total = 0;
+        for (int value : client.open_stream<int>("range", 10000)) {
+            stream_total += value;
+        }
+        rpc_utils::Logger::info("range(10000) summed to " + std::to_string(stream_total));
+        auto upload = client.open_client_stream("sum_stream");
+        for (int i = 1; i <= 1000; ++i) {
+            upload.write(static_cast<double>(i));
+        }
+        rpc_utils::Logger::info("sum_stream(1..1000) = " + std::to_string(upload.finish<double>()));
+
+        print_separator();
+
         // 测试错误处理
         rpc_utils::Logger::info("Testing error handling:");
         try {
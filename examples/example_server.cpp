@@ -21,22 +21,22 @@ void signal_handler(int signal) {
 
 // 示例：简单的算术运算函数
 double add(double a, double b) {
-    rpc_utils::Logger::debug("add(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+    rpc_utils::Logger::debugf("add(%f, %f)", a, b);
     return a + b;
 }
 
 double subtract(double a, double b) {
-    rpc_utils::Logger::debug("subtract(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+    rpc_utils::Logger::debugf("subtract(%f, %f)", a, b);
     return a - b;
 }
 
 double multiply(double a, double b) {
-    rpc_utils::Logger::debug("multiply(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+    rpc_utils::Logger::debugf("multiply(%f, %f)", a, b);
     return a * b;
 }
 
 double divide(double a, double b) {
-    rpc_utils::Logger::debug("divide(" + std::to_string(a) + ", " + std::to_string(b) + ")");
+    rpc_utils::Logger::debugf("divide(%f, %f)", a, b);
     if (b == 0.0) {
         rpc::this_handler().respond_error(
             std::make_tuple(1, "Division by zero"));
@@ -46,13 +46,18 @@ double divide(double a, double b) {
 
 // 示例：返回字符串的函数
 std::string greet(const std::string& name) {
-    rpc_utils::Logger::debug("greet(" + name + ")");
+    rpc_utils::Logger::debugf("greet(%s)", name.c_str());
     return "Hello, " + name + "!";
 }
 
 // 示例：无返回值的函数
+// 故意使用指数复杂度的递归，用于演示结果缓存
+uint64_t fibonacci(int n) {
+    return n < 2 ? static_cast<uint64_t>(n) : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
 void log_message(const std::string& message) {
-    rpc_utils::Logger::info("Received message: " + message);
+    RPC_LOG_INFO("Received message: " + message);
 }
 
 int main(int argc, char* argv[]) {
@@ -60,8 +65,9 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
-    // 设置日志级别
+    // 设置日志级别，处理函数中的日志交由后台线程批量输出
     rpc_utils::Logger::set_log_level(rpc_utils::LogLevel::DEBUG);
+    rpc_utils::Logger::set_log_mode(rpc_utils::LogMode::ASYNC);
 
     try {
         // 创建服务器
@@ -74,6 +80,9 @@ int main(int argc, char* argv[]) {
         rpc_utils::RPCServerWrapper server(port);
         g_server = &server;
 
+        // 启用按方法的调用统计，可通过 "__stats" 远程查询
+        server.enable_stats();
+
         // 绑定算术运算函数
         server.bind("add", &add);
         server.bind("subtract", &subtract);
@@ -88,10 +97,42 @@ int main(int argc, char* argv[]) {
 
         // 绑定lambda函数
         server.bind("square", [](double x) -> double {
-            rpc_utils::Logger::debug("square(" + std::to_string(x) + ")");
+            rpc_utils::Logger::debugf("square(%f)", x);
             return x * x;
         });
 
+        // 二进制数据：参数直接引用请求缓冲区，返回的Blob不复制进响应对象
+        server.bind("checksum", [](const rpc_utils::BinaryView& data) -> uint64_t {
+            uint64_t sum = 0;
+            for (char byte : data) {
+                sum += static_cast<unsigned char>(byte);
+            }
+            return sum;
+        });
+        server.bind("make_blob", [](uint32_t size) {
+            return rpc_utils::Blob(std::vector<char>(size, 'x'));
+        });
+
+        // 流式方法：逐个发送/接收元素，窗口额度限制未被取走的数据量
+        server.bind_stream("range", [](rpc_utils::StreamWriter<int>& out, int count) {
+            for (int i = 0; i < count; ++i) {
+                if (!out.write(i)) {
+                    return;  // 客户端已取消
+                }
+            }
+        });
+        server.bind_client_stream("sum_stream", [](rpc_utils::StreamReader<double>& in) {
+            double sum = 0.0;
+            double value = 0.0;
+            while (in.next(value)) {
+                sum += value;
+            }
+            return sum;
+        });
+
+        // 纯函数：相同参数的重复请求直接返回缓存结果
+        server.bind_cached("fibonacci", &fibonacci, 1024, std::chrono::minutes(10));
+
         // 绑定用于停止服务器的函数
         server.bind("shutdown", [&server]() {
             rpc_utils::Logger::info("Shutdown requested via RPC");
@@ -109,16 +150,25 @@ int main(int argc, char* argv[]) {
         rpc_utils::Logger::info("  - greet(string) -> string");
         rpc_utils::Logger::info("  - log_message(string) -> void");
         rpc_utils::Logger::info("  - square(double) -> double");
+        rpc_utils::Logger::info("  - checksum(bin) -> uint64");
+        rpc_utils::Logger::info("  - make_blob(uint32) -> bin");
+        rpc_utils::Logger::info("  - fibonacci(int) -> uint64 (cached)");
+        rpc_utils::Logger::info("  - range(int) -> stream<int>");
+        rpc_utils::Logger::info("  - sum_stream(stream<double>) -> double");
         rpc_utils::Logger::info("  - shutdown() -> void");
+        rpc_utils::Logger::info("  - __stats() -> map<string, MethodStatsSnapshot>");
+        rpc_utils::Logger::info("  - __cache_stats() -> map<string, CacheStats>");
         rpc_utils::Logger::info("Press Ctrl+C to stop the server");
 
         // 运行服务器（阻塞调用）
         server.run();
 
         rpc_utils::Logger::info("Server stopped");
+        rpc_utils::Logger::flush();
 
     } catch (const std::exception& e) {
         rpc_utils::Logger::error("Server error: " + std::string(e.what()));
+        rpc_utils::Logger::flush();
         return 1;
     }
 
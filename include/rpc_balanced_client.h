@@ -0,0 +1,359 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <exception>
+#include "rpc/client.h"
+#include "rpc/rpc_error.h"
+#include "rpc_binary.h"
+#include "rpc_completion.h"
+#include "rpc_errors.h"
+#include "rpc_hedge.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 服务端点
+ */
+struct Endpoint {
+    std::string host;
+    uint16_t port = 0;
+
+    Endpoint() = default;
+    Endpoint(std::string h, uint16_t p) : host(std::move(h)), port(p) {}
+
+    /**
+     * @brief 解析"host:port"格式的端点
+     * @param address 端点字符串
+     * @return 端点
+     * @throws std::runtime_error 格式错误时抛出异常
+     */
+    static Endpoint parse(const std::string& address);
+
+    /**
+     * @brief 格式化为"host:port"
+     */
+    std::string to_string() const { return host + ":" + std::to_string(port); }
+};
+
+/**
+ * @brief 单个端点的负载与健康状态
+ */
+struct EndpointStats {
+    Endpoint endpoint;
+    bool healthy = false;
+    size_t in_flight = 0;
+    double ewma_latency_us = 0;
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    uint64_t reconnects = 0;
+};
+
+/**
+ * @brief 多端点负载均衡客户端
+ *
+ * 对每个端点维持一条连接。每次调用随机取两个健康端点，选择
+ * (在途请求数 + 1) × 延迟EWMA 较小的一个（power-of-two-choices），
+ * 使负载随各副本的实际处理能力分配。连接断开的端点退出轮转，
+ * 并按指数退避重新建连。服务器正在停止（drain）时，该端点重新建连，
+ * 被拒绝的同步调用改用新连接重发一次。可被多个线程安全共享。
+ */
+class RPCBalancedClient {
+public:
+    /**
+     * @brief 构造函数
+     * @param endpoints 端点列表
+     * @param timeout_ms 超时时间（毫秒），默认5000ms
+     * @throws std::runtime_error 端点列表为空或创建连接失败时抛出异常
+     */
+    explicit RPCBalancedClient(const std::vector<Endpoint>& endpoints, int64_t timeout_ms = 5000);
+
+    /**
+     * @brief 析构函数
+     */
+    ~RPCBalancedClient();
+
+    // 禁用拷贝
+    RPCBalancedClient(const RPCBalancedClient&) = delete;
+    RPCBalancedClient& operator=(const RPCBalancedClient&) = delete;
+
+    /**
+     * @brief 同步调用RPC函数（线程安全）
+     * @tparam R 返回值类型
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     * @return 函数返回值
+     * @throws OverloadedError 服务器过载、请求被拒绝时抛出异常
+     * @throws std::runtime_error 调用失败时抛出异常
+     */
+    template<typename R, typename... Args>
+    R call(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 异步调用RPC函数（线程安全）
+     *
+     * 请求会立即发出，响应由客户端的完成线程取出后放入返回的future，可以用wait_for轮询。
+     * 响应到达（或超时）时归还所选端点的在途计数并计入其延迟EWMA，与调用方是否取走结果无关。
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     * @return std::future对象，用于获取异步结果；调用失败时get()抛出
+     *         OverloadedError、DeadlineExceededError或std::runtime_error
+     */
+    template<typename... Args>
+    auto async_call(const std::string& func_name, Args&&... args)
+        -> std::future<RPCLIB_MSGPACK::object_handle>;
+
+    /**
+     * @brief 发送通知（不等待返回值）
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     */
+    template<typename... Args>
+    void send_notification(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 设置对冲策略
+     *
+     * 对策略中标记为幂等的方法，同步调用在对冲延迟内未返回时会向另一个端点再发送一次，
+     * 取先到的响应。端点数不少于2时生效；须在开始调用之前设置。
+     * @param policy 对冲策略，nullptr表示关闭对冲
+     */
+    void set_hedge_policy(std::shared_ptr<HedgePolicy> policy);
+
+    /**
+     * @brief 设置所有连接的超时时间
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void set_timeout(int64_t timeout_ms);
+
+    /**
+     * @brief 清除所有连接的超时设置
+     */
+    void clear_timeout();
+
+    /**
+     * @brief 获取端点数
+     * @return 端点数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 获取当前健康（已连接）的端点数
+     * @return 健康端点数
+     */
+    size_t healthy_count() const;
+
+    /**
+     * @brief 获取各端点的负载与健康状态
+     * @return 按构造顺序排列的端点状态
+     */
+    std::vector<EndpointStats> endpoint_stats() const;
+
+    /**
+     * @brief 等待所有连接上的异步响应完成
+     */
+    void wait_all_responses();
+
+private:
+    struct Replica {
+        Endpoint endpoint;
+        std::shared_ptr<rpc::client> client;    // 通过std::atomic_load/atomic_store访问
+        std::atomic<size_t> in_flight{0};
+        std::atomic<double> ewma_us{0.0};
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> reconnects{0};
+        std::atomic<int64_t> retry_at_ns{0};
+        std::atomic<int64_t> backoff_ms{0};
+        std::atomic<bool> draining{false};      // 对端正在停止，需要重新建连
+        std::mutex reconnect_mutex;
+    };
+
+    /**
+     * @brief 端点租约，析构时归还在途计数
+     */
+    class Lease {
+    public:
+        Lease(Replica* replica, std::shared_ptr<rpc::client> client);
+        Lease(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        rpc::client& client() const { return *client_; }
+        const Endpoint& endpoint() const { return replica_->endpoint; }
+        const Replica* replica() const { return replica_; }
+
+        /**
+         * @brief 记录本次调用的结果与延迟
+         * @param ok false表示传输层失败（超时、断开），会加重该端点的延迟估计
+         */
+        void complete(bool ok);
+
+        /**
+         * @brief 按异步调用的结果记录：服务器返回的错误不算端点失败，过载、超时与传输错误算失败，
+         *        服务器正在停止时端点退出轮转
+         * @param error 完成队列交付的异常，成功时为空
+         */
+        void complete(std::exception_ptr error);
+
+        /**
+         * @brief 该连接的服务器正在停止：端点退出轮转，下次选择端点时重新建连
+         */
+        void retire() { replica_->draining.store(true, std::memory_order_relaxed); }
+
+    private:
+        Replica* replica_;
+        std::shared_ptr<rpc::client> client_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /**
+     * @brief 以power-of-two-choices选择端点并增加其在途计数
+     * @param exclude 不参与选择的端点（对冲请求避开主请求所在的端点）
+     * @return 端点租约
+     */
+    Lease acquire(const Replica* exclude = nullptr);
+
+    /**
+     * @brief 查找需要对冲的方法
+     * @return 未启用对冲或方法未标记为幂等时返回nullptr
+     */
+    HedgePolicy::Method* hedge_method(const std::string& func_name) const;
+
+    /**
+     * @brief 以对冲方式发送请求，两路请求的耗时都计入各自端点的延迟EWMA
+     */
+    template<typename... Args>
+    RPCLIB_MSGPACK::object_handle hedged_call(HedgePolicy::Method* method,
+                                              const std::string& func_name, const Args&... args);
+
+    bool is_healthy(const Replica& replica) const;
+    void maybe_reconnect(Replica& replica);
+
+    /**
+     * @brief 获取（首次异步调用时创建）完成队列
+     */
+    detail::CompletionQueue& completions();
+
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    std::atomic<int64_t> timeout_ms_;
+    std::shared_ptr<HedgePolicy> hedge_;
+    std::once_flag completions_once_;
+    // 最后声明、最先析构：完成线程退出、归还在途计数后才销毁端点
+    std::unique_ptr<detail::CompletionQueue> completions_;
+};
+
+// 模板实现
+template<typename R, typename... Args>
+R RPCBalancedClient::call(const std::string& func_name, Args&&... args) {
+    if (HedgePolicy::Method* method = hedge_method(func_name)) {
+        try {
+            return detail::take_result<R>(hedged_call(method, func_name, args...));
+        } catch (rpc::rpc_error& e) {
+            detail::rethrow_call_error(func_name, e);
+        } catch (const DeadlineExceededError&) {
+            throw;
+        } catch (const OverloadedError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Exception in RPC call '" + func_name + "': " + e.what());
+        }
+    }
+
+    for (int attempt = 0;; ++attempt) {
+        Lease lease = acquire();
+        try {
+            RPCLIB_MSGPACK::object_handle result = lease.client().call(func_name, args...);
+            lease.complete(true);
+            return detail::take_result<R>(std::move(result));
+        } catch (rpc::rpc_error& e) {
+            // 服务端返回了错误，端点本身是健康的；但过载的端点按失败计入，使其暂时少分到流量
+            lease.complete(!detail::is_overloaded(e));
+            if (detail::is_draining(e)) {
+                // 请求未执行；新连接可能落在接管监听套接字的新进程或其他副本上，重发一次
+                lease.retire();
+                if (attempt == 0) {
+                    continue;
+                }
+            }
+            detail::rethrow_call_error(func_name, e, " on " + lease.endpoint().to_string());
+        } catch (const std::exception& e) {
+            lease.complete(false);
+            throw std::runtime_error("Exception in RPC call '" + func_name + "' on " +
+                                     lease.endpoint().to_string() + ": " + e.what());
+        }
+    }
+}
+
+template<typename... Args>
+auto RPCBalancedClient::async_call(const std::string& func_name, Args&&... args)
+    -> std::future<RPCLIB_MSGPACK::object_handle> {
+    auto lease = std::make_shared<Lease>(acquire());
+    auto response = lease->client().async_call(func_name, std::forward<Args>(args)...);
+    auto promise = std::make_shared<std::promise<RPCLIB_MSGPACK::object_handle>>();
+    auto result = promise->get_future();
+    int64_t timeout_ms = timeout_ms_.load(std::memory_order_relaxed);
+    auto deadline = timeout_ms > 0
+        ? detail::CompletionQueue::Clock::now() + std::chrono::milliseconds(timeout_ms)
+        : detail::CompletionQueue::Clock::time_point::max();
+    // 先归还在途计数再交付结果，取得结果后发起的调用能看到准确的负载
+    completions().add(func_name, std::move(response), nullptr, deadline,
+        [lease, promise](RPCLIB_MSGPACK::object_handle reply, std::exception_ptr error) mutable {
+            lease->complete(error);
+            lease.reset();
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(reply));
+            }
+        });
+    return result;
+}
+
+template<typename... Args>
+RPCLIB_MSGPACK::object_handle RPCBalancedClient::hedged_call(HedgePolicy::Method* method,
+                                                             const std::string& func_name,
+                                                             const Args&... args) {
+    std::unique_ptr<Lease> leases[2];
+    auto complete_all = [&leases](bool ok) {
+        for (auto& lease : leases) {
+            if (lease) {
+                // 落后的一路以当前耗时作为其延迟的下界计入
+                lease->complete(ok);
+            }
+        }
+    };
+
+    try {
+        detail::HedgedResult result = detail::run_hedged(*hedge_, method, func_name, [&](bool hedge) {
+            leases[hedge ? 1 : 0] = std::make_unique<Lease>(acquire(hedge ? leases[0]->replica() : nullptr));
+            return leases[hedge ? 1 : 0]->client().async_call(func_name, args...);
+        }, timeout_ms_.load(std::memory_order_relaxed));
+        complete_all(true);
+        return std::move(result.handle);
+    } catch (rpc::rpc_error& e) {
+        complete_all(!detail::is_overloaded(e));
+        throw;
+    } catch (...) {
+        complete_all(false);
+        throw;
+    }
+}
+
+template<typename... Args>
+void RPCBalancedClient::send_notification(const std::string& func_name, Args&&... args) {
+    Lease lease = acquire();
+    lease.client().send(func_name, std::forward<Args>(args)...);
+}
+
+} // namespace rpc_utils
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <stdexcept>
+#include "rpc/msgpack.hpp"
+#include "rpc_errors.h"
+
+namespace rpc_utils {
+
+namespace detail {
+
+/**
+ * @brief 批量请求中的一项（线上格式：[method, args]）
+ */
+struct BatchRequestItem {
+    std::string method;
+    RPCLIB_MSGPACK::object args;
+
+    MSGPACK_DEFINE_ARRAY(method, args);
+};
+
+/**
+ * @brief 批量响应中的一项（线上格式：[ok, value, error, info]）
+ *
+ * info为处理函数发送的结构化错误（过载、超过截止时间等），没有时code为空；
+ * 只读取前三个字段的旧客户端忽略它。
+ */
+struct BatchResultItem {
+    bool ok = false;
+    RPCLIB_MSGPACK::object value;
+    std::string error;
+    ErrorInfo info;
+
+    MSGPACK_DEFINE_ARRAY(ok, value, error, info);
+};
+
+/**
+ * @brief 服务端批量调度器的返回值，持有结果对象所在的内存区
+ */
+struct BatchReply {
+    std::vector<BatchResultItem> items;
+    std::vector<std::shared_ptr<RPCLIB_MSGPACK::zone>> zones;
+
+    MSGPACK_DEFINE_ARRAY(items);
+};
+
+/// 服务端自动注册的批量调度方法名
+const char* const kBatchMethod = "__batch";
+
+} // namespace detail
+
+/**
+ * @brief 批量调用构建器
+ *
+ * 收集多个(方法名, 参数)对，由RPCClientWrapper::call_batch在一次往返中发送。
+ */
+class RPCBatch {
+public:
+    RPCBatch();
+
+    /**
+     * @brief 追加一次调用
+     * @tparam Args 参数类型
+     * @param method 函数名
+     * @param args 函数参数
+     * @return 自身引用，便于链式调用
+     */
+    template<typename... Args>
+    RPCBatch& add(const std::string& method, Args&&... args);
+
+    /**
+     * @brief 获取调用数量
+     * @return 调用数量
+     */
+    size_t size() const { return items_.size(); }
+
+    /**
+     * @brief 清空所有调用
+     */
+    void clear();
+
+    /**
+     * @brief 获取待发送的调用列表
+     * @return 调用列表
+     */
+    const std::vector<detail::BatchRequestItem>& items() const { return items_; }
+
+private:
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone_;
+    std::vector<detail::BatchRequestItem> items_;
+};
+
+/**
+ * @brief 批量调用结果，按提交顺序保存每一项的返回值或错误
+ */
+class BatchResults {
+public:
+    BatchResults() = default;
+
+    /**
+     * @brief 由__batch响应构造
+     * @param handle 响应对象
+     */
+    explicit BatchResults(RPCLIB_MSGPACK::object_handle handle);
+
+    /**
+     * @brief 获取结果数量
+     * @return 结果数量
+     */
+    size_t size() const { return items_.size(); }
+
+    /**
+     * @brief 检查某一项是否成功
+     * @param index 调用序号
+     * @return true if succeeded
+     */
+    bool ok(size_t index) const;
+
+    /**
+     * @brief 获取某一项的错误信息
+     * @param index 调用序号
+     * @return 错误信息，成功时为空
+     */
+    const std::string& error(size_t index) const;
+
+    /**
+     * @brief 获取某一项的结构化错误
+     * @param index 调用序号
+     * @return 结构化错误，该项成功或错误未结构化时code为空
+     */
+    const ErrorInfo& error_info(size_t index) const;
+
+    /**
+     * @brief 获取某一项的返回值
+     * @tparam R 返回值类型
+     * @param index 调用序号
+     * @return 返回值
+     * @throws OverloadedError 该项因服务器过载被拒绝
+     * @throws DeadlineExceededError 该项超过截止时间
+     * @throws std::runtime_error 该项因其他原因失败
+     */
+    template<typename R>
+    R get(size_t index) const;
+
+    /**
+     * @brief 获取某一项未解码的返回值
+     * @param index 调用序号
+     * @return msgpack对象，生命周期与本结果相同
+     */
+    const RPCLIB_MSGPACK::object& raw(size_t index) const;
+
+private:
+    const detail::BatchResultItem& item(size_t index) const;
+    [[noreturn]] void throw_error(size_t index) const;
+
+    RPCLIB_MSGPACK::object_handle handle_;
+    std::vector<detail::BatchResultItem> items_;
+};
+
+// 模板实现
+template<typename... Args>
+RPCBatch& RPCBatch::add(const std::string& method, Args&&... args) {
+    detail::BatchRequestItem item;
+    item.method = method;
+    item.args = RPCLIB_MSGPACK::object(std::make_tuple(std::forward<Args>(args)...), *zone_);
+    items_.push_back(std::move(item));
+    return *this;
+}
+
+template<typename R>
+R BatchResults::get(size_t index) const {
+    const detail::BatchResultItem& result = item(index);
+    if (!result.ok) {
+        throw_error(index);
+    }
+    return result.value.as<R>();
+}
+
+} // namespace rpc_utils
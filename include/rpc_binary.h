@@ -0,0 +1,334 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include "rpc/msgpack.hpp"
+#include "rpc_pool.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 二进制数据视图，以msgpack bin类型编码
+ *
+ * 发送时直接借用调用方内存，不经过std::string中转；接收时指向读缓冲区，
+ * 并可通过owner持有缓冲区的所有权（见take_binary）。
+ * 未持有所有权的视图只在被借用内存的生命周期内有效：作为服务端处理函数参数时
+ * 仅在处理函数执行期间有效，需要保留时请转换为Blob。
+ */
+class BinaryView {
+public:
+    BinaryView() : data_(nullptr), size_(0) {}
+
+    /**
+     * @brief 借用一段内存（不拷贝，不持有）
+     * @param data 数据起始地址
+     * @param size 字节数
+     */
+    BinaryView(const void* data, size_t size)
+        : data_(static_cast<const char*>(data)), size_(size) {}
+
+    /**
+     * @brief 引用一段内存并持有其所有者，视图存在期间内存保持有效
+     * @param data 数据起始地址
+     * @param size 字节数
+     * @param owner 数据所有者
+     */
+    BinaryView(const void* data, size_t size, std::shared_ptr<const void> owner)
+        : data_(static_cast<const char*>(data)), size_(size), owner_(std::move(owner)) {}
+
+    /**
+     * @brief 借用字符串的内容
+     * @param str 字符串，必须比视图存活更久
+     */
+    explicit BinaryView(const std::string& str) : BinaryView(str.data(), str.size()) {}
+
+    /**
+     * @brief 借用字节数组的内容
+     * @param bytes 字节数组，必须比视图存活更久
+     */
+    explicit BinaryView(const std::vector<char>& bytes) : BinaryView(bytes.data(), bytes.size()) {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+
+    /**
+     * @brief 是否持有底层内存的所有权
+     * @return true表示视图独立于原始调用有效
+     */
+    bool owned() const { return static_cast<bool>(owner_); }
+
+    /**
+     * @brief 获取底层内存的所有者
+     * @return 所有者，借用视图返回空指针
+     */
+    const std::shared_ptr<const void>& owner() const { return owner_; }
+
+    /**
+     * @brief 截取子视图，与原视图共享所有者
+     * @param offset 起始偏移
+     * @param count 字节数，超出部分被截断
+     * @return 子视图
+     */
+    BinaryView subview(size_t offset, size_t count = static_cast<size_t>(-1)) const {
+        if (offset > size_) {
+            throw std::out_of_range("BinaryView offset " + std::to_string(offset) +
+                                    " out of range (size " + std::to_string(size_) + ")");
+        }
+        return BinaryView(data_ + offset, std::min(count, size_ - offset), owner_);
+    }
+
+    /**
+     * @brief 拷贝为字符串
+     * @return 字符串副本
+     */
+    std::string to_string() const { return std::string(data_, size_); }
+
+private:
+    const char* data_;
+    size_t size_;
+    std::shared_ptr<const void> owner_;
+};
+
+/**
+ * @brief 引用计数的只读二进制缓冲区
+ *
+ * 拷贝Blob只增加引用计数。作为服务端返回值时，结果对象通过内存区终结器
+ * 引用Blob而不复制数据，直到最终写入发送缓冲区。
+ */
+class Blob {
+public:
+    Blob() = default;
+
+    /**
+     * @brief 接管字符串（移动，不拷贝数据）
+     * @param str 字符串
+     */
+    explicit Blob(std::string&& str) {
+        auto holder = std::make_shared<const std::string>(std::move(str));
+        view_ = BinaryView(holder->data(), holder->size(), holder);
+    }
+
+    /**
+     * @brief 接管字节数组（移动，不拷贝数据）
+     * @param bytes 字节数组
+     */
+    explicit Blob(std::vector<char>&& bytes) {
+        auto holder = std::make_shared<const std::vector<char>>(std::move(bytes));
+        view_ = BinaryView(holder->data(), holder->size(), holder);
+    }
+
+    /**
+     * @brief 从视图构造：持有所有权的视图共享其所有者，借用视图则拷贝数据
+     * @param view 二进制视图
+     */
+    explicit Blob(const BinaryView& view) {
+        if (view.owned()) {
+            view_ = view;
+        } else {
+            *this = copy(view.data(), view.size());
+        }
+    }
+
+    /**
+     * @brief 拷贝一段内存
+     * @param data 数据起始地址
+     * @param size 字节数
+     * @return 持有副本的Blob
+     */
+    static Blob copy(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        return Blob(std::vector<char>(bytes, bytes + size));
+    }
+
+    const char* data() const { return view_.data(); }
+    size_t size() const { return view_.size(); }
+    bool empty() const { return view_.empty(); }
+
+    /**
+     * @brief 获取共享所有权的视图
+     * @return 二进制视图
+     */
+    const BinaryView& view() const { return view_; }
+    operator const BinaryView&() const { return view_; }
+
+private:
+    BinaryView view_;
+};
+
+/**
+ * @brief 从调用结果中取出二进制数据，视图持有结果句柄从而保持读缓冲区存活
+ *
+ * 用于async_call返回的future：auto data = take_binary(future.get());
+ * @param handle 调用结果句柄
+ * @return 持有所有权的视图，不拷贝数据
+ */
+BinaryView take_binary(RPCLIB_MSGPACK::object_handle handle);
+
+namespace detail {
+
+/**
+ * @brief 把调用结果句柄转换为返回值类型，二进制类型接管句柄以避免拷贝
+ */
+template<typename R>
+struct ResultTaker {
+    static R take(RPCLIB_MSGPACK::object_handle handle) {
+        R result = handle.get().template as<R>();
+        recycle_zone(std::move(handle.zone()));
+        return result;
+    }
+};
+
+template<>
+struct ResultTaker<void> {
+    static void take(RPCLIB_MSGPACK::object_handle handle) {
+        recycle_zone(std::move(handle.zone()));
+    }
+};
+
+template<>
+struct ResultTaker<BinaryView> {
+    static BinaryView take(RPCLIB_MSGPACK::object_handle handle) {
+        return take_binary(std::move(handle));
+    }
+};
+
+template<>
+struct ResultTaker<Blob> {
+    static Blob take(RPCLIB_MSGPACK::object_handle handle) {
+        return Blob(take_binary(std::move(handle)));
+    }
+};
+
+template<typename R>
+R take_result(RPCLIB_MSGPACK::object_handle handle) {
+    return ResultTaker<R>::take(std::move(handle));
+}
+
+/**
+ * @brief 内存区终结器：释放对数据所有者的引用
+ */
+void release_binary_owner(void* owner);
+
+/**
+ * @brief 把二进制视图写入带内存区的对象
+ *
+ * 持有所有权的视图通过内存区终结器延长所有者生命周期，只引用不拷贝；
+ * 借用视图无法保证存活到对象被发送，因此拷贝进内存区。
+ */
+void binary_to_object(RPCLIB_MSGPACK::object::with_zone& o, const BinaryView& view);
+
+/**
+ * @brief 从msgpack对象读取二进制视图（bin或str类型），视图指向对象所在内存
+ */
+BinaryView binary_from_object(const RPCLIB_MSGPACK::object& o);
+
+/**
+ * @brief 共享所有权的msgpack对象
+ *
+ * 作为处理函数返回值时，响应对象浅引用其中的对象树，并通过内存区终结器
+ * 持有句柄，同一结果可被多个响应同时发送而不复制（用于结果缓存等）。
+ */
+struct SharedObject {
+    std::shared_ptr<const RPCLIB_MSGPACK::object_handle> handle;
+};
+
+/**
+ * @brief 把共享对象浅拷贝到带内存区的对象中，并由内存区持有其句柄
+ */
+void share_object(RPCLIB_MSGPACK::object::with_zone& o, const SharedObject& shared);
+
+inline uint32_t checked_binary_size(size_t size) {
+    if (size > 0xffffffffULL) {
+        throw std::length_error("Binary payload too large for msgpack bin: " +
+                                std::to_string(size) + " bytes");
+    }
+    return static_cast<uint32_t>(size);
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
+
+// msgpack 适配器
+namespace RPCLIB_MSGPACK {
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
+namespace adaptor {
+
+template<>
+struct convert<rpc_utils::BinaryView> {
+    const RPCLIB_MSGPACK::object& operator()(const RPCLIB_MSGPACK::object& o,
+                                             rpc_utils::BinaryView& v) const {
+        v = rpc_utils::detail::binary_from_object(o);
+        return o;
+    }
+};
+
+template<>
+struct pack<rpc_utils::BinaryView> {
+    template<typename Stream>
+    packer<Stream>& operator()(packer<Stream>& o, const rpc_utils::BinaryView& v) const {
+        uint32_t size = rpc_utils::detail::checked_binary_size(v.size());
+        o.pack_bin(size);
+        o.pack_bin_body(v.data(), size);
+        return o;
+    }
+};
+
+template<>
+struct object_with_zone<rpc_utils::BinaryView> {
+    void operator()(RPCLIB_MSGPACK::object::with_zone& o, const rpc_utils::BinaryView& v) const {
+        rpc_utils::detail::binary_to_object(o, v);
+    }
+};
+
+template<>
+struct convert<rpc_utils::Blob> {
+    const RPCLIB_MSGPACK::object& operator()(const RPCLIB_MSGPACK::object& o,
+                                             rpc_utils::Blob& v) const {
+        // 对象不持有内存区，只能拷贝；需要零拷贝时通过take_binary从结果句柄获取
+        v = rpc_utils::Blob(rpc_utils::detail::binary_from_object(o));
+        return o;
+    }
+};
+
+template<>
+struct pack<rpc_utils::Blob> {
+    template<typename Stream>
+    packer<Stream>& operator()(packer<Stream>& o, const rpc_utils::Blob& v) const {
+        return pack<rpc_utils::BinaryView>()(o, v.view());
+    }
+};
+
+template<>
+struct object_with_zone<rpc_utils::Blob> {
+    void operator()(RPCLIB_MSGPACK::object::with_zone& o, const rpc_utils::Blob& v) const {
+        rpc_utils::detail::binary_to_object(o, v.view());
+    }
+};
+
+template<>
+struct pack<rpc_utils::detail::SharedObject> {
+    template<typename Stream>
+    packer<Stream>& operator()(packer<Stream>& o, const rpc_utils::detail::SharedObject& v) const {
+        o.pack(v.handle->get());
+        return o;
+    }
+};
+
+template<>
+struct object_with_zone<rpc_utils::detail::SharedObject> {
+    void operator()(RPCLIB_MSGPACK::object::with_zone& o,
+                    const rpc_utils::detail::SharedObject& v) const {
+        rpc_utils::detail::share_object(o, v);
+    }
+};
+
+} // namespace adaptor
+} // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+} // namespace RPCLIB_MSGPACK
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <unordered_map>
+#include "rpc/msgpack.hpp"
+#include "rpc/detail/func_traits.h"
+#include "rpc_binary.h"
+#include "rpc_pool.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 结果缓存统计
+ */
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;      // 因容量或内存上限被淘汰的条目数
+    uint64_t expirations = 0;    // 因过期被移除的条目数
+    uint64_t coalesced = 0;      // 与进行中的相同请求合并、未单独执行的请求数
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+
+    MSGPACK_DEFINE_MAP(hits, misses, evictions, expirations, coalesced, entries, bytes);
+};
+
+/**
+ * @brief 分片LRU结果缓存
+ *
+ * 键为序列化后的参数字节，值为编码后的返回值对象。按键哈希分成多个分片，
+ * 每个分片独立加锁并维护自己的LRU链表，条目数和内存上限按分片平均分配。
+ */
+class ResultCache {
+public:
+    using Value = std::shared_ptr<const RPCLIB_MSGPACK::object_handle>;
+
+    /**
+     * @brief 构造函数
+     * @param capacity 最大条目数
+     * @param ttl 条目有效期，0表示不过期
+     * @param max_bytes 最大内存占用（估算值），0表示不限制
+     */
+    ResultCache(size_t capacity, std::chrono::milliseconds ttl, size_t max_bytes);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief 查找缓存
+     * @param key 序列化后的参数
+     * @return 缓存的返回值，未命中或已过期时返回nullptr
+     */
+    Value get(const std::string& key);
+
+    /**
+     * @brief 写入缓存，必要时淘汰最久未使用的条目
+     * @param key 序列化后的参数
+     * @param value 返回值
+     */
+    void put(std::string key, Value value);
+
+    /**
+     * @brief 清空缓存（计数保留）
+     */
+    void clear();
+
+    /**
+     * @brief 获取统计
+     * @return 各分片统计之和
+     */
+    CacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        Value value;
+        size_t bytes;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;    // 头部为最近使用
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        CacheStats stats;
+    };
+
+    Shard& shard_for(const std::string& key);
+    void erase_locked(Shard& shard, std::list<Entry>::iterator it);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shard_capacity_;
+    size_t shard_max_bytes_;
+    std::chrono::milliseconds ttl_;
+};
+
+/**
+ * @brief 请求合并（single-flight）
+ *
+ * 同一键的请求正在执行时，后到的请求等待并共享其结果（或异常），
+ * 而不是再执行一次。
+ */
+class SingleFlight {
+public:
+    using Value = ResultCache::Value;
+
+    SingleFlight() : executions_(0), coalesced_(0) {}
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    /**
+     * @brief 执行或加入同一键的进行中请求
+     * @param key 请求键
+     * @param compute 实际执行的函数，只由首个请求调用
+     * @return 结果
+     */
+    Value run(const std::string& key, const std::function<Value()>& compute);
+
+    /**
+     * @brief 实际执行次数
+     */
+    uint64_t executions() const { return executions_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 被合并的请求数
+     */
+    uint64_t coalesced() const { return coalesced_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<Value>> flights_;
+    std::atomic<uint64_t> executions_;
+    std::atomic<uint64_t> coalesced_;
+};
+
+namespace detail {
+
+/**
+ * @brief 按位置把任意参数类型映射为未解码的msgpack对象
+ */
+template<typename>
+using raw_arg_t = RPCLIB_MSGPACK::object;
+
+/**
+ * @brief 把未解码的参数重新编码为缓存键
+ * @param args 参数对象指针数组
+ * @param count 参数个数
+ */
+std::string pack_args_key(const RPCLIB_MSGPACK::object* const* args, size_t count);
+
+/**
+ * @brief 把返回值编码为可共享的对象
+ */
+template<typename R>
+SharedObject make_shared_result(const R& result) {
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone = acquire_zone();
+    RPCLIB_MSGPACK::object object(result, *zone);
+    return make_shared_object(object, std::move(zone));
+}
+
+/**
+ * @brief 把未解码的参数解码为原类型并调用函数
+ */
+template<typename R, typename F, typename ArgsTuple>
+struct RawInvoker;
+
+template<typename R, typename F, typename... Args>
+struct RawInvoker<R, F, std::tuple<Args...>> {
+    using RawArgs = std::array<const RPCLIB_MSGPACK::object*, sizeof...(Args)>;
+
+    static R invoke(F& func, const RawArgs& raw) {
+        return invoke(func, raw, std::index_sequence_for<Args...>());
+    }
+
+    template<size_t... I>
+    static R invoke(F& func, const RawArgs& raw, std::index_sequence<I...>) {
+        std::tuple<Args...> args;
+        (void)raw;
+        (void)std::initializer_list<int>{(raw[I]->convert(std::get<I>(args)), 0)...};
+        return func(std::get<I>(args)...);
+    }
+};
+
+/**
+ * @brief 带结果缓存的处理函数包装
+ *
+ * 参数以未解码的msgpack对象接收：命中时直接返回缓存的结果对象，
+ * 不解码参数也不执行原函数；未命中时才把参数解码为原类型并调用，
+ * 同一参数的并发未命中只执行一次。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class CachedHandler;
+
+template<typename F, typename R, typename... Args>
+class CachedHandler<F, R, std::tuple<Args...>> {
+    static_assert(!std::is_void<R>::value, "bind_cached requires a function that returns a value");
+
+public:
+    using Invoker = RawInvoker<R, F, std::tuple<Args...>>;
+
+    CachedHandler(F func, std::shared_ptr<ResultCache> cache, std::shared_ptr<SingleFlight> flights)
+        : func_(std::move(func)), cache_(std::move(cache)), flights_(std::move(flights)) {}
+
+    SharedObject operator()(raw_arg_t<Args>&... args) {
+        typename Invoker::RawArgs raw = {{&args...}};
+        std::string key = pack_args_key(raw.data(), raw.size());
+        if (ResultCache::Value hit = cache_->get(key)) {
+            return SharedObject{std::move(hit)};
+        }
+
+        return SharedObject{flights_->run(key, [&]() {
+            ResultCache::Value value = make_shared_result(Invoker::invoke(func_, raw)).handle;
+            cache_->put(key, value);
+            return value;
+        })};
+    }
+
+private:
+    F func_;
+    std::shared_ptr<ResultCache> cache_;
+    std::shared_ptr<SingleFlight> flights_;
+};
+
+template<typename F>
+using cached_handler_t = CachedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+/**
+ * @brief 合并相同并发请求的处理函数包装
+ *
+ * 参数相同的请求同时到达时只执行一次原函数，结果对象只构造一次，
+ * 由所有等待中的响应共同引用。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class CoalescedHandler;
+
+template<typename F, typename R, typename... Args>
+class CoalescedHandler<F, R, std::tuple<Args...>> {
+    static_assert(!std::is_void<R>::value, "bind_coalesced requires a function that returns a value");
+
+public:
+    using Invoker = RawInvoker<R, F, std::tuple<Args...>>;
+
+    CoalescedHandler(F func, std::shared_ptr<SingleFlight> flights)
+        : func_(std::move(func)), flights_(std::move(flights)) {}
+
+    SharedObject operator()(raw_arg_t<Args>&... args) {
+        typename Invoker::RawArgs raw = {{&args...}};
+        return SharedObject{flights_->run(pack_args_key(raw.data(), raw.size()), [&]() {
+            return make_shared_result(Invoker::invoke(func_, raw)).handle;
+        })};
+    }
+
+private:
+    F func_;
+    std::shared_ptr<SingleFlight> flights_;
+};
+
+template<typename F>
+using coalesced_handler_t = CoalescedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <exception>
+#include "rpc/client.h"
+#include "rpc/rpc_error.h"
+#include "rpc_binary.h"
+#include "rpc_completion.h"
+#include "rpc_errors.h"
+#include "rpc_hedge.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief RPC客户端连接池
+ *
+ * 对同一服务端点维护N条rpc::client连接，可被多个线程安全共享。
+ * 每次调用会被分派到当前在途请求数最少的连接上，
+ * 使连接数与建连开销随CPU核数而非业务线程数增长。
+ */
+class RPCClientPool {
+public:
+    /**
+     * @brief 构造函数
+     * @param host 服务器地址
+     * @param port 服务器端口
+     * @param pool_size 连接数，0表示使用硬件并发数
+     * @param timeout_ms 超时时间（毫秒），默认5000ms
+     * @throws std::runtime_error 创建连接失败时抛出异常
+     */
+    RPCClientPool(const std::string& host, uint16_t port,
+                  size_t pool_size = 0, int64_t timeout_ms = 5000);
+
+    /**
+     * @brief 析构函数
+     */
+    ~RPCClientPool();
+
+    // 禁用拷贝
+    RPCClientPool(const RPCClientPool&) = delete;
+    RPCClientPool& operator=(const RPCClientPool&) = delete;
+
+    /**
+     * @brief 同步调用RPC函数（线程安全）
+     * @tparam R 返回值类型
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     * @return 函数返回值
+     * @throws OverloadedError 服务器过载、请求被拒绝时抛出异常
+     * @throws std::runtime_error 调用失败时抛出异常
+     */
+    template<typename R, typename... Args>
+    R call(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 异步调用RPC函数（线程安全）
+     *
+     * 请求会立即发出，响应由连接池的完成线程取出后放入返回的future，
+     * 可以用wait_for/wait_until轮询；在响应到达（或超时）之前，该请求计入所选连接的在途请求数。
+     * 设置了超时时，超时未收到响应的调用以DeadlineExceededError结束。
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     * @return std::future对象，用于获取异步结果；调用失败时get()抛出
+     *         OverloadedError、DeadlineExceededError或std::runtime_error
+     */
+    template<typename... Args>
+    auto async_call(const std::string& func_name, Args&&... args)
+        -> std::future<RPCLIB_MSGPACK::object_handle>;
+
+    /**
+     * @brief 发送通知（不等待返回值）
+     * @tparam Args 参数类型
+     * @param func_name 函数名
+     * @param args 函数参数
+     */
+    template<typename... Args>
+    void send_notification(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 设置对冲策略
+     *
+     * 对策略中标记为幂等的方法，同步调用在对冲延迟内未返回时会向另一条连接再发送一次，
+     * 取先到的响应。连接数不少于2时生效；须在开始调用之前设置。
+     * @param policy 对冲策略，nullptr表示关闭对冲
+     */
+    void set_hedge_policy(std::shared_ptr<HedgePolicy> policy);
+
+    /**
+     * @brief 设置所有连接的超时时间
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void set_timeout(int64_t timeout_ms);
+
+    /**
+     * @brief 清除所有连接的超时设置
+     */
+    void clear_timeout();
+
+    /**
+     * @brief 获取连接数
+     * @return 连接数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 获取处于已连接状态的连接数
+     * @return 已连接的连接数
+     */
+    size_t connected_count() const;
+
+    /**
+     * @brief 获取所有连接上的在途请求总数
+     * @return 在途请求数
+     */
+    size_t in_flight() const;
+
+    /**
+     * @brief 等待所有连接上的异步响应完成
+     */
+    void wait_all_responses();
+
+private:
+    struct Connection {
+        std::unique_ptr<rpc::client> client;
+        std::atomic<size_t> in_flight{0};
+    };
+
+    /**
+     * @brief 连接租约，析构时归还在途计数
+     */
+    class Lease {
+    public:
+        explicit Lease(Connection* conn) : conn_(conn) {}
+        Lease(Lease&& other) noexcept : conn_(other.conn_) { other.conn_ = nullptr; }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() {
+            if (conn_) {
+                conn_->in_flight.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        rpc::client& client() const { return *conn_->client; }
+        const Connection* connection() const { return conn_; }
+
+    private:
+        Connection* conn_;
+    };
+
+    /**
+     * @brief 选择在途请求最少的连接并增加其在途计数
+     * @param exclude 不参与选择的连接（对冲请求避开主请求所在的连接）
+     * @return 连接租约
+     */
+    Lease acquire(const Connection* exclude = nullptr);
+
+    /**
+     * @brief 查找需要对冲的方法
+     * @return 未启用对冲或方法未标记为幂等时返回nullptr
+     */
+    HedgePolicy::Method* hedge_method(const std::string& func_name) const;
+
+    /**
+     * @brief 获取（首次异步调用时创建）完成队列
+     */
+    detail::CompletionQueue& completions();
+
+    /**
+     * @brief 以对冲方式发送请求
+     */
+    template<typename... Args>
+    RPCLIB_MSGPACK::object_handle hedged_call(HedgePolicy::Method* method,
+                                              const std::string& func_name, const Args&... args);
+
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::atomic<size_t> next_;
+    std::atomic<int64_t> timeout_ms_;
+    std::shared_ptr<HedgePolicy> hedge_;
+    std::string host_;
+    uint16_t port_;
+    std::once_flag completions_once_;
+    // 最后声明、最先析构：完成线程退出、归还在途计数后才断开连接
+    std::unique_ptr<detail::CompletionQueue> completions_;
+};
+
+// 模板实现
+template<typename R, typename... Args>
+R RPCClientPool::call(const std::string& func_name, Args&&... args) {
+    try {
+        if (HedgePolicy::Method* method = hedge_method(func_name)) {
+            return detail::take_result<R>(hedged_call(method, func_name, args...));
+        }
+        Lease lease = acquire();
+        return detail::take_result<R>(lease.client().call(func_name, std::forward<Args>(args)...));
+    } catch (rpc::rpc_error& e) {
+        detail::rethrow_call_error(func_name, e);
+    } catch (const DeadlineExceededError&) {
+        throw;
+    } catch (const OverloadedError&) {
+        throw;
+    } catch (const InflightLimitError&) {
+        throw;
+    } catch (const std::exception& e) {
+        std::string error_msg = "Exception in RPC call '" + func_name + "': " + e.what();
+        throw std::runtime_error(error_msg);
+    }
+}
+
+template<typename... Args>
+auto RPCClientPool::async_call(const std::string& func_name, Args&&... args)
+    -> std::future<RPCLIB_MSGPACK::object_handle> {
+    auto lease = std::make_shared<Lease>(acquire());
+    auto response = lease->client().async_call(func_name, std::forward<Args>(args)...);
+    auto promise = std::make_shared<std::promise<RPCLIB_MSGPACK::object_handle>>();
+    auto result = promise->get_future();
+    int64_t timeout_ms = timeout_ms_.load(std::memory_order_relaxed);
+    auto deadline = timeout_ms > 0
+        ? detail::CompletionQueue::Clock::now() + std::chrono::milliseconds(timeout_ms)
+        : detail::CompletionQueue::Clock::time_point::max();
+    // 先归还在途计数再交付结果，取得结果后发起的调用能看到准确的负载
+    completions().add(func_name, std::move(response), nullptr, deadline,
+        [lease, promise](RPCLIB_MSGPACK::object_handle reply, std::exception_ptr error) mutable {
+            lease.reset();
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(reply));
+            }
+        });
+    return result;
+}
+
+template<typename... Args>
+RPCLIB_MSGPACK::object_handle RPCClientPool::hedged_call(HedgePolicy::Method* method,
+                                                         const std::string& func_name,
+                                                         const Args&... args) {
+    std::unique_ptr<Lease> leases[2];
+    return detail::run_hedged(*hedge_, method, func_name, [&](bool hedge) {
+        leases[hedge ? 1 : 0] = std::make_unique<Lease>(acquire(hedge ? leases[0]->connection() : nullptr));
+        return leases[hedge ? 1 : 0]->client().async_call(func_name, args...);
+    }, timeout_ms_.load(std::memory_order_relaxed)).handle;
+}
+
+template<typename... Args>
+void RPCClientPool::send_notification(const std::string& func_name, Args&&... args) {
+    Lease lease = acquire();
+    lease.client().send(func_name, std::forward<Args>(args)...);
+}
+
+} // namespace rpc_utils
@@ -4,8 +4,23 @@
 #include <memory>
 #include <functional>
 #include <exception>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <utility>
 #include "rpc/client.h"
 #include "rpc/rpc_error.h"
+#include "rpc_batch.h"
+#include "rpc_binary.h"
+#include "rpc_errors.h"
+#include "rpc_context.h"
+#include "rpc_trace.h"
+#include "rpc_compress.h"
+#include "rpc_stream.h"
+#include "rpc_local_transport.h"
+#include "rpc_completion.h"
+#include "rpc_stub.h"
+#include "rpc_window.h"
 
 namespace rpc_utils {
 
@@ -24,6 +39,18 @@ public:
      */
     RPCClientWrapper(const std::string& host, uint16_t port, int64_t timeout_ms = 5000);
 
+    /**
+     * @brief 按端点字符串构造
+     *
+     * 支持host:port、tcp://host:port，以及同主机传输unix:///path/to.sock与shm://name
+     * （服务器需通过RPCServerWrapper::listen监听相同端点）。同主机传输上批量调用、
+     * 流式调用不可用，压缩与截止时间传递的设置被忽略。
+     * @param endpoint 端点
+     * @throws std::invalid_argument 端点格式错误时抛出异常
+     * @throws std::runtime_error 连接失败时抛出异常
+     */
+    explicit RPCClientWrapper(const std::string& endpoint);
+
     /**
      * @brief 析构函数
      */
@@ -40,6 +67,8 @@ public:
      * @param func_name 函数名
      * @param args 函数参数
      * @return 函数返回值
+     * @throws OverloadedError 服务器过载、请求被拒绝时抛出异常
+     * @throws DeadlineExceededError 启用截止时间传递或压缩且超过截止时间时抛出异常
      * @throws std::runtime_error 调用失败时抛出异常
      */
     template<typename R, typename... Args>
@@ -51,20 +80,133 @@ public:
      * @param func_name 函数名
      * @param args 函数参数
      * @return std::future对象，用于获取异步结果
+     * @throws InflightLimitError 在途窗口已满且不能等待时抛出异常
      */
     template<typename... Args>
-    auto async_call(const std::string& func_name, Args&&... args) 
-        -> std::future<RPCLIB_MSGPACK::object_handle>;
+    auto async_call(const std::string& func_name, Args&&... args)
+        -> typename std::enable_if<!detail::ends_with_callback<Args...>::value,
+                                   std::future<RPCLIB_MSGPACK::object_handle>>::type;
+
+    /**
+     * @brief 异步调用RPC函数，响应到达时执行回调
+     *
+     * 最后一个参数为回调，签名为void(object_handle result, std::exception_ptr error)，
+     * 其余参数为函数参数。调用线程不阻塞，回调在客户端的完成线程上按完成顺序执行，
+     * 不应在回调中长时间阻塞。设置了超时时，超时的调用以DeadlineExceededError完成；
+     * 请求无法发出时回调在调用线程上立即执行。
+     * @param func_name 函数名
+     * @param args 函数参数，最后一个为回调
+     */
+    template<typename... Args>
+    auto async_call(const std::string& func_name, Args&&... args)
+        -> typename std::enable_if<detail::ends_with_callback<Args...>::value>::type;
+
+#ifdef RPC_UTILS_HAS_COROUTINES
+    /**
+     * @brief 协程形式的异步调用（C++20）
+     *
+     * 请求在co_await时发出，协程在客户端的完成线程上恢复：
+     * int sum = co_await client.co_call<int>("add", 1, 2);
+     * @tparam R 返回值类型
+     * @throws 与call相同，在co_await处抛出
+     */
+    template<typename R, typename... Args>
+    CallAwaitable<R> co_call(const std::string& func_name, Args&&... args);
+#endif
+
+    /**
+     * @brief 创建预先绑定方法的类型化调用句柄
+     *
+     * auto add = client.stub<double(double, double)>("add");
+     * double sum = add(1.5, 2.5);
+     * 参数在编译期按签名检查和转换。同主机传输（unix://、shm://）上按预先算好的方法ID调用，
+     * 服务器按ID分派；TCP连接上按方法名调用，与call相同，rpclib等其他服务器也能处理。
+     * @tparam Sig 函数签名
+     * @param func_name 函数名
+     */
+    template<typename Sig>
+    RPCStub<Sig> stub(const std::string& func_name) {
+        return RPCStub<Sig>(*this, func_name);
+    }
+
+    /**
+     * @brief 以回调方式发出、尚未完成的调用数
+     */
+    size_t pending_callbacks() const;
+
+    /**
+     * @brief 限制未完成的异步请求数与字节数
+     *
+     * async_call（future与回调形式）、co_call与类型化句柄的async在发出前占用名额，
+     * 收到响应、失败或超时后释放；窗口已满时按options.policy等待或抛出
+     * InflightLimitError（回调形式经回调收到该异常）。send_notification在窗口已满时
+     * 同样等待或被拒绝，但不占用名额。同步调用不受限制。完成线程上（回调与co_call
+     * 恢复的协程中）发起的调用不等待，窗口已满时直接被拒绝。
+     * 启用后future形式的async_call也经完成线程取得响应，错误类型与回调形式相同；
+     * 类型化句柄的async按方法名发送。
+     * @param options 窗口配置
+     */
+    void set_inflight_limit(const InflightOptions& options);
+
+    /**
+     * @brief 在途窗口统计（未设置窗口时全为0）
+     */
+    InflightStats inflight_stats() const;
 
     /**
      * @brief 发送通知（不等待返回值）
      * @tparam Args 参数类型
      * @param func_name 函数名
      * @param args 函数参数
+     * @throws InflightLimitError 在途窗口已满且不能等待时抛出异常
      */
     template<typename... Args>
     void send_notification(const std::string& func_name, Args&&... args);
 
+    /**
+     * @brief 批量同步调用：所有调用打包在一个请求中，一次往返完成
+     * @param batch 批量调用
+     * @param parallel 是否允许服务端并行执行各项调用
+     * @return 按提交顺序排列的结果，单项失败不会抛出异常
+     * @throws std::runtime_error 整个批量请求失败时抛出异常
+     */
+    BatchResults call_batch(const RPCBatch& batch, bool parallel = false);
+
+    /**
+     * @brief 批量异步调用
+     *
+     * 请求在返回前已发出，batch可立即复用；响应由完成线程取出后放入返回的future，可用wait_for轮询。
+     * @param batch 批量调用
+     * @param parallel 是否允许服务端并行执行各项调用
+     * @return std::future对象，用于获取批量结果
+     */
+    std::future<BatchResults> async_call_batch(const RPCBatch& batch, bool parallel = false);
+
+    /**
+     * @brief 调用服务端流式方法（由bind_stream绑定），逐批接收元素
+     *
+     * 返回的读取器引用本客户端，使用期间客户端必须保持存活。
+     * @tparam T 元素类型
+     * @param func_name 函数名
+     * @param args 函数参数（不含StreamWriter）
+     * @return 流读取器
+     * @throws std::runtime_error 打开流失败时抛出异常
+     */
+    template<typename T, typename... Args>
+    ClientStream<T> open_stream(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 调用客户端流式方法（由bind_client_stream绑定），逐个写入元素
+     *
+     * 返回的写入器引用本客户端，使用期间客户端必须保持存活。
+     * @param func_name 函数名
+     * @param args 函数参数（不含StreamReader）
+     * @return 流写入器，写完后调用finish<R>()获取返回值
+     * @throws std::runtime_error 打开流失败时抛出异常
+     */
+    template<typename... Args>
+    ClientStreamWriter open_client_stream(const std::string& func_name, Args&&... args);
+
     /**
      * @brief 设置超时时间
      * @param timeout_ms 超时时间（毫秒）
@@ -76,6 +218,69 @@ public:
      */
     void clear_timeout();
 
+    /**
+     * @brief 启用截止时间传递
+     *
+     * 启用后call/async_call把请求包装在上下文信封中，携带剩余时间发送给服务器，
+     * 服务器对到达时已过期的请求不再执行，处理函数可通过RequestContext::current()
+     * 读取截止时间。截止时间取超时设置与当前请求上下文（在处理函数中发起嵌套调用时）
+     * 中较早的一个。服务器须为RPCServerWrapper。
+     * @param enable 是否启用
+     * @throws std::runtime_error 同主机传输（unix://、shm://）不携带上下文，启用时抛出异常
+     */
+    void set_propagate_deadline(bool enable);
+
+    /**
+     * @brief 启用追踪上下文传递
+     *
+     * 启用后，被采样的请求（当前请求上下文在追踪中，或启用了追踪且按采样率开始新的
+     * 追踪）经上下文信封携带追踪ID与客户端跨度ID发送，服务器据此记录子跨度，并通过
+     * RequestContext::current().trace()交给处理函数，处理函数中的嵌套调用继续沿用。
+     * 未被采样的请求照常发送，不增加开销。同步调用记录客户端跨度，异步调用只传递
+     * 上下文。服务器须为RPCServerWrapper。
+     * @param enable 是否启用
+     * @throws std::runtime_error 同主机传输（unix://、shm://）不携带上下文，启用时抛出异常
+     */
+    void set_propagate_trace(bool enable);
+
+    /**
+     * @brief 对所有方法启用负载压缩
+     *
+     * 启用后call/async_call把请求包装在压缩信封中：参数序列化后达到options.min_size
+     * 时压缩，并告知服务器按同样的方式压缩响应。序列化与压缩使用线程内复用的缓冲区，
+     * 不额外分配内存。服务器须为RPCServerWrapper。通知（send_notification）不压缩。
+     * @param options 压缩配置，codec为Codec::none时关闭
+     * @throws std::runtime_error 同主机传输（unix://、shm://）不压缩，启用时抛出异常
+     */
+    void enable_compression(const CompressionOptions& options = CompressionOptions());
+
+    /**
+     * @brief 为单个方法设置压缩配置，覆盖enable_compression的设置
+     *
+     * 例如只对返回大块文本的方法启用压缩，或对已压缩的数据（图片等）关闭压缩。
+     * @param name 函数名
+     * @param options 压缩配置，codec为Codec::none表示该方法不压缩
+     * @throws std::runtime_error 同主机传输（unix://、shm://）不压缩，启用时抛出异常
+     */
+    void set_method_compression(const std::string& name, const CompressionOptions& options);
+
+    /**
+     * @brief 设置写合并（仅同主机传输）
+     *
+     * 启用后请求与通知先在发送缓冲区中累积，在有线程开始等待响应（同步调用、future的
+     * get()、完成线程取结果）、调用flush()或累积达到options.max_bytes时一次写出，
+     * 连续发起的多个异步调用只需要一次系统调用。只发送通知时需要自行调用flush()。
+     * rpclib的TCP连接逐个写出请求，该设置对其无效。
+     * @param options 写合并配置
+     */
+    void set_write_coalescing(const CoalesceOptions& options);
+
+    /**
+     * @brief 写出写合并累积的请求与通知（未启用或TCP连接时什么也不做）
+     * @throws std::runtime_error 连接已断开时抛出异常
+     */
+    void flush();
+
     /**
      * @brief 获取连接状态
      * @return 连接状态
@@ -94,33 +299,374 @@ public:
     bool is_connected() const;
 
 private:
+    template<typename Sig>
+    friend class RPCStub;
+
+    /**
+     * @brief 同主机传输上按方法ID调用，TCP连接上按方法名调用
+     */
+    template<typename R, typename... Args>
+    R call_by_id(uint64_t method_id, const std::string& func_name, Args&&... args);
+
+    template<typename... Args>
+    std::future<RPCLIB_MSGPACK::object_handle> async_call_by_id(uint64_t method_id,
+                                                                const std::string& func_name,
+                                                                Args&&... args);
+
+    /**
+     * @brief 同主机传输不支持该功能时抛出异常
+     * @param feature 功能名称，用于错误信息
+     */
+    void require_tcp(const char* feature) const;
+
+    /**
+     * @brief 生成随请求发送的上下文：按配置填入截止时间与追踪上下文
+     */
+    detail::WireContext wire_context(const detail::CallDeadline& deadline, const TraceContext& trace) const;
+
+    /**
+     * @brief 按当前配置发出请求，返回原始响应；需要后处理（解压）时写入finish
+     */
+    template<typename... Args>
+    std::future<RPCLIB_MSGPACK::object_handle> start_call(const std::string& func_name,
+                                                          detail::CompletionQueue::Finish& finish,
+                                                          Args&&... args);
+
+    /**
+     * @brief 占用在途窗口的名额并发出请求，响应到达时执行回调
+     */
+    template<typename... Args>
+    void submit(const std::string& func_name, CallCallback callback, Args&&... args);
+
+    /**
+     * @brief 发出已占用bytes字节名额的请求，回调执行前释放名额
+     */
+    template<typename... Args>
+    void enqueue(const std::string& func_name, size_t bytes, CallCallback callback, Args&&... args);
+
+    /**
+     * @brief 占用在途窗口的一个名额
+     * @return 占用的字节数
+     * @throws InflightLimitError 窗口已满且不能等待时抛出异常
+     */
+    template<typename... Args>
+    size_t acquire_window(const std::string& func_name, const Args&... args);
+
+    template<typename Tuple, size_t... I>
+    void submit_with_callback(const std::string& func_name, Tuple&& args, std::index_sequence<I...>);
+
+    /**
+     * @brief 获取（必要时创建）完成队列
+     */
+    detail::CompletionQueue& completions();
+
+    /**
+     * @brief 获取TCP连接，使用同主机传输时抛出异常
+     * @param feature 需要TCP的功能（用于错误信息）
+     */
+    rpc::client& tcp_client(const char* feature) const;
+
+    /**
+     * @brief 经上下文信封发送请求，并等待到截止时间
+     */
+    template<typename... Args>
+    RPCLIB_MSGPACK::object_handle call_with_context(const std::string& func_name, const TraceContext& trace,
+                                                    Args&&... args);
+
+    /**
+     * @brief 查找方法的压缩配置
+     * @return 该方法不压缩时返回nullptr
+     */
+    const CompressionOptions* compression_for(const std::string& func_name) const;
+
+    /**
+     * @brief 经压缩信封发送请求
+     */
+    template<typename... Args>
+    std::future<RPCLIB_MSGPACK::object_handle> send_compressed(const std::string& func_name,
+                                                               const CompressionOptions& options,
+                                                               const detail::CallDeadline& deadline,
+                                                               const TraceContext& trace,
+                                                               Args&&... args);
+
     std::unique_ptr<rpc::client> client_;
+    std::unique_ptr<detail::LocalClient> local_;     // 同主机传输，与client_二选一
     std::string host_;
     uint16_t port_;
+    int64_t timeout_ms_;
+    bool propagate_deadline_;
+    bool propagate_trace_;
+    CompressionOptions compression_;
+    std::map<std::string, CompressionOptions> method_compression_;
+    std::shared_ptr<detail::InflightWindow> window_;     // 在途回调持有引用
+    std::once_flag completions_once_;
+    // 最后声明、最先析构：完成线程退出后才断开连接
+    std::unique_ptr<detail::CompletionQueue> completions_;
 };
 
 // 模板实现
 template<typename R, typename... Args>
 R RPCClientWrapper::call(const std::string& func_name, Args&&... args) {
+    TraceSpan span(func_name, SpanKind::client);
     try {
-        return client_->call(func_name, std::forward<Args>(args)...).template as<R>();
-    } catch (const rpc::rpc_error& e) {
-        std::string error_msg = "RPC call failed for function '" + func_name + "': " + e.what();
-        throw std::runtime_error(error_msg);
+        if (local_) {
+            return detail::take_result<R>(local_->call(func_name, timeout_ms_, std::forward<Args>(args)...));
+        }
+        TraceContext trace = propagate_trace_ ? span.context() : TraceContext();
+        if (const CompressionOptions* compression = compression_for(func_name)) {
+            detail::CallDeadline deadline(timeout_ms_);
+            auto response = send_compressed(func_name, *compression, deadline, trace,
+                                            std::forward<Args>(args)...);
+            deadline.wait(response, func_name);
+            return detail::take_result<R>(detail::open_compressed_reply(response.get()));
+        }
+        if (propagate_deadline_ || trace.valid()) {
+            return detail::take_result<R>(call_with_context(func_name, trace, std::forward<Args>(args)...));
+        }
+        return detail::take_result<R>(client_->call(func_name, std::forward<Args>(args)...));
+    } catch (rpc::rpc_error& e) {
+        detail::rethrow_call_error(func_name, e);
+    } catch (const DeadlineExceededError&) {
+        throw;
+    } catch (const OverloadedError&) {
+        throw;
     } catch (const std::exception& e) {
         std::string error_msg = "Exception in RPC call '" + func_name + "': " + e.what();
         throw std::runtime_error(error_msg);
     }
 }
 
+template<typename R, typename... Args>
+R RPCClientWrapper::call_by_id(uint64_t method_id, const std::string& func_name, Args&&... args) {
+    if (!local_) {
+        return call<R>(func_name, std::forward<Args>(args)...);
+    }
+    TraceSpan span(func_name, SpanKind::client);
+    try {
+        return detail::take_result<R>(
+            local_->call_id(method_id, func_name, timeout_ms_, std::forward<Args>(args)...));
+    } catch (rpc::rpc_error& e) {
+        detail::rethrow_call_error(func_name, e);
+    } catch (const DeadlineExceededError&) {
+        throw;
+    } catch (const OverloadedError&) {
+        throw;
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Exception in RPC call '" + func_name + "': " + e.what());
+    }
+}
+
+template<typename... Args>
+std::future<RPCLIB_MSGPACK::object_handle> RPCClientWrapper::async_call_by_id(
+    uint64_t method_id, const std::string& func_name, Args&&... args) {
+    if (window_ || !local_) {
+        return async_call(func_name, std::forward<Args>(args)...);
+    }
+    return local_->async_call_id(method_id, func_name, std::forward<Args>(args)...);
+}
+
+template<typename R, typename... Params>
+R RPCStub<R(Params...)>::operator()(const Params&... args) const {
+    return client_->template call_by_id<R>(id_, name_, args...);
+}
+
+template<typename R, typename... Params>
+std::future<RPCLIB_MSGPACK::object_handle> RPCStub<R(Params...)>::async(const Params&... args) const {
+    return client_->async_call_by_id(id_, name_, args...);
+}
+
+template<typename... Args>
+auto RPCClientWrapper::async_call(const std::string& func_name, Args&&... args)
+    -> typename std::enable_if<!detail::ends_with_callback<Args...>::value,
+                               std::future<RPCLIB_MSGPACK::object_handle>>::type {
+    auto fulfil = [](std::shared_ptr<std::promise<RPCLIB_MSGPACK::object_handle>> promise) {
+        return [promise](RPCLIB_MSGPACK::object_handle response, std::exception_ptr error) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(response));
+            }
+        };
+    };
+    if (window_) {
+        size_t bytes = acquire_window(func_name, args...);
+        auto promise = std::make_shared<std::promise<RPCLIB_MSGPACK::object_handle>>();
+        auto result = promise->get_future();
+        enqueue(func_name, bytes, fulfil(promise), std::forward<Args>(args)...);
+        return result;
+    }
+    detail::CompletionQueue::Finish finish;
+    auto response = start_call(func_name, finish, std::forward<Args>(args)...);
+    if (!finish) {
+        return response;
+    }
+    // 需要后处理（解压）的响应交给完成线程，返回的future照常可以轮询
+    auto promise = std::make_shared<std::promise<RPCLIB_MSGPACK::object_handle>>();
+    auto result = promise->get_future();
+    auto deadline = timeout_ms_ > 0
+        ? detail::CompletionQueue::Clock::now() + std::chrono::milliseconds(timeout_ms_)
+        : detail::CompletionQueue::Clock::time_point::max();
+    completions().add(func_name, std::move(response), std::move(finish), deadline, fulfil(promise));
+    return result;
+}
+
+template<typename... Args>
+auto RPCClientWrapper::async_call(const std::string& func_name, Args&&... args)
+    -> typename std::enable_if<detail::ends_with_callback<Args...>::value>::type {
+    submit_with_callback(func_name, std::forward_as_tuple(std::forward<Args>(args)...),
+                         std::make_index_sequence<sizeof...(Args) - 1>());
+}
+
+template<typename Tuple, size_t... I>
+void RPCClientWrapper::submit_with_callback(const std::string& func_name, Tuple&& args,
+                                            std::index_sequence<I...>) {
+    CallCallback callback(std::get<sizeof...(I)>(std::move(args)));
+    submit(func_name, std::move(callback), std::get<I>(std::move(args))...);
+}
+
+#ifdef RPC_UTILS_HAS_COROUTINES
+template<typename R, typename... Args>
+CallAwaitable<R> RPCClientWrapper::co_call(const std::string& func_name, Args&&... args) {
+    return CallAwaitable<R>(
+        [this, func_name, arguments = std::make_tuple(std::forward<Args>(args)...)](CallCallback callback) mutable {
+            std::apply([&](auto&... unpacked) {
+                submit(func_name, std::move(callback), unpacked...);
+            }, arguments);
+        });
+}
+#endif
+
+template<typename... Args>
+void RPCClientWrapper::submit(const std::string& func_name, CallCallback callback, Args&&... args) {
+    size_t bytes = 0;
+    if (window_) {
+        try {
+            bytes = acquire_window(func_name, args...);
+        } catch (...) {
+            callback(RPCLIB_MSGPACK::object_handle(), std::current_exception());
+            return;
+        }
+    }
+    enqueue(func_name, bytes, std::move(callback), std::forward<Args>(args)...);
+}
+
+template<typename... Args>
+void RPCClientWrapper::enqueue(const std::string& func_name, size_t bytes, CallCallback callback,
+                               Args&&... args) {
+    if (window_) {
+        // 先释放名额再执行回调，回调中发起的调用可以立即取得名额
+        callback = [window = window_, bytes, inner = std::move(callback)](
+                       RPCLIB_MSGPACK::object_handle result, std::exception_ptr error) {
+            window->release(bytes);
+            inner(std::move(result), error);
+        };
+    }
+    detail::CompletionQueue::Finish finish;
+    std::future<RPCLIB_MSGPACK::object_handle> response;
+    try {
+        response = start_call(func_name, finish, std::forward<Args>(args)...);
+    } catch (...) {
+        callback(RPCLIB_MSGPACK::object_handle(), std::current_exception());
+        return;
+    }
+    auto deadline = timeout_ms_ > 0
+        ? detail::CompletionQueue::Clock::now() + std::chrono::milliseconds(timeout_ms_)
+        : detail::CompletionQueue::Clock::time_point::max();
+    completions().add(func_name, std::move(response), std::move(finish), deadline, std::move(callback));
+}
+
+template<typename... Args>
+size_t RPCClientWrapper::acquire_window(const std::string& func_name, const Args&... args) {
+    size_t bytes = window_->counts_bytes() ? detail::packed_size(args...) : 0;
+    window_->acquire(func_name, bytes, timeout_ms_, !detail::in_completion_thread());
+    return bytes;
+}
+
 template<typename... Args>
-auto RPCClientWrapper::async_call(const std::string& func_name, Args&&... args) 
-    -> std::future<RPCLIB_MSGPACK::object_handle> {
+std::future<RPCLIB_MSGPACK::object_handle> RPCClientWrapper::start_call(
+    const std::string& func_name, detail::CompletionQueue::Finish& finish, Args&&... args) {
+    if (local_) {
+        return local_->async_call(func_name, std::forward<Args>(args)...);
+    }
+    TraceContext trace = propagate_trace_ ? detail::outgoing_trace() : TraceContext();
+    if (const CompressionOptions* compression = compression_for(func_name)) {
+        detail::CallDeadline deadline(timeout_ms_);
+        finish = [](RPCLIB_MSGPACK::object_handle reply) {
+            return detail::open_compressed_reply(std::move(reply));
+        };
+        return send_compressed(func_name, *compression, deadline, trace, std::forward<Args>(args)...);
+    }
+    if (propagate_deadline_ || trace.valid()) {
+        detail::CallDeadline deadline(timeout_ms_);
+        if (propagate_deadline_) {
+            deadline.check(func_name);
+        }
+        return client_->async_call(detail::kContextMethod, wire_context(deadline, trace), func_name,
+                                   std::forward_as_tuple(args...));
+    }
     return client_->async_call(func_name, std::forward<Args>(args)...);
 }
 
+template<typename... Args>
+RPCLIB_MSGPACK::object_handle RPCClientWrapper::call_with_context(const std::string& func_name,
+                                                                  const TraceContext& trace,
+                                                                  Args&&... args) {
+    detail::CallDeadline deadline(timeout_ms_);
+    if (propagate_deadline_) {
+        deadline.check(func_name);
+    }
+    // 参数以数组形式放在信封内，服务器按方法名分派
+    auto response = client_->async_call(detail::kContextMethod, wire_context(deadline, trace), func_name,
+                                        std::forward_as_tuple(args...));
+    deadline.wait(response, func_name);
+    return response.get();
+}
+
+template<typename... Args>
+std::future<RPCLIB_MSGPACK::object_handle> RPCClientWrapper::send_compressed(
+    const std::string& func_name, const CompressionOptions& options,
+    const detail::CallDeadline& deadline, const TraceContext& trace, Args&&... args) {
+    detail::CompressedRequest request;
+    if (propagate_deadline_) {
+        deadline.check(func_name);
+    }
+    request.context = wire_context(deadline, trace);
+    request.method = func_name;
+    request.reply_codec = static_cast<uint8_t>(options.codec);
+    request.reply_min_size = options.min_size;
+    request.reply_acceleration = options.acceleration;
+
+    // 参数序列化与压缩都在线程内复用的缓冲区中完成，rpclib在async_call返回前
+    // 已把请求写入自己的发送缓冲区，之后即可归还
+    detail::ScratchBuffer packed;
+    RPCLIB_MSGPACK::pack(packed, std::forward_as_tuple(args...));
+    detail::ScratchBuffer compressed;
+    detail::make_payload(options, packed, compressed, request.args);
+    return client_->async_call(detail::kCompressedMethod, request);
+}
+
+template<typename T, typename... Args>
+ClientStream<T> RPCClientWrapper::open_stream(const std::string& func_name, Args&&... args) {
+    auto reply = call<detail::StreamOpenReply>(func_name, std::forward<Args>(args)...);
+    return ClientStream<T>(tcp_client("Streaming"), func_name, reply);
+}
+
+template<typename... Args>
+ClientStreamWriter RPCClientWrapper::open_client_stream(const std::string& func_name, Args&&... args) {
+    auto reply = call<detail::StreamOpenReply>(func_name, std::forward<Args>(args)...);
+    return ClientStreamWriter(tcp_client("Streaming"), func_name, reply);
+}
+
 template<typename... Args>
 void RPCClientWrapper::send_notification(const std::string& func_name, Args&&... args) {
+    if (window_) {
+        size_t bytes = window_->counts_bytes() ? detail::packed_size(args...) : 0;
+        window_->admit(func_name, bytes, timeout_ms_, !detail::in_completion_thread());
+    }
+    if (local_) {
+        local_->notify(func_name, std::forward<Args>(args)...);
+        return;
+    }
     client_->send(func_name, std::forward<Args>(args)...);
 }
 
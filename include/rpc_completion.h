@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include "rpc/msgpack.hpp"
+#include "rpc_binary.h"
+
+// C++20编译时提供co_await接口，C++14/17下只提供回调接口
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define RPC_UTILS_HAS_COROUTINES 1
+#endif
+#endif
+
+namespace rpc_utils {
+
+/**
+ * @brief 异步调用的完成回调
+ *
+ * 成功时error为空、result为返回值；失败时error为异常（OverloadedError、
+ * DeadlineExceededError或std::runtime_error），可用std::rethrow_exception取出。
+ */
+using CallCallback = std::function<void(RPCLIB_MSGPACK::object_handle result, std::exception_ptr error)>;
+
+namespace detail {
+
+/**
+ * @brief 判断F能否作为完成回调
+ */
+template<typename F, typename = void>
+struct is_call_callback : std::false_type {};
+
+template<typename F>
+struct is_call_callback<F, decltype(void(std::declval<typename std::decay<F>::type&>()(
+    std::declval<RPCLIB_MSGPACK::object_handle>(), std::declval<std::exception_ptr>())))>
+    : std::true_type {};
+
+/**
+ * @brief 判断参数列表的最后一个是否为完成回调
+ */
+template<typename... Args>
+struct ends_with_callback : std::false_type {};
+
+template<typename Last>
+struct ends_with_callback<Last> : is_call_callback<Last> {};
+
+template<typename First, typename Second, typename... Rest>
+struct ends_with_callback<First, Second, Rest...> : ends_with_callback<Second, Rest...> {};
+
+/**
+ * @brief 当前线程是否为某个完成队列的完成线程（回调在其上执行，不能阻塞等待其他调用完成）
+ */
+bool in_completion_thread();
+
+/**
+ * @brief 完成队列：在一个专用线程上等待异步调用的响应并执行回调
+ *
+ * rpclib只提供future，没有完成通知，因此由完成线程在最早发出的请求上阻塞等待
+ * （同一连接上的响应大多按发送顺序到达），并定期检查一遍其余请求，乱序到达的响应
+ * 最多延迟一个检查间隔。检查间隔从200微秒起，连续没有调用完成时逐次加倍（最长10毫秒），
+ * 此时改为在条件变量上等待，新提交的调用立即唤醒完成线程并恢复最短间隔；只有长时间
+ * 未完成的调用在空闲时才会多等一个间隔。调用线程提交后立即返回，不会阻塞。
+ */
+class CompletionQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 对响应的后处理（例如解压），可为空
+     */
+    using Finish = std::function<RPCLIB_MSGPACK::object_handle(RPCLIB_MSGPACK::object_handle)>;
+
+    CompletionQueue();
+    ~CompletionQueue();
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    /**
+     * @brief 提交一个等待中的调用
+     * @param func_name 函数名（用于错误信息）
+     * @param response 响应
+     * @param finish 后处理
+     * @param deadline 截止时间，超过后以DeadlineExceededError完成
+     * @param callback 完成回调，在完成线程上执行
+     */
+    void add(const std::string& func_name, std::future<RPCLIB_MSGPACK::object_handle> response,
+             Finish finish, Clock::time_point deadline, CallCallback callback);
+
+    /**
+     * @brief 尚未完成的调用数
+     */
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        std::string func_name;
+        std::future<RPCLIB_MSGPACK::object_handle> response;
+        Finish finish;
+        Clock::time_point deadline;
+        CallCallback callback;
+    };
+
+    void run();
+    void complete(Entry& entry);
+    void deliver(Entry& entry, RPCLIB_MSGPACK::object_handle result, std::exception_ptr error);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Entry> incoming_;
+    bool stopping_;
+    std::atomic<size_t> pending_;
+    std::thread thread_;
+};
+
+} // namespace detail
+
+#ifdef RPC_UTILS_HAS_COROUTINES
+/**
+ * @brief co_call返回的可等待对象
+ *
+ * 请求在co_await挂起时才发出，协程在完成线程上恢复；调用失败时co_await抛出异常。
+ * @tparam R 返回值类型
+ */
+template<typename R>
+class CallAwaitable {
+public:
+    using Starter = std::function<void(CallCallback)>;
+
+    explicit CallAwaitable(Starter starter) : starter_(std::move(starter)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> waiter) {
+        // 回调可能在starter返回前执行并恢复协程，之后不能再访问this
+        Starter starter = std::move(starter_);
+        starter([this, waiter](RPCLIB_MSGPACK::object_handle result, std::exception_ptr error) {
+            result_ = std::move(result);
+            error_ = error;
+            waiter.resume();
+        });
+    }
+
+    R await_resume() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return detail::take_result<R>(std::move(result_));
+    }
+
+private:
+    Starter starter_;
+    RPCLIB_MSGPACK::object_handle result_;
+    std::exception_ptr error_;
+};
+#endif
+
+} // namespace rpc_utils
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+#include "rpc_binary.h"
+#include "rpc_context.h"
+#include "rpc_pool.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 负载压缩算法
+ */
+enum class Codec : uint8_t {
+    none = 0,   // 不压缩
+    lz4 = 1,    // LZ4块格式（内置实现，无需外部依赖）
+};
+
+/**
+ * @brief 负载压缩配置
+ *
+ * 请求参数与响应分别序列化后，达到min_size字节才压缩；压缩后没有变小的负载原样发送。
+ */
+struct CompressionOptions {
+    Codec codec = Codec::lz4;       // 压缩算法，Codec::none表示不压缩
+    size_t min_size = 4096;         // 序列化后达到该字节数才压缩，0表示总是压缩
+    int acceleration = 1;           // LZ4加速系数：越大越快，压缩率越低
+};
+
+/**
+ * @brief 压缩统计（服务器端）
+ */
+struct CompressionStats {
+    uint64_t requests = 0;              // 经压缩信封到达的请求数
+    uint64_t compressed_requests = 0;   // 其中参数被压缩的请求数
+    uint64_t request_bytes = 0;         // 被压缩的参数解压后的字节数
+    uint64_t request_wire_bytes = 0;    // 被压缩的参数实际传输的字节数
+    uint64_t compressed_replies = 0;    // 被压缩的响应数
+    uint64_t reply_bytes = 0;           // 被压缩的响应压缩前的字节数
+    uint64_t reply_wire_bytes = 0;      // 被压缩的响应实际传输的字节数
+
+    MSGPACK_DEFINE_MAP(requests, compressed_requests, request_bytes, request_wire_bytes,
+                       compressed_replies, reply_bytes, reply_wire_bytes);
+};
+
+namespace detail {
+
+/**
+ * @brief 压缩信封方法：参数为CompressedRequest，返回[codec, raw_size, 结果或压缩数据]
+ */
+const char* const kCompressedMethod = "__z";
+
+/**
+ * @brief LZ4压缩输出的最大长度
+ */
+inline size_t lz4_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+/**
+ * @brief LZ4块压缩，使用当前线程的哈希表，不分配内存
+ * @param src 输入
+ * @param size 输入字节数
+ * @param dst 输出，容量不小于lz4_compress_bound(size)
+ * @param acceleration 加速系数（>=1）
+ * @return 输出字节数
+ */
+size_t lz4_compress(const char* src, size_t size, char* dst, int acceleration);
+
+/**
+ * @brief LZ4块解压，对畸形输入做边界检查
+ * @param src 压缩数据
+ * @param size 压缩数据字节数
+ * @param dst 输出
+ * @param raw_size 解压后的字节数，必须与实际一致
+ * @throws std::runtime_error 数据损坏时抛出异常
+ */
+void lz4_decompress(const char* src, size_t size, char* dst, size_t raw_size);
+
+/**
+ * @brief 解包一段完整的msgpack数据，字符串/二进制引用输入而不拷贝
+ * @param zone 解包使用的内存区
+ * @param data 数据，使用结果期间必须保持有效
+ * @param size 字节数
+ * @throws std::runtime_error 数据之后还有多余字节时抛出异常
+ */
+RPCLIB_MSGPACK::object unpack_referenced(RPCLIB_MSGPACK::zone& zone, const char* data, size_t size);
+
+/**
+ * @brief 序列化后的负载，codec为Codec::none时data为原始msgpack字节
+ */
+struct CompressedPayload {
+    uint8_t codec = 0;
+    uint32_t raw_size = 0;
+    BinaryView data;
+
+    MSGPACK_DEFINE_ARRAY(codec, raw_size, data);
+};
+
+/**
+ * @brief 压缩信封：方法名、参数负载，以及客户端接受的响应压缩方式
+ */
+struct CompressedRequest {
+    std::string method;
+    CompressedPayload args;
+    uint8_t reply_codec = 0;
+    uint64_t reply_min_size = 0;
+    int32_t reply_acceleration = 1;
+    WireContext context;            // 未启用截止时间传递时timeout_us为-1
+
+    MSGPACK_DEFINE_ARRAY(method, args, reply_codec, reply_min_size, reply_acceleration, context);
+};
+
+/**
+ * @brief 按配置压缩已序列化的数据
+ * @param options 压缩配置
+ * @param data 序列化后的数据
+ * @param size 字节数
+ * @param out 压缩输出
+ * @return 压缩后的字节数；未达到阈值或压缩后没有变小时返回0
+ */
+size_t try_compress(const CompressionOptions& options, const char* data, size_t size, ScratchBuffer& out);
+
+/**
+ * @brief 生成压缩信封的参数负载
+ * @param options 压缩配置
+ * @param packed 序列化后的参数数组
+ * @param compressed 压缩输出，负载可能引用其中的数据
+ * @param payload 生成的负载，引用packed或compressed
+ */
+void make_payload(const CompressionOptions& options, const ScratchBuffer& packed,
+                  ScratchBuffer& compressed, CompressedPayload& payload);
+
+/**
+ * @brief 解压参数负载并解包，解包结果引用scratch中的数据
+ * @param payload 参数负载
+ * @param scratch 解压缓冲区，使用结果期间必须保持存活
+ * @param zone 解包使用的内存区
+ * @return 参数数组
+ * @throws std::runtime_error 负载损坏或使用未知算法时抛出异常
+ */
+RPCLIB_MSGPACK::object open_payload(const CompressedPayload& payload, ScratchBuffer& scratch,
+                                    RPCLIB_MSGPACK::zone& zone);
+
+/**
+ * @brief 服务器端压缩统计计数器
+ */
+class CompressionCounters {
+public:
+    CompressionCounters();
+
+    void record_request(const CompressedPayload& payload);
+    void record_reply(size_t raw_size, size_t wire_size);
+    CompressionStats snapshot() const;
+
+private:
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> compressed_requests_;
+    std::atomic<uint64_t> request_bytes_;
+    std::atomic<uint64_t> request_wire_bytes_;
+    std::atomic<uint64_t> compressed_replies_;
+    std::atomic<uint64_t> reply_bytes_;
+    std::atomic<uint64_t> reply_wire_bytes_;
+};
+
+/**
+ * @brief 按客户端接受的方式构造压缩信封的响应
+ * @param request 请求信封
+ * @param result 处理函数的返回值，位于zone中
+ * @param zone 返回值所在的内存区，由响应接管
+ * @param counters 统计计数器
+ * @return 共享对象形式的响应[codec, raw_size, 结果或压缩数据]
+ */
+SharedObject make_compressed_reply(const CompressedRequest& request, const RPCLIB_MSGPACK::object& result,
+                                   std::unique_ptr<RPCLIB_MSGPACK::zone> zone,
+                                   CompressionCounters& counters);
+
+/**
+ * @brief 解开压缩信封的响应，返回与普通调用相同的结果句柄
+ *
+ * 数据直接解压到结果句柄的内存区中，解包后的字符串/二进制引用该内存，
+ * 因此BinaryView/Blob返回值同样不再拷贝。
+ * @param reply 压缩信封的响应
+ * @return 结果句柄
+ * @throws std::runtime_error 响应损坏时抛出异常
+ */
+RPCLIB_MSGPACK::object_handle open_compressed_reply(RPCLIB_MSGPACK::object_handle reply);
+
+} // namespace detail
+
+} // namespace rpc_utils
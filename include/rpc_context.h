@@ -0,0 +1,270 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+/**
+ * @brief 分布式追踪上下文
+ */
+struct TraceContext {
+    uint64_t trace_id = 0;      // 追踪ID，0表示不在追踪中
+    uint64_t span_id = 0;       // 当前跨度ID，其后开始的跨度以它为父跨度；0表示无父跨度
+
+    bool valid() const { return trace_id != 0; }
+};
+
+/**
+ * @brief 当前请求的上下文（截止时间、追踪上下文等）
+ *
+ * 服务器在执行经由上下文信封到达的请求时，把客户端传来的截止时间与追踪上下文
+ * 安装为当前线程的上下文；处理函数可以据此提前放弃已经没有人等待的工作。
+ * 处理函数中通过RPCClientWrapper发起的嵌套调用会自动继承该截止时间与追踪上下文。
+ */
+class RequestContext {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 构造无截止时间的上下文
+     */
+    RequestContext() : has_deadline_(false) {}
+
+    /**
+     * @brief 构造带截止时间的上下文
+     * @param deadline 截止时间
+     */
+    explicit RequestContext(Clock::time_point deadline)
+        : has_deadline_(true), deadline_(deadline) {}
+
+    /**
+     * @brief 获取当前线程的请求上下文
+     * @return 上下文；不在请求处理中时为无截止时间的上下文
+     */
+    static const RequestContext& current();
+
+    /**
+     * @brief 是否有截止时间
+     */
+    bool has_deadline() const { return has_deadline_; }
+
+    /**
+     * @brief 截止时间（has_deadline()为false时无意义）
+     */
+    Clock::time_point deadline() const { return deadline_; }
+
+    /**
+     * @brief 剩余时间
+     * @return 剩余时间，已过期时返回0，无截止时间时返回milliseconds::max()
+     */
+    std::chrono::milliseconds remaining() const;
+
+    /**
+     * @brief 是否已过期
+     */
+    bool expired() const { return has_deadline_ && Clock::now() >= deadline_; }
+
+    /**
+     * @brief 已过期时抛出DeadlineExceededError，供处理函数在长时间计算中途检查
+     * @param what 正在进行的工作，用于错误信息
+     * @throws DeadlineExceededError 已过期时抛出异常
+     */
+    void check(const std::string& what = std::string()) const;
+
+    /**
+     * @brief 追踪上下文；请求未被采样时无效
+     */
+    const TraceContext& trace() const { return trace_; }
+
+    /**
+     * @brief 设置追踪上下文
+     */
+    void set_trace(const TraceContext& trace) { trace_ = trace; }
+
+private:
+    bool has_deadline_;
+    Clock::time_point deadline_;
+    TraceContext trace_;
+};
+
+/**
+ * @brief 在当前作用域内安装请求上下文，离开时恢复原来的上下文
+ */
+class ContextScope {
+public:
+    explicit ContextScope(const RequestContext& context);
+    ~ContextScope();
+
+    ContextScope(const ContextScope&) = delete;
+    ContextScope& operator=(const ContextScope&) = delete;
+
+private:
+    RequestContext saved_;
+};
+
+namespace detail {
+
+/**
+ * @brief 上下文信封方法：参数为(WireContext, 方法名, 参数数组)
+ */
+const char* const kContextMethod = "__ctx";
+
+/**
+ * @brief 随请求发送的上下文
+ */
+struct WireContext {
+    int64_t timeout_us = -1;    // 发送时的剩余时间（微秒），<0表示无截止时间
+    int64_t sent_at_us = 0;     // 发送时客户端的系统时间（微秒），用于估计传输与排队耗时
+    uint64_t trace_id = 0;      // 追踪ID，0表示未被采样
+    uint64_t span_id = 0;       // 客户端跨度ID，服务器跨度以它为父跨度
+    uint64_t clock_id = 0;      // 客户端进程的随机标识，服务器按它估计各客户端的时钟差；0表示无
+
+    MSGPACK_DEFINE_MAP(timeout_us, sent_at_us, trace_id, span_id, clock_id);
+};
+
+/**
+ * @brief 当前请求的来源，由收到请求的传输层设置
+ */
+struct RequestOrigin {
+    uint64_t session = 0;                           // 连接ID，0表示未知（rpclib端口）
+    RequestContext::Clock::time_point arrival;      // 从连接读到请求的时间，未知时为默认值
+
+    bool has_arrival() const { return arrival != RequestContext::Clock::time_point(); }
+};
+
+/**
+ * @brief 获取当前线程正在处理的请求的来源
+ * @return 来源；传输层未设置时session为0且没有到达时间
+ */
+const RequestOrigin& current_origin();
+
+/**
+ * @brief 在当前作用域内设置请求来源，离开时恢复；origin须在作用域内保持有效
+ */
+class OriginScope {
+public:
+    explicit OriginScope(const RequestOrigin& origin);
+    ~OriginScope();
+
+    OriginScope(const OriginScope&) = delete;
+    OriginScope& operator=(const OriginScope&) = delete;
+
+private:
+    const RequestOrigin* saved_;
+};
+
+/**
+ * @brief 分配传输层的连接ID（最高位为1，不会与rpclib的会话ID重复）
+ */
+uint64_t new_session_id();
+
+/**
+ * @brief 当前请求所属连接的ID：优先取传输层设置的来源，否则为rpclib的会话ID
+ */
+uint64_t current_session();
+
+/**
+ * @brief 不要求时钟同步地估计请求在网络与接收队列中额外花费的时间
+ *
+ * 对每个客户端记录 服务器收到时的系统时间 - 客户端发送时的系统时间，即双方时钟差加上
+ * 该请求的传输与排队耗时。一段时间内的最小值近似为时钟差加最小传输耗时，单个请求超出
+ * 最小值的部分就是它额外排队的时间。最小值按两个相邻窗口维护，任一方调整时钟后旧值
+ * 最多两个窗口后失效。客户端以进程级随机的clock_id区分，重新连接后估计值仍然有效。
+ */
+class ClockOffsetTable {
+public:
+    ClockOffsetTable() = default;
+
+    ClockOffsetTable(const ClockOffsetTable&) = delete;
+    ClockOffsetTable& operator=(const ClockOffsetTable&) = delete;
+
+    /**
+     * @brief 记录一个请求
+     * @param clock_id 客户端标识
+     * @param offset_us 服务器收到时的系统时间减去客户端发送时的系统时间（微秒）
+     * @param now_us 服务器收到时的系统时间（微秒）
+     * @return 该请求超出最小值的耗时（微秒），不小于0
+     */
+    int64_t excess_us(uint64_t clock_id, int64_t offset_us, int64_t now_us);
+
+private:
+    struct Entry {
+        int64_t window_start_us;
+        int64_t current_min_us;
+        int64_t previous_min_us;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+    };
+
+    static const size_t kShards = 16;
+    Shard shards_[kShards];
+};
+
+/**
+ * @brief 一次调用的截止时间：取客户端超时与当前请求上下文中较早的一个
+ */
+class CallDeadline {
+public:
+    /**
+     * @brief 构造函数
+     * @param timeout_ms 客户端超时（毫秒），<=0表示不限
+     */
+    explicit CallDeadline(int64_t timeout_ms);
+
+    /**
+     * @brief 是否有截止时间
+     */
+    bool bounded() const { return bounded_; }
+
+    /**
+     * @brief 生成随请求发送的上下文
+     */
+    WireContext wire() const;
+
+    /**
+     * @brief 已过期时抛出DeadlineExceededError，不发送请求
+     * @param func_name 函数名
+     */
+    void check(const std::string& func_name) const;
+
+    /**
+     * @brief 等待响应直到截止时间
+     * @param response 响应
+     * @param func_name 函数名
+     * @throws DeadlineExceededError 截止时间前未收到响应时抛出异常
+     */
+    void wait(const std::future<RPCLIB_MSGPACK::object_handle>& response,
+              const std::string& func_name) const;
+
+private:
+    bool bounded_;
+    RequestContext::Clock::time_point deadline_;
+};
+
+/**
+ * @brief 把客户端发送的上下文换算为本地截止时间，并取出追踪上下文
+ *
+ * 截止时间从请求到达时起算，扣除请求在服务器内排队的时间；给出offsets时再扣除
+ * 按客户端时钟差估计的额外传输与排队耗时。
+ * @param wire 客户端上下文
+ * @param arrival 收到请求的时间
+ * @param offsets 时钟差估计，nullptr表示不估计
+ * @param trust_client_clock 是否直接用双方系统时间之差扣除传输耗时（要求时钟同步）
+ * @return 本地请求上下文
+ */
+RequestContext make_request_context(const WireContext& wire, RequestContext::Clock::time_point arrival,
+                                    ClockOffsetTable* offsets, bool trust_client_clock);
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include "rpc/detail/func_traits.h"
+
+namespace rpc_utils {
+
+namespace detail {
+
+/**
+ * @brief 服务器的停止闸门：统计执行中的处理函数，停止期间拒绝新请求
+ */
+class DrainGate {
+public:
+    DrainGate() : draining_(false), in_flight_(0) {}
+
+    /**
+     * @brief 进入处理函数
+     * @return 正在停止时返回false，此时不计入执行中的请求
+     */
+    bool enter() {
+        // 先计数再检查：drain()置位后等到计数归零，不会漏掉已经通过检查的请求
+        in_flight_.fetch_add(1);
+        if (draining_.load()) {
+            in_flight_.fetch_sub(1);
+            return false;
+        }
+        return true;
+    }
+
+    void leave() { in_flight_.fetch_sub(1, std::memory_order_release); }
+
+    /**
+     * @brief 计入一个已交给线程池、尚未执行完的请求（不检查是否正在停止），完成后调用leave
+     */
+    void hold() { in_flight_.fetch_add(1); }
+
+    /**
+     * @brief 开始停止，之后到达的请求都被拒绝
+     */
+    void close() { draining_.store(true); }
+
+    bool draining() const { return draining_.load(std::memory_order_relaxed); }
+
+    size_t in_flight() const { return in_flight_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool> draining_;
+    std::atomic<size_t> in_flight_;
+};
+
+/**
+ * @brief 以draining错误拒绝请求（客户端收到DrainingError）
+ */
+[[noreturn]] void reject_draining(const std::string& name);
+
+/**
+ * @brief 经过停止闸门的处理函数包装
+ *
+ * 服务器正在停止时不执行原函数、立即以draining错误拒绝；否则在执行期间计入
+ * 执行中的请求。保持与原函数相同的参数列表。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class GatedHandler;
+
+template<typename F, typename R, typename... Args>
+class GatedHandler<F, R, std::tuple<Args...>> {
+public:
+    GatedHandler(F func, DrainGate* gate, std::string name)
+        : func_(std::move(func)), gate_(gate), name_(std::move(name)) {}
+
+    R operator()(Args&... args) {
+        if (!gate_->enter()) {
+            reject_draining(name_);
+        }
+        Leave leave{gate_};
+        return func_(args...);
+    }
+
+private:
+    struct Leave {
+        DrainGate* gate;
+        ~Leave() { gate->leave(); }
+    };
+
+    F func_;
+    DrainGate* gate_;
+    std::string name_;
+};
+
+template<typename F>
+using gated_handler_t = GatedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+} // namespace detail
+
+} // namespace rpc_utils
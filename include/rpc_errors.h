@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <stdexcept>
+#include "rpc/msgpack.hpp"
+#include "rpc/rpc_error.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 服务器过载时返回的错误码
+ */
+const char* const kOverloadedErrorCode = "overloaded";
+
+/**
+ * @brief 请求在执行前已超过截止时间时返回的错误码
+ */
+const char* const kDeadlineExceededErrorCode = "deadline_exceeded";
+
+/**
+ * @brief 服务器正在停止、不再执行新请求时返回的错误码
+ */
+const char* const kDrainingErrorCode = "draining";
+
+/**
+ * @brief 结构化错误响应
+ *
+ * 服务器通过rpc::this_handler().respond_error()发送，客户端据code区分错误类型。
+ */
+struct ErrorInfo {
+    std::string code;
+    std::string message;
+    uint64_t retry_after_ms = 0;    // 建议的重试间隔，0表示无建议
+
+    MSGPACK_DEFINE_MAP(code, message, retry_after_ms);
+};
+
+/**
+ * @brief 服务器过载、请求被立即拒绝
+ *
+ * 请求未被执行，客户端可以退避后重试，或改发其他副本。
+ */
+class OverloadedError : public std::runtime_error {
+public:
+    OverloadedError(const std::string& what, std::string function,
+                    std::chrono::milliseconds retry_after)
+        : std::runtime_error(what),
+          function_(std::move(function)),
+          retry_after_(retry_after) {}
+
+    /**
+     * @brief 被拒绝的函数名
+     */
+    const std::string& function() const { return function_; }
+
+    /**
+     * @brief 服务器建议的重试间隔，0表示无建议
+     */
+    std::chrono::milliseconds retry_after() const { return retry_after_; }
+
+private:
+    std::string function_;
+    std::chrono::milliseconds retry_after_;
+};
+
+/**
+ * @brief 服务器正在停止（drain），请求被立即拒绝
+ *
+ * 请求未被执行，可以立即重新连接（接管监听套接字的新进程会接受新连接）或改发其他副本。
+ * 派生自OverloadedError，按过载处理的调用方无需修改。
+ */
+class DrainingError : public OverloadedError {
+public:
+    DrainingError(const std::string& what, std::string function)
+        : OverloadedError(what, std::move(function), std::chrono::milliseconds(0)) {}
+};
+
+/**
+ * @brief 调用超过截止时间
+ *
+ * 客户端在截止时间前未收到响应，或服务器收到请求时截止时间已过而未执行。
+ */
+class DeadlineExceededError : public std::runtime_error {
+public:
+    explicit DeadlineExceededError(const std::string& what) : std::runtime_error(what) {}
+};
+
+/**
+ * @brief 客户端在途请求已达上限，请求未发送
+ *
+ * 由RPCClientWrapper::set_inflight_limit配置的窗口产生，稍后重试即可。
+ */
+class InflightLimitError : public std::runtime_error {
+public:
+    explicit InflightLimitError(const std::string& what) : std::runtime_error(what) {}
+};
+
+namespace detail {
+
+/**
+ * @brief 以结构化错误拒绝当前请求（只能在I/O线程上的处理函数中调用）
+ * @param code 错误码
+ * @param message 错误信息
+ * @param retry_after 建议的重试间隔
+ */
+[[noreturn]] void respond_error_info(const char* code, const std::string& message,
+                                     std::chrono::milliseconds retry_after = std::chrono::milliseconds(0));
+
+/**
+ * @brief 以过载错误拒绝当前请求（只能在处理函数中调用）
+ * @param message 错误信息
+ * @param retry_after 建议的重试间隔
+ */
+[[noreturn]] void respond_overloaded(const std::string& message,
+                                     std::chrono::milliseconds retry_after = std::chrono::milliseconds(0));
+
+/**
+ * @brief 取出当前线程上最近一次respond_error_info发送的结构化错误并清除
+ *
+ * 供不经过rpclib分派请求的路径（同主机传输）把结构化错误转发给客户端。
+ * @param info 取出的错误
+ * @return 存在未取出的错误时返回true
+ */
+bool take_responded_error(ErrorInfo& info);
+
+/**
+ * @brief 解析错误响应中的结构化错误
+ * @param error 错误对象
+ * @param info 解析结果
+ * @return 错误对象是ErrorInfo时返回true
+ */
+bool parse_error_info(const RPCLIB_MSGPACK::object& error, ErrorInfo& info);
+
+/**
+ * @brief 检查rpclib错误是否为服务器过载（包括正在停止）
+ */
+bool is_overloaded(rpc::rpc_error& e);
+
+/**
+ * @brief 检查rpclib错误是否为服务器正在停止
+ */
+bool is_draining(rpc::rpc_error& e);
+
+/**
+ * @brief 把rpclib的调用错误转换为rpc_utils的异常
+ *
+ * 过载错误转换为OverloadedError，正在停止转换为DrainingError，超过截止时间转换为DeadlineExceededError，
+ * 其他错误转换为std::runtime_error。
+ * @param func_name 函数名
+ * @param e rpclib错误
+ * @param location 附加在函数名之后的位置描述（例如" on host:port"），可为空
+ */
+[[noreturn]] void rethrow_call_error(const std::string& func_name, rpc::rpc_error& e,
+                                     const std::string& location = std::string());
+
+/**
+ * @brief 把响应中的错误对象转换为rpc_utils的异常（规则同rethrow_call_error）
+ * @param func_name 函数名
+ * @param error 错误对象
+ * @param what 非结构化错误的描述
+ * @param location 附加在函数名之后的位置描述，可为空
+ */
+[[noreturn]] void rethrow_error_object(const std::string& func_name, const RPCLIB_MSGPACK::object& error,
+                                       const std::string& what,
+                                       const std::string& location = std::string());
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace rpc_utils {
+
+/**
+ * @brief 工作窃取线程池配置
+ */
+struct ExecutorOptions {
+    size_t threads = 0;               // 工作线程数，0表示使用硬件并发数
+    size_t queue_limit = 0;           // 排队任务上限，0表示等于线程数
+    std::vector<int> cpu_affinity;    // 工作线程依次绑定的CPU编号，为空表示不绑定
+    std::string name = "default";     // 线程池名称
+};
+
+/**
+ * @brief 工作窃取线程池
+ *
+ * 每个工作线程拥有自己的任务队列，空闲时从其他线程的队列尾部窃取任务；
+ * 排队任务数达到上限时拒绝新任务而不是无限增长。
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @brief 构造函数，立即启动所有工作线程
+     * @param options 线程池配置
+     */
+    explicit WorkStealingPool(const ExecutorOptions& options);
+
+    /**
+     * @brief 析构函数，执行完已排队的任务后停止所有工作线程
+     */
+    ~WorkStealingPool();
+
+    // 禁用拷贝
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief 提交任务
+     * @param task 任务
+     * @return false表示队列已满或线程池已停止，任务未被接受
+     */
+    bool try_submit(Task task);
+
+    /**
+     * @brief 获取工作线程数
+     * @return 线程数
+     */
+    size_t threads() const { return workers_.size(); }
+
+    /**
+     * @brief 获取排队任务上限
+     * @return 排队上限
+     */
+    size_t queue_limit() const { return queue_limit_; }
+
+    /**
+     * @brief 获取当前排队（尚未开始执行）的任务数
+     * @return 排队任务数
+     */
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 获取因队列已满而被拒绝的任务总数
+     * @return 拒绝次数
+     */
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 获取线程池名称
+     * @return 名称
+     */
+    const std::string& name() const { return name_; }
+
+    /**
+     * @brief 获取当前线程所属的线程池
+     * @return 不在任何线程池的工作线程上时返回nullptr
+     */
+    static const WorkStealingPool* current();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void worker_loop(size_t index, int cpu);
+    bool pop_local(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::string name_;
+    size_t queue_limit_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> next_;
+    std::atomic<size_t> sleepers_;
+    std::atomic<uint64_t> rejected_;
+    std::atomic<bool> stopping_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+};
+
+} // namespace rpc_utils
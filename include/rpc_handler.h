@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "rpc/msgpack.hpp"
+#include "rpc/detail/func_traits.h"
+#include "rpc_stats.h"
+#include "rpc_executor.h"
+#include "rpc_context.h"
+#include "rpc_errors.h"
+
+namespace rpc_utils {
+
+namespace detail {
+
+/**
+ * @brief 带调用统计的处理函数包装
+ *
+ * 保持与原函数相同的参数列表，以便rpclib按原签名解码参数。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class GuardedHandler;
+
+template<typename F, typename R, typename... Args>
+class GuardedHandler<F, R, std::tuple<Args...>> {
+public:
+    GuardedHandler(F func, MethodStats* stats)
+        : func_(std::move(func)), stats_(stats) {}
+
+    R operator()(Args&... args) {
+        StatsScope scope(stats_);
+        try {
+            return func_(args...);
+        } catch (...) {
+            scope.fail();
+            throw;
+        }
+    }
+
+private:
+    F func_;
+    MethodStats* stats_;
+};
+
+template<typename F>
+using guarded_handler_t = GuardedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+/**
+ * @brief 线程池已满时的错误信息
+ */
+std::string pool_full_message(const std::string& name, const WorkStealingPool& pool);
+
+/**
+ * @brief 线程池已满时以过载错误拒绝请求（客户端收到OverloadedError）
+ */
+[[noreturn]] void throw_pool_full(const std::string& name, const WorkStealingPool& pool);
+
+/**
+ * @brief 请求在线程池中排队期间已过截止时间时，以deadline_exceeded错误拒绝
+ */
+void check_queued_deadline(const RequestContext& context, const WorkStealingPool& pool);
+
+/**
+ * @brief 卸载到独立线程池执行的处理函数包装
+ *
+ * 多事件循环端口与同主机端点在分派前把整个请求交给该线程池、由工作线程写回响应，
+ * 处理函数在此先检查请求排队期间是否已过截止时间。rpclib只能在处理函数返回时写回响应，
+ * 交给线程池也释放不了I/O线程，因此从rpclib端口到达的请求直接在I/O线程上执行，
+ * 与bind绑定的方法相同。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class OffloadedHandler;
+
+template<typename F, typename R, typename... Args>
+class OffloadedHandler<F, R, std::tuple<Args...>> {
+public:
+    OffloadedHandler(F func, WorkStealingPool* pool)
+        : func_(std::move(func)), pool_(pool) {}
+
+    R operator()(Args&... args) {
+        if (WorkStealingPool::current() == pool_) {
+            check_queued_deadline(RequestContext::current(), *pool_);
+        }
+        return func_(args...);
+    }
+
+private:
+    F func_;
+    WorkStealingPool* pool_;
+};
+
+template<typename F>
+using offloaded_handler_t = OffloadedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+/**
+ * @brief 类型擦除后的方法：以msgpack参数数组调用，返回值构造在给定内存区中
+ */
+using RawMethod = std::function<RPCLIB_MSGPACK::object(
+    const RPCLIB_MSGPACK::object& args, RPCLIB_MSGPACK::zone& zone)>;
+
+/**
+ * @brief 检查参数数组的元素个数
+ * @throws std::runtime_error 参数不是数组或个数不符时抛出异常
+ */
+void check_arg_count(const std::string& name, size_t expected, const RPCLIB_MSGPACK::object& args);
+
+template<typename H, typename Tuple, size_t... I>
+RPCLIB_MSGPACK::object invoke_raw(H& handler, Tuple& args, RPCLIB_MSGPACK::zone& zone,
+                                  std::false_type, std::index_sequence<I...>) {
+    return RPCLIB_MSGPACK::object(handler(std::get<I>(args)...), zone);
+}
+
+template<typename H, typename Tuple, size_t... I>
+RPCLIB_MSGPACK::object invoke_raw(H& handler, Tuple& args, RPCLIB_MSGPACK::zone&,
+                                  std::true_type, std::index_sequence<I...>) {
+    handler(std::get<I>(args)...);
+    return RPCLIB_MSGPACK::object();
+}
+
+/**
+ * @brief 将处理函数包装为RawMethod
+ * @param name 方法名（用于错误信息）
+ * @param handler 处理函数
+ */
+template<typename H>
+RawMethod make_raw_method(const std::string& name, H handler) {
+    using traits = rpc::detail::func_traits<H>;
+    using args_type = typename traits::args_type;
+    using result_type = typename traits::result_type;
+    constexpr size_t arg_count = std::tuple_size<args_type>::value;
+
+    return [name, handler](const RPCLIB_MSGPACK::object& args,
+                           RPCLIB_MSGPACK::zone& zone) -> RPCLIB_MSGPACK::object {
+        check_arg_count(name, arg_count, args);
+        args_type args_real;
+        args.convert(args_real);
+        // 与rpclib一致，每次调用使用处理函数的副本，可被多个线程并发调用
+        H local = handler;
+        return invoke_raw(local, args_real, zone,
+                          std::is_void<result_type>(),
+                          std::make_index_sequence<arg_count>());
+    };
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace rpc_utils {
+
+namespace detail {
+
+/**
+ * @brief 交接的监听套接字
+ */
+struct InheritedSocket {
+    std::string key;    // kReactorSocketKey或同主机端点字符串（unix://...、shm://...）
+    int fd = -1;
+};
+
+/**
+ * @brief 多事件循环监听套接字的交接键，按事件循环顺序各一个
+ */
+const char* const kReactorSocketKey = "reactor";
+
+/**
+ * @brief 监听套接字交接（旧进程端）
+ *
+ * 在Unix域控制套接字上等待新进程连接，经SCM_RIGHTS一次发送所有监听套接字。
+ * 新进程开始接受连接时回复一个字节确认；收到确认前新进程退出（连接断开）时，
+ * 本进程照常服务并继续等待下一个新进程。两个进程此后共用同一组套接字，
+ * 内核中排队的连接不会丢失。
+ */
+class HandoffListener {
+public:
+    /**
+     * @brief 在交接时提供当前的监听套接字（在交接线程上调用）
+     */
+    using Provider = std::function<std::vector<InheritedSocket>()>;
+
+    /**
+     * @brief 创建并绑定控制套接字（替换路径上已有的套接字文件）
+     * @throws std::runtime_error 绑定失败时抛出异常
+     */
+    HandoffListener(const std::string& path, Provider provider);
+    ~HandoffListener();
+
+    HandoffListener(const HandoffListener&) = delete;
+    HandoffListener& operator=(const HandoffListener&) = delete;
+
+    /**
+     * @brief 等待交接完成
+     * @param timeout 等待时间，0表示一直等待
+     * @return 新进程已确认接管时返回true
+     */
+    bool wait(std::chrono::milliseconds timeout);
+
+    bool handed_off() const { return handed_off_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 停止等待新进程，关闭控制套接字
+     */
+    void stop();
+
+private:
+    void run();
+
+    /**
+     * @brief 向一个新进程发送监听套接字并等待确认
+     * @return 收到确认时返回true
+     */
+    bool serve(int fd);
+
+    std::string path_;
+    Provider provider_;
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::atomic<bool> handed_off_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+/**
+ * @brief 从旧进程接收监听套接字（新进程端）
+ * @param path 旧进程的控制套接字路径
+ * @param timeout 等待旧进程发送的时间
+ * @param control_fd 写入保持打开的控制连接，开始接受连接后交给confirm_handoff
+ * @return 收到的监听套接字
+ * @throws std::runtime_error 连接失败、超时或消息格式错误时抛出异常
+ */
+std::vector<InheritedSocket> receive_listeners(const std::string& path, std::chrono::milliseconds timeout,
+                                               int& control_fd);
+
+/**
+ * @brief 通知旧进程已开始接受连接，并关闭控制连接
+ */
+void confirm_handoff(int control_fd);
+
+} // namespace detail
+
+} // namespace rpc_utils
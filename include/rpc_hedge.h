@@ -0,0 +1,171 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include "rpc/msgpack.hpp"
+#include "rpc_stats.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 对冲请求配置
+ */
+struct HedgeOptions {
+    std::chrono::microseconds delay{0};          // 固定对冲延迟，0表示按观测到的分位延迟
+    double percentile = 0.95;                    // 自适应延迟使用的分位点
+    std::chrono::microseconds min_delay{1000};   // 自适应对冲延迟的下限
+    uint64_t window = 1000;                      // 每累积多少个样本重新计算一次分位延迟，首个窗口满之前不对冲
+    double budget_ratio = 0.05;                  // 对冲请求数相对普通请求数的上限比例
+    double max_burst = 10;                       // 预算令牌上限，允许的对冲突发数
+};
+
+/**
+ * @brief 对冲请求统计
+ */
+struct HedgeStats {
+    uint64_t requests = 0;           // 走对冲流程的调用数
+    uint64_t hedged = 0;             // 实际发出对冲请求的次数
+    uint64_t hedge_wins = 0;         // 对冲请求先返回的次数
+    uint64_t budget_exhausted = 0;   // 因预算不足放弃对冲的次数
+};
+
+/**
+ * @brief 对冲请求策略
+ *
+ * 对标记为幂等的方法，若主请求在对冲延迟内没有返回，就向另一条连接（或另一个端点）
+ * 再发送一次相同请求，取先到的响应，另一个响应到达后被丢弃。对冲延迟默认取该方法
+ * 最近一个窗口内观测到的p95；对冲次数由令牌桶限制：每个请求存入budget_ratio个令牌，
+ * 每次对冲消耗一个，额外负载因此不超过budget_ratio。
+ * 可被多个客户端和线程共享。
+ */
+class HedgePolicy {
+public:
+    /**
+     * @brief 构造函数
+     * @param options 对冲配置
+     */
+    explicit HedgePolicy(HedgeOptions options = HedgeOptions());
+
+    HedgePolicy(const HedgePolicy&) = delete;
+    HedgePolicy& operator=(const HedgePolicy&) = delete;
+
+    /**
+     * @brief 把方法标记为幂等，允许对冲
+     * @param name 方法名
+     */
+    void mark_idempotent(const std::string& name);
+
+    /**
+     * @brief 检查方法是否允许对冲
+     * @param name 方法名
+     * @return 已标记为幂等时返回true
+     */
+    bool is_idempotent(const std::string& name) const;
+
+    /**
+     * @brief 获取方法当前的对冲延迟
+     * @param name 方法名
+     * @return 对冲延迟，未标记为幂等或尚无足够样本时返回microseconds::max()
+     */
+    std::chrono::microseconds delay(const std::string& name) const;
+
+    /**
+     * @brief 获取统计
+     * @return 统计快照
+     */
+    HedgeStats stats() const;
+
+    /**
+     * @brief 单个幂等方法的延迟观测
+     */
+    struct Method {
+        LatencyHistogram latency;     // 纳秒
+        std::atomic<uint64_t> samples{0};
+        std::atomic<int64_t> delay_us{-1};    // -1表示尚未估计
+    };
+
+    /**
+     * @brief 查找幂等方法的观测状态
+     * @param name 方法名
+     * @return 未标记为幂等时返回nullptr；返回的指针在策略生命周期内有效
+     */
+    Method* find(const std::string& name) const;
+
+    /**
+     * @brief 记录一次普通请求，向预算存入令牌
+     */
+    void on_request();
+
+    /**
+     * @brief 尝试为一次对冲消耗令牌
+     * @return 预算充足时返回true
+     */
+    bool try_hedge();
+
+    /**
+     * @brief 记录一次成功调用的耗时，每满一个窗口重新计算对冲延迟
+     * @param method 方法观测状态
+     * @param latency_ns 从发出主请求到收到首个响应的耗时
+     * @param hedge_won 是否由对冲请求返回
+     */
+    void record(Method* method, uint64_t latency_ns, bool hedge_won);
+
+    /**
+     * @brief 对冲延迟
+     * @param method 方法观测状态
+     * @return 对冲延迟，尚无足够样本时返回microseconds::max()
+     */
+    std::chrono::microseconds delay(const Method* method) const;
+
+private:
+    HedgeOptions options_;
+    int64_t token_unit_;      // 一次对冲消耗的令牌（以千分之一为单位）
+    int64_t token_deposit_;   // 每个请求存入的令牌
+    int64_t token_max_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Method>> methods_;
+
+    std::atomic<int64_t> tokens_;
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> hedged_;
+    std::atomic<uint64_t> hedge_wins_;
+    std::atomic<uint64_t> budget_exhausted_;
+};
+
+namespace detail {
+
+/**
+ * @brief 对冲调用的结果
+ */
+struct HedgedResult {
+    RPCLIB_MSGPACK::object_handle handle;
+    bool hedge_won = false;
+};
+
+/**
+ * @brief 执行一次对冲调用
+ *
+ * 先发送主请求，超过对冲延迟仍未返回且预算允许时再发送对冲请求，返回先成功的响应。
+ * 服务端返回的错误（rpc::rpc_error）立即抛出；某一路传输失败时继续等待另一路。
+ * @param policy 对冲策略
+ * @param method 方法观测状态（非空）
+ * @param func_name 方法名，用于超时错误信息
+ * @param send 发送请求，参数为true表示对冲请求（须发往另一条连接或另一个端点）
+ * @param timeout_ms 整体超时（毫秒），<=0表示不限
+ * @return 先返回的响应
+ */
+HedgedResult run_hedged(HedgePolicy& policy, HedgePolicy::Method* method,
+                        const std::string& func_name,
+                        const std::function<std::future<RPCLIB_MSGPACK::object_handle>(bool)>& send,
+                        int64_t timeout_ms);
+
+} // namespace detail
+
+} // namespace rpc_utils
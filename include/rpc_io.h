@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+/**
+ * @brief 写合并配置
+ *
+ * 启用后同一连接上连续产生的帧先在发送缓冲区中累积，在连接即将空闲时一次写出：
+ * 服务器端为已读入的请求全部处理完、即将等待新数据时，客户端为有线程开始等待响应时；
+ * 累积字节数达到max_bytes时立即写出。适用于系统调用开销高的环境（例如Occlum/SGX中
+ * 每次系统调用都要退出飞地）。
+ */
+struct CoalesceOptions {
+    bool enabled = false;
+    size_t max_bytes = 64 * 1024;   // 累积达到该字节数时立即写出
+};
+
+/**
+ * @brief 传输层系统调用与帧计数（全进程，含已退出线程）
+ *
+ * 只统计rpc_utils自己实现的传输：多事件循环端口与unix://、shm://端点；
+ * rpclib的TCP连接不在其中。
+ */
+struct IoStats {
+    uint64_t read_calls = 0;    // read/recv
+    uint64_t write_calls = 0;   // send/sendmsg
+    uint64_t wait_calls = 0;    // poll/epoll_wait/futex
+    uint64_t frames_in = 0;     // 收到的帧（服务器为请求与通知，客户端为响应）
+    uint64_t frames_out = 0;    // 发出的帧
+
+    uint64_t syscalls() const { return read_calls + write_calls + wait_calls; }
+
+    /**
+     * @brief 每收到一帧平均的系统调用数
+     */
+    double syscalls_per_rpc() const {
+        return frames_in > 0 ? static_cast<double>(syscalls()) / static_cast<double>(frames_in) : 0.0;
+    }
+
+    MSGPACK_DEFINE_MAP(read_calls, write_calls, wait_calls, frames_in, frames_out);
+};
+
+/**
+ * @brief 汇总所有线程的传输层计数
+ */
+IoStats io_stats();
+
+namespace detail {
+
+/**
+ * @brief rpc_utils自己实现的传输上单帧（一个请求或响应）的最大字节数
+ *
+ * 同主机传输的长度前缀与多事件循环端口上未解析完的请求超过该值时关闭连接，
+ * 避免对端声明的长度使本进程分配任意大的内存。
+ */
+const size_t kMaxFrameSize = 64 * 1024 * 1024;
+
+enum class IoCounter { read_calls, write_calls, wait_calls, frames_in, frames_out };
+
+/**
+ * @brief 累加当前线程的传输层计数（不加锁）
+ */
+void count_io(IoCounter counter, uint64_t n = 1);
+
+/**
+ * @brief 连接的异步响应出口
+ *
+ * 请求被交给线程池执行时，工作线程通过它把打包好的响应交回连接发送，
+ * 收到请求的事件循环或连接线程不等待执行结果。线程安全；连接关闭后交回的响应被丢弃。
+ */
+class ReplyChannel {
+public:
+    virtual ~ReplyChannel() = default;
+
+    /**
+     * @brief 交回一个完整的响应帧
+     */
+    virtual void post(const char* data, size_t size) = 0;
+};
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "rpc/msgpack.hpp"
+#include "rpc/detail/func_traits.h"
+#include "rpc_errors.h"
+#include "rpc_context.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 并发限制器配置
+ *
+ * min_limit与max_limit相等时为固定上限，不做自适应调整。
+ */
+struct LimiterOptions {
+    size_t initial_limit = 0;                           // 初始并发上限，0表示按执行处理函数的线程数设置
+    size_t min_limit = 1;                               // 并发上限的下限
+    size_t max_limit = 1000;                            // 并发上限的上限
+    double tolerance = 1.5;                             // 短期延迟超过长期延迟多少倍才开始收缩
+    double smoothing = 0.2;                             // 每个窗口向新上限靠拢的比例
+    size_t long_window = 600;                           // 长期延迟EWMA覆盖的窗口数
+    std::chrono::milliseconds window{100};              // 采样窗口长度
+};
+
+/**
+ * @brief 并发限制器统计
+ */
+struct LimiterStats {
+    uint64_t limit = 0;        // 当前并发上限
+    uint64_t in_flight = 0;    // 当前执行中的请求数
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    double short_rtt_us = 0;   // 最近一个窗口的平均耗时
+    double long_rtt_us = 0;    // 长期耗时EWMA
+
+    MSGPACK_DEFINE_MAP(limit, in_flight, accepted, rejected, short_rtt_us, long_rtt_us);
+};
+
+/**
+ * @brief 自适应并发限制器（梯度算法）
+ *
+ * 每个采样窗口结束时比较该窗口的平均耗时（短期）与长期耗时EWMA：
+ * 短期耗时明显升高说明请求开始排队，上限按 long/short 的比例收缩；
+ * 耗时平稳时上限每个窗口增加约 sqrt(limit)，持续探测可用的并发度。
+ * 超出上限的请求立即被拒绝，而不是排队等到超时。
+ * 准入与释放只做原子操作，窗口结算由恰好跨过窗口边界的线程完成。
+ */
+class ConcurrencyLimiter {
+public:
+    /**
+     * @brief 构造函数
+     * @param options 限制器配置
+     */
+    explicit ConcurrencyLimiter(const LimiterOptions& options = LimiterOptions());
+
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    /**
+     * @brief 尝试准入一个请求
+     * @return 未超过并发上限时返回true，调用方之后必须调用release或abandon
+     */
+    bool try_acquire();
+
+    /**
+     * @brief 请求完成，归还并发额度并记录耗时
+     * @param latency_ns 请求耗时（纳秒）
+     */
+    void release(uint64_t latency_ns);
+
+    /**
+     * @brief 归还并发额度但不记录耗时（例如请求在其他限制器处被拒绝）
+     */
+    void abandon();
+
+    /**
+     * @brief 按实际执行处理函数的线程数设置初始上限
+     *
+     * 只在initial_limit为0且尚未设置过时生效，由服务器在开始运行时调用。
+     * @param concurrency 可同时执行处理函数的线程数
+     */
+    void seed(size_t concurrency);
+
+    /**
+     * @brief 获取当前并发上限
+     */
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 建议被拒绝的客户端等待的时间（约为长期平均耗时）
+     */
+    std::chrono::milliseconds retry_after() const;
+
+    /**
+     * @brief 获取统计
+     * @return 统计快照
+     */
+    LimiterStats stats() const;
+
+private:
+    void close_window(int64_t now_ns);
+
+    LimiterOptions options_;
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> in_flight_;
+    std::atomic<uint64_t> accepted_;
+    std::atomic<uint64_t> rejected_;
+
+    // 当前采样窗口
+    std::atomic<int64_t> window_start_ns_;
+    std::atomic<uint64_t> window_sum_ns_;
+    std::atomic<uint64_t> window_count_;
+    std::atomic<size_t> window_max_in_flight_;
+    std::atomic<int64_t> retry_after_ms_;
+
+    // 由mutex_保护的估计值
+    mutable std::mutex mutex_;
+    bool seeded_;
+    double estimated_limit_;
+    double short_rtt_ns_;
+    double long_rtt_ns_;
+};
+
+namespace detail {
+
+/**
+ * @brief 一次准入的并发额度，析构时归还
+ *
+ * 耗时从传输层读到请求时算起，包含请求在服务器内排队的时间；
+ * 传输层没有记录到达时间时（rpclib端口）从准入时算起。
+ */
+class LimiterPermit {
+public:
+    explicit LimiterPermit(ConcurrencyLimiter* limiter)
+        : limiter_(limiter != nullptr && limiter->try_acquire() ? limiter : nullptr),
+          rejected_(limiter != nullptr && limiter_ == nullptr),
+          start_(current_origin().has_arrival() ? current_origin().arrival
+                                                : std::chrono::steady_clock::now()) {}
+
+    ~LimiterPermit() {
+        if (limiter_ != nullptr) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            limiter_->release(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    LimiterPermit(const LimiterPermit&) = delete;
+    LimiterPermit& operator=(const LimiterPermit&) = delete;
+
+    /**
+     * @brief 是否被拒绝（未设置限制器时不会被拒绝）
+     */
+    bool rejected() const { return rejected_; }
+
+    /**
+     * @brief 放弃额度，不记录耗时
+     */
+    void abandon() {
+        if (limiter_ != nullptr) {
+            limiter_->abandon();
+            limiter_ = nullptr;
+        }
+    }
+
+private:
+    ConcurrencyLimiter* limiter_;
+    bool rejected_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief 以过载错误拒绝请求
+ * @param name 方法名
+ * @param limiter 拒绝请求的限制器
+ * @param scope 限制范围描述（"server"或"method"）
+ */
+[[noreturn]] void reject_overloaded(const std::string& name, const ConcurrencyLimiter& limiter,
+                                    const char* scope);
+
+/**
+ * @brief 带并发限制的处理函数包装
+ *
+ * 先检查方法级上限，再检查服务器级上限；任一超限时立即以过载错误拒绝，
+ * 不执行原函数。保持与原函数相同的参数列表。
+ */
+template<typename F, typename R, typename ArgsTuple>
+class LimitedHandler;
+
+template<typename F, typename R, typename... Args>
+class LimitedHandler<F, R, std::tuple<Args...>> {
+public:
+    LimitedHandler(F func, std::shared_ptr<ConcurrencyLimiter> server_limiter,
+                   std::shared_ptr<ConcurrencyLimiter> method_limiter, std::string name)
+        : func_(std::move(func)),
+          server_limiter_(std::move(server_limiter)),
+          method_limiter_(std::move(method_limiter)),
+          name_(std::move(name)) {}
+
+    R operator()(Args&... args) {
+        LimiterPermit method_permit(method_limiter_.get());
+        if (method_permit.rejected()) {
+            reject_overloaded(name_, *method_limiter_, "method");
+        }
+        LimiterPermit server_permit(server_limiter_.get());
+        if (server_permit.rejected()) {
+            method_permit.abandon();
+            reject_overloaded(name_, *server_limiter_, "server");
+        }
+        return func_(args...);
+    }
+
+private:
+    F func_;
+    std::shared_ptr<ConcurrencyLimiter> server_limiter_;
+    std::shared_ptr<ConcurrencyLimiter> method_limiter_;
+    std::string name_;
+};
+
+template<typename F>
+using limited_handler_t = LimitedHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+} // namespace detail
+
+} // namespace rpc_utils
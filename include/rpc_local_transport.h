@@ -0,0 +1,417 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <tuple>
+#include <sys/uio.h>
+#include "rpc/msgpack.hpp"
+#include "rpc_compress.h"
+#include "rpc_io.h"
+
+namespace rpc_utils {
+
+namespace detail {
+
+/**
+ * @brief 传输方式
+ */
+enum class TransportKind {
+    tcp,            // rpclib的TCP连接
+    unix_socket,    // Unix域套接字
+    shm,            // 共享内存环形缓冲区（经Unix域套接字握手）
+};
+
+/**
+ * @brief 端点地址
+ *
+ * 支持 host:port、tcp://host:port、unix:///path/to.sock 与 shm://name。
+ * shm端点的握手套接字位于 $TMPDIR（默认/tmp）下的 rpc_utils.shm.<name>.sock。
+ */
+struct TransportAddress {
+    TransportKind kind = TransportKind::tcp;
+    std::string host;
+    uint16_t port = 0;
+    std::string path;       // Unix域套接字路径（shm为握手套接字路径）
+    std::string name;       // shm名称
+
+    /**
+     * @brief 解析端点字符串
+     * @throws std::invalid_argument 格式错误时抛出异常
+     */
+    static TransportAddress parse(const std::string& endpoint);
+
+    std::string to_string() const;
+};
+
+/**
+ * @brief 同主机连接：按帧收发msgpack消息
+ *
+ * Unix域套接字模式下每帧为4字节长度加消息体；共享内存模式下消息经两个单生产者/
+ * 单消费者环形缓冲区传递，等待时先自旋再在futex上休眠，对端未休眠时收发都不需要
+ * 系统调用。握手用的套接字在共享内存模式下只用于检测对端退出。
+ * 启用写合并后send()只把帧放入发送缓冲区（共享内存模式下写入环但暂不发布），
+ * 由flush()或累积达到上限时一次写出。
+ * 同一时刻只允许一个线程发送、一个线程接收。
+ */
+class LocalConnection {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 连接到服务器（客户端）
+     * @throws std::runtime_error 连接或握手失败时抛出异常
+     */
+    static std::unique_ptr<LocalConnection> connect(const TransportAddress& address);
+
+    /**
+     * @brief 接管已接受的套接字（服务器），shm模式下完成握手
+     * @throws std::runtime_error 握手失败时抛出异常
+     */
+    static std::unique_ptr<LocalConnection> accept(int fd, TransportKind kind);
+
+    ~LocalConnection();
+
+    LocalConnection(const LocalConnection&) = delete;
+    LocalConnection& operator=(const LocalConnection&) = delete;
+
+    /**
+     * @brief 发送一帧
+     * @throws std::runtime_error 连接已关闭时抛出异常
+     */
+    void send(const char* data, size_t size);
+
+    /**
+     * @brief 设置写合并（与send()在同一线程上调用）
+     */
+    void set_coalescing(const CoalesceOptions& options);
+
+    /**
+     * @brief 写出写合并累积的帧，没有累积时什么也不做
+     * @throws std::runtime_error 连接已关闭时抛出异常
+     */
+    void flush();
+
+    /**
+     * @brief 接收缓冲区中是否已有完整的帧（为true时receive()不需要等待）
+     */
+    bool has_buffered_frame() const;
+
+    /**
+     * @brief 接收一帧
+     *
+     * deadline只限制等待帧开始的时间，帧一旦开始到达就会读完，保证不会读到半帧。
+     * @param frame 接收缓冲区
+     * @param deadline 截止时间
+     * @return 超时返回false
+     * @throws std::runtime_error 连接已关闭时抛出异常
+     */
+    bool receive(ScratchBuffer& frame, Clock::time_point deadline);
+
+    /**
+     * @brief 关闭连接并唤醒对端
+     */
+    void close();
+
+    bool is_open() const { return open_.load(std::memory_order_acquire); }
+
+private:
+    struct Ring;
+
+    LocalConnection(int fd, TransportKind kind);
+
+    void map_segment(void* segment, size_t capacity, bool client_side);
+    void socket_send(const char* data, size_t size);
+    void socket_write(iovec* iov, size_t count);
+    bool socket_fill(Clock::time_point deadline);
+    bool socket_receive(ScratchBuffer& frame, Clock::time_point deadline);
+    void ring_send(const char* data, size_t size);
+    void ring_publish();
+    bool ring_receive(ScratchBuffer& frame, Clock::time_point deadline);
+    [[noreturn]] void fail(const std::string& what);
+
+    int fd_;
+    TransportKind kind_;
+    std::atomic<bool> open_;
+    // 共享内存模式
+    void* segment_;
+    size_t segment_size_;
+    std::unique_ptr<Ring> out_;
+    std::unique_ptr<Ring> in_;
+    uint64_t out_head_;         // 已写入out_但可能尚未发布的位置
+    // 套接字模式的读缓冲
+    std::unique_ptr<char[]> inbox_;
+    size_t inbox_begin_;
+    size_t inbox_end_;
+    // 写合并
+    CoalesceOptions coalesce_;
+    ScratchBuffer outbox_;      // 套接字模式下累积的帧（含长度前缀）
+};
+
+/**
+ * @brief 同主机传输的客户端
+ *
+ * 请求按msgpack-rpc格式编码。服务器按顺序处理同一连接上的请求，响应也按顺序返回；
+ * 等待响应的线程自己从连接读取（同一时刻只有一个线程读取，读到其他请求的响应时
+ * 转交给对应的等待者），同步调用不经过额外的线程切换。
+ * 启用写合并时，请求与通知先累积，在有线程开始等待响应、调用flush()或累积达到上限时
+ * 一次写出。
+ */
+class LocalClient {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 连接到服务器
+     * @throws std::runtime_error 连接失败时抛出异常
+     */
+    explicit LocalClient(const TransportAddress& address);
+    ~LocalClient();
+
+    LocalClient(const LocalClient&) = delete;
+    LocalClient& operator=(const LocalClient&) = delete;
+
+    /**
+     * @brief 同步调用
+     * @param timeout_ms 超时（毫秒），<=0表示不限
+     * @throws std::runtime_error 调用失败或超时时抛出异常
+     */
+    template<typename... Args>
+    RPCLIB_MSGPACK::object_handle call(const std::string& func_name, int64_t timeout_ms, Args&&... args);
+
+    /**
+     * @brief 异步调用，返回延迟求值（deferred）的future
+     */
+    template<typename... Args>
+    std::future<RPCLIB_MSGPACK::object_handle> async_call(const std::string& func_name, Args&&... args);
+
+    /**
+     * @brief 按方法ID同步调用，ID放在请求的方法名位置
+     * @param method_id 方法ID
+     * @param func_name 方法名（用于错误信息）
+     */
+    template<typename... Args>
+    RPCLIB_MSGPACK::object_handle call_id(uint64_t method_id, const std::string& func_name,
+                                          int64_t timeout_ms, Args&&... args);
+
+    /**
+     * @brief 按方法ID异步调用
+     */
+    template<typename... Args>
+    std::future<RPCLIB_MSGPACK::object_handle> async_call_id(uint64_t method_id, const std::string& func_name,
+                                                             Args&&... args);
+
+    /**
+     * @brief 发送通知
+     */
+    template<typename... Args>
+    void notify(const std::string& func_name, Args&&... args);
+
+    bool is_connected() const { return connection_->is_open(); }
+
+    /**
+     * @brief 设置写合并，关闭时写出已累积的请求
+     */
+    void set_coalescing(const CoalesceOptions& options);
+
+    /**
+     * @brief 写出累积的请求与通知
+     * @throws std::runtime_error 连接已断开时抛出异常
+     */
+    void flush();
+
+private:
+    template<typename Method, typename... Args>
+    uint32_t send_request(const Method& method, Args&&... args);
+
+    static Clock::time_point deadline_after(int64_t timeout_ms) {
+        return timeout_ms > 0 ? Clock::now() + std::chrono::milliseconds(timeout_ms) : Clock::time_point::max();
+    }
+
+    std::future<RPCLIB_MSGPACK::object_handle> deferred_response(uint32_t id, const std::string& func_name) {
+        return std::async(std::launch::deferred, [this, id, func_name]() {
+            return wait_response(id, func_name, Clock::time_point::max());
+        });
+    }
+
+    void send_frame(const ScratchBuffer& frame);
+
+    /**
+     * @brief 等待指定请求的响应
+     * @throws std::runtime_error 服务器返回错误、超时或连接断开时抛出异常
+     */
+    RPCLIB_MSGPACK::object_handle wait_response(uint32_t id, const std::string& func_name,
+                                                Clock::time_point deadline);
+
+    std::unique_ptr<LocalConnection> connection_;
+    std::string endpoint_;
+    std::atomic<uint32_t> next_id_;
+    std::atomic<bool> coalescing_;
+    std::mutex write_mutex_;
+    std::mutex read_mutex_;
+    std::condition_variable read_cv_;
+    bool reading_;
+    std::string failure_;
+    std::unordered_map<uint32_t, RPCLIB_MSGPACK::object_handle> ready_;
+    std::unordered_set<uint32_t> abandoned_;
+};
+
+/**
+ * @brief 同主机传输的监听器（服务器端）
+ *
+ * 每个连接由一个专用线程按顺序处理，处理函数直接在该线程上执行；处理函数也可以把请求
+ * 交给其他线程，之后经连接的ReplyChannel交回响应，与连接线程的发送经同一把锁串行。
+ * 启用写合并时，一次读入的多个请求的响应在处理完这些请求后一起写出。
+ */
+class LocalListener {
+public:
+    /**
+     * @brief 处理一帧请求，需要立即响应时写入reply并返回true
+     *
+     * 通知，或请求已交给其他线程、稍后经channel交回响应时返回false。
+     */
+    using Handler = std::function<bool(const char* data, size_t size, ScratchBuffer& reply,
+                                       const std::shared_ptr<ReplyChannel>& channel)>;
+
+    /**
+     * @brief 连接关闭时在连接线程上调用，参数为连接ID（即请求来源中的session）
+     */
+    using SessionClosed = std::function<void(uint64_t session)>;
+
+    /**
+     * @brief 创建并绑定监听套接字
+     * @param on_close 连接关闭通知，可以为空
+     * @param coalesce 响应的写合并配置
+     * @param inherited_fd 从旧进程接管的监听套接字，给出时不再绑定；-1表示新建
+     * @throws std::runtime_error 绑定失败时抛出异常
+     */
+    LocalListener(const TransportAddress& address, Handler handler, SessionClosed on_close = SessionClosed(),
+                  const CoalesceOptions& coalesce = CoalesceOptions(), int inherited_fd = -1);
+    ~LocalListener();
+
+    LocalListener(const LocalListener&) = delete;
+    LocalListener& operator=(const LocalListener&) = delete;
+
+    /**
+     * @brief 开始接受连接
+     */
+    void start();
+
+    /**
+     * @brief 停止接受连接并关闭所有连接，等待处理线程退出
+     */
+    void stop();
+
+    /**
+     * @brief 停止接受新连接并关闭监听套接字，已有连接照常处理
+     */
+    void stop_accepting();
+
+    /**
+     * @brief 监听套接字（用于交接给新进程），停止接受连接后为-1
+     */
+    int listen_fd() const { return listen_fd_; }
+
+    /**
+     * @brief 监听套接字已交给新进程，析构时不删除套接字文件
+     */
+    void release_path() { owns_path_ = false; }
+
+    const TransportAddress& address() const { return address_; }
+
+private:
+    class Channel;
+
+    struct Session {
+        explicit Session(int session_fd) : fd(session_fd), connection(nullptr), done(false) {}
+
+        int fd;
+        std::thread thread;
+        LocalConnection* connection;    // 由mutex_保护，握手完成后有效
+        std::atomic<bool> done;
+    };
+
+    void accept_loop();
+    void serve(Session* session);
+    void reap_sessions();
+
+    TransportAddress address_;
+    Handler handler_;
+    SessionClosed on_close_;
+    CoalesceOptions coalesce_;
+    int listen_fd_;
+    bool owns_path_;
+    std::atomic<bool> running_;
+    std::atomic<bool> accepting_;
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::list<std::unique_ptr<Session>> sessions_;
+};
+
+// 模板实现
+template<typename Method, typename... Args>
+uint32_t LocalClient::send_request(const Method& method, Args&&... args) {
+    uint32_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    ScratchBuffer frame;
+    RPCLIB_MSGPACK::packer<ScratchBuffer> packer(frame);
+    packer.pack_array(4);
+    packer.pack(static_cast<uint8_t>(0));
+    packer.pack(id);
+    packer.pack(method);
+    packer.pack(std::forward_as_tuple(args...));
+    send_frame(frame);
+    return id;
+}
+
+template<typename... Args>
+RPCLIB_MSGPACK::object_handle LocalClient::call(const std::string& func_name, int64_t timeout_ms,
+                                                Args&&... args) {
+    uint32_t id = send_request(func_name, std::forward<Args>(args)...);
+    return wait_response(id, func_name, deadline_after(timeout_ms));
+}
+
+template<typename... Args>
+std::future<RPCLIB_MSGPACK::object_handle> LocalClient::async_call(const std::string& func_name,
+                                                                   Args&&... args) {
+    uint32_t id = send_request(func_name, std::forward<Args>(args)...);
+    return deferred_response(id, func_name);
+}
+
+template<typename... Args>
+RPCLIB_MSGPACK::object_handle LocalClient::call_id(uint64_t method_id, const std::string& func_name,
+                                                   int64_t timeout_ms, Args&&... args) {
+    uint32_t id = send_request(method_id, std::forward<Args>(args)...);
+    return wait_response(id, func_name, deadline_after(timeout_ms));
+}
+
+template<typename... Args>
+std::future<RPCLIB_MSGPACK::object_handle> LocalClient::async_call_id(uint64_t method_id,
+                                                                      const std::string& func_name,
+                                                                      Args&&... args) {
+    uint32_t id = send_request(method_id, std::forward<Args>(args)...);
+    return deferred_response(id, func_name);
+}
+
+template<typename... Args>
+void LocalClient::notify(const std::string& func_name, Args&&... args) {
+    ScratchBuffer frame;
+    RPCLIB_MSGPACK::packer<ScratchBuffer> packer(frame);
+    packer.pack_array(3);
+    packer.pack(static_cast<uint8_t>(2));
+    packer.pack(func_name);
+    packer.pack(std::forward_as_tuple(args...));
+    send_frame(frame);
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
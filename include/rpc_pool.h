@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+/**
+ * @brief 内存池配置
+ *
+ * 临时缓冲区与msgpack内存区（zone）按线程缓存，取用和归还都不加锁。
+ * 超出上限的对象直接释放，修改配置对之后的归还生效。
+ */
+struct PoolOptions {
+    size_t max_spare_buffers = 4;                       // 每个线程保留的空闲缓冲区数
+    size_t max_buffer_capacity = 32 * 1024 * 1024;      // 容量超过该值的缓冲区用完即释放
+    size_t max_spare_zones = 16;                        // 每个线程保留的空闲内存区数
+};
+
+/**
+ * @brief 内存池统计（全进程，含已退出线程）
+ */
+struct PoolStats {
+    uint64_t buffer_hits = 0;       // 从空闲缓冲区取得的次数
+    uint64_t buffer_misses = 0;     // 新分配缓冲区的次数
+    uint64_t zone_hits = 0;         // 从空闲内存区取得的次数
+    uint64_t zone_misses = 0;       // 新分配内存区的次数
+
+    double buffer_hit_rate() const {
+        uint64_t total = buffer_hits + buffer_misses;
+        return total > 0 ? static_cast<double>(buffer_hits) / static_cast<double>(total) : 0.0;
+    }
+
+    double zone_hit_rate() const {
+        uint64_t total = zone_hits + zone_misses;
+        return total > 0 ? static_cast<double>(zone_hits) / static_cast<double>(total) : 0.0;
+    }
+
+    MSGPACK_DEFINE_MAP(buffer_hits, buffer_misses, zone_hits, zone_misses);
+};
+
+/**
+ * @brief 设置内存池配置
+ */
+void set_pool_options(const PoolOptions& options);
+
+/**
+ * @brief 当前内存池配置
+ */
+PoolOptions pool_options();
+
+/**
+ * @brief 汇总所有线程的内存池统计
+ */
+PoolStats pool_stats();
+
+namespace detail {
+
+struct SharedObject;
+
+/**
+ * @brief 线程内复用的临时缓冲区
+ *
+ * 构造时从当前线程的空闲缓冲区中取出一个，析构时归还，容量在多次调用之间保留；
+ * 同一线程上嵌套使用（例如处理函数内发起压缩调用）时各自取得不同的缓冲区。
+ * 提供write接口，可直接作为msgpack packer的输出流。
+ */
+class ScratchBuffer {
+public:
+    ScratchBuffer();
+    ~ScratchBuffer();
+
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+    char* data() { return data_.get(); }
+    const char* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+    void clear() { size_ = 0; }
+
+    /**
+     * @brief 调整长度，新增的字节不初始化
+     */
+    void resize(size_t size) {
+        if (size > capacity_) {
+            grow(size);
+        }
+        size_ = size;
+    }
+
+    void write(const char* data, size_t size) {
+        if (size_ + size > capacity_) {
+            grow(size_ + size);
+        }
+        std::memcpy(data_.get() + size_, data, size);
+        size_ += size;
+    }
+
+private:
+    void grow(size_t min_capacity);
+
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+    size_t capacity_;
+};
+
+/**
+ * @brief 从当前线程的空闲内存区中取出一个，没有时新建
+ *
+ * 返回的内存区与普通new出的相同，可以交给object_handle；不归还时照常释放。
+ */
+std::unique_ptr<RPCLIB_MSGPACK::zone> acquire_zone();
+
+/**
+ * @brief 清空内存区（执行终结器、只保留第一块）并放回当前线程的空闲列表
+ */
+void recycle_zone(std::unique_ptr<RPCLIB_MSGPACK::zone> zone);
+
+/**
+ * @brief 作用域内借用的内存区，析构时归还
+ */
+class PooledZone {
+public:
+    PooledZone() : zone_(acquire_zone()) {}
+    ~PooledZone() { recycle_zone(std::move(zone_)); }
+
+    PooledZone(const PooledZone&) = delete;
+    PooledZone& operator=(const PooledZone&) = delete;
+
+    RPCLIB_MSGPACK::zone& operator*() { return *zone_; }
+    RPCLIB_MSGPACK::zone* operator->() { return zone_.get(); }
+
+    /**
+     * @brief 交出内存区的所有权（例如交给object_handle），之后不再归还
+     */
+    std::unique_ptr<RPCLIB_MSGPACK::zone> release() { return std::move(zone_); }
+
+private:
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone_;
+};
+
+/**
+ * @brief 把位于zone中的对象包装为共享对象，最后一个引用释放时内存区归还给当时所在线程的池
+ */
+SharedObject make_shared_object(const RPCLIB_MSGPACK::object& object,
+                                std::unique_ptr<RPCLIB_MSGPACK::zone> zone);
+
+/**
+ * @brief 解包一段完整的msgpack数据到池中的内存区，数据被拷贝，输入可随即复用
+ */
+RPCLIB_MSGPACK::object_handle pooled_unpack(const char* data, size_t size);
+
+} // namespace detail
+
+} // namespace rpc_utils
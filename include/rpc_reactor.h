@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+#include "rpc_pool.h"
+#include "rpc_io.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 多事件循环模式配置
+ */
+struct ReactorOptions {
+    size_t threads = 0;         // 事件循环数，0表示进程可用的CPU数
+    bool pin_threads = true;    // 把第i个事件循环绑定到进程可用的第i个CPU
+};
+
+/**
+ * @brief 单个事件循环的统计
+ */
+struct ReactorStats {
+    int64_t cpu = -1;           // 绑定的CPU，未绑定时为-1
+    uint64_t connections = 0;   // 当前连接数
+    uint64_t accepted = 0;      // 累计接受的连接数
+    uint64_t requests = 0;      // 累计处理的请求与通知数
+
+    MSGPACK_DEFINE_MAP(cpu, connections, accepted, requests);
+};
+
+namespace detail {
+
+/**
+ * @brief 多事件循环TCP服务：每个循环一个SO_REUSEPORT监听套接字和一个epoll实例
+ *
+ * 内核按连接把新连接分给各循环的监听套接字，连接此后一直由接受它的循环处理，
+ * 不在线程间迁移。协议为标准msgpack-rpc，rpclib客户端可以直接连接。
+ * 一次可读事件中尽量多读（读满缓冲区时接着读），依次处理读到的所有请求，
+ * 这些请求的响应合并为一次发送。处理函数可以把请求交给其他线程，之后经连接的
+ * ReplyChannel交回响应：响应进入所属循环的完成队列，由eventfd唤醒循环追加到连接上发送。
+ * 仅支持Linux。
+ */
+class ReactorGroup {
+public:
+    /**
+     * @brief 处理一个请求对象，需要立即响应时追加到reply并返回true
+     *
+     * 通知，或请求已交给其他线程、稍后经channel交回响应时返回false。
+     * @throws std::exception 请求格式错误时抛出异常，连接随之关闭
+     */
+    using Handler = std::function<bool(const RPCLIB_MSGPACK::object& request, ScratchBuffer& reply,
+                                       const std::shared_ptr<ReplyChannel>& channel)>;
+
+    /**
+     * @brief 连接关闭时在所属循环的线程上调用，参数为连接ID（即请求来源中的session）
+     */
+    using SessionClosed = std::function<void(uint64_t session)>;
+
+    /**
+     * @brief 创建并绑定所有监听套接字
+     *
+     * 给出inherited时先接管这些从旧进程收到的监听套接字（每个一个事件循环，事件循环数
+     * 至少为套接字数），不足的部分在同一端口上新建。
+     * @param address 监听地址，空字符串表示所有地址
+     * @param port 端口，0表示由系统分配
+     * @param on_close 连接关闭通知，可以为空
+     * @param inherited 接管的监听套接字，构造后归本对象所有
+     * @throws std::runtime_error 绑定失败或系统不支持时抛出异常
+     */
+    ReactorGroup(const std::string& address, uint16_t port, const ReactorOptions& options, Handler handler,
+                 SessionClosed on_close = SessionClosed(), const std::vector<int>& inherited = std::vector<int>());
+    ~ReactorGroup();
+
+    ReactorGroup(const ReactorGroup&) = delete;
+    ReactorGroup& operator=(const ReactorGroup&) = delete;
+
+    /**
+     * @brief 启动所有事件循环
+     */
+    void start();
+
+    /**
+     * @brief 停止所有事件循环并关闭其上的连接
+     */
+    void stop();
+
+    /**
+     * @brief 停止接受新连接并关闭监听套接字，已有连接照常处理
+     */
+    void stop_accepting();
+
+    /**
+     * @brief 各事件循环的监听套接字（用于交接给新进程）
+     * @return 停止接受连接后为空
+     */
+    std::vector<int> listen_fds() const;
+
+    uint16_t port() const { return port_; }
+
+    std::vector<ReactorStats> stats() const;
+
+private:
+    struct Session;
+    struct Shard;
+    struct Completions;
+    class SessionChannel;
+
+    void run_shard(Shard* shard);
+    void deliver_replies(Shard* shard);
+    void accept_all(Shard* shard);
+    bool read_session(Shard* shard, Session* session);
+    bool handle_requests(Shard* shard, Session* session);
+    bool flush_session(Shard* shard, Session* session);
+    void close_session(Shard* shard, Session* session);
+    void close_listener(Shard* shard);
+
+    std::string address_;
+    uint16_t port_;
+    ReactorOptions options_;
+    Handler handler_;
+    SessionClosed on_close_;
+    std::atomic<bool> running_;
+    std::atomic<bool> accepting_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -5,7 +5,28 @@
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <chrono>
+#include <mutex>
 #include "rpc/server.h"
+#include "rpc_handler.h"
+#include "rpc_stats.h"
+#include "rpc_batch.h"
+#include "rpc_binary.h"
+#include "rpc_stream.h"
+#include "rpc_cache.h"
+#include "rpc_limiter.h"
+#include "rpc_context.h"
+#include "rpc_trace.h"
+#include "rpc_compress.h"
+#include "rpc_local_transport.h"
+#include "rpc_reactor.h"
+#include "rpc_drain.h"
+#include "rpc_handoff.h"
+#include "rpc_stub.h"
 
 namespace rpc_utils {
 
@@ -43,10 +64,253 @@ public:
      * @tparam F 函数类型
      * @param name 函数名称
      * @param func 要绑定的函数
+     * @throws std::runtime_error 方法ID与已绑定的其他方法冲突时抛出异常
      */
     template<typename F>
     void bind(const std::string& name, F&& func);
 
+    /**
+     * @brief 绑定函数，并在独立的工作窃取线程池中执行
+     *
+     * 适用于CPU密集或会阻塞的处理函数，线程数、排队上限与CPU亲和性单独配置，
+     * 队列已满时立即返回过载错误。卸载只在多事件循环端口（listen_reactors）与同主机端点
+     * （listen）上生效：请求在分派前整个交给线程池，由工作线程写回响应，事件循环与连接线程
+     * 不等待。rpclib只能在处理函数返回时写回响应，交给线程池也释放不了I/O线程，因此构造函数
+     * 端口上的请求直接在I/O线程上执行，与bind相同；只有该端口时运行会记录警告。
+     * 同名（options.name）线程池在多个方法之间共享，以首次绑定时的配置创建。
+     * 需在run/async_run之前调用。
+     * @tparam F 函数类型
+     * @param name 函数名称
+     * @param func 要绑定的函数
+     * @param options 线程池配置（线程数、排队上限、CPU亲和性）
+     */
+    template<typename F>
+    void bind_offloaded(const std::string& name, F&& func,
+                        const ExecutorOptions& options = ExecutorOptions());
+
+    /**
+     * @brief 绑定纯函数，相同参数的重复请求直接返回缓存的结果
+     *
+     * 以序列化后的参数字节为键，结果保存在分片LRU缓存中；命中时既不解码参数
+     * 也不执行函数，缓存的结果对象被直接引用到响应中。相同参数的并发未命中
+     * 会被合并为一次执行（见bind_coalesced）。只适用于结果仅取决于参数、
+     * 且没有副作用的函数。启用统计后可通过保留方法"__cache_stats"查询命中率。
+     * @tparam F 函数类型
+     * @param name 函数名称
+     * @param func 要绑定的函数
+     * @param capacity 最大缓存条目数
+     * @param ttl 条目有效期，0表示不过期
+     * @param max_bytes 缓存的最大内存占用（估算值），0表示不限制
+     */
+    template<typename F>
+    void bind_cached(const std::string& name, F&& func, size_t capacity,
+                     std::chrono::milliseconds ttl = std::chrono::milliseconds(0),
+                     size_t max_bytes = 0);
+
+    /**
+     * @brief 绑定函数，参数相同的并发请求合并为一次执行
+     *
+     * 以序列化后的参数字节为键：某个键正在执行时，后到的相同请求等待并共享
+     * 其结果或异常，结果对象只构造一次，由所有等待中的响应共同引用。
+     * 在构造函数端口上，等待中的请求会占用I/O线程，因此需以多个工作线程运行服务器才能发挥作用；
+     * 多事件循环端口与同主机端点把这类请求交给内部的阻塞线程池执行。
+     * 只适用于可以安全共享结果的幂等函数。
+     * @tparam F 函数类型
+     * @param name 函数名称
+     * @param func 要绑定的函数
+     */
+    template<typename F>
+    void bind_coalesced(const std::string& name, F&& func);
+
+    /**
+     * @brief 获取各缓存/合并方法的结果复用统计
+     * @return 方法名到统计的映射（bind_coalesced方法只有misses和coalesced计数）
+     */
+    std::map<std::string, CacheStats> cache_stats() const;
+
+    /**
+     * @brief 清空某个方法的结果缓存
+     * @param name 函数名称
+     */
+    void clear_cache(const std::string& name);
+
+    /**
+     * @brief 绑定服务端流式函数：处理函数通过StreamWriter逐个发送元素
+     *
+     * 处理函数形如 void(StreamWriter<T>& out, Args... args)，在独立线程池中运行，
+     * 客户端通过RPCClientWrapper::open_stream<T>(name, args...)逐批接收。
+     * 客户端尚未取走的元素超出窗口（options.window_items/window_bytes）时write阻塞，
+     * 生产方不会因客户端较慢而无限占用内存。线程池的配置同bind_offloaded。
+     * 需在run/async_run之前调用。
+     * @tparam F 函数类型
+     * @param name 函数名称
+     * @param func 要绑定的函数
+     * @param options 窗口大小与线程池配置
+     */
+    template<typename F>
+    void bind_stream(const std::string& name, F&& func,
+                     const StreamOptions& options = StreamOptions());
+
+    /**
+     * @brief 绑定客户端流式函数：处理函数通过StreamReader逐个接收元素
+     *
+     * 处理函数形如 R(StreamReader<T>& in, Args... args)，在独立线程池中运行，
+     * 客户端通过RPCClientWrapper::open_client_stream(name, args...)写入，
+     * 并用finish<R>()取得返回值。服务端缓冲超出窗口时客户端的推送阻塞。
+     * 需在run/async_run之前调用。
+     * @tparam F 函数类型
+     * @param name 函数名称
+     * @param func 要绑定的函数
+     * @param options 窗口大小与线程池配置
+     */
+    template<typename F>
+    void bind_client_stream(const std::string& name, F&& func,
+                            const StreamOptions& options = StreamOptions());
+
+    /**
+     * @brief 启用按方法的调用统计
+     *
+     * 启用后，之后bind的每个函数都会记录调用次数、错误次数和延迟直方图，
+     * 并注册保留方法"__stats"，返回各方法的p50/p90/p99/p999延迟（微秒），
+     * "__cache_stats"，返回bind_cached方法的命中/未命中计数，
+     * "__limit_stats"，返回并发限制器的当前上限与拒绝计数，
+     * "__compression_stats"，返回压缩前后的字节数，
+     * 以及"__pool_stats"，返回缓冲区与内存区池的命中/未命中计数。
+     * 需在bind之前调用。
+     */
+    void enable_stats();
+
+    /**
+     * @brief 启用服务器级自适应并发限制
+     *
+     * 之后绑定的所有方法共享一个并发上限，上限按观测到的处理耗时自动调整：
+     * 耗时明显升高时收缩，平稳时缓慢增长。未指定initial_limit时，开始运行时以执行处理函数的
+     * 线程数（rpclib工作线程、事件循环线程与bind_offloaded线程池）作为初始上限。
+     * 超出上限的请求立即以过载错误拒绝，
+     * 客户端收到OverloadedError，而不是在服务器内排队直到超时。
+     * 保留方法（"__stats"等）不受限制。需在bind之前调用。
+     * @param options 限制器配置
+     */
+    void enable_concurrency_limit(const LimiterOptions& options = LimiterOptions());
+
+    /**
+     * @brief 为单个方法设置固定的并发上限
+     *
+     * 与服务器级限制同时生效，先检查方法级上限。需在绑定该方法之前调用。
+     * @param name 函数名称
+     * @param max_in_flight 最大同时执行数
+     */
+    void set_method_limit(const std::string& name, size_t max_in_flight);
+
+    /**
+     * @brief 为单个方法设置自适应并发上限
+     * @param name 函数名称
+     * @param options 限制器配置
+     */
+    void set_method_limit(const std::string& name, const LimiterOptions& options);
+
+    /**
+     * @brief 获取并发限制统计
+     *
+     * 启用统计后也可通过保留方法"__limit_stats"远程查询。
+     * @return 方法名到统计的映射，服务器级限制的键为"*"
+     */
+    std::map<std::string, LimiterStats> limiter_stats() const;
+
+    /**
+     * @brief 是否信任客户端时钟来估计请求的传输与排队耗时
+     *
+     * 客户端启用截止时间传递后，请求携带发送时的剩余时间。服务器从读到请求时起算
+     * （rpclib端口只能从处理函数开始时起算），并按每个客户端"收到时间 - 发送时间"
+     * 的近期最小值估计单个请求额外的传输与排队耗时一并扣除，不要求时钟同步。
+     * 双方时钟同步（例如同一主机）时可启用本选项，改为直接扣除双方系统时间之差。
+     * @param trust 是否信任
+     */
+    void set_trust_client_clock(bool trust);
+
+    /**
+     * @brief 获取因截止时间已过而未执行的请求数
+     */
+    uint64_t expired_requests() const;
+
+    /**
+     * @brief 获取负载压缩统计
+     *
+     * 客户端启用压缩后，请求经保留方法"__z"到达，是否压缩响应由客户端在请求中指定。
+     * @return 压缩前后的字节数
+     */
+    CompressionStats compression_stats() const;
+
+    /**
+     * @brief 获取各方法的统计快照
+     * @return 方法名到统计快照的映射，未启用统计时为空
+     */
+    std::map<std::string, MethodStatsSnapshot> stats() const;
+
+    /**
+     * @brief 设置批量调用并行执行时的最大线程数
+     *
+     * 服务器自动注册保留方法"__batch"，按位置返回每项调用的结果或错误；
+     * 客户端请求并行执行时，最多使用该数量的线程同时执行各项调用：发起线程之外的
+     * 线程取自内部的批量线程池，该池按本设置在首次并行执行时创建，需在运行前调用。
+     * @param max_threads 最大线程数，0表示使用硬件并发数
+     */
+    void set_batch_parallelism(size_t max_threads);
+
+    /**
+     * @brief 额外监听同主机端点
+     *
+     * 支持unix:///path/to.sock（Unix域套接字）与shm://name（共享内存环形缓冲区），
+     * 客户端以相同的端点字符串构造RPCClientWrapper即可连接。每个连接由一个专用线程
+     * 按顺序处理，已绑定的方法（含并发限制、缓存与卸载）与内置的保留方法都可调用。
+     * @param endpoint 端点
+     * @throws std::invalid_argument 端点格式错误或为TCP端点时抛出异常
+     * @throws std::runtime_error 绑定失败时抛出异常
+     */
+    void listen(const std::string& endpoint);
+
+    /**
+     * @brief 设置同主机端点上响应的写合并，对之后调用listen()添加的端点生效
+     *
+     * 启用后同一连接上一次读入的多个请求处理完后，响应一起写出。
+     * 多事件循环端口总是按读取合并响应，不受该设置影响；rpclib的TCP端口逐个写出响应。
+     * @param options 写合并配置
+     */
+    void set_write_coalescing(const CoalesceOptions& options);
+
+    /**
+     * @brief 在单独的端口上启用多事件循环模式
+     *
+     * 每个事件循环有自己的SO_REUSEPORT监听套接字和epoll实例，并可绑定到一个CPU；
+     * 内核把新连接分散到各循环，连接此后只在接受它的循环上处理，请求直接在该线程上执行；
+     * 会阻塞的请求（bind_offloaded与bind_coalesced方法、流式保留方法、并行批量调用）
+     * 交给线程池，完成后经eventfd唤醒循环写回响应，不会拖住同一循环上的其他连接。
+     * 协议与构造函数端口相同，rpclib客户端和RPCClientWrapper都可以直接连接，
+     * 已绑定的方法与保留方法都可调用。rpclib的监听端口无法设置SO_REUSEPORT，
+     * 因此多事件循环使用另一个端口；只需要该模式时构造函数端口可传0。
+     * 随run()/async_run()启动，随stop()停止；服务器运行时调用立即生效。仅支持Linux。
+     * @param address 监听地址，空字符串表示所有地址
+     * @param port 端口，0表示由系统分配（之后用reactor_port()获取）
+     * @param options 事件循环数与CPU绑定
+     * @throws std::runtime_error 已启用、绑定失败或系统不支持时抛出异常
+     */
+    void listen_reactors(const std::string& address, uint16_t port,
+                         const ReactorOptions& options = ReactorOptions());
+
+    /**
+     * @brief 多事件循环模式的监听端口
+     * @return 端口号，未启用时返回0
+     */
+    uint16_t reactor_port() const;
+
+    /**
+     * @brief 各事件循环的连接与请求统计，启用统计后也可经"__reactor_stats"远程获取
+     *
+     * 系统调用次数见io_stats()（启用统计后也可经"__io_stats"远程获取）。
+     * @return 按事件循环排列，未启用时为空
+     */
+    std::vector<ReactorStats> reactor_stats() const;
+
     /**
      * @brief 同步运行服务器（阻塞调用）
      */
@@ -63,6 +327,59 @@ public:
      */
     void stop();
 
+    /**
+     * @brief 优雅停止：处理完执行中的请求后停止服务器
+     *
+     * 依次：停止在同主机端点与多事件循环端口上接受新连接；此后到达的请求不再执行，
+     * 立即以draining错误拒绝（客户端收到DrainingError，RPCBalancedClient会重新建连并
+     * 重发一次）；等待执行中的处理函数返回、打开的流结束；最后关闭所有连接并停止。
+     * rpclib的监听端口无法单独停止接受连接，新连接上的请求同样被拒绝。
+     * @param timeout 最长等待时间，超时后仍然停止
+     * @return 超时前所有请求都已完成时返回true
+     */
+    bool drain(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 是否已开始drain
+     */
+    bool draining() const;
+
+    /**
+     * @brief 在Unix域控制套接字上等待新进程接管监听套接字（旧进程调用）
+     *
+     * 新进程调用take_over(path)后，本进程把同主机端点与多事件循环端口的监听套接字经
+     * SCM_RIGHTS交给它；两个进程共用同一组套接字，重启期间排队的连接不会丢失。
+     * 新进程开始运行时确认接管，wait_handoff()随之返回，之后调用drain()处理完剩余请求。
+     * rpclib的监听端口由rpclib自行绑定，无法交接：需要无缝重启的流量应使用
+     * listen_reactors()端口（rpclib客户端可直接连接）或同主机端点。
+     * 需在listen()/listen_reactors()之后调用。
+     * @param path 控制套接字路径
+     * @throws std::runtime_error 绑定失败时抛出异常
+     */
+    void enable_handoff(const std::string& path);
+
+    /**
+     * @brief 等待新进程确认接管监听套接字
+     * @param timeout 等待时间，0表示一直等待
+     * @return 已完成交接时返回true
+     */
+    bool wait_handoff(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /**
+     * @brief 从旧进程接管监听套接字（新进程调用）
+     *
+     * 须在listen()/listen_reactors()之前调用：之后对相同端点的listen()直接使用收到的套接字，
+     * listen_reactors()接管旧进程全部事件循环的套接字（事件循环数不少于其个数）。
+     * run()/async_run()开始接受连接时通知旧进程；此前本进程退出时旧进程照常服务。
+     * 没有对应listen调用的套接字在运行时关闭。
+     * @param path 旧进程的控制套接字路径（旧进程的enable_handoff参数）
+     * @param timeout 等待旧进程发送的时间
+     * @return 收到的监听套接字数
+     * @throws std::runtime_error 连接失败或超时时抛出异常
+     */
+    size_t take_over(const std::string& path,
+                     std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
     /**
      * @brief 设置异常抑制模式
      * @param suppress true表示捕获异常并返回错误给客户端，false表示异常会崩溃服务器
@@ -87,16 +404,285 @@ public:
     bool is_running() const;
 
 private:
+    /**
+     * @brief 按需加上并发限制，再绑定最终的处理函数
+     */
+    template<typename H>
+    void bind_handler(const std::string& name, H handler);
+
+    /**
+     * @brief 经停止闸门绑定用户方法的处理函数
+     */
+    template<typename H>
+    void install_gated(const std::string& name, H handler);
+
+    /**
+     * @brief 将最终的处理函数同时绑定到rpclib和内部方法表
+     */
+    template<typename H>
+    void install_handler(const std::string& name, H handler);
+
+    /**
+     * @brief 查找方法级并发限制器
+     * @return 未设置时返回nullptr
+     */
+    std::shared_ptr<ConcurrencyLimiter> method_limiter(const std::string& name) const;
+
+    /**
+     * @brief 按执行处理函数的线程数设置未指定初始值的限制器
+     * @param worker_threads rpclib端口的工作线程数
+     */
+    void seed_limiters(size_t worker_threads);
+
+    /**
+     * @brief 注册内部方法表项（供批量调用等按名调度的路径使用）
+     */
+    void register_method(const std::string& name, detail::RawMethod method);
+
+    /**
+     * @brief 按名查找内部方法表项
+     * @return 方法，不存在时返回nullptr
+     */
+    const detail::RawMethod* find_method(const std::string& name) const;
+
+    using MethodEntry = std::pair<const std::string, detail::RawMethod>;
+
+    /**
+     * @brief 按方法ID查找内部方法表项
+     * @return 方法名与方法，不存在时返回nullptr
+     */
+    const MethodEntry* find_method_by_id(uint64_t id) const;
+
+    /**
+     * @brief 获取（必要时创建）卸载线程池
+     */
+    WorkStealingPool* offload_pool(const ExecutorOptions& options);
+
+    /**
+     * @brief 初始化时注册内置的保留方法
+     */
+    void register_builtin_methods();
+
+    /**
+     * @brief 执行经上下文信封到达的请求：检查截止时间，安装请求上下文后按名分派
+     */
+    detail::SharedObject dispatch_with_context(const detail::WireContext& wire,
+                                               const std::string& name,
+                                               const RPCLIB_MSGPACK::object& args);
+
+    /**
+     * @brief 执行经压缩信封到达的请求：解压参数，按名分派，按客户端的要求压缩响应
+     */
+    detail::SharedObject dispatch_compressed(const detail::CompressedRequest& request);
+
+    /**
+     * @brief 把客户端上下文换算为请求上下文，已过期时以deadline_exceeded错误拒绝请求
+     */
+    RequestContext accept_context(const detail::WireContext& wire, const std::string& name);
+
+    /**
+     * @brief 按名查找方法，不存在时抛出异常
+     */
+    const detail::RawMethod& require_method(const std::string& name) const;
+
+    /**
+     * @brief 处理同主机传输收到的一帧请求
+     * @return 需要立即响应时返回true
+     */
+    bool handle_local_frame(const char* data, size_t size, detail::ScratchBuffer& reply,
+                            const std::shared_ptr<detail::ReplyChannel>& channel);
+
+    /**
+     * @brief 处理一个已解包的请求或通知，响应追加到reply
+     *
+     * 给出channel时，会阻塞的请求交给线程池执行，响应稍后经channel交回；
+     * 不给出时总是在当前线程上执行。
+     * @return 需要立即响应时返回true
+     * @throws std::runtime_error 请求格式错误时抛出异常
+     */
+    bool handle_request(const RPCLIB_MSGPACK::object& request, detail::ScratchBuffer& reply,
+                        const std::shared_ptr<detail::ReplyChannel>& channel);
+
+    /**
+     * @brief 多事件循环端口与同主机端点上需交给线程池执行的请求的目标线程池
+     *
+     * 卸载方法交给其线程池；合并执行的方法、流式保留方法与并行批量调用要等待其他线程，
+     * 交给阻塞线程池。上下文、压缩信封与批量调用按内层方法判断。
+     * @return 可以在收到请求的线程上直接执行时返回nullptr
+     */
+    WorkStealingPool* dispatch_pool(const std::string& name, const RPCLIB_MSGPACK::object& args) const;
+
+    /**
+     * @brief 把请求交给线程池执行，响应经channel交回
+     * @return 线程池队列已满时返回false
+     */
+    bool defer_request(WorkStealingPool* pool, const RPCLIB_MSGPACK::object& request,
+                       const std::shared_ptr<detail::ReplyChannel>& channel);
+
+    /**
+     * @brief 创建执行阻塞请求的线程池（首次启用同主机端点或多事件循环时）
+     */
+    void create_blocking_pool();
+
+    /**
+     * @brief 获取（首次并行执行批量调用时创建）执行批量调用辅助任务的线程池
+     */
+    WorkStealingPool* batch_pool();
+
+    /**
+     * @brief 启动同主机监听与多事件循环；接管了旧进程的监听套接字时通知旧进程
+     */
+    void start_listeners();
+
+    /**
+     * @brief 同主机端点与多事件循环停止接受新连接
+     */
+    void stop_accepting();
+
+    /**
+     * @brief 停止等待新进程接管；已交接时不再删除同主机端点的套接字文件
+     */
+    void stop_handoff();
+
+    /**
+     * @brief 当前的监听套接字（在交接线程上调用）
+     */
+    std::vector<detail::InheritedSocket> handoff_sockets() const;
+
+    /**
+     * @brief 取出从旧进程接管的监听套接字
+     * @param key 交接键
+     * @return 套接字，没有时返回空
+     */
+    std::vector<int> take_inherited(const std::string& key);
+
+    /**
+     * @brief 执行一次批量调用
+     */
+    detail::BatchReply run_batch(const std::vector<detail::BatchRequestItem>& items, bool parallel);
+
+    /**
+     * @brief 执行批量调用中的一项，结果写入result
+     */
+    void run_batch_item(const detail::BatchRequestItem& item,
+                        RPCLIB_MSGPACK::zone& zone,
+                        detail::BatchResultItem& result) const;
+
+    // 先于rpclib服务器声明、后于它析构，处理函数中持有其指针
+    detail::DrainGate gate_;
     std::unique_ptr<rpc::server> server_;
+    std::unordered_map<std::string, detail::RawMethod> methods_;
+    std::unordered_map<uint64_t, const MethodEntry*> method_ids_;    // 指向methods_中的节点
+    std::map<std::string, std::unique_ptr<WorkStealingPool>> offload_pools_;
+    std::unordered_map<std::string, WorkStealingPool*> offloaded_methods_;  // 卸载方法所用的线程池
+    std::unordered_set<std::string> blocking_methods_;                      // 会等待其他线程的方法
+    WorkStealingPool* blocking_pool_;
+    // 位于线程池之后，先于线程池析构，从而唤醒阻塞在流上的处理函数
+    detail::StreamRegistry streams_;
+    size_t batch_parallelism_;
+    std::once_flag batch_pool_once_;
+    WorkStealingPool* batch_pool_;
+    std::unique_ptr<StatsRegistry> stats_;
+    std::map<std::string, std::shared_ptr<ResultCache>> caches_;
+    std::map<std::string, std::shared_ptr<SingleFlight>> flights_;
+    std::shared_ptr<ConcurrencyLimiter> limiter_;
+    std::map<std::string, std::shared_ptr<ConcurrencyLimiter>> method_limiters_;
     std::atomic<bool> is_running_;
+    std::atomic<uint64_t> expired_requests_;
+    bool trust_client_clock_;
+    detail::ClockOffsetTable clock_offsets_;
+    detail::CompressionCounters compression_counters_;
     std::string address_;
     uint16_t port_;
+    CoalesceOptions coalesce_;
+    std::unique_ptr<detail::HandoffListener> handoff_;
+    std::vector<detail::InheritedSocket> inherited_;    // take_over收到、尚未被listen取用的套接字
+    int handoff_control_fd_;                            // 通知旧进程的控制连接，-1表示无
+    // 最后声明、最先析构：处理线程退出后才销毁方法表
+    std::vector<std::unique_ptr<detail::LocalListener>> local_listeners_;
+    std::unique_ptr<detail::ReactorGroup> reactors_;
 };
 
 // 模板实现
 template<typename F>
 void RPCServerWrapper::bind(const std::string& name, F&& func) {
-    server_->bind(name, std::forward<F>(func));
+    if (stats_) {
+        bind_handler(name, detail::guarded_handler_t<F>(std::forward<F>(func), stats_->method(name)));
+    } else {
+        bind_handler(name, typename std::decay<F>::type(std::forward<F>(func)));
+    }
+}
+
+template<typename F>
+void RPCServerWrapper::bind_offloaded(const std::string& name, F&& func,
+                                      const ExecutorOptions& options) {
+    WorkStealingPool* pool = offload_pool(options);
+    offloaded_methods_[name] = pool;
+    detail::offloaded_handler_t<F> offloaded(std::forward<F>(func), pool);
+    if (stats_) {
+        // 统计包含排队等待时间，反映调用方看到的延迟
+        bind_handler(name, detail::guarded_handler_t<decltype(offloaded)>(
+            std::move(offloaded), stats_->method(name)));
+    } else {
+        bind_handler(name, std::move(offloaded));
+    }
+}
+
+template<typename F>
+void RPCServerWrapper::bind_cached(const std::string& name, F&& func, size_t capacity,
+                                   std::chrono::milliseconds ttl, size_t max_bytes) {
+    auto cache = std::make_shared<ResultCache>(capacity, ttl, max_bytes);
+    auto flights = std::make_shared<SingleFlight>();
+    caches_[name] = cache;
+    flights_[name] = flights;
+    bind(name, detail::cached_handler_t<F>(std::forward<F>(func), std::move(cache), std::move(flights)));
+}
+
+template<typename F>
+void RPCServerWrapper::bind_coalesced(const std::string& name, F&& func) {
+    auto flights = std::make_shared<SingleFlight>();
+    flights_[name] = flights;
+    blocking_methods_.insert(name);
+    bind(name, detail::coalesced_handler_t<F>(std::forward<F>(func), std::move(flights)));
+}
+
+template<typename F>
+void RPCServerWrapper::bind_stream(const std::string& name, F&& func, const StreamOptions& options) {
+    blocking_methods_.insert({detail::kStreamNextMethod, detail::kStreamPushMethod, detail::kStreamFinishMethod});
+    bind(name, detail::stream_open_handler_t<F>(
+        std::forward<F>(func), &streams_, offload_pool(options.executor), options, name));
+}
+
+template<typename F>
+void RPCServerWrapper::bind_client_stream(const std::string& name, F&& func,
+                                          const StreamOptions& options) {
+    blocking_methods_.insert({detail::kStreamNextMethod, detail::kStreamPushMethod, detail::kStreamFinishMethod});
+    bind(name, detail::stream_sink_handler_t<F>(
+        std::forward<F>(func), &streams_, offload_pool(options.executor), options, name));
+}
+
+template<typename H>
+void RPCServerWrapper::bind_handler(const std::string& name, H handler) {
+    std::shared_ptr<ConcurrencyLimiter> method = method_limiter(name);
+    if (limiter_ || method) {
+        // 位于统计之外：被拒绝的请求不计入方法的调用次数和延迟
+        install_gated(name, detail::limited_handler_t<H>(std::move(handler), limiter_,
+                                                         std::move(method), name));
+    } else {
+        install_gated(name, std::move(handler));
+    }
+}
+
+template<typename H>
+void RPCServerWrapper::install_gated(const std::string& name, H handler) {
+    // 最外层：停止期间被拒绝的请求既不占用并发额度，也不计入统计
+    install_handler(name, detail::gated_handler_t<H>(std::move(handler), &gate_, name));
+}
+
+template<typename H>
+void RPCServerWrapper::install_handler(const std::string& name, H handler) {
+    register_method(name, detail::make_raw_method(name, handler));
+    server_->bind(name, std::move(handler));
 }
 
 } // namespace rpc_utils
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+/**
+ * @brief 直方图快照
+ *
+ * 由LatencyHistogram合并得到的只读计数，用于计算分位数。
+ */
+class HistogramSnapshot {
+public:
+    HistogramSnapshot();
+
+    /**
+     * @brief 合并另一个快照
+     * @param other 另一个快照
+     */
+    void merge(const HistogramSnapshot& other);
+
+    /**
+     * @brief 计算分位数
+     * @param quantile 分位点，取值[0, 1]，例如0.99
+     * @return 对应分位的数值（所在桶的上界，不超过最大观测值），无样本时返回0
+     */
+    uint64_t percentile(double quantile) const;
+
+    /**
+     * @brief 获取样本总数
+     * @return 样本数
+     */
+    uint64_t count() const { return count_; }
+
+    /**
+     * @brief 获取最大观测值
+     * @return 最大值
+     */
+    uint64_t max() const { return max_; }
+
+    /**
+     * @brief 获取平均值
+     * @return 平均值，无样本时返回0
+     */
+    double mean() const;
+
+private:
+    friend class LatencyHistogram;
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+/**
+ * @brief HDR风格的对数-线性延迟直方图
+ *
+ * 每个2的幂区间再均分为16个子桶，相对误差约6%；记录操作只做一次
+ * relaxed原子自增，无锁、无分配，可被多个线程并发调用。
+ */
+class LatencyHistogram {
+public:
+    static const unsigned kSubBucketBits = 4;
+    static const size_t kSubBucketCount = size_t(1) << kSubBucketBits;
+    static const unsigned kMaxValueBits = 42;
+    static const size_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief 记录一个样本
+     * @param value 样本值（例如纳秒），超出范围的值计入最后一个桶
+     */
+    void record(uint64_t value) {
+        buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (value > prev &&
+               !max_.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief 将当前计数累加到快照
+     * @param snapshot 目标快照
+     */
+    void merge_into(HistogramSnapshot& snapshot) const;
+
+    /**
+     * @brief 获取当前计数的快照
+     * @return 快照
+     */
+    HistogramSnapshot snapshot() const;
+
+    /**
+     * @brief 清空所有计数（与并发记录之间不保证原子性）
+     */
+    void reset();
+
+    /**
+     * @brief 计算样本值所在的桶
+     * @param value 样本值
+     * @return 桶下标
+     */
+    static size_t bucket_index(uint64_t value) {
+        if (value < kSubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        if (msb >= kMaxValueBits) {
+            return kBucketCount - 1;
+        }
+        unsigned shift = msb - kSubBucketBits;
+        return (shift + 1) * kSubBucketCount +
+               static_cast<size_t>((value >> shift) & (kSubBucketCount - 1));
+    }
+
+    /**
+     * @brief 获取桶能表示的最大值
+     * @param index 桶下标
+     * @return 桶上界
+     */
+    static uint64_t bucket_upper_bound(size_t index);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+ * @brief 单个RPC方法的统计快照（时间单位为微秒）
+ */
+struct MethodStatsSnapshot {
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    double mean_us = 0;
+    double p50_us = 0;
+    double p90_us = 0;
+    double p99_us = 0;
+    double p999_us = 0;
+    double max_us = 0;
+
+    MSGPACK_DEFINE_MAP(calls, errors, mean_us, p50_us, p90_us, p99_us, p999_us, max_us);
+};
+
+/**
+ * @brief 单个RPC方法的调用统计
+ *
+ * 内部按线程分片：每个线程固定写入一个分片，记录路径无锁、无分配，
+ * 只有在读取快照时才合并所有分片。
+ */
+class MethodStats {
+public:
+    MethodStats();
+    ~MethodStats();
+
+    MethodStats(const MethodStats&) = delete;
+    MethodStats& operator=(const MethodStats&) = delete;
+
+    /**
+     * @brief 记录一次调用
+     * @param latency_ns 调用耗时（纳秒）
+     * @param ok 是否成功
+     */
+    void record(uint64_t latency_ns, bool ok);
+
+    /**
+     * @brief 合并所有分片得到快照
+     * @return 统计快照
+     */
+    MethodStatsSnapshot snapshot() const;
+
+    /**
+     * @brief 合并所有分片得到延迟直方图（纳秒）
+     * @return 直方图快照
+     */
+    HistogramSnapshot latency() const;
+
+private:
+    struct Shard;
+
+    static size_t shard_index();
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+/**
+ * @brief 按方法名组织的统计注册表
+ *
+ * 只有创建方法条目和读取快照时加锁，记录路径直接使用MethodStats指针。
+ */
+class StatsRegistry {
+public:
+    /**
+     * @brief 获取（必要时创建）方法的统计对象，返回的指针在注册表生命周期内有效
+     * @param name 方法名
+     * @return 统计对象
+     */
+    MethodStats* method(const std::string& name);
+
+    /**
+     * @brief 获取所有方法的统计快照
+     * @return 方法名到快照的映射
+     */
+    std::map<std::string, MethodStatsSnapshot> snapshot() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<MethodStats>> methods_;
+};
+
+namespace detail {
+
+/**
+ * @brief 单次调用的计时范围，析构时把耗时和成败写入MethodStats
+ */
+class StatsScope {
+public:
+    explicit StatsScope(MethodStats* stats)
+        : stats_(stats), ok_(true), start_(std::chrono::steady_clock::now()) {}
+
+    ~StatsScope() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stats_->record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), ok_);
+    }
+
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+
+    void fail() { ok_ = false; }
+
+private:
+    MethodStats* stats_;
+    bool ok_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace detail
+
+} // namespace rpc_utils
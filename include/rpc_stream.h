@@ -0,0 +1,688 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include <unordered_map>
+#include <type_traits>
+#include <stdexcept>
+#include "rpc/client.h"
+#include "rpc/msgpack.hpp"
+#include "rpc_binary.h"
+#include "rpc_executor.h"
+#include "rpc_handler.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 流式方法配置
+ *
+ * 接收方为每个流保留最多window_items个元素、window_bytes字节的缓冲（信用额度），
+ * 额度用完时发送方阻塞，直到接收方取走数据归还额度。
+ */
+struct StreamOptions {
+    size_t window_items = 64;              // 每个流缓冲的最大元素数
+    size_t window_bytes = 1 << 20;         // 每个流缓冲的最大字节数
+    ExecutorOptions executor;              // 运行流处理函数的线程池
+
+    StreamOptions() { executor.name = "stream"; }
+};
+
+namespace detail {
+
+/// 流式调用的保留方法名
+const char* const kStreamNextMethod = "__stream_next";
+const char* const kStreamPushMethod = "__stream_push";
+const char* const kStreamFinishMethod = "__stream_finish";
+const char* const kStreamCancelMethod = "__stream_cancel";
+
+/// 表示无限等待的超时值
+const std::chrono::milliseconds kStreamWaitForever(-1);
+
+/**
+ * @brief 打开流的返回值（线上格式：[id, window_items, window_bytes]）
+ */
+struct StreamOpenReply {
+    uint64_t id = 0;
+    uint64_t window_items = 0;
+    uint64_t window_bytes = 0;
+
+    MSGPACK_DEFINE_ARRAY(id, window_items, window_bytes);
+};
+
+/**
+ * @brief 服务端流的一批数据（线上格式：[data, count, done, error]）
+ *
+ * data是count个依次排列的msgpack编码元素，服务端以Blob引用发送，不再复制。
+ */
+struct StreamChunk {
+    BinaryView data;
+    uint32_t count = 0;
+    bool done = false;
+    std::string error;
+
+    MSGPACK_DEFINE_ARRAY(data, count, done, error);
+};
+
+/**
+ * @brief 客户端流的最终结果（线上格式：[done, value, error]）
+ */
+struct StreamResult {
+    bool done = false;
+    BinaryView value;
+    std::string error;
+
+    MSGPACK_DEFINE_ARRAY(done, value, error);
+};
+
+/**
+ * @brief 单个流的共享状态：有界的已编码元素缓冲区
+ *
+ * 写入方在缓冲区超出窗口时等待，读取方取走全部缓冲数据后唤醒写入方。
+ */
+class StreamState {
+public:
+    StreamState(uint64_t id, uint64_t session, bool inbound, size_t window_items, size_t window_bytes);
+
+    uint64_t id() const { return id_; }
+    uint64_t session() const { return session_; }
+    bool inbound() const { return inbound_; }
+
+    /**
+     * @brief 追加count个已编码元素，窗口已满时等待
+     * @param timeout 最长等待时间，kStreamWaitForever表示一直等待
+     * @return false表示超时或流已取消
+     */
+    bool put(const char* data, size_t size, size_t count, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 取走缓冲区中的全部元素，缓冲区为空时等待
+     * @param data 输出已编码元素
+     * @param timeout 最长等待时间，kStreamWaitForever表示一直等待
+     * @return 取到的元素数，0表示超时或流已结束（用finished区分）
+     */
+    size_t take(std::string& data, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 写入方结束，不再有新元素
+     */
+    void close();
+
+    /**
+     * @brief 处理函数正常结束
+     * @param result 已编码的返回值
+     */
+    void complete(std::string result);
+
+    /**
+     * @brief 处理函数失败
+     * @param error 错误信息
+     */
+    void fail(const std::string& error);
+
+    /**
+     * @brief 取消流，唤醒所有等待方
+     */
+    void cancel();
+
+    /**
+     * @brief 等待处理函数结束
+     * @return false表示超时
+     */
+    bool wait_completed(std::chrono::milliseconds timeout);
+
+    bool finished() const;
+    bool completed() const;
+    bool cancelled() const;
+    std::string error() const;
+    std::string take_result();
+
+    /**
+     * @brief 记录对端活动时间
+     */
+    void touch();
+
+    /**
+     * @brief 对端是否已超过给定时间没有活动
+     */
+    bool idle_for(std::chrono::steady_clock::time_point now, std::chrono::milliseconds timeout) const;
+
+private:
+    template<typename Pred>
+    bool wait(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds timeout, Pred pred);
+
+    const uint64_t id_;
+    const uint64_t session_;
+    const bool inbound_;
+    const size_t window_items_;
+    const size_t window_bytes_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string buffer_;
+    size_t count_;
+    bool closed_;
+    bool completed_;
+    bool cancelled_;
+    std::string error_;
+    std::string result_;
+    std::chrono::steady_clock::time_point last_active_;
+};
+
+/**
+ * @brief 服务端的流表，实现各个流式保留方法
+ *
+ * 流ID是随机的64位数，并绑定到打开它的连接：其他连接使用该ID时视为未知的流。
+ * 多事件循环与同主机端点的连接关闭时，其上的流立即被取消；rpclib端口没有连接关闭的
+ * 通知，由后台线程定期取消对端超过idle_timeout无活动的流，唤醒阻塞中的处理函数。
+ */
+class StreamRegistry {
+public:
+    /**
+     * @brief 构造函数
+     * @param idle_timeout 对端超过该时间无活动的流会被取消
+     */
+    explicit StreamRegistry(std::chrono::milliseconds idle_timeout = std::chrono::seconds(60));
+
+    /**
+     * @brief 析构函数，停止回收线程并取消所有流以唤醒阻塞中的处理函数
+     */
+    ~StreamRegistry();
+
+    StreamRegistry(const StreamRegistry&) = delete;
+    StreamRegistry& operator=(const StreamRegistry&) = delete;
+
+    /**
+     * @brief 为当前请求所属的连接创建新流
+     * @param inbound true表示客户端写入（客户端流），false表示服务端写入
+     */
+    std::shared_ptr<StreamState> open(bool inbound, size_t window_items, size_t window_bytes);
+
+    /**
+     * @brief 移除流
+     */
+    void erase(uint64_t id);
+
+    /**
+     * @brief 取消所有流
+     */
+    void cancel_all();
+
+    /**
+     * @brief 取消某个连接上的所有流（连接关闭时）
+     * @param session 连接ID
+     */
+    void cancel_session(uint64_t session);
+
+    /**
+     * @brief 获取活动流数量
+     */
+    size_t size() const;
+
+    /// 以下对应各保留方法
+    StreamChunk next(uint64_t id);
+    bool push(uint64_t id, const BinaryView& data, uint32_t count);
+    StreamResult finish(uint64_t id);
+    void cancel(uint64_t id);
+
+private:
+    std::shared_ptr<StreamState> find(uint64_t id, bool inbound) const;
+    uint64_t new_id();
+    void reap_loop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable reaper_cv_;
+    std::unordered_map<uint64_t, std::shared_ptr<StreamState>> streams_;
+    std::random_device random_;
+    std::chrono::milliseconds idle_timeout_;
+    bool stopping_;
+    std::thread reaper_;    // 首次打开流时启动
+};
+
+/**
+ * @brief 把值编码为msgpack字节串
+ */
+template<typename T>
+std::string pack_to_string(const T& value) {
+    RPCLIB_MSGPACK::sbuffer buffer;
+    RPCLIB_MSGPACK::pack(buffer, value);
+    return std::string(buffer.data(), buffer.size());
+}
+
+template<typename T>
+struct always_false : std::false_type {};
+
+} // namespace detail
+
+/**
+ * @brief 服务端流的写入器，由bind_stream绑定的处理函数用来逐个发送元素
+ * @tparam T 元素类型
+ */
+template<typename T>
+class StreamWriter {
+public:
+    explicit StreamWriter(detail::StreamState& state) : state_(state) {}
+
+    /**
+     * @brief 发送一个元素，客户端尚未取走的数据超出窗口时阻塞
+     * @param value 元素
+     * @return false表示客户端已取消或断开，处理函数应停止生产
+     */
+    bool write(const T& value);
+
+    /**
+     * @brief 客户端是否已取消
+     */
+    bool cancelled() const { return state_.cancelled(); }
+
+private:
+    detail::StreamState& state_;
+    RPCLIB_MSGPACK::sbuffer buffer_;
+};
+
+/**
+ * @brief 客户端流的读取器，由bind_client_stream绑定的处理函数用来逐个接收元素
+ * @tparam T 元素类型
+ */
+template<typename T>
+class StreamReader {
+public:
+    explicit StreamReader(detail::StreamState& state) : state_(state), offset_(0) {}
+
+    /**
+     * @brief 接收下一个元素，暂无数据时阻塞
+     * @param value 输出元素
+     * @return false表示客户端已写完所有元素
+     * @throws std::runtime_error 客户端取消或断开时抛出异常
+     */
+    bool next(T& value);
+
+private:
+    detail::StreamState& state_;
+    std::string chunk_;
+    size_t offset_;
+    RPCLIB_MSGPACK::object_handle current_;
+};
+
+namespace detail {
+
+/**
+ * @brief 服务端流的打开方法：创建流，把处理函数交给线程池，立即返回流ID
+ *
+ * 参数列表为原函数去掉首个StreamWriter参数，以便rpclib按其余参数解码。
+ */
+template<typename F, typename ArgsTuple>
+class StreamOpenHandler {
+    static_assert(always_false<F>::value,
+                  "bind_stream handler must take StreamWriter<T>& as its first parameter");
+};
+
+template<typename F, typename T, typename... Args>
+class StreamOpenHandler<F, std::tuple<StreamWriter<T>, Args...>> {
+public:
+    StreamOpenHandler(F func, StreamRegistry* registry, WorkStealingPool* pool,
+                      const StreamOptions& options, std::string name)
+        : func_(std::move(func)), registry_(registry), pool_(pool),
+          window_items_(options.window_items), window_bytes_(options.window_bytes),
+          name_(std::move(name)) {}
+
+    StreamOpenReply operator()(Args&... args) {
+        std::shared_ptr<StreamState> state = registry_->open(false, window_items_, window_bytes_);
+        F func = func_;
+        std::tuple<Args...> captured(args...);
+        bool accepted = pool_->try_submit([func, state, captured]() mutable {
+            produce(func, *state, captured, std::index_sequence_for<Args...>());
+        });
+        if (!accepted) {
+            registry_->erase(state->id());
+            throw_pool_full(name_, *pool_);
+        }
+        StreamOpenReply reply;
+        reply.id = state->id();
+        reply.window_items = window_items_;
+        reply.window_bytes = window_bytes_;
+        return reply;
+    }
+
+private:
+    template<typename Tuple, size_t... I>
+    static void produce(F& func, StreamState& state, Tuple& args, std::index_sequence<I...>) {
+        StreamWriter<T> writer(state);
+        try {
+            func(writer, std::get<I>(args)...);
+            state.close();
+        } catch (const std::exception& e) {
+            state.fail(e.what());
+        } catch (...) {
+            state.fail("Stream handler threw an unknown exception");
+        }
+    }
+
+    F func_;
+    StreamRegistry* registry_;
+    WorkStealingPool* pool_;
+    size_t window_items_;
+    size_t window_bytes_;
+    std::string name_;
+};
+
+template<typename F>
+using stream_open_handler_t = StreamOpenHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+/**
+ * @brief 客户端流的打开方法：创建流并在线程池中运行处理函数，处理函数从流中读取元素
+ */
+template<typename F, typename R, typename ArgsTuple>
+class StreamSinkHandler {
+    static_assert(always_false<F>::value,
+                  "bind_client_stream handler must take StreamReader<T>& as its first parameter");
+};
+
+template<typename F, typename R, typename T, typename... Args>
+class StreamSinkHandler<F, R, std::tuple<StreamReader<T>, Args...>> {
+public:
+    StreamSinkHandler(F func, StreamRegistry* registry, WorkStealingPool* pool,
+                      const StreamOptions& options, std::string name)
+        : func_(std::move(func)), registry_(registry), pool_(pool),
+          window_items_(options.window_items), window_bytes_(options.window_bytes),
+          name_(std::move(name)) {}
+
+    StreamOpenReply operator()(Args&... args) {
+        std::shared_ptr<StreamState> state = registry_->open(true, window_items_, window_bytes_);
+        F func = func_;
+        std::tuple<Args...> captured(args...);
+        bool accepted = pool_->try_submit([func, state, captured]() mutable {
+            consume(func, *state, captured, std::is_void<R>(), std::index_sequence_for<Args...>());
+        });
+        if (!accepted) {
+            registry_->erase(state->id());
+            throw_pool_full(name_, *pool_);
+        }
+        StreamOpenReply reply;
+        reply.id = state->id();
+        reply.window_items = window_items_;
+        reply.window_bytes = window_bytes_;
+        return reply;
+    }
+
+private:
+    template<typename Tuple, size_t... I>
+    static void consume(F& func, StreamState& state, Tuple& args,
+                        std::false_type, std::index_sequence<I...>) {
+        StreamReader<T> reader(state);
+        try {
+            state.complete(pack_to_string(func(reader, std::get<I>(args)...)));
+        } catch (const std::exception& e) {
+            state.fail(e.what());
+        } catch (...) {
+            state.fail("Stream handler threw an unknown exception");
+        }
+    }
+
+    template<typename Tuple, size_t... I>
+    static void consume(F& func, StreamState& state, Tuple& args,
+                        std::true_type, std::index_sequence<I...>) {
+        StreamReader<T> reader(state);
+        try {
+            func(reader, std::get<I>(args)...);
+            // 无返回值时结果为msgpack nil
+            state.complete(std::string(1, static_cast<char>(0xc0)));
+        } catch (const std::exception& e) {
+            state.fail(e.what());
+        } catch (...) {
+            state.fail("Stream handler threw an unknown exception");
+        }
+    }
+
+    F func_;
+    StreamRegistry* registry_;
+    WorkStealingPool* pool_;
+    size_t window_items_;
+    size_t window_bytes_;
+    std::string name_;
+};
+
+template<typename F>
+using stream_sink_handler_t = StreamSinkHandler<
+    typename std::decay<F>::type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::result_type,
+    typename rpc::detail::func_traits<typename std::decay<F>::type>::args_type>;
+
+/**
+ * @brief 客户端读取服务端流的公共部分
+ *
+ * 收到一批数据后立即预取下一批，使服务端在客户端处理当前批次时继续生产；
+ * 每次取走数据都会把窗口额度归还给服务端。
+ */
+class ClientStreamBase {
+public:
+    ClientStreamBase(rpc::client& client, std::string name, const StreamOpenReply& reply);
+    ClientStreamBase(ClientStreamBase&& other) noexcept;
+    ~ClientStreamBase();
+
+    ClientStreamBase(const ClientStreamBase&) = delete;
+    ClientStreamBase& operator=(const ClientStreamBase&) = delete;
+    ClientStreamBase& operator=(ClientStreamBase&&) = delete;
+
+    /**
+     * @brief 取消流，服务端处理函数的下一次write返回false
+     */
+    void cancel();
+
+    /**
+     * @brief 流ID
+     */
+    uint64_t id() const { return id_; }
+
+protected:
+    /**
+     * @brief 读取下一个元素
+     * @return false表示流已结束
+     * @throws std::runtime_error 服务端处理函数失败时抛出异常
+     */
+    bool next_object(RPCLIB_MSGPACK::object_handle& item);
+
+private:
+    void fetch();
+
+    rpc::client* client_;
+    std::string name_;
+    uint64_t id_;
+    RPCLIB_MSGPACK::object_handle chunk_handle_;
+    StreamChunk chunk_;
+    size_t offset_;
+    size_t remaining_;
+    bool done_;
+    std::future<RPCLIB_MSGPACK::object_handle> pending_;
+};
+
+} // namespace detail
+
+/**
+ * @brief 服务端流的客户端读取器，由RPCClientWrapper::open_stream返回
+ *
+ * 可用next逐个读取、for_each回调或范围for循环遍历；提前销毁时自动取消流。
+ * @tparam T 元素类型
+ */
+template<typename T>
+class ClientStream : public detail::ClientStreamBase {
+public:
+    using detail::ClientStreamBase::ClientStreamBase;
+
+    /**
+     * @brief 读取下一个元素
+     * @param value 输出元素
+     * @return false表示流已结束
+     * @throws std::runtime_error 服务端处理函数失败时抛出异常
+     */
+    bool next(T& value);
+
+    /**
+     * @brief 对剩余的每个元素调用回调
+     * @param callback 形如void(const T&)的回调
+     */
+    template<typename F>
+    void for_each(F&& callback);
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() : stream_(nullptr) {}
+        explicit iterator(ClientStream* stream) : stream_(stream) { ++*this; }
+
+        reference operator*() const { return value_; }
+        pointer operator->() const { return &value_; }
+        iterator& operator++() {
+            if (stream_ && !stream_->next(value_)) {
+                stream_ = nullptr;
+            }
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return stream_ == other.stream_; }
+        bool operator!=(const iterator& other) const { return stream_ != other.stream_; }
+
+    private:
+        ClientStream* stream_;
+        T value_;
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+};
+
+/**
+ * @brief 客户端流的写入器，由RPCClientWrapper::open_client_stream返回
+ *
+ * 元素在本地累积到半个窗口后一次推送；服务端窗口已满时推送阻塞，
+ * 直到处理函数取走数据。提前销毁时自动取消流。
+ */
+class ClientStreamWriter {
+public:
+    ClientStreamWriter(rpc::client& client, std::string name, const detail::StreamOpenReply& reply);
+    ClientStreamWriter(ClientStreamWriter&& other) noexcept;
+    ~ClientStreamWriter();
+
+    ClientStreamWriter(const ClientStreamWriter&) = delete;
+    ClientStreamWriter& operator=(const ClientStreamWriter&) = delete;
+    ClientStreamWriter& operator=(ClientStreamWriter&&) = delete;
+
+    /**
+     * @brief 写入一个元素
+     * @param value 元素
+     */
+    template<typename T>
+    void write(const T& value);
+
+    /**
+     * @brief 立即推送本地累积的元素
+     */
+    void flush();
+
+    /**
+     * @brief 结束写入并等待处理函数的返回值
+     * @tparam R 返回值类型
+     * @return 处理函数的返回值
+     * @throws std::runtime_error 处理函数失败时抛出异常
+     */
+    template<typename R = void>
+    R finish();
+
+    /**
+     * @brief 取消流，服务端处理函数的StreamReader::next抛出异常
+     */
+    void cancel();
+
+    /**
+     * @brief 流ID
+     */
+    uint64_t id() const { return id_; }
+
+private:
+    RPCLIB_MSGPACK::object_handle finish_raw();
+
+    rpc::client* client_;
+    std::string name_;
+    uint64_t id_;
+    size_t flush_items_;
+    size_t flush_bytes_;
+    RPCLIB_MSGPACK::sbuffer buffer_;
+    size_t count_;
+    bool finished_;
+};
+
+// 模板实现
+template<typename T>
+bool StreamWriter<T>::write(const T& value) {
+    buffer_.clear();
+    RPCLIB_MSGPACK::pack(buffer_, value);
+    return state_.put(buffer_.data(), buffer_.size(), 1, detail::kStreamWaitForever);
+}
+
+template<typename T>
+bool StreamReader<T>::next(T& value) {
+    while (offset_ >= chunk_.size()) {
+        offset_ = 0;
+        if (state_.take(chunk_, detail::kStreamWaitForever) == 0) {
+            if (state_.cancelled()) {
+                throw std::runtime_error("Stream " + std::to_string(state_.id()) +
+                                         " was cancelled by the client");
+            }
+            return false;
+        }
+    }
+    // 元素在下一次调用前保持有效
+    current_ = RPCLIB_MSGPACK::unpack(chunk_.data(), chunk_.size(), offset_);
+    current_.get().convert(value);
+    return true;
+}
+
+template<typename T>
+bool ClientStream<T>::next(T& value) {
+    RPCLIB_MSGPACK::object_handle item;
+    if (!next_object(item)) {
+        return false;
+    }
+    value = detail::take_result<T>(std::move(item));
+    return true;
+}
+
+template<typename T>
+template<typename F>
+void ClientStream<T>::for_each(F&& callback) {
+    T value;
+    while (next(value)) {
+        callback(value);
+    }
+}
+
+template<typename T>
+void ClientStreamWriter::write(const T& value) {
+    if (finished_) {
+        throw std::runtime_error("Stream '" + name_ + "' has already finished");
+    }
+    RPCLIB_MSGPACK::pack(buffer_, value);
+    ++count_;
+    if (count_ >= flush_items_ || buffer_.size() >= flush_bytes_) {
+        flush();
+    }
+}
+
+template<typename R>
+R ClientStreamWriter::finish() {
+    return detail::take_result<R>(finish_raw());
+}
+
+} // namespace rpc_utils
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <future>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+class RPCClientWrapper;
+
+namespace detail {
+
+/**
+ * @brief 方法ID：方法名的64位FNV-1a哈希
+ *
+ * 客户端与服务器各自由方法名计算，无需协商；服务器绑定时检查冲突。
+ */
+inline uint64_t method_id(const std::string& name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace detail
+
+/**
+ * @brief 预先绑定方法的类型化调用句柄
+ *
+ * 由RPCClientWrapper::stub<R(Params...)>("name")创建。参数在编译期按签名转换。
+ * 同主机传输（unix://、shm://）上方法名的ID在创建时算好，ID直接放在请求的方法名位置，
+ * 服务器按ID分派，不再按方法名查找；TCP连接上按方法名调用，与RPCClientWrapper::call相同。
+ * 句柄不拥有客户端，使用期间客户端必须保持存活。
+ * @tparam Sig 函数签名，例如double(double, double)
+ */
+template<typename Sig>
+class RPCStub;
+
+template<typename R, typename... Params>
+class RPCStub<R(Params...)> {
+public:
+    /**
+     * @brief 同步调用
+     * @throws 与RPCClientWrapper::call相同
+     */
+    R operator()(const Params&... args) const;
+
+    /**
+     * @brief 异步调用
+     */
+    std::future<RPCLIB_MSGPACK::object_handle> async(const Params&... args) const;
+
+    const std::string& name() const { return name_; }
+    uint64_t id() const { return id_; }
+
+private:
+    friend class RPCClientWrapper;
+
+    RPCStub(RPCClientWrapper& client, const std::string& name)
+        : client_(&client), name_(name), id_(detail::method_id(name)) {}
+
+    RPCClientWrapper* client_;
+    std::string name_;
+    uint64_t id_;
+};
+
+} // namespace rpc_utils
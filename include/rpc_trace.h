@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "rpc_context.h"
+
+namespace rpc_utils {
+
+/**
+ * @brief 追踪配置
+ */
+struct TraceOptions {
+    double sample_rate = 1.0;       // 本进程发起的新追踪中被采样的比例，0~1
+    size_t ring_capacity = 16384;   // 每个线程保留的最近跨度数，更早的跨度被覆盖
+};
+
+/**
+ * @brief 跨度类型，写入Chrome trace事件的cat字段
+ */
+enum class SpanKind {
+    internal,   // 处理函数内的一段工作，只在当前请求被采样时记录
+    client,     // 一次同步调用；不在追踪中时按采样率开始新的追踪
+    server      // 服务器执行一个请求
+};
+
+/**
+ * @brief 启用追踪
+ *
+ * 启用后本进程记录被采样请求的跨度：客户端同步调用、服务器执行经上下文信封
+ * 到达的请求，以及处理函数中的TraceSpan。跨度记录在每个线程各自的环形缓冲区中，
+ * 由write_chrome_trace()导出。未启用时不记录跨度，但收到的追踪上下文仍会随
+ * 嵌套调用继续传递。
+ * @param options 追踪配置
+ */
+void enable_tracing(const TraceOptions& options = TraceOptions());
+
+/**
+ * @brief 停止记录跨度（已记录的跨度保留）
+ */
+void disable_tracing();
+
+/**
+ * @brief 是否启用了追踪
+ */
+bool tracing_enabled();
+
+/**
+ * @brief 把所有线程记录的跨度按Chrome trace JSON格式写入文件
+ *
+ * 输出可直接在chrome://tracing或Perfetto UI（ui.perfetto.dev）中打开。
+ * 每个跨度是一个完整事件（ph为"X"），时间戳为系统时间（微秒），
+ * args中带trace_id、span_id与parent_id，可据此关联各进程导出的文件。
+ * @param path 文件路径
+ * @return 写出的跨度数
+ * @throws std::runtime_error 文件无法写入时抛出异常
+ */
+size_t write_chrome_trace(const std::string& path);
+
+/**
+ * @brief 丢弃所有线程已记录的跨度
+ */
+void clear_traces();
+
+/**
+ * @brief 跨度：构造时开始，析构时结束并记录
+ *
+ * 当前请求被采样且本进程启用了追踪时才记录，否则几乎没有开销。
+ * internal与server类型的跨度在存续期间成为当前线程的父跨度，
+ * 其间发起的嵌套调用与开始的跨度都是它的子跨度。
+ * @code
+ * server.bind("render", [](const Page& page) {
+ *     TraceSpan span("layout");
+ *     ...
+ * });
+ * @endcode
+ */
+class TraceSpan {
+public:
+    /**
+     * @brief 开始一个跨度
+     * @param name 跨度名称
+     * @param kind 跨度类型
+     */
+    explicit TraceSpan(const std::string& name, SpanKind kind = SpanKind::internal);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    /**
+     * @brief 是否在记录该跨度
+     */
+    bool recording() const { return recording_; }
+
+    /**
+     * @brief 子跨度应使用的追踪上下文：记录时为本跨度，否则为继承来的上下文
+     */
+    const TraceContext& context() const { return context_; }
+
+private:
+    bool recording_;
+    SpanKind kind_;
+    TraceContext context_;
+    uint64_t parent_id_;
+    int64_t start_us_;                      // 系统时间，用作事件时间戳
+    RequestContext::Clock::time_point start_;
+    std::string name_;
+    std::unique_ptr<ContextScope> scope_;
+};
+
+namespace detail {
+
+/**
+ * @brief 发出请求时应携带的追踪上下文
+ *
+ * 当前请求在追踪中时沿用其上下文；否则在启用了追踪时按采样率开始新的追踪，
+ * 未被采样时返回无效的上下文。
+ */
+TraceContext outgoing_trace();
+
+} // namespace detail
+
+} // namespace rpc_utils
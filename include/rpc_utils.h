@@ -5,6 +5,9 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
 
 namespace rpc_utils {
 
@@ -18,6 +21,14 @@ enum class LogLevel {
     ERROR
 };
 
+/**
+ * @brief 日志输出模式
+ */
+enum class LogMode {
+    SYNC,   // 调用线程直接写出
+    ASYNC   // 调用线程写入线程本地环形缓冲区，由后台线程批量格式化输出
+};
+
 /**
  * @brief 简单的日志工具类
  */
@@ -29,6 +40,73 @@ public:
      */
     static void set_log_level(LogLevel level);
 
+    /**
+     * @brief 检查指定级别的日志是否会被输出
+     * @param level 日志级别
+     * @return true if enabled
+     */
+    static bool is_enabled(LogLevel level) {
+        return level >= current_level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置日志输出模式
+     *
+     * 切换到ASYNC时启动后台写线程；切换回SYNC时先输出所有缓冲中的日志。
+     * 异步模式下缓冲区满时新日志会被丢弃并计数，调用线程永不阻塞。
+     * @param mode 输出模式
+     */
+    static void set_log_mode(LogMode mode);
+
+    /**
+     * @brief 设置异步模式下每个线程环形缓冲区的记录数
+     * @param records 记录数（向上取整为2的幂），仅对之后新建的缓冲区生效
+     */
+    static void set_async_buffer_size(size_t records);
+
+    /**
+     * @brief 等待异步缓冲区中的日志全部写出
+     */
+    static void flush();
+
+    /**
+     * @brief 获取异步模式下因缓冲区满而丢弃的日志条数
+     * @return 丢弃条数
+     */
+    static uint64_t dropped_count();
+
+    /**
+     * @brief 按printf格式记录日志，级别未启用时不做任何格式化
+     * @param level 日志级别
+     * @param format 格式字符串
+     */
+    static void logf(LogLevel level, const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    /**
+     * @brief 按printf格式记录调试信息
+     * @param format 格式字符串
+     */
+    static void debugf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    /**
+     * @brief 按printf格式记录普通信息
+     * @param format 格式字符串
+     */
+    static void infof(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    /**
+     * @brief 按printf格式记录警告信息
+     * @param format 格式字符串
+     */
+    static void warningf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    /**
+     * @brief 按printf格式记录错误信息
+     * @param format 格式字符串
+     */
+    static void errorf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
     /**
      * @brief 记录调试信息
      * @param message 日志消息
@@ -54,12 +132,47 @@ public:
     static void error(const std::string& message);
 
 private:
-    static LogLevel current_level_;
+    static std::atomic<LogLevel> current_level_;
     static void log(LogLevel level, const std::string& message);
+    static void vlogf(LogLevel level, const char* format, va_list args);
+    static void write(LogLevel level, const char* message, size_t length);
     static std::string get_timestamp();
     static std::string level_to_string(LogLevel level);
 };
 
+/**
+ * @brief 仅在级别启用时才对消息表达式求值的日志宏
+ *
+ * 例如 RPC_LOG_DEBUG("add(" + std::to_string(a) + ")") 在DEBUG被过滤时不会构造任何字符串。
+ */
+#define RPC_LOG_DEBUG(message) \
+    do { \
+        if (::rpc_utils::Logger::is_enabled(::rpc_utils::LogLevel::DEBUG)) { \
+            ::rpc_utils::Logger::debug(message); \
+        } \
+    } while (0)
+
+#define RPC_LOG_INFO(message) \
+    do { \
+        if (::rpc_utils::Logger::is_enabled(::rpc_utils::LogLevel::INFO)) { \
+            ::rpc_utils::Logger::info(message); \
+        } \
+    } while (0)
+
+#define RPC_LOG_WARNING(message) \
+    do { \
+        if (::rpc_utils::Logger::is_enabled(::rpc_utils::LogLevel::WARNING)) { \
+            ::rpc_utils::Logger::warning(message); \
+        } \
+    } while (0)
+
+#define RPC_LOG_ERROR(message) \
+    do { \
+        if (::rpc_utils::Logger::is_enabled(::rpc_utils::LogLevel::ERROR)) { \
+            ::rpc_utils::Logger::error(message); \
+        } \
+    } while (0)
+
 /**
  * @brief 性能计时器
  */
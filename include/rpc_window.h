@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <tuple>
+#include <cstdint>
+#include "rpc/msgpack.hpp"
+
+namespace rpc_utils {
+
+/**
+ * @brief 在途窗口已满时的处理方式
+ */
+enum class BackpressurePolicy {
+    block,          // 等待名额，最长等待客户端超时时间，超时后抛出InflightLimitError
+    fail_fast,      // 立即抛出InflightLimitError
+    callback,       // 立即抛出InflightLimitError，名额恢复后调用on_capacity
+};
+
+/**
+ * @brief 客户端在途窗口配置
+ */
+struct InflightOptions {
+    size_t max_requests = 1024;     // 最多未完成的异步请求数，0表示不限
+    size_t max_bytes = 0;           // 未完成请求的参数字节数上限，0表示不限
+    BackpressurePolicy policy = BackpressurePolicy::block;
+    // callback策略下，拒绝过请求后名额恢复时调用一次（在释放名额的线程上执行）
+    std::function<void()> on_capacity;
+};
+
+/**
+ * @brief 在途窗口统计
+ */
+struct InflightStats {
+    uint64_t in_flight = 0;         // 当前未完成的请求数
+    uint64_t in_flight_bytes = 0;   // 当前未完成请求的参数字节数
+    uint64_t waiting = 0;           // 当前等待名额的调用数（队列深度）
+    uint64_t waits = 0;             // 累计等待过名额的调用数
+    uint64_t rejected = 0;          // 累计被拒绝的调用数
+    uint64_t total_wait_us = 0;     // 累计等待时间（微秒）
+    uint64_t max_wait_us = 0;       // 最长一次等待（微秒）
+
+    MSGPACK_DEFINE_MAP(in_flight, in_flight_bytes, waiting, waits, rejected, total_wait_us, max_wait_us);
+};
+
+namespace detail {
+
+/**
+ * @brief 只统计长度的msgpack输出流
+ */
+struct ByteCounter {
+    size_t size = 0;
+
+    void write(const char*, size_t n) { size += n; }
+};
+
+/**
+ * @brief 参数序列化后的字节数
+ */
+template<typename... Args>
+size_t packed_size(const Args&... args) {
+    ByteCounter counter;
+    RPCLIB_MSGPACK::pack(counter, std::forward_as_tuple(args...));
+    return counter.size;
+}
+
+/**
+ * @brief 客户端在途窗口：限制未完成的异步请求数与字节数
+ *
+ * 异步调用发出前占用名额，收到响应（或失败、超时）后释放；通知没有响应，
+ * 只在窗口已满时按相同策略等待或被拒绝，不占用名额。
+ * 单个请求超过字节上限时，只要没有其他在途请求仍然放行，避免永远无法发送。
+ */
+class InflightWindow {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit InflightWindow(const InflightOptions& options);
+
+    InflightWindow(const InflightWindow&) = delete;
+    InflightWindow& operator=(const InflightWindow&) = delete;
+
+    bool counts_bytes() const { return options_.max_bytes > 0; }
+
+    /**
+     * @brief 占用一个名额
+     * @param func_name 函数名（用于错误信息）
+     * @param bytes 请求的参数字节数
+     * @param timeout_ms block策略下的最长等待时间，<=0表示不限
+     * @param may_block 为false时block策略也立即拒绝（完成线程上等待会死锁）
+     * @throws InflightLimitError 窗口已满且不能等待或等待超时时抛出异常
+     */
+    void acquire(const std::string& func_name, size_t bytes, int64_t timeout_ms, bool may_block);
+
+    /**
+     * @brief 按策略等待窗口有空位，但不占用名额（用于通知）
+     * @throws InflightLimitError 同acquire
+     */
+    void admit(const std::string& func_name, size_t bytes, int64_t timeout_ms, bool may_block);
+
+    /**
+     * @brief 释放acquire占用的名额
+     */
+    void release(size_t bytes);
+
+    InflightStats stats() const;
+
+private:
+    bool has_room(size_t bytes) const;
+    void reserve(const std::string& func_name, size_t bytes, int64_t timeout_ms, bool may_block, bool take);
+
+    InflightOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t in_flight_;
+    size_t in_flight_bytes_;
+    size_t waiting_;
+    uint64_t waits_;
+    uint64_t rejected_;
+    uint64_t total_wait_us_;
+    uint64_t max_wait_us_;
+    bool notify_capacity_;      // 拒绝过请求，名额恢复时调用on_capacity
+};
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,309 @@
+#include "rpc_balanced_client.h"
+#include "rpc_utils.h"
+#include <stdexcept>
+#include <algorithm>
+#include <random>
+#include <system_error>
+
+namespace rpc_utils {
+
+namespace {
+
+// EWMA平滑系数：新样本权重
+const double kEwmaAlpha = 0.2;
+
+// 传输层失败时的延迟惩罚倍数
+const double kFailurePenalty = 2.0;
+
+// 重连退避的初始值和上限
+const int64_t kMinBackoffMs = 100;
+const int64_t kMaxBackoffMs = 5000;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t random_index(size_t bound) {
+    thread_local std::minstd_rand engine(std::random_device{}());
+    return std::uniform_int_distribution<size_t>(0, bound - 1)(engine);
+}
+
+} // namespace
+
+Endpoint Endpoint::parse(const std::string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        throw std::runtime_error("Invalid endpoint '" + address + "', expected host:port");
+    }
+
+    std::string host = address.substr(0, colon);
+    int port = 0;
+    try {
+        size_t parsed = 0;
+        port = std::stoi(address.substr(colon + 1), &parsed);
+        if (parsed != address.size() - colon - 1) {
+            port = 0;
+        }
+    } catch (const std::exception&) {
+        port = 0;
+    }
+    if (port <= 0 || port > 65535 ||
+        !RPCUtils::is_valid_host(host) || !RPCUtils::is_valid_port(static_cast<uint16_t>(port))) {
+        throw std::runtime_error("Invalid endpoint '" + address + "', expected host:port");
+    }
+    return Endpoint(host, static_cast<uint16_t>(port));
+}
+
+// Lease 实现
+RPCBalancedClient::Lease::Lease(Replica* replica, std::shared_ptr<rpc::client> client)
+    : replica_(replica),
+      client_(std::move(client)),
+      start_(std::chrono::steady_clock::now()) {}
+
+RPCBalancedClient::Lease::Lease(Lease&& other) noexcept
+    : replica_(other.replica_),
+      client_(std::move(other.client_)),
+      start_(other.start_) {
+    other.replica_ = nullptr;
+}
+
+RPCBalancedClient::Lease::~Lease() {
+    if (replica_ != nullptr) {
+        replica_->in_flight.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void RPCBalancedClient::Lease::complete(bool ok) {
+    double sample = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start_).count();
+
+    replica_->calls.fetch_add(1, std::memory_order_relaxed);
+    double current = replica_->ewma_us.load(std::memory_order_relaxed);
+    if (!ok) {
+        replica_->errors.fetch_add(1, std::memory_order_relaxed);
+        sample = std::max(sample, current * kFailurePenalty);
+    }
+
+    double updated;
+    do {
+        // 首个样本直接作为初值
+        updated = current > 0 ? current + kEwmaAlpha * (sample - current) : sample;
+    } while (!replica_->ewma_us.compare_exchange_weak(current, updated, std::memory_order_relaxed));
+}
+
+// RPCBalancedClient 实现
+RPCBalancedClient::RPCBalancedClient(const std::vector<Endpoint>& endpoints, int64_t timeout_ms)
+    : timeout_ms_(timeout_ms) {
+    if (endpoints.empty()) {
+        throw std::runtime_error("Failed to create balanced RPC client: no endpoints");
+    }
+
+    try {
+        replicas_.reserve(endpoints.size());
+        for (const auto& endpoint : endpoints) {
+            auto replica = std::make_unique<Replica>();
+            replica->endpoint = endpoint;
+            replica->client = std::make_shared<rpc::client>(endpoint.host, endpoint.port);
+            if (timeout_ms > 0) {
+                replica->client->set_timeout(timeout_ms);
+            }
+            replica->backoff_ms.store(kMinBackoffMs, std::memory_order_relaxed);
+            replicas_.push_back(std::move(replica));
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to create balanced RPC client: " + std::string(e.what()));
+    }
+}
+
+void RPCBalancedClient::Lease::complete(std::exception_ptr error) {
+    if (!error) {
+        complete(true);
+        return;
+    }
+    try {
+        std::rethrow_exception(error);
+    } catch (const DrainingError&) {
+        retire();
+        complete(false);
+    } catch (const OverloadedError&) {
+        complete(false);
+    } catch (const DeadlineExceededError&) {
+        complete(false);
+    } catch (const rpc::timeout&) {
+        complete(false);
+    } catch (const std::system_error&) {
+        complete(false);
+    } catch (const std::runtime_error&) {
+        // 服务端返回的错误，端点本身是健康的
+        complete(true);
+    } catch (...) {
+        complete(false);
+    }
+}
+
+RPCBalancedClient::~RPCBalancedClient() {
+    // 各连接析构时会自动断开
+}
+
+bool RPCBalancedClient::is_healthy(const Replica& replica) const {
+    return !replica.draining.load(std::memory_order_relaxed) &&
+           std::atomic_load(&replica.client)->get_connection_state() ==
+           rpc::client::connection_state::connected;
+}
+
+void RPCBalancedClient::maybe_reconnect(Replica& replica) {
+    auto state = std::atomic_load(&replica.client)->get_connection_state();
+    if (!replica.draining.load(std::memory_order_relaxed) &&
+        state != rpc::client::connection_state::disconnected &&
+        state != rpc::client::connection_state::reset) {
+        return;
+    }
+
+    int64_t now = now_ns();
+    if (now < replica.retry_at_ns.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(replica.reconnect_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || now < replica.retry_at_ns.load(std::memory_order_relaxed)) {
+        // 其他线程正在重连
+        return;
+    }
+
+    int64_t backoff = replica.backoff_ms.load(std::memory_order_relaxed);
+    replica.retry_at_ns.store(now + backoff * 1000000, std::memory_order_relaxed);
+    replica.backoff_ms.store(std::min(backoff * 2, kMaxBackoffMs), std::memory_order_relaxed);
+
+    try {
+        // rpc::client不会自动重连，断开后换一个新实例；旧实例在最后一个租约归还后析构
+        auto client = std::make_shared<rpc::client>(replica.endpoint.host, replica.endpoint.port);
+        int64_t timeout_ms = timeout_ms_.load(std::memory_order_relaxed);
+        if (timeout_ms > 0) {
+            client->set_timeout(timeout_ms);
+        }
+        std::atomic_store(&replica.client, std::move(client));
+        replica.draining.store(false, std::memory_order_relaxed);
+        replica.reconnects.fetch_add(1, std::memory_order_relaxed);
+        // 新连接按冷启动处理，由新样本重新估计延迟
+        replica.ewma_us.store(0.0, std::memory_order_relaxed);
+    } catch (const std::exception&) {
+        // 地址解析失败等情况，等待下次退避到期后重试
+    }
+}
+
+RPCBalancedClient::Lease RPCBalancedClient::acquire(const Replica* exclude) {
+    // 收集健康端点；顺带为到期的断开端点发起重连
+    thread_local std::vector<Replica*> candidates;
+    thread_local std::vector<Replica*> healthy;
+    candidates.clear();
+    healthy.clear();
+    for (auto& replica : replicas_) {
+        if (replica.get() == exclude && replicas_.size() > 1) {
+            continue;
+        }
+        candidates.push_back(replica.get());
+        if (is_healthy(*replica)) {
+            healthy.push_back(replica.get());
+            // 连接恢复后重置退避
+            replica->backoff_ms.store(kMinBackoffMs, std::memory_order_relaxed);
+        } else {
+            maybe_reconnect(*replica);
+        }
+    }
+
+    Replica* chosen = nullptr;
+    if (healthy.empty()) {
+        // 没有健康端点时（例如刚启动尚在建连）随机选择一个，由调用本身报告错误
+        chosen = candidates[random_index(candidates.size())];
+    } else if (healthy.size() == 1) {
+        chosen = healthy.front();
+    } else {
+        size_t first = random_index(healthy.size());
+        size_t second = random_index(healthy.size() - 1);
+        if (second >= first) {
+            ++second;
+        }
+
+        auto score = [](const Replica* replica) {
+            // 尚无样本的端点按1us计，使新端点能尽快获得流量
+            double latency = std::max(1.0, replica->ewma_us.load(std::memory_order_relaxed));
+            return (replica->in_flight.load(std::memory_order_relaxed) + 1) * latency;
+        };
+        chosen = score(healthy[first]) <= score(healthy[second]) ? healthy[first] : healthy[second];
+    }
+
+    chosen->in_flight.fetch_add(1, std::memory_order_relaxed);
+    return Lease(chosen, std::atomic_load(&chosen->client));
+}
+
+HedgePolicy::Method* RPCBalancedClient::hedge_method(const std::string& func_name) const {
+    if (!hedge_ || replicas_.size() < 2) {
+        return nullptr;
+    }
+    return hedge_->find(func_name);
+}
+
+void RPCBalancedClient::set_hedge_policy(std::shared_ptr<HedgePolicy> policy) {
+    hedge_ = std::move(policy);
+}
+
+void RPCBalancedClient::set_timeout(int64_t timeout_ms) {
+    timeout_ms_.store(timeout_ms, std::memory_order_relaxed);
+    for (auto& replica : replicas_) {
+        std::atomic_load(&replica->client)->set_timeout(timeout_ms);
+    }
+}
+
+void RPCBalancedClient::clear_timeout() {
+    timeout_ms_.store(0, std::memory_order_relaxed);
+    for (auto& replica : replicas_) {
+        std::atomic_load(&replica->client)->clear_timeout();
+    }
+}
+
+size_t RPCBalancedClient::size() const {
+    return replicas_.size();
+}
+
+size_t RPCBalancedClient::healthy_count() const {
+    size_t healthy = 0;
+    for (const auto& replica : replicas_) {
+        if (is_healthy(*replica)) {
+            ++healthy;
+        }
+    }
+    return healthy;
+}
+
+std::vector<EndpointStats> RPCBalancedClient::endpoint_stats() const {
+    std::vector<EndpointStats> result;
+    result.reserve(replicas_.size());
+    for (const auto& replica : replicas_) {
+        EndpointStats stats;
+        stats.endpoint = replica->endpoint;
+        stats.healthy = is_healthy(*replica);
+        stats.in_flight = replica->in_flight.load(std::memory_order_relaxed);
+        stats.ewma_latency_us = replica->ewma_us.load(std::memory_order_relaxed);
+        stats.calls = replica->calls.load(std::memory_order_relaxed);
+        stats.errors = replica->errors.load(std::memory_order_relaxed);
+        stats.reconnects = replica->reconnects.load(std::memory_order_relaxed);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+detail::CompletionQueue& RPCBalancedClient::completions() {
+    std::call_once(completions_once_, [this]() {
+        completions_ = std::make_unique<detail::CompletionQueue>();
+    });
+    return *completions_;
+}
+
+void RPCBalancedClient::wait_all_responses() {
+    for (auto& replica : replicas_) {
+        std::atomic_load(&replica->client)->wait_all_responses();
+    }
+}
+
+} // namespace rpc_utils
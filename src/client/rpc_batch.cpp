@@ -0,0 +1,62 @@
+#include "rpc_batch.h"
+
+namespace rpc_utils {
+
+// RPCBatch 实现
+RPCBatch::RPCBatch() : zone_(std::make_unique<RPCLIB_MSGPACK::zone>()) {}
+
+void RPCBatch::clear() {
+    items_.clear();
+    zone_ = std::make_unique<RPCLIB_MSGPACK::zone>();
+}
+
+// BatchResults 实现
+BatchResults::BatchResults(RPCLIB_MSGPACK::object_handle handle)
+    : handle_(std::move(handle)) {
+    // 结果项中的value直接引用handle_内存区中的数据，不做拷贝
+    detail::BatchReply reply;
+    handle_.get().convert(reply);
+    items_ = std::move(reply.items);
+}
+
+bool BatchResults::ok(size_t index) const {
+    return item(index).ok;
+}
+
+const std::string& BatchResults::error(size_t index) const {
+    return item(index).error;
+}
+
+const ErrorInfo& BatchResults::error_info(size_t index) const {
+    return item(index).info;
+}
+
+void BatchResults::throw_error(size_t index) const {
+    const detail::BatchResultItem& result = item(index);
+    std::string call = "batched call #" + std::to_string(index);
+    if (result.info.code == kOverloadedErrorCode) {
+        throw OverloadedError("Server overloaded in " + call + ": " + result.info.message, call,
+                              std::chrono::milliseconds(result.info.retry_after_ms));
+    }
+    if (result.info.code == kDrainingErrorCode) {
+        throw DrainingError("Server draining in " + call + ": " + result.info.message, call);
+    }
+    if (result.info.code == kDeadlineExceededErrorCode) {
+        throw DeadlineExceededError("Deadline exceeded in " + call + ": " + result.info.message);
+    }
+    throw std::runtime_error("Batched RPC call #" + std::to_string(index) + " failed: " + result.error);
+}
+
+const RPCLIB_MSGPACK::object& BatchResults::raw(size_t index) const {
+    return item(index).value;
+}
+
+const detail::BatchResultItem& BatchResults::item(size_t index) const {
+    if (index >= items_.size()) {
+        throw std::out_of_range("Batch result index " + std::to_string(index) +
+                                " out of range (size " + std::to_string(items_.size()) + ")");
+    }
+    return items_[index];
+}
+
+} // namespace rpc_utils
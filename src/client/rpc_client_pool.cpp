@@ -0,0 +1,130 @@
+#include "rpc_client_pool.h"
+#include <stdexcept>
+#include <thread>
+#include <limits>
+#include <algorithm>
+
+namespace rpc_utils {
+
+RPCClientPool::RPCClientPool(const std::string& host, uint16_t port,
+                             size_t pool_size, int64_t timeout_ms)
+    : next_(0), timeout_ms_(timeout_ms), host_(host), port_(port) {
+    if (pool_size == 0) {
+        pool_size = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    try {
+        connections_.reserve(pool_size);
+        for (size_t i = 0; i < pool_size; ++i) {
+            auto conn = std::make_unique<Connection>();
+            conn->client = std::make_unique<rpc::client>(host, port);
+            if (timeout_ms > 0) {
+                conn->client->set_timeout(timeout_ms);
+            }
+            connections_.push_back(std::move(conn));
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to create RPC client pool: " + std::string(e.what()));
+    }
+}
+
+RPCClientPool::~RPCClientPool() {
+    // 各连接析构时会自动断开
+}
+
+RPCClientPool::Lease RPCClientPool::acquire(const Connection* exclude) {
+    const size_t count = connections_.size();
+    // 轮转起点，避免负载相同时总是落在第一条连接上
+    const size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+
+    Connection* best = nullptr;
+    size_t best_load = std::numeric_limits<size_t>::max();
+    bool best_connected = false;
+
+    for (size_t i = 0; i < count; ++i) {
+        Connection* conn = connections_[(start + i) % count].get();
+        if (conn == exclude && count > 1) {
+            continue;
+        }
+        size_t load = conn->in_flight.load(std::memory_order_relaxed);
+        bool connected = conn->client->get_connection_state() ==
+                         rpc::client::connection_state::connected;
+
+        // 优先选择已连接的连接，其次比较在途请求数
+        if (best == nullptr ||
+            (connected && !best_connected) ||
+            (connected == best_connected && load < best_load)) {
+            best = conn;
+            best_load = load;
+            best_connected = connected;
+            if (connected && load == 0) {
+                break;
+            }
+        }
+    }
+
+    best->in_flight.fetch_add(1, std::memory_order_relaxed);
+    return Lease(best);
+}
+
+HedgePolicy::Method* RPCClientPool::hedge_method(const std::string& func_name) const {
+    if (!hedge_ || connections_.size() < 2) {
+        return nullptr;
+    }
+    return hedge_->find(func_name);
+}
+
+detail::CompletionQueue& RPCClientPool::completions() {
+    std::call_once(completions_once_, [this]() {
+        completions_ = std::make_unique<detail::CompletionQueue>();
+    });
+    return *completions_;
+}
+
+void RPCClientPool::set_hedge_policy(std::shared_ptr<HedgePolicy> policy) {
+    hedge_ = std::move(policy);
+}
+
+void RPCClientPool::set_timeout(int64_t timeout_ms) {
+    timeout_ms_.store(timeout_ms, std::memory_order_relaxed);
+    for (auto& conn : connections_) {
+        conn->client->set_timeout(timeout_ms);
+    }
+}
+
+void RPCClientPool::clear_timeout() {
+    timeout_ms_.store(0, std::memory_order_relaxed);
+    for (auto& conn : connections_) {
+        conn->client->clear_timeout();
+    }
+}
+
+size_t RPCClientPool::size() const {
+    return connections_.size();
+}
+
+size_t RPCClientPool::connected_count() const {
+    size_t connected = 0;
+    for (const auto& conn : connections_) {
+        if (conn->client->get_connection_state() == rpc::client::connection_state::connected) {
+            ++connected;
+        }
+    }
+    return connected;
+}
+
+size_t RPCClientPool::in_flight() const {
+    size_t total = 0;
+    for (const auto& conn : connections_) {
+        total += conn->in_flight.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void RPCClientPool::wait_all_responses() {
+    for (auto& conn : connections_) {
+        conn->client->wait_all_responses();
+    }
+}
+
+} // namespace rpc_utils
@@ -4,7 +4,8 @@
 namespace rpc_utils {
 
 RPCClientWrapper::RPCClientWrapper(const std::string& host, uint16_t port, int64_t timeout_ms)
-    : host_(host), port_(port) {
+    : host_(host), port_(port), timeout_ms_(timeout_ms), propagate_deadline_(false), propagate_trace_(false) {
+    compression_.codec = Codec::none;
     try {
         client_ = std::make_unique<rpc::client>(host, port);
         if (timeout_ms > 0) {
@@ -15,24 +16,178 @@ RPCClientWrapper::RPCClientWrapper(const std::string& host, uint16_t port, int64
     }
 }
 
+RPCClientWrapper::RPCClientWrapper(const std::string& endpoint)
+    : port_(0), timeout_ms_(5000), propagate_deadline_(false), propagate_trace_(false) {
+    compression_.codec = Codec::none;
+    detail::TransportAddress address = detail::TransportAddress::parse(endpoint);
+    try {
+        if (address.kind == detail::TransportKind::tcp) {
+            host_ = address.host;
+            port_ = address.port;
+            client_ = std::make_unique<rpc::client>(host_, port_);
+            client_->set_timeout(timeout_ms_);
+        } else {
+            local_ = std::make_unique<detail::LocalClient>(address);
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to create RPC client: " + std::string(e.what()));
+    }
+}
+
 RPCClientWrapper::~RPCClientWrapper() {
     // 客户端析构时会自动断开连接
 }
 
+BatchResults RPCClientWrapper::call_batch(const RPCBatch& batch, bool parallel) {
+    try {
+        return BatchResults(tcp_client("Batch call").call(detail::kBatchMethod, batch.items(), parallel));
+    } catch (const rpc::rpc_error& e) {
+        throw std::runtime_error("RPC batch call failed: " + std::string(e.what()));
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Exception in RPC batch call: " + std::string(e.what()));
+    }
+}
+
+std::future<BatchResults> RPCClientWrapper::async_call_batch(const RPCBatch& batch, bool parallel) {
+    auto response = tcp_client("Batch call").async_call(detail::kBatchMethod, batch.items(), parallel);
+    auto promise = std::make_shared<std::promise<BatchResults>>();
+    auto result = promise->get_future();
+    auto deadline = timeout_ms_ > 0
+        ? detail::CompletionQueue::Clock::now() + std::chrono::milliseconds(timeout_ms_)
+        : detail::CompletionQueue::Clock::time_point::max();
+    completions().add(detail::kBatchMethod, std::move(response), nullptr, deadline,
+        [promise](RPCLIB_MSGPACK::object_handle reply, std::exception_ptr error) {
+            if (!error) {
+                try {
+                    promise->set_value(BatchResults(std::move(reply)));
+                    return;
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            promise->set_exception(error);
+        });
+    return result;
+}
+
 void RPCClientWrapper::set_timeout(int64_t timeout_ms) {
-    client_->set_timeout(timeout_ms);
+    timeout_ms_ = timeout_ms;
+    if (client_) {
+        client_->set_timeout(timeout_ms);
+    }
 }
 
 void RPCClientWrapper::clear_timeout() {
-    client_->clear_timeout();
+    timeout_ms_ = 0;
+    if (client_) {
+        client_->clear_timeout();
+    }
+}
+
+void RPCClientWrapper::set_propagate_deadline(bool enable) {
+    if (enable) {
+        require_tcp("Deadline propagation");
+    }
+    propagate_deadline_ = enable;
+}
+
+void RPCClientWrapper::set_propagate_trace(bool enable) {
+    if (enable) {
+        require_tcp("Trace propagation");
+    }
+    propagate_trace_ = enable;
+}
+
+void RPCClientWrapper::require_tcp(const char* feature) const {
+    if (local_) {
+        throw std::runtime_error(std::string(feature) + " is not supported on unix:// and shm:// connections");
+    }
+}
+
+detail::WireContext RPCClientWrapper::wire_context(const detail::CallDeadline& deadline,
+                                                   const TraceContext& trace) const {
+    detail::WireContext wire = propagate_deadline_ ? deadline.wire() : detail::WireContext();
+    wire.trace_id = trace.trace_id;
+    wire.span_id = trace.span_id;
+    return wire;
+}
+
+void RPCClientWrapper::enable_compression(const CompressionOptions& options) {
+    if (options.codec != Codec::none) {
+        require_tcp("Compression");
+    }
+    compression_ = options;
+}
+
+void RPCClientWrapper::set_method_compression(const std::string& name, const CompressionOptions& options) {
+    if (options.codec != Codec::none) {
+        require_tcp("Compression");
+    }
+    method_compression_[name] = options;
+}
+
+size_t RPCClientWrapper::pending_callbacks() const {
+    return completions_ ? completions_->pending() : 0;
+}
+
+void RPCClientWrapper::set_inflight_limit(const InflightOptions& options) {
+    window_ = std::make_shared<detail::InflightWindow>(options);
+}
+
+InflightStats RPCClientWrapper::inflight_stats() const {
+    return window_ ? window_->stats() : InflightStats();
+}
+
+detail::CompletionQueue& RPCClientWrapper::completions() {
+    std::call_once(completions_once_, [this]() {
+        completions_ = std::make_unique<detail::CompletionQueue>();
+    });
+    return *completions_;
+}
+
+rpc::client& RPCClientWrapper::tcp_client(const char* feature) const {
+    if (!client_) {
+        throw std::runtime_error(std::string(feature) + " is only supported over TCP");
+    }
+    return *client_;
+}
+
+const CompressionOptions* RPCClientWrapper::compression_for(const std::string& func_name) const {
+    const CompressionOptions* options = &compression_;
+    if (!method_compression_.empty()) {
+        auto it = method_compression_.find(func_name);
+        if (it != method_compression_.end()) {
+            options = &it->second;
+        }
+    }
+    return options->codec == Codec::none ? nullptr : options;
+}
+
+void RPCClientWrapper::set_write_coalescing(const CoalesceOptions& options) {
+    if (local_) {
+        local_->set_coalescing(options);
+    }
+}
+
+void RPCClientWrapper::flush() {
+    if (local_) {
+        local_->flush();
+    }
 }
 
 rpc::client::connection_state RPCClientWrapper::get_connection_state() const {
+    if (local_) {
+        return local_->is_connected() ? rpc::client::connection_state::connected
+                                      : rpc::client::connection_state::disconnected;
+    }
     return client_->get_connection_state();
 }
 
 void RPCClientWrapper::wait_all_responses() {
-    client_->wait_all_responses();
+    // 同主机传输的异步调用在get()时才读取响应，无需等待
+    if (client_) {
+        client_->wait_all_responses();
+    }
 }
 
 bool RPCClientWrapper::is_connected() const {
@@ -0,0 +1,168 @@
+#include "rpc_completion.h"
+#include "rpc_errors.h"
+#include "rpc_utils.h"
+#include "rpc/rpc_error.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+// 检查其余请求的间隔：有调用完成时为最小值，连续没有调用完成时逐次加倍直到最大值
+const std::chrono::steady_clock::duration kMinSweepInterval = std::chrono::microseconds(200);
+const std::chrono::steady_clock::duration kMaxSweepInterval = std::chrono::milliseconds(10);
+
+thread_local bool tls_completion_thread = false;
+
+} // namespace
+
+bool in_completion_thread() {
+    return tls_completion_thread;
+}
+
+CompletionQueue::CompletionQueue() : stopping_(false), pending_(0) {
+    thread_ = std::thread(&CompletionQueue::run, this);
+}
+
+CompletionQueue::~CompletionQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void CompletionQueue::add(const std::string& func_name, std::future<RPCLIB_MSGPACK::object_handle> response,
+                          Finish finish, Clock::time_point deadline, CallCallback callback) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        incoming_.push_back(Entry{func_name, std::move(response), std::move(finish), deadline,
+                                  std::move(callback)});
+    }
+    cv_.notify_one();
+}
+
+void CompletionQueue::run() {
+    tls_completion_thread = true;
+    std::deque<Entry> waiting;
+    Clock::time_point last_sweep = Clock::now();
+    Clock::duration interval = kMinSweepInterval;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (waiting.empty()) {
+                cv_.wait(lock, [this] { return stopping_ || !incoming_.empty(); });
+            } else if (interval > kMinSweepInterval) {
+                // 退避中：最早的请求已等待多次检查仍未完成，在条件变量上等待，新提交的调用可以唤醒
+                cv_.wait_until(lock, last_sweep + interval, [this] { return stopping_ || !incoming_.empty(); });
+            }
+            if (stopping_) {
+                for (auto& entry : incoming_) {
+                    waiting.push_back(std::move(entry));
+                }
+                incoming_.clear();
+                break;
+            }
+            if (!incoming_.empty()) {
+                interval = kMinSweepInterval;
+            }
+            for (auto& entry : incoming_) {
+                waiting.push_back(std::move(entry));
+            }
+            incoming_.clear();
+        }
+
+        // 在最早的请求上等待到下一次检查；延迟求值的future（同主机传输）只能在这里阻塞取出
+        Clock::time_point now = Clock::now();
+        Clock::duration slice = interval == kMinSweepInterval && last_sweep + interval > now
+            ? last_sweep + interval - now
+            : Clock::duration::zero();
+        Entry& front = waiting.front();
+        std::future_status status = front.response.wait_for(slice);
+        bool progressed = false;
+        if (status != std::future_status::timeout) {
+            complete(front);
+            waiting.pop_front();
+            progressed = true;
+        } else if (Clock::now() >= front.deadline) {
+            deliver(front, RPCLIB_MSGPACK::object_handle(), std::make_exception_ptr(DeadlineExceededError(
+                "Deadline exceeded while waiting for '" + front.func_name + "'")));
+            waiting.pop_front();
+            progressed = true;
+        }
+
+        now = Clock::now();
+        if (now - last_sweep < interval) {
+            if (progressed) {
+                interval = kMinSweepInterval;
+            }
+            continue;
+        }
+        last_sweep = now;
+        std::deque<Entry> still_waiting;
+        for (auto& entry : waiting) {
+            status = entry.response.wait_for(std::chrono::seconds(0));
+            if (status == std::future_status::ready) {
+                complete(entry);
+                progressed = true;
+            } else if (status == std::future_status::timeout && now >= entry.deadline) {
+                deliver(entry, RPCLIB_MSGPACK::object_handle(), std::make_exception_ptr(DeadlineExceededError(
+                    "Deadline exceeded while waiting for '" + entry.func_name + "'")));
+                progressed = true;
+            } else {
+                still_waiting.push_back(std::move(entry));
+            }
+        }
+        waiting.swap(still_waiting);
+        // 没有任何调用完成时检查间隔加倍，有调用完成时恢复
+        interval = progressed ? kMinSweepInterval : std::min<Clock::duration>(2 * interval, kMaxSweepInterval);
+    }
+
+    // 客户端关闭时，未完成的调用以异常结束
+    for (auto& entry : waiting) {
+        deliver(entry, RPCLIB_MSGPACK::object_handle(), std::make_exception_ptr(std::runtime_error(
+            "RPC client closed before the response to '" + entry.func_name + "' arrived")));
+    }
+}
+
+void CompletionQueue::complete(Entry& entry) {
+    RPCLIB_MSGPACK::object_handle result;
+    std::exception_ptr error;
+    try {
+        result = entry.response.get();
+        if (entry.finish) {
+            result = entry.finish(std::move(result));
+        }
+    } catch (rpc::rpc_error& e) {
+        try {
+            rethrow_call_error(entry.func_name, e);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    deliver(entry, std::move(result), error);
+}
+
+void CompletionQueue::deliver(Entry& entry, RPCLIB_MSGPACK::object_handle result, std::exception_ptr error) {
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    try {
+        entry.callback(std::move(result), error);
+    } catch (const std::exception& e) {
+        Logger::warningf("Completion callback for '%s' threw an exception: %s",
+                         entry.func_name.c_str(), e.what());
+    } catch (...) {
+        Logger::warningf("Completion callback for '%s' threw an unknown exception",
+                         entry.func_name.c_str());
+    }
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
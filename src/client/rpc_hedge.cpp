@@ -0,0 +1,194 @@
+#include "rpc_hedge.h"
+#include "rpc/rpc_error.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace {
+
+// 令牌以千分之一为单位计数，避免浮点原子操作
+const int64_t kTokenScale = 1000;
+
+// 两路请求都在途时轮询的初始和最大间隔
+const std::chrono::microseconds kMinPollSlice(50);
+const std::chrono::microseconds kMaxPollSlice(1000);
+
+} // namespace
+
+HedgePolicy::HedgePolicy(HedgeOptions options)
+    : options_(options),
+      token_unit_(kTokenScale),
+      token_deposit_(static_cast<int64_t>(std::max(0.0, options.budget_ratio) * kTokenScale)),
+      token_max_(static_cast<int64_t>(std::max(1.0, options.max_burst) * kTokenScale)),
+      tokens_(0),
+      requests_(0),
+      hedged_(0),
+      hedge_wins_(0),
+      budget_exhausted_(0) {
+    if (options_.window == 0) {
+        options_.window = 1;
+    }
+}
+
+void HedgePolicy::mark_idempotent(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& method = methods_[name];
+    if (!method) {
+        method = std::make_unique<Method>();
+    }
+}
+
+bool HedgePolicy::is_idempotent(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+HedgePolicy::Method* HedgePolicy::find(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = methods_.find(name);
+    return it != methods_.end() ? it->second.get() : nullptr;
+}
+
+std::chrono::microseconds HedgePolicy::delay(const std::string& name) const {
+    const Method* method = find(name);
+    return method != nullptr ? delay(method) : std::chrono::microseconds::max();
+}
+
+std::chrono::microseconds HedgePolicy::delay(const Method* method) const {
+    if (options_.delay.count() > 0) {
+        return options_.delay;
+    }
+    int64_t delay_us = method->delay_us.load(std::memory_order_relaxed);
+    return delay_us < 0 ? std::chrono::microseconds::max() : std::chrono::microseconds(delay_us);
+}
+
+void HedgePolicy::on_request() {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    int64_t current = tokens_.load(std::memory_order_relaxed);
+    while (current < token_max_ &&
+           !tokens_.compare_exchange_weak(current, std::min(token_max_, current + token_deposit_),
+                                          std::memory_order_relaxed)) {
+    }
+}
+
+bool HedgePolicy::try_hedge() {
+    int64_t current = tokens_.load(std::memory_order_relaxed);
+    while (current >= token_unit_) {
+        if (tokens_.compare_exchange_weak(current, current - token_unit_, std::memory_order_relaxed)) {
+            hedged_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    budget_exhausted_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void HedgePolicy::record(Method* method, uint64_t latency_ns, bool hedge_won) {
+    if (hedge_won) {
+        hedge_wins_.fetch_add(1, std::memory_order_relaxed);
+    }
+    method->latency.record(latency_ns);
+
+    uint64_t samples = method->samples.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (samples % options_.window == 0) {
+        // 只由凑满窗口的线程重新估计；清空时与并发记录之间丢失少量样本可以接受
+        uint64_t p_ns = method->latency.snapshot().percentile(options_.percentile);
+        int64_t delay_us = std::max<int64_t>(options_.min_delay.count(),
+                                             static_cast<int64_t>(p_ns / 1000));
+        method->delay_us.store(delay_us, std::memory_order_relaxed);
+        method->latency.reset();
+    }
+}
+
+HedgeStats HedgePolicy::stats() const {
+    HedgeStats stats;
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.hedged = hedged_.load(std::memory_order_relaxed);
+    stats.hedge_wins = hedge_wins_.load(std::memory_order_relaxed);
+    stats.budget_exhausted = budget_exhausted_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+namespace detail {
+
+HedgedResult run_hedged(HedgePolicy& policy, HedgePolicy::Method* method,
+                        const std::string& func_name,
+                        const std::function<std::future<RPCLIB_MSGPACK::object_handle>(bool)>& send,
+                        int64_t timeout_ms) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const bool bounded = timeout_ms > 0;
+    const auto deadline = start + std::chrono::milliseconds(bounded ? timeout_ms : 0);
+
+    policy.on_request();
+
+    std::future<RPCLIB_MSGPACK::object_handle> responses[2];
+    bool pending[2] = {true, false};
+    responses[0] = send(false);
+
+    std::chrono::microseconds hedge_delay = policy.delay(method);
+    if (hedge_delay != std::chrono::microseconds::max() &&
+        (!bounded || start + hedge_delay < deadline)) {
+        if (responses[0].wait_until(start + hedge_delay) != std::future_status::ready &&
+            policy.try_hedge()) {
+            responses[1] = send(true);
+            pending[1] = true;
+        }
+    }
+
+    std::exception_ptr last_error;
+    std::chrono::microseconds slice = kMinPollSlice;
+    while (true) {
+        for (int i = 0; i < 2; ++i) {
+            if (!pending[i] ||
+                responses[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            try {
+                HedgedResult result;
+                result.handle = responses[i].get();
+                result.hedge_won = (i == 1);
+                policy.record(method, static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()),
+                    result.hedge_won);
+                return result;
+            } catch (const rpc::rpc_error&) {
+                // 服务端错误对两路请求是一样的，不必再等
+                throw;
+            } catch (...) {
+                last_error = std::current_exception();
+                pending[i] = false;
+            }
+        }
+
+        if (!pending[0] && !pending[1]) {
+            std::rethrow_exception(last_error);
+        }
+        if (bounded && Clock::now() >= deadline) {
+            throw std::runtime_error("Timeout of " + std::to_string(timeout_ms) +
+                                     "ms while calling RPC function '" + func_name + "'");
+        }
+
+        if (pending[0] != pending[1]) {
+            // 只剩一路在途，直接阻塞等待
+            auto& response = responses[pending[0] ? 0 : 1];
+            if (bounded) {
+                response.wait_until(deadline);
+            } else {
+                response.wait();
+            }
+        } else {
+            // std::future不能同时等待两个，两路都在途时以逐渐加长的间隔轮流检查
+            auto until = Clock::now() + slice;
+            if (bounded) {
+                until = std::min(until, deadline);
+            }
+            responses[0].wait_until(until);
+            slice = std::min(slice * 2, kMaxPollSlice);
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
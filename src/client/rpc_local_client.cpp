@@ -0,0 +1,147 @@
+#include "rpc_local_transport.h"
+#include "rpc_errors.h"
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+/**
+ * @brief 校验响应[1, id, error, result]并返回id
+ */
+uint32_t response_id(const RPCLIB_MSGPACK::object& response) {
+    if (response.type != RPCLIB_MSGPACK::type::ARRAY || response.via.array.size != 4 ||
+        response.via.array.ptr[0].as<int>() != 1) {
+        throw std::runtime_error("Malformed response frame");
+    }
+    return response.via.array.ptr[1].as<uint32_t>();
+}
+
+} // namespace
+
+LocalClient::LocalClient(const TransportAddress& address)
+    : connection_(LocalConnection::connect(address)),
+      endpoint_(address.to_string()),
+      next_id_(0),
+      coalescing_(false),
+      reading_(false) {}
+
+LocalClient::~LocalClient() {
+    if (coalescing_.load(std::memory_order_relaxed) && connection_->is_open()) {
+        // 累积的通知不丢弃
+        try {
+            flush();
+        } catch (const std::exception&) {
+        }
+    }
+    connection_->close();
+}
+
+void LocalClient::send_frame(const ScratchBuffer& frame) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    connection_->send(frame.data(), frame.size());
+}
+
+void LocalClient::set_coalescing(const CoalesceOptions& options) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    connection_->set_coalescing(options);
+    coalescing_.store(options.enabled, std::memory_order_relaxed);
+}
+
+void LocalClient::flush() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    connection_->flush();
+}
+
+RPCLIB_MSGPACK::object_handle LocalClient::wait_response(uint32_t id, const std::string& func_name,
+                                                         Clock::time_point deadline) {
+    if (coalescing_.load(std::memory_order_relaxed)) {
+        // 开始等待前写出累积的请求（包括本次调用）
+        try {
+            flush();
+        } catch (const std::exception& e) {
+            throw std::runtime_error("RPC call failed for function '" + func_name + "' over " +
+                                     endpoint_ + ": " + e.what());
+        }
+    }
+    RPCLIB_MSGPACK::object_handle response;
+    std::unique_lock<std::mutex> lock(read_mutex_);
+    while (true) {
+        auto it = ready_.find(id);
+        if (it != ready_.end()) {
+            response = std::move(it->second);
+            ready_.erase(it);
+            break;
+        }
+        if (!failure_.empty()) {
+            throw std::runtime_error("RPC call failed for function '" + func_name + "' over " +
+                                     endpoint_ + ": " + failure_);
+        }
+        if (Clock::now() >= deadline) {
+            abandoned_.insert(id);
+            throw std::runtime_error("Timeout while calling RPC function '" + func_name + "' over " + endpoint_);
+        }
+
+        if (reading_) {
+            // 其他线程正在读取，等它转交响应或让出读取权
+            if (deadline == Clock::time_point::max()) {
+                read_cv_.wait(lock);
+            } else {
+                read_cv_.wait_until(lock, deadline);
+            }
+            continue;
+        }
+
+        // 由当前线程读取下一帧
+        reading_ = true;
+        lock.unlock();
+        RPCLIB_MSGPACK::object_handle frame_handle;
+        uint32_t frame_id = 0;
+        bool received = false;
+        std::string error;
+        try {
+            ScratchBuffer frame;
+            received = connection_->receive(frame, deadline);
+            if (received) {
+                frame_handle = pooled_unpack(frame.data(), frame.size());
+                frame_id = response_id(frame_handle.get());
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        lock.lock();
+        reading_ = false;
+        read_cv_.notify_all();
+        if (!error.empty()) {
+            failure_ = error;
+            continue;
+        }
+        if (!received) {
+            continue;
+        }
+        if (frame_id == id) {
+            response = std::move(frame_handle);
+            break;
+        }
+        if (abandoned_.erase(frame_id) == 0) {
+            ready_.emplace(frame_id, std::move(frame_handle));
+        }
+    }
+    lock.unlock();
+
+    const RPCLIB_MSGPACK::object& error = response.get().via.array.ptr[2];
+    if (!error.is_nil()) {
+        std::string what = error.type == RPCLIB_MSGPACK::type::STR
+            ? error.as<std::string>()
+            : std::string("server returned an error");
+        rethrow_error_object(func_name, error, what, " over " + endpoint_);
+    }
+    RPCLIB_MSGPACK::object result = response.get().via.array.ptr[3];
+    return RPCLIB_MSGPACK::object_handle(result, std::move(response.zone()));
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
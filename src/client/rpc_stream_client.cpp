@@ -0,0 +1,179 @@
+#include "rpc_stream.h"
+#include "rpc/rpc_error.h"
+#include <algorithm>
+
+namespace rpc_utils {
+
+namespace {
+
+[[noreturn]] void rethrow_stream_error(const std::string& name, const char* what) {
+    throw std::runtime_error("Stream '" + name + "' failed: " + what);
+}
+
+} // namespace
+
+namespace detail {
+
+// ClientStreamBase 实现
+ClientStreamBase::ClientStreamBase(rpc::client& client, std::string name, const StreamOpenReply& reply)
+    : client_(&client),
+      name_(std::move(name)),
+      id_(reply.id),
+      offset_(0),
+      remaining_(0),
+      done_(false) {}
+
+ClientStreamBase::ClientStreamBase(ClientStreamBase&& other) noexcept
+    : client_(other.client_),
+      name_(std::move(other.name_)),
+      id_(other.id_),
+      chunk_handle_(std::move(other.chunk_handle_)),
+      chunk_(std::move(other.chunk_)),
+      offset_(other.offset_),
+      remaining_(other.remaining_),
+      done_(other.done_),
+      pending_(std::move(other.pending_)) {
+    other.client_ = nullptr;
+    other.done_ = true;
+}
+
+ClientStreamBase::~ClientStreamBase() {
+    cancel();
+}
+
+void ClientStreamBase::cancel() {
+    if (client_ == nullptr || done_) {
+        return;
+    }
+    done_ = true;
+    remaining_ = 0;
+    try {
+        client_->send(kStreamCancelMethod, id_);
+    } catch (...) {
+        // 连接已断开时服务端会在空闲超时后回收该流
+    }
+}
+
+bool ClientStreamBase::next_object(RPCLIB_MSGPACK::object_handle& item) {
+    while (remaining_ == 0) {
+        if (done_) {
+            if (!chunk_.error.empty()) {
+                rethrow_stream_error(name_, chunk_.error.c_str());
+            }
+            return false;
+        }
+        fetch();
+    }
+    item = RPCLIB_MSGPACK::unpack(chunk_.data.data(), chunk_.data.size(), offset_);
+    --remaining_;
+    return true;
+}
+
+void ClientStreamBase::fetch() {
+    try {
+        RPCLIB_MSGPACK::object_handle handle = pending_.valid()
+            ? pending_.get()
+            : client_->call(kStreamNextMethod, id_);
+        // chunk_.data指向handle的内存区，二者一起保存
+        chunk_ = handle.get().as<StreamChunk>();
+        chunk_handle_ = std::move(handle);
+        offset_ = 0;
+        remaining_ = chunk_.count;
+        if (chunk_.done) {
+            done_ = true;
+        } else {
+            // 处理当前批次的同时预取下一批
+            pending_ = client_->async_call(kStreamNextMethod, id_);
+        }
+    } catch (const rpc::rpc_error& e) {
+        done_ = true;
+        rethrow_stream_error(name_, e.what());
+    }
+}
+
+} // namespace detail
+
+// ClientStreamWriter 实现
+ClientStreamWriter::ClientStreamWriter(rpc::client& client, std::string name,
+                                       const detail::StreamOpenReply& reply)
+    : client_(&client),
+      name_(std::move(name)),
+      id_(reply.id),
+      // 每次推送半个窗口，服务端处理一批的同时可以接收下一批
+      flush_items_(std::max<uint64_t>(1, reply.window_items / 2)),
+      flush_bytes_(std::max<uint64_t>(1, reply.window_bytes / 2)),
+      count_(0),
+      finished_(false) {}
+
+ClientStreamWriter::ClientStreamWriter(ClientStreamWriter&& other) noexcept
+    : client_(other.client_),
+      name_(std::move(other.name_)),
+      id_(other.id_),
+      flush_items_(other.flush_items_),
+      flush_bytes_(other.flush_bytes_),
+      buffer_(std::move(other.buffer_)),
+      count_(other.count_),
+      finished_(other.finished_) {
+    other.client_ = nullptr;
+    other.finished_ = true;
+}
+
+ClientStreamWriter::~ClientStreamWriter() {
+    cancel();
+}
+
+void ClientStreamWriter::flush() {
+    if (count_ == 0) {
+        return;
+    }
+    try {
+        BinaryView data(buffer_.data(), buffer_.size());
+        // 服务端窗口已满时每次等待一段时间后返回false，重试直到被接受
+        while (!client_->call(detail::kStreamPushMethod, id_, data,
+                              static_cast<uint32_t>(count_)).as<bool>()) {
+        }
+    } catch (const rpc::rpc_error& e) {
+        finished_ = true;
+        rethrow_stream_error(name_, e.what());
+    }
+    buffer_.clear();
+    count_ = 0;
+}
+
+RPCLIB_MSGPACK::object_handle ClientStreamWriter::finish_raw() {
+    if (finished_) {
+        throw std::runtime_error("Stream '" + name_ + "' has already finished");
+    }
+    flush();
+    try {
+        while (true) {
+            RPCLIB_MSGPACK::object_handle handle = client_->call(detail::kStreamFinishMethod, id_);
+            detail::StreamResult result = handle.get().as<detail::StreamResult>();
+            if (!result.done) {
+                continue;
+            }
+            finished_ = true;
+            if (!result.error.empty()) {
+                rethrow_stream_error(name_, result.error.c_str());
+            }
+            return RPCLIB_MSGPACK::unpack(result.value.data(), result.value.size());
+        }
+    } catch (const rpc::rpc_error& e) {
+        finished_ = true;
+        rethrow_stream_error(name_, e.what());
+    }
+}
+
+void ClientStreamWriter::cancel() {
+    if (client_ == nullptr || finished_) {
+        return;
+    }
+    finished_ = true;
+    try {
+        client_->send(detail::kStreamCancelMethod, id_);
+    } catch (...) {
+        // 连接已断开时服务端会在空闲超时后回收该流
+    }
+}
+
+} // namespace rpc_utils
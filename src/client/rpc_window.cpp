@@ -0,0 +1,116 @@
+#include "rpc_window.h"
+#include "rpc_errors.h"
+#include "rpc_utils.h"
+#include <algorithm>
+
+namespace rpc_utils {
+
+namespace detail {
+
+InflightWindow::InflightWindow(const InflightOptions& options)
+    : options_(options),
+      in_flight_(0),
+      in_flight_bytes_(0),
+      waiting_(0),
+      waits_(0),
+      rejected_(0),
+      total_wait_us_(0),
+      max_wait_us_(0),
+      notify_capacity_(false) {}
+
+void InflightWindow::acquire(const std::string& func_name, size_t bytes, int64_t timeout_ms, bool may_block) {
+    reserve(func_name, bytes, timeout_ms, may_block, true);
+}
+
+void InflightWindow::admit(const std::string& func_name, size_t bytes, int64_t timeout_ms, bool may_block) {
+    reserve(func_name, bytes, timeout_ms, may_block, false);
+}
+
+bool InflightWindow::has_room(size_t bytes) const {
+    if (options_.max_requests > 0 && in_flight_ >= options_.max_requests) {
+        return false;
+    }
+    return options_.max_bytes == 0 || in_flight_ == 0 || in_flight_bytes_ + bytes <= options_.max_bytes;
+}
+
+void InflightWindow::reserve(const std::string& func_name, size_t bytes, int64_t timeout_ms,
+                             bool may_block, bool take) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!has_room(bytes)) {
+        bool waited = false;
+        if (options_.policy == BackpressurePolicy::block && may_block) {
+            Clock::time_point start = Clock::now();
+            ++waiting_;
+            ++waits_;
+            auto ready = [&] { return has_room(bytes); };
+            if (timeout_ms > 0) {
+                waited = cv_.wait_until(lock, start + std::chrono::milliseconds(timeout_ms), ready);
+            } else {
+                cv_.wait(lock, ready);
+                waited = true;
+            }
+            --waiting_;
+            uint64_t wait_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+            total_wait_us_ += wait_us;
+            max_wait_us_ = std::max(max_wait_us_, wait_us);
+        }
+        if (!waited) {
+            ++rejected_;
+            if (options_.policy == BackpressurePolicy::callback) {
+                notify_capacity_ = true;
+            }
+            throw InflightLimitError("In-flight limit reached for RPC call '" + func_name + "' (" +
+                                     std::to_string(in_flight_) + " requests, " +
+                                     std::to_string(in_flight_bytes_) + " bytes in flight)");
+        }
+    }
+    if (take) {
+        ++in_flight_;
+        in_flight_bytes_ += bytes;
+    }
+}
+
+void InflightWindow::release(size_t bytes) {
+    std::function<void()> on_capacity;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_flight_;
+        in_flight_bytes_ -= bytes;
+        if (waiting_ > 0) {
+            // 等待者需要的字节数各不相同，全部唤醒后各自判断
+            cv_.notify_all();
+        }
+        if (notify_capacity_ && has_room(0)) {
+            notify_capacity_ = false;
+            on_capacity = options_.on_capacity;
+        }
+    }
+    if (!on_capacity) {
+        return;
+    }
+    try {
+        on_capacity();
+    } catch (const std::exception& e) {
+        Logger::warningf("In-flight capacity callback threw an exception: %s", e.what());
+    } catch (...) {
+        Logger::warning("In-flight capacity callback threw an unknown exception");
+    }
+}
+
+InflightStats InflightWindow::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    InflightStats stats;
+    stats.in_flight = in_flight_;
+    stats.in_flight_bytes = in_flight_bytes_;
+    stats.waiting = waiting_;
+    stats.waits = waits_;
+    stats.rejected = rejected_;
+    stats.total_wait_us = total_wait_us_;
+    stats.max_wait_us = max_wait_us_;
+    return stats;
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
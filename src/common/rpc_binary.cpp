@@ -0,0 +1,67 @@
+#include "rpc_binary.h"
+#include <cstring>
+
+namespace rpc_utils {
+
+BinaryView take_binary(RPCLIB_MSGPACK::object_handle handle) {
+    // 视图指向结果对象所在的内存区（rpclib解包时引用读缓冲区而不是拷贝），
+    // 把句柄转为共享所有者后，视图存在期间读缓冲区保持有效
+    auto holder = std::make_shared<RPCLIB_MSGPACK::object_handle>(std::move(handle));
+    BinaryView view = detail::binary_from_object(holder->get());
+    return BinaryView(view.data(), view.size(), std::move(holder));
+}
+
+namespace detail {
+
+void release_binary_owner(void* owner) {
+    delete static_cast<std::shared_ptr<const void>*>(owner);
+}
+
+void share_object(RPCLIB_MSGPACK::object::with_zone& o, const SharedObject& shared) {
+    const RPCLIB_MSGPACK::object& source = shared.handle->get();
+    std::unique_ptr<std::shared_ptr<const void>> owner(
+        new std::shared_ptr<const void>(shared.handle));
+    o.zone.push_finalizer(&release_binary_owner, owner.get());
+    owner.release();
+    o.type = source.type;
+    o.via = source.via;
+}
+
+void binary_to_object(RPCLIB_MSGPACK::object::with_zone& o, const BinaryView& view) {
+    uint32_t size = checked_binary_size(view.size());
+    o.type = RPCLIB_MSGPACK::type::BIN;
+    o.via.bin.size = size;
+
+    if (view.owned()) {
+        std::unique_ptr<std::shared_ptr<const void>> owner(
+            new std::shared_ptr<const void>(view.owner()));
+        o.zone.push_finalizer(&release_binary_owner, owner.get());
+        owner.release();
+        o.via.bin.ptr = view.data();
+        return;
+    }
+
+    char* copy = static_cast<char*>(o.zone.allocate_no_align(size));
+    if (size > 0) {
+        std::memcpy(copy, view.data(), size);
+    }
+    o.via.bin.ptr = copy;
+}
+
+BinaryView binary_from_object(const RPCLIB_MSGPACK::object& o) {
+    switch (o.type) {
+    case RPCLIB_MSGPACK::type::BIN:
+        return BinaryView(o.via.bin.ptr, o.via.bin.size);
+    case RPCLIB_MSGPACK::type::STR:
+        // 兼容以字符串发送二进制数据的对端
+        return BinaryView(o.via.str.ptr, o.via.str.size);
+    case RPCLIB_MSGPACK::type::NIL:
+        return BinaryView();
+    default:
+        throw RPCLIB_MSGPACK::type_error();
+    }
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,399 @@
+#include "rpc_compress.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace {
+
+// LZ4块格式常量
+const size_t kMinMatch = 4;
+const size_t kLastLiterals = 5;     // 最后5个字节总是字面量
+const size_t kMatchFindLimit = 12;  // 最后一个匹配必须在结尾12个字节之前开始
+const size_t kMinInputSize = kMatchFindLimit + 1;
+const size_t kMaxDistance = 65535;
+const int kHashLog = 14;
+const unsigned kSkipTrigger = 6;    // 连续未命中时逐渐加大步长
+// LZ4的最大压缩比约为255:1，据此拒绝声明了异常解压长度的负载
+const uint64_t kMaxExpansion = 255;
+
+// 每个线程的压缩哈希表：保存输入中的位置，跨调用复用而不清零，
+// 候选位置总会校验距离与内容，残留的旧值只会降低压缩率，不影响正确性
+thread_local std::unique_ptr<uint32_t[]> tls_hash_table;
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hash_sequence(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+/**
+ * @brief 从p与match开始的相同字节数，p不超过limit
+ */
+inline size_t count_match(const uint8_t* p, const uint8_t* match, const uint8_t* limit) {
+    const uint8_t* start = p;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (p + sizeof(uint64_t) <= limit) {
+        uint64_t a;
+        uint64_t b;
+        std::memcpy(&a, p, sizeof(a));
+        std::memcpy(&b, match, sizeof(b));
+        uint64_t diff = a ^ b;
+        if (diff != 0) {
+            return static_cast<size_t>(p - start) + (__builtin_ctzll(diff) >> 3);
+        }
+        p += sizeof(uint64_t);
+        match += sizeof(uint64_t);
+    }
+#endif
+    while (p < limit && *p == *match) {
+        ++p;
+        ++match;
+    }
+    return static_cast<size_t>(p - start);
+}
+
+inline uint8_t* write_length(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+inline size_t read_length(const uint8_t*& ip, const uint8_t* end) {
+    size_t length = 0;
+    uint8_t byte;
+    do {
+        if (ip >= end) {
+            throw std::runtime_error("Corrupted LZ4 data: truncated length");
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+/**
+ * @brief 写入一个序列：字面量，以及可选的匹配（match_length为不含kMinMatch的长度）
+ */
+inline uint8_t* write_sequence(uint8_t* op, const uint8_t* literals, size_t literal_length,
+                               size_t offset, size_t match_length, bool has_match) {
+    uint8_t* token = op++;
+    if (literal_length >= 15) {
+        *token = 15 << 4;
+        op = write_length(op, literal_length - 15);
+    } else {
+        *token = static_cast<uint8_t>(literal_length << 4);
+    }
+    std::memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (!has_match) {
+        return op;
+    }
+    *op++ = static_cast<uint8_t>(offset & 0xff);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    if (match_length >= 15) {
+        *token |= 15;
+        op = write_length(op, match_length - 15);
+    } else {
+        *token |= static_cast<uint8_t>(match_length);
+    }
+    return op;
+}
+
+void check_raw_size(uint64_t raw_size, size_t wire_size) {
+    if (raw_size > wire_size * kMaxExpansion + 16) {
+        throw std::runtime_error("Corrupted compressed payload: declared size " +
+                                 std::to_string(raw_size) + " for " +
+                                 std::to_string(wire_size) + " compressed bytes");
+    }
+}
+
+bool always_reference(RPCLIB_MSGPACK::type::object_type, std::size_t, void*) {
+    return true;
+}
+
+} // namespace
+
+namespace detail {
+
+RPCLIB_MSGPACK::object unpack_referenced(RPCLIB_MSGPACK::zone& zone, const char* data, size_t size) {
+    std::size_t offset = 0;
+    bool referenced = false;
+    RPCLIB_MSGPACK::object result = RPCLIB_MSGPACK::unpack(
+        zone, data, size, offset, referenced, &always_reference, nullptr);
+    if (offset != size) {
+        throw std::runtime_error("Malformed msgpack message: trailing bytes after message");
+    }
+    return result;
+}
+
+size_t lz4_compress(const char* src, size_t size, char* dst, int acceleration) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    const uint8_t* end = base + size;
+    uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+
+    if (size >= kMinInputSize) {
+        if (!tls_hash_table) {
+            tls_hash_table.reset(new uint32_t[size_t(1) << kHashLog]());
+        }
+        uint32_t* table = tls_hash_table.get();
+        const uint8_t* match_find_limit = end - kMatchFindLimit;
+        const uint8_t* match_limit = end - kLastLiterals;
+        unsigned searches = static_cast<unsigned>(std::max(1, acceleration)) << kSkipTrigger;
+
+        while (ip < match_find_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t& slot = table[hash_sequence(sequence)];
+            size_t position = static_cast<size_t>(ip - base);
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position);
+
+            if (candidate >= position || position - candidate > kMaxDistance ||
+                read32(base + candidate) != sequence) {
+                ip += searches++ >> kSkipTrigger;
+                continue;
+            }
+
+            // 向前扩展匹配，不越过上一个序列的结尾
+            const uint8_t* match = base + candidate;
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                --ip;
+                --match;
+            }
+            size_t match_length = count_match(ip + kMinMatch, match + kMinMatch, match_limit);
+            op = write_sequence(op, anchor, static_cast<size_t>(ip - anchor),
+                                static_cast<size_t>(ip - match), match_length, true);
+            ip += kMinMatch + match_length;
+            anchor = ip;
+            searches = static_cast<unsigned>(std::max(1, acceleration)) << kSkipTrigger;
+
+            if (ip < match_find_limit) {
+                // 补充匹配结尾附近的位置，提高后续命中率
+                table[hash_sequence(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+
+    op = write_sequence(op, anchor, static_cast<size_t>(end - anchor), 0, 0, false);
+    return static_cast<size_t>(op - reinterpret_cast<uint8_t*>(dst));
+}
+
+void lz4_decompress(const char* src, size_t size, char* dst, size_t raw_size) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = ip + size;
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op = out;
+    uint8_t* out_end = out + raw_size;
+
+    while (true) {
+        if (ip >= end) {
+            throw std::runtime_error("Corrupted LZ4 data: missing token");
+        }
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length += read_length(ip, end);
+        }
+        if (literal_length > static_cast<size_t>(end - ip) ||
+            literal_length > static_cast<size_t>(out_end - op)) {
+            throw std::runtime_error("Corrupted LZ4 data: literal run out of bounds");
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == end) {
+            // 最后一个序列只有字面量
+            break;
+        }
+
+        if (end - ip < 2) {
+            throw std::runtime_error("Corrupted LZ4 data: truncated offset");
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) {
+            throw std::runtime_error("Corrupted LZ4 data: invalid match offset");
+        }
+
+        size_t match_length = token & 15;
+        if (match_length == 15) {
+            match_length += read_length(ip, end);
+        }
+        match_length += kMinMatch;
+        if (match_length > static_cast<size_t>(out_end - op)) {
+            throw std::runtime_error("Corrupted LZ4 data: match out of bounds");
+        }
+
+        // 匹配可能与输出重叠（offset < match_length）：已复制的部分逐次倍增
+        const uint8_t* match = op - offset;
+        while (match_length > 0) {
+            size_t chunk = std::min(match_length, static_cast<size_t>(op - match));
+            std::memcpy(op, match, chunk);
+            op += chunk;
+            match_length -= chunk;
+        }
+    }
+
+    if (op != out_end) {
+        throw std::runtime_error("Corrupted LZ4 data: decompressed " +
+                                 std::to_string(op - out) + " bytes, expected " +
+                                 std::to_string(raw_size));
+    }
+}
+
+size_t try_compress(const CompressionOptions& options, const char* data, size_t size, ScratchBuffer& out) {
+    if (options.codec != Codec::lz4 || size < options.min_size || size == 0) {
+        return 0;
+    }
+    out.resize(lz4_compress_bound(size));
+    size_t compressed = lz4_compress(data, size, out.data(), options.acceleration);
+    // 不可压缩的数据原样发送，避免接收方白白解压
+    return compressed < size ? compressed : 0;
+}
+
+void make_payload(const CompressionOptions& options, const ScratchBuffer& packed,
+                  ScratchBuffer& compressed, CompressedPayload& payload) {
+    payload.raw_size = checked_binary_size(packed.size());
+    size_t compressed_size = try_compress(options, packed.data(), packed.size(), compressed);
+    if (compressed_size > 0) {
+        payload.codec = static_cast<uint8_t>(Codec::lz4);
+        payload.data = BinaryView(compressed.data(), compressed_size);
+    } else {
+        payload.codec = static_cast<uint8_t>(Codec::none);
+        payload.data = BinaryView(packed.data(), packed.size());
+    }
+}
+
+RPCLIB_MSGPACK::object open_payload(const CompressedPayload& payload, ScratchBuffer& scratch,
+                                    RPCLIB_MSGPACK::zone& zone) {
+    switch (static_cast<Codec>(payload.codec)) {
+    case Codec::none:
+        return unpack_referenced(zone, payload.data.data(), payload.data.size());
+    case Codec::lz4:
+        check_raw_size(payload.raw_size, payload.data.size());
+        scratch.resize(payload.raw_size);
+        lz4_decompress(payload.data.data(), payload.data.size(), scratch.data(), payload.raw_size);
+        return unpack_referenced(zone, scratch.data(), payload.raw_size);
+    default:
+        throw std::runtime_error("Unsupported compression codec " + std::to_string(payload.codec));
+    }
+}
+
+CompressionCounters::CompressionCounters()
+    : requests_(0),
+      compressed_requests_(0),
+      request_bytes_(0),
+      request_wire_bytes_(0),
+      compressed_replies_(0),
+      reply_bytes_(0),
+      reply_wire_bytes_(0) {}
+
+void CompressionCounters::record_request(const CompressedPayload& payload) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (payload.codec != static_cast<uint8_t>(Codec::none)) {
+        compressed_requests_.fetch_add(1, std::memory_order_relaxed);
+        request_bytes_.fetch_add(payload.raw_size, std::memory_order_relaxed);
+        request_wire_bytes_.fetch_add(payload.data.size(), std::memory_order_relaxed);
+    }
+}
+
+void CompressionCounters::record_reply(size_t raw_size, size_t wire_size) {
+    compressed_replies_.fetch_add(1, std::memory_order_relaxed);
+    reply_bytes_.fetch_add(raw_size, std::memory_order_relaxed);
+    reply_wire_bytes_.fetch_add(wire_size, std::memory_order_relaxed);
+}
+
+CompressionStats CompressionCounters::snapshot() const {
+    CompressionStats stats;
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.compressed_requests = compressed_requests_.load(std::memory_order_relaxed);
+    stats.request_bytes = request_bytes_.load(std::memory_order_relaxed);
+    stats.request_wire_bytes = request_wire_bytes_.load(std::memory_order_relaxed);
+    stats.compressed_replies = compressed_replies_.load(std::memory_order_relaxed);
+    stats.reply_bytes = reply_bytes_.load(std::memory_order_relaxed);
+    stats.reply_wire_bytes = reply_wire_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SharedObject make_compressed_reply(const CompressedRequest& request, const RPCLIB_MSGPACK::object& result,
+                                   std::unique_ptr<RPCLIB_MSGPACK::zone> zone,
+                                   CompressionCounters& counters) {
+    auto* items = static_cast<RPCLIB_MSGPACK::object*>(
+        zone->allocate_align(sizeof(RPCLIB_MSGPACK::object) * 3));
+    items[0] = RPCLIB_MSGPACK::object(static_cast<uint8_t>(Codec::none));
+    items[1] = RPCLIB_MSGPACK::object(static_cast<uint32_t>(0));
+    items[2] = result;
+
+    CompressionOptions options;
+    options.codec = static_cast<Codec>(request.reply_codec);
+    options.min_size = static_cast<size_t>(request.reply_min_size);
+    options.acceleration = request.reply_acceleration;
+    if (options.codec == Codec::lz4) {
+        ScratchBuffer packed;
+        RPCLIB_MSGPACK::pack(packed, result);
+        ScratchBuffer compressed;
+        size_t compressed_size = try_compress(options, packed.data(), packed.size(), compressed);
+        if (compressed_size > 0) {
+            // 只把压缩结果拷入内存区，原结果对象随内存区一起释放
+            char* data = static_cast<char*>(zone->allocate_no_align(compressed_size));
+            std::memcpy(data, compressed.data(), compressed_size);
+            items[0] = RPCLIB_MSGPACK::object(static_cast<uint8_t>(Codec::lz4));
+            items[1] = RPCLIB_MSGPACK::object(checked_binary_size(packed.size()));
+            items[2].type = RPCLIB_MSGPACK::type::BIN;
+            items[2].via.bin.size = static_cast<uint32_t>(compressed_size);
+            items[2].via.bin.ptr = data;
+            counters.record_reply(packed.size(), compressed_size);
+        }
+    }
+
+    RPCLIB_MSGPACK::object reply;
+    reply.type = RPCLIB_MSGPACK::type::ARRAY;
+    reply.via.array.size = 3;
+    reply.via.array.ptr = items;
+    return make_shared_object(reply, std::move(zone));
+}
+
+RPCLIB_MSGPACK::object_handle open_compressed_reply(RPCLIB_MSGPACK::object_handle reply) {
+    const RPCLIB_MSGPACK::object& envelope = reply.get();
+    if (envelope.type != RPCLIB_MSGPACK::type::ARRAY || envelope.via.array.size != 3) {
+        throw std::runtime_error("Malformed compressed reply");
+    }
+    auto codec = static_cast<Codec>(envelope.via.array.ptr[0].as<uint8_t>());
+    uint32_t raw_size = envelope.via.array.ptr[1].as<uint32_t>();
+    const RPCLIB_MSGPACK::object& value = envelope.via.array.ptr[2];
+
+    if (codec == Codec::none) {
+        // 结果对象仍位于原响应的内存区中，转移内存区的所有权即可
+        RPCLIB_MSGPACK::object result = value;
+        return RPCLIB_MSGPACK::object_handle(result, std::move(reply.zone()));
+    }
+    if (codec != Codec::lz4) {
+        throw std::runtime_error("Unsupported compression codec " +
+                                 std::to_string(static_cast<unsigned>(codec)));
+    }
+
+    BinaryView data = binary_from_object(value);
+    check_raw_size(raw_size, data.size());
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone = acquire_zone();
+    char* buffer = static_cast<char*>(zone->allocate_no_align(raw_size));
+    lz4_decompress(data.data(), data.size(), buffer, raw_size);
+    RPCLIB_MSGPACK::object result = unpack_referenced(*zone, buffer, raw_size);
+    recycle_zone(std::move(reply.zone()));
+    return RPCLIB_MSGPACK::object_handle(result, std::move(zone));
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
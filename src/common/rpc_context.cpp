@@ -0,0 +1,188 @@
+#include "rpc_context.h"
+#include "rpc_errors.h"
+#include "rpc/this_session.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+
+namespace rpc_utils {
+
+namespace {
+
+thread_local RequestContext tls_context;
+thread_local const detail::RequestOrigin* tls_origin = nullptr;
+
+// 时钟差最小值的窗口长度
+const int64_t kClockWindowUs = 10 * 1000 * 1000;
+// 每个分片最多跟踪的客户端数
+const size_t kMaxClocksPerShard = 1024;
+
+int64_t system_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const RequestContext& RequestContext::current() {
+    return tls_context;
+}
+
+std::chrono::milliseconds RequestContext::remaining() const {
+    if (!has_deadline_) {
+        return std::chrono::milliseconds::max();
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline_ - Clock::now());
+    return std::max(left, std::chrono::milliseconds(0));
+}
+
+void RequestContext::check(const std::string& what) const {
+    if (expired()) {
+        throw DeadlineExceededError(what.empty()
+            ? std::string("Request deadline exceeded")
+            : "Request deadline exceeded during " + what);
+    }
+}
+
+ContextScope::ContextScope(const RequestContext& context) : saved_(tls_context) {
+    tls_context = context;
+}
+
+ContextScope::~ContextScope() {
+    tls_context = saved_;
+}
+
+namespace detail {
+
+namespace {
+
+uint64_t process_clock_id() {
+    static const uint64_t id = []() {
+        std::random_device device;
+        uint64_t value = (static_cast<uint64_t>(device()) << 32) | device();
+        return value != 0 ? value : 1;
+    }();
+    return id;
+}
+
+} // namespace
+
+const RequestOrigin& current_origin() {
+    static const RequestOrigin none;
+    return tls_origin != nullptr ? *tls_origin : none;
+}
+
+OriginScope::OriginScope(const RequestOrigin& origin) : saved_(tls_origin) {
+    tls_origin = &origin;
+}
+
+OriginScope::~OriginScope() {
+    tls_origin = saved_;
+}
+
+uint64_t new_session_id() {
+    static std::atomic<uint64_t> next(1);
+    return (uint64_t(1) << 63) | next.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t current_session() {
+    const RequestOrigin& origin = current_origin();
+    if (origin.session != 0) {
+        return origin.session;
+    }
+    return static_cast<uint64_t>(rpc::this_session().id());
+}
+
+int64_t ClockOffsetTable::excess_us(uint64_t clock_id, int64_t offset_us, int64_t now_us) {
+    Shard& shard = shards_[clock_id % kShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(clock_id);
+    if (it == shard.entries.end()) {
+        // 客户端数量异常多时整体重置：估计值丢失只会少扣除，不会误判过期
+        if (shard.entries.size() >= kMaxClocksPerShard) {
+            shard.entries.clear();
+        }
+        shard.entries.emplace(clock_id, Entry{now_us, offset_us, offset_us});
+        return 0;
+    }
+    Entry& entry = it->second;
+    if (now_us - entry.window_start_us >= kClockWindowUs) {
+        entry.previous_min_us = entry.current_min_us;
+        entry.current_min_us = offset_us;
+        entry.window_start_us = now_us;
+    }
+    entry.current_min_us = std::min(entry.current_min_us, offset_us);
+    return std::max<int64_t>(0, offset_us - std::min(entry.current_min_us, entry.previous_min_us));
+}
+
+CallDeadline::CallDeadline(int64_t timeout_ms) : bounded_(false) {
+    auto now = RequestContext::Clock::now();
+    if (timeout_ms > 0) {
+        bounded_ = true;
+        deadline_ = now + std::chrono::milliseconds(timeout_ms);
+    }
+    // 在处理函数中发起的嵌套调用不晚于外层请求的截止时间
+    const RequestContext& context = RequestContext::current();
+    if (context.has_deadline() && (!bounded_ || context.deadline() < deadline_)) {
+        bounded_ = true;
+        deadline_ = context.deadline();
+    }
+}
+
+WireContext CallDeadline::wire() const {
+    WireContext wire;
+    wire.sent_at_us = system_now_us();
+    wire.clock_id = process_clock_id();
+    if (bounded_) {
+        auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline_ - RequestContext::Clock::now()).count();
+        wire.timeout_us = std::max<int64_t>(0, left);
+    }
+    return wire;
+}
+
+void CallDeadline::check(const std::string& func_name) const {
+    if (bounded_ && RequestContext::Clock::now() >= deadline_) {
+        throw DeadlineExceededError("Deadline exceeded before calling '" + func_name + "'");
+    }
+}
+
+void CallDeadline::wait(const std::future<RPCLIB_MSGPACK::object_handle>& response,
+                        const std::string& func_name) const {
+    if (!bounded_) {
+        response.wait();
+        return;
+    }
+    if (response.wait_until(deadline_) != std::future_status::ready) {
+        throw DeadlineExceededError("Deadline exceeded while waiting for '" + func_name + "'");
+    }
+}
+
+RequestContext make_request_context(const WireContext& wire, RequestContext::Clock::time_point arrival,
+                                    ClockOffsetTable* offsets, bool trust_client_clock) {
+    RequestContext context;
+    if (wire.timeout_us >= 0) {
+        // 从到达时起算：在服务器内排队的时间已经用掉了预算
+        int64_t budget_us = wire.timeout_us;
+        auto queued = RequestContext::Clock::now() - arrival;
+        int64_t arrival_us = system_now_us() -
+            std::chrono::duration_cast<std::chrono::microseconds>(queued).count();
+        int64_t offset_us = arrival_us - wire.sent_at_us;
+        if (trust_client_clock) {
+            // 双方时钟同步时，直接扣除请求在网络和服务器接收队列中花费的时间
+            budget_us -= std::max<int64_t>(0, offset_us);
+        } else if (offsets != nullptr && wire.clock_id != 0 && wire.sent_at_us > 0) {
+            budget_us -= offsets->excess_us(wire.clock_id, offset_us, arrival_us);
+        }
+        context = RequestContext(arrival + std::chrono::microseconds(budget_us));
+    }
+    TraceContext trace;
+    trace.trace_id = wire.trace_id;
+    trace.span_id = wire.span_id;
+    context.set_trace(trace);
+    return context;
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
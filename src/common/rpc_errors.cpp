@@ -0,0 +1,93 @@
+#include "rpc_errors.h"
+#include "rpc/this_handler.h"
+#include <algorithm>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+thread_local bool tls_has_responded_error = false;
+thread_local ErrorInfo tls_responded_error;
+
+} // namespace
+
+void respond_error_info(const char* code, const std::string& message,
+                        std::chrono::milliseconds retry_after) {
+    ErrorInfo info;
+    info.code = code;
+    info.message = message;
+    info.retry_after_ms = static_cast<uint64_t>(std::max<int64_t>(0, retry_after.count()));
+    tls_responded_error = info;
+    tls_has_responded_error = true;
+    // respond_error会抛出异常中断处理函数，下面的throw只是保证不会返回
+    rpc::this_handler().respond_error(info);
+    throw std::runtime_error(message);
+}
+
+void respond_overloaded(const std::string& message, std::chrono::milliseconds retry_after) {
+    respond_error_info(kOverloadedErrorCode, message, retry_after);
+}
+
+bool take_responded_error(ErrorInfo& info) {
+    if (!tls_has_responded_error) {
+        return false;
+    }
+    tls_has_responded_error = false;
+    info = std::move(tls_responded_error);
+    return true;
+}
+
+bool parse_error_info(const RPCLIB_MSGPACK::object& error, ErrorInfo& info) {
+    if (error.type != RPCLIB_MSGPACK::type::MAP) {
+        return false;
+    }
+    try {
+        error.convert(info);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return !info.code.empty();
+}
+
+bool is_overloaded(rpc::rpc_error& e) {
+    ErrorInfo info;
+    return parse_error_info(e.get_error().get(), info) &&
+           (info.code == kOverloadedErrorCode || info.code == kDrainingErrorCode);
+}
+
+bool is_draining(rpc::rpc_error& e) {
+    ErrorInfo info;
+    return parse_error_info(e.get_error().get(), info) && info.code == kDrainingErrorCode;
+}
+
+void rethrow_call_error(const std::string& func_name, rpc::rpc_error& e, const std::string& location) {
+    rethrow_error_object(func_name, e.get_error().get(), e.what(), location);
+}
+
+void rethrow_error_object(const std::string& func_name, const RPCLIB_MSGPACK::object& error,
+                          const std::string& what, const std::string& location) {
+    ErrorInfo info;
+    if (parse_error_info(error, info)) {
+        if (info.code == kOverloadedErrorCode) {
+            throw OverloadedError("Server overloaded while calling '" + func_name + "'" + location +
+                                  ": " + info.message,
+                                  func_name, std::chrono::milliseconds(info.retry_after_ms));
+        }
+        if (info.code == kDrainingErrorCode) {
+            throw DrainingError("Server draining while calling '" + func_name + "'" + location +
+                                ": " + info.message, func_name);
+        }
+        if (info.code == kDeadlineExceededErrorCode) {
+            throw DeadlineExceededError("Deadline exceeded while calling '" + func_name + "'" +
+                                        location + ": " + info.message);
+        }
+    }
+    throw std::runtime_error("RPC call failed for function '" + func_name + "'" + location +
+                             ": " + what);
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,154 @@
+#include "rpc_executor.h"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace rpc_utils {
+
+namespace {
+
+// 当前线程所属的线程池及其工作线程序号，用于让池内提交的任务进入本地队列
+thread_local const WorkStealingPool* t_current_pool = nullptr;
+thread_local size_t t_current_index = 0;
+
+void pin_current_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(const ExecutorOptions& options)
+    : name_(options.name),
+      queue_limit_(0),
+      queued_(0),
+      next_(0),
+      sleepers_(0),
+      rejected_(0),
+      stopping_(false) {
+    size_t count = options.threads > 0
+        ? options.threads
+        : std::max<size_t>(1, std::thread::hardware_concurrency());
+    queue_limit_ = options.queue_limit > 0 ? options.queue_limit : count;
+
+    workers_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        int cpu = options.cpu_affinity.empty()
+            ? -1
+            : options.cpu_affinity[i % options.cpu_affinity.size()];
+        workers_[i]->thread = std::thread(&WorkStealingPool::worker_loop, this, i, cpu);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_.store(true);
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+const WorkStealingPool* WorkStealingPool::current() {
+    return t_current_pool;
+}
+
+bool WorkStealingPool::try_submit(Task task) {
+    if (stopping_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (queued_.fetch_add(1) >= queue_limit_) {
+        queued_.fetch_sub(1);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t index = t_current_pool == this
+        ? t_current_index
+        : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+    return true;
+}
+
+bool WorkStealingPool::pop_local(size_t index, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, Task& task) {
+    const size_t count = workers_.size();
+    for (size_t i = 1; i < count; ++i) {
+        Worker& victim = *workers_[(thief + i) % count];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(size_t index, int cpu) {
+    pin_current_thread(cpu);
+    t_current_pool = this;
+    t_current_index = index;
+
+    Task task;
+    while (true) {
+        if (pop_local(index, task) || steal(index, task)) {
+            queued_.fetch_sub(1);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        // 计数已增加但任务可能尚未入队，因此只要queued_非零就重新尝试领取
+        sleep_cv_.wait(lock, [this] {
+            return stopping_.load() || queued_.load() > 0;
+        });
+        sleepers_.fetch_sub(1);
+        if (stopping_.load() && queued_.load() == 0) {
+            break;
+        }
+    }
+
+    t_current_pool = nullptr;
+}
+
+} // namespace rpc_utils
@@ -0,0 +1,94 @@
+#include "rpc_io.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+namespace rpc_utils {
+
+namespace {
+
+const size_t kCounterCount = 5;
+
+/**
+ * @brief 单个线程的计数，只由所属线程写入，线程退出时并入注册表的retired
+ */
+struct ThreadCounters {
+    ThreadCounters();
+    ~ThreadCounters();
+
+    std::atomic<uint64_t> values[kCounterCount];
+};
+
+struct CounterRegistry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> threads;
+    uint64_t retired[kCounterCount] = {};
+};
+
+// 故意不释放：静态对象析构后仍可能有线程退出
+CounterRegistry& registry() {
+    static CounterRegistry* instance = new CounterRegistry();
+    return *instance;
+}
+
+// 线程退出时其他thread_local对象的析构函数仍可能收发数据，析构后不再计数
+thread_local bool tls_counters_destroyed = false;
+
+ThreadCounters::ThreadCounters() {
+    for (auto& value : values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    CounterRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.threads.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    tls_counters_destroyed = true;
+    CounterRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        reg.retired[i] += values[i].load(std::memory_order_relaxed);
+    }
+    reg.threads.erase(std::remove(reg.threads.begin(), reg.threads.end(), this), reg.threads.end());
+}
+
+} // namespace
+
+IoStats io_stats() {
+    uint64_t totals[kCounterCount];
+    {
+        CounterRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        std::copy(reg.retired, reg.retired + kCounterCount, totals);
+        for (const ThreadCounters* thread : reg.threads) {
+            for (size_t i = 0; i < kCounterCount; ++i) {
+                totals[i] += thread->values[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    IoStats stats;
+    stats.read_calls = totals[static_cast<size_t>(detail::IoCounter::read_calls)];
+    stats.write_calls = totals[static_cast<size_t>(detail::IoCounter::write_calls)];
+    stats.wait_calls = totals[static_cast<size_t>(detail::IoCounter::wait_calls)];
+    stats.frames_in = totals[static_cast<size_t>(detail::IoCounter::frames_in)];
+    stats.frames_out = totals[static_cast<size_t>(detail::IoCounter::frames_out)];
+    return stats;
+}
+
+namespace detail {
+
+void count_io(IoCounter counter, uint64_t n) {
+    if (tls_counters_destroyed) {
+        return;
+    }
+    thread_local ThreadCounters counters;
+    std::atomic<uint64_t>& value = counters.values[static_cast<size_t>(counter)];
+    // 只有所属线程写入，读-改-写不需要原子指令
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,762 @@
+#include "rpc_local_transport.h"
+#include "rpc_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kUnixScheme = "unix://";
+const char* const kShmScheme = "shm://";
+const char* const kTcpScheme = "tcp://";
+const char* const kSegmentPrefix = "/rpc_utils.";
+
+const size_t kRingCapacity = 1 << 20;           // 每个方向的环形缓冲区容量
+const size_t kMinRingCapacity = 4096;
+const size_t kMaxRingCapacity = size_t(1) << 30;
+const size_t kInboxSize = 64 * 1024;            // 套接字模式的读缓冲大小
+const auto kParkSlice = std::chrono::milliseconds(100);
+const auto kHandshakeTimeout = std::chrono::seconds(5);
+
+bool starts_with(const std::string& s, const char* prefix) {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+std::string error_text(int error) {
+    return std::strerror(error);
+}
+
+/**
+ * @brief 环形缓冲区头部，位于共享内存中
+ *
+ * head只由生产者写，tail只由消费者写，分别放在不同的缓存行上。
+ * data_seq/space_seq是futex字，每次发布head/tail时递增。
+ */
+struct RingHeader {
+    RingHeader()
+        : head(0), data_seq(0), consumer_waiting(0),
+          tail(0), space_seq(0), producer_waiting(0),
+          closed(0) {}
+
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> data_seq;
+    std::atomic<uint32_t> consumer_waiting;
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> space_seq;
+    std::atomic<uint32_t> producer_waiting;
+    alignas(64) std::atomic<uint32_t> closed;
+};
+
+size_t segment_size_for(size_t capacity) {
+    return 2 * (sizeof(RingHeader) + capacity);
+}
+
+bool is_power_of_two(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, Clock::duration timeout) {
+#ifdef __linux__
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    // 共享内存跨进程使用，不能带FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    count_io(IoCounter::wait_calls);
+#else
+    (void)word;
+    (void)expected;
+    std::this_thread::sleep_for(std::min<Clock::duration>(timeout, std::chrono::microseconds(100)));
+#endif
+}
+
+void futex_wake(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    count_io(IoCounter::wait_calls);
+#else
+    (void)word;
+#endif
+}
+
+/**
+ * @brief 检查握手套接字的对端是否已退出（非阻塞）
+ */
+bool peer_hung_up(int fd) {
+    pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    p.revents = 0;
+    int ready = ::poll(&p, 1, 0);
+    count_io(IoCounter::wait_calls);
+    if (ready <= 0) {
+        return false;
+    }
+    if (p.revents & (POLLHUP | POLLERR)) {
+        return true;
+    }
+    char byte;
+    count_io(IoCounter::read_calls);
+    return ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+/**
+ * @brief 休眠前的自旋时间；单核机器上自旋只会拖延对端，直接休眠
+ */
+Clock::duration spin_duration() {
+    static const Clock::duration duration = std::thread::hardware_concurrency() > 1
+        ? Clock::duration(std::chrono::microseconds(50))
+        : Clock::duration::zero();
+    return duration;
+}
+
+enum class WaitResult { ready, timeout, closed };
+
+/**
+ * @brief 等待对端发布数据或空间：先自旋，再在futex上分段休眠
+ */
+template<typename Ready>
+WaitResult wait_for_peer(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting,
+                         const std::atomic<uint32_t>& closed, int fd,
+                         Clock::time_point deadline, Ready ready) {
+    Clock::time_point spin_until = Clock::now() + spin_duration();
+    while (true) {
+        if (ready()) {
+            return WaitResult::ready;
+        }
+        if (closed.load(std::memory_order_acquire)) {
+            return WaitResult::closed;
+        }
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) {
+            return WaitResult::timeout;
+        }
+        if (now < spin_until) {
+            cpu_relax();
+            continue;
+        }
+
+        // 先声明等待再检查条件，与对端"发布后检查等待标志"配对，不会丢失唤醒
+        waiting.store(1, std::memory_order_seq_cst);
+        uint32_t observed = seq.load(std::memory_order_seq_cst);
+        if (!ready() && !closed.load(std::memory_order_acquire)) {
+            Clock::duration slice = deadline - now;
+            if (slice > kParkSlice) {
+                slice = kParkSlice;
+            }
+            futex_wait(seq, observed, slice);
+        }
+        waiting.store(0, std::memory_order_relaxed);
+        if (!ready() && peer_hung_up(fd)) {
+            return WaitResult::closed;
+        }
+    }
+}
+
+} // namespace
+
+// TransportAddress 实现
+TransportAddress TransportAddress::parse(const std::string& endpoint) {
+    TransportAddress address;
+    if (starts_with(endpoint, kUnixScheme)) {
+        address.kind = TransportKind::unix_socket;
+        address.path = endpoint.substr(std::strlen(kUnixScheme));
+        if (address.path.empty() || address.path.size() >= sizeof(sockaddr_un().sun_path)) {
+            throw std::invalid_argument("Invalid unix endpoint '" + endpoint + "'");
+        }
+        return address;
+    }
+
+    if (starts_with(endpoint, kShmScheme)) {
+        address.kind = TransportKind::shm;
+        address.name = endpoint.substr(std::strlen(kShmScheme));
+        bool valid = !address.name.empty() && address.name.size() <= 64;
+        for (char c : address.name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            throw std::invalid_argument("Invalid shm endpoint '" + endpoint +
+                                        "', expected shm://name with [A-Za-z0-9_.-]");
+        }
+        const char* tmpdir = std::getenv("TMPDIR");
+        std::string dir = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+        if (dir.back() == '/') {
+            dir.pop_back();
+        }
+        address.path = dir + "/rpc_utils.shm." + address.name + ".sock";
+        if (address.path.size() >= sizeof(sockaddr_un().sun_path)) {
+            throw std::invalid_argument("Socket path for shm endpoint '" + endpoint + "' is too long");
+        }
+        return address;
+    }
+
+    std::string host_port = starts_with(endpoint, kTcpScheme)
+        ? endpoint.substr(std::strlen(kTcpScheme))
+        : endpoint;
+    size_t colon = host_port.rfind(':');
+    int port = 0;
+    if (colon != std::string::npos && colon != 0 && colon + 1 != host_port.size()) {
+        try {
+            size_t parsed = 0;
+            port = std::stoi(host_port.substr(colon + 1), &parsed);
+            if (parsed != host_port.size() - colon - 1) {
+                port = 0;
+            }
+        } catch (const std::exception&) {
+            port = 0;
+        }
+    }
+    if (port <= 0 || port > 65535 || !RPCUtils::is_valid_host(host_port.substr(0, colon))) {
+        throw std::invalid_argument("Invalid endpoint '" + endpoint +
+                                    "', expected host:port, unix:///path or shm://name");
+    }
+    address.kind = TransportKind::tcp;
+    address.host = host_port.substr(0, colon);
+    address.port = static_cast<uint16_t>(port);
+    return address;
+}
+
+std::string TransportAddress::to_string() const {
+    switch (kind) {
+    case TransportKind::unix_socket:
+        return kUnixScheme + path;
+    case TransportKind::shm:
+        return kShmScheme + name;
+    default:
+        return host + ":" + std::to_string(port);
+    }
+}
+
+// LocalConnection 实现
+struct LocalConnection::Ring {
+    RingHeader* header;
+    char* data;
+    size_t capacity;    // 2的幂
+};
+
+LocalConnection::LocalConnection(int fd, TransportKind kind)
+    : fd_(fd),
+      kind_(kind),
+      open_(true),
+      segment_(nullptr),
+      segment_size_(0),
+      out_head_(0),
+      inbox_(new char[kInboxSize]),
+      inbox_begin_(0),
+      inbox_end_(0) {}
+
+LocalConnection::~LocalConnection() {
+    close();
+    if (segment_) {
+        ::munmap(segment_, segment_size_);
+    }
+    ::close(fd_);
+}
+
+std::unique_ptr<LocalConnection> LocalConnection::connect(const TransportAddress& address) {
+    if (address.kind == TransportKind::tcp) {
+        throw std::invalid_argument("LocalConnection does not handle tcp endpoints");
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create unix socket: " + error_text(errno));
+    }
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, address.path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to connect to " + address.to_string() + ": " + error_text(error));
+    }
+    std::unique_ptr<LocalConnection> connection(new LocalConnection(fd, address.kind));
+    if (address.kind != TransportKind::shm) {
+        return connection;
+    }
+
+    // 客户端创建共享内存段并把名字发给服务器，服务器映射成功后双方都不再需要这个名字
+    static std::atomic<uint32_t> segment_counter(0);
+    std::string segment_name = kSegmentPrefix + std::to_string(::getpid()) + "." +
+        std::to_string(segment_counter.fetch_add(1)) + "." + address.name;
+    size_t segment_size = segment_size_for(kRingCapacity);
+    int shm_fd = ::shm_open(segment_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm_fd < 0) {
+        throw std::runtime_error("Failed to create shared memory '" + segment_name + "': " +
+                                 error_text(errno));
+    }
+    void* segment = MAP_FAILED;
+    if (::ftruncate(shm_fd, static_cast<off_t>(segment_size)) == 0) {
+        segment = ::mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    }
+    int error = errno;
+    ::close(shm_fd);
+    if (segment == MAP_FAILED) {
+        ::shm_unlink(segment_name.c_str());
+        throw std::runtime_error("Failed to map shared memory '" + segment_name + "': " + error_text(error));
+    }
+    connection->map_segment(segment, kRingCapacity, true);
+
+    try {
+        ScratchBuffer frame;
+        RPCLIB_MSGPACK::pack(frame, std::make_tuple(segment_name, static_cast<uint64_t>(kRingCapacity)));
+        connection->socket_send(frame.data(), frame.size());
+        if (!connection->socket_receive(frame, Clock::now() + kHandshakeTimeout)) {
+            throw std::runtime_error("Timeout during shm handshake with " + address.to_string());
+        }
+        ::shm_unlink(segment_name.c_str());
+        if (frame.size() > 0) {
+            throw std::runtime_error("Server rejected shm handshake: " + std::string(frame.data(), frame.size()));
+        }
+    } catch (...) {
+        ::shm_unlink(segment_name.c_str());
+        throw;
+    }
+    return connection;
+}
+
+std::unique_ptr<LocalConnection> LocalConnection::accept(int fd, TransportKind kind) {
+    std::unique_ptr<LocalConnection> connection(new LocalConnection(fd, kind));
+    if (kind != TransportKind::shm) {
+        return connection;
+    }
+
+    ScratchBuffer frame;
+    if (!connection->socket_receive(frame, Clock::now() + kHandshakeTimeout)) {
+        throw std::runtime_error("Timeout waiting for shm handshake");
+    }
+    std::string error;
+    try {
+        RPCLIB_MSGPACK::zone zone;
+        std::tuple<std::string, uint64_t> handshake;
+        unpack_referenced(zone, frame.data(), frame.size()).convert(handshake);
+        const std::string& segment_name = std::get<0>(handshake);
+        uint64_t capacity = std::get<1>(handshake);
+        if (!starts_with(segment_name, kSegmentPrefix) || segment_name.find('/', 1) != std::string::npos ||
+            capacity < kMinRingCapacity || capacity > kMaxRingCapacity || !is_power_of_two(capacity)) {
+            throw std::runtime_error("invalid handshake");
+        }
+
+        size_t segment_size = segment_size_for(static_cast<size_t>(capacity));
+        int shm_fd = ::shm_open(segment_name.c_str(), O_RDWR, 0);
+        if (shm_fd < 0) {
+            throw std::runtime_error("shm_open failed: " + error_text(errno));
+        }
+        struct stat info;
+        void* segment = MAP_FAILED;
+        if (::fstat(shm_fd, &info) == 0 && static_cast<size_t>(info.st_size) == segment_size) {
+            segment = ::mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        }
+        ::close(shm_fd);
+        if (segment == MAP_FAILED) {
+            throw std::runtime_error("shared memory segment has unexpected size");
+        }
+        connection->map_segment(segment, static_cast<size_t>(capacity), false);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    // 空帧表示握手成功，否则为错误信息
+    connection->socket_send(error.data(), error.size());
+    if (!error.empty()) {
+        throw std::runtime_error("Rejected shm handshake: " + error);
+    }
+    return connection;
+}
+
+void LocalConnection::map_segment(void* segment, size_t capacity, bool client_side) {
+    char* base = static_cast<char*>(segment);
+    size_t stride = sizeof(RingHeader) + capacity;
+    // 环A：客户端→服务器，环B：服务器→客户端
+    RingHeader* a = reinterpret_cast<RingHeader*>(base);
+    RingHeader* b = reinterpret_cast<RingHeader*>(base + stride);
+    if (client_side) {
+        new (a) RingHeader();
+        new (b) RingHeader();
+    }
+    std::unique_ptr<Ring> ring_a(new Ring{a, base + sizeof(RingHeader), capacity});
+    std::unique_ptr<Ring> ring_b(new Ring{b, base + stride + sizeof(RingHeader), capacity});
+    segment_ = segment;
+    segment_size_ = 2 * stride;
+    out_ = std::move(client_side ? ring_a : ring_b);
+    in_ = std::move(client_side ? ring_b : ring_a);
+}
+
+void LocalConnection::send(const char* data, size_t size) {
+    if (!is_open()) {
+        throw std::runtime_error("Local transport error: connection is closed");
+    }
+    if (size > kMaxFrameSize) {
+        throw std::runtime_error("Local transport error: frame of " + std::to_string(size) +
+                                 " bytes exceeds the limit of " + std::to_string(kMaxFrameSize) + " bytes");
+    }
+    if (segment_) {
+        ring_send(data, size);
+    } else if (coalesce_.enabled) {
+        uint32_t length = checked_binary_size(size);
+        outbox_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        outbox_.write(data, size);
+        if (outbox_.size() >= coalesce_.max_bytes) {
+            flush();
+        }
+    } else {
+        socket_send(data, size);
+    }
+    count_io(IoCounter::frames_out);
+}
+
+void LocalConnection::set_coalescing(const CoalesceOptions& options) {
+    coalesce_ = options;
+    if (!coalesce_.enabled && is_open()) {
+        flush();
+    }
+}
+
+void LocalConnection::flush() {
+    if (!is_open()) {
+        throw std::runtime_error("Local transport error: connection is closed");
+    }
+    if (segment_) {
+        if (out_head_ != out_->header->head.load(std::memory_order_relaxed)) {
+            ring_publish();
+        }
+        return;
+    }
+    if (outbox_.size() == 0) {
+        return;
+    }
+    iovec iov;
+    iov.iov_base = outbox_.data();
+    iov.iov_len = outbox_.size();
+    socket_write(&iov, 1);
+    outbox_.clear();
+}
+
+bool LocalConnection::has_buffered_frame() const {
+    if (segment_) {
+        const RingHeader& header = *in_->header;
+        return header.head.load(std::memory_order_acquire) != header.tail.load(std::memory_order_relaxed);
+    }
+    size_t buffered = inbox_end_ - inbox_begin_;
+    uint32_t length = 0;
+    if (buffered < sizeof(length)) {
+        return false;
+    }
+    std::memcpy(&length, inbox_.get() + inbox_begin_, sizeof(length));
+    return buffered - sizeof(length) >= length;
+}
+
+bool LocalConnection::receive(ScratchBuffer& frame, Clock::time_point deadline) {
+    if (!is_open()) {
+        throw std::runtime_error("Local transport error: connection is closed");
+    }
+    bool received = segment_ ? ring_receive(frame, deadline) : socket_receive(frame, deadline);
+    if (received) {
+        count_io(IoCounter::frames_in);
+    }
+    return received;
+}
+
+void LocalConnection::close() {
+    bool expected = true;
+    if (!open_.compare_exchange_strong(expected, false)) {
+        return;
+    }
+    if (segment_) {
+        for (Ring* ring : {out_.get(), in_.get()}) {
+            RingHeader& header = *ring->header;
+            header.closed.store(1, std::memory_order_release);
+            header.data_seq.fetch_add(1, std::memory_order_seq_cst);
+            header.space_seq.fetch_add(1, std::memory_order_seq_cst);
+            futex_wake(header.data_seq);
+            futex_wake(header.space_seq);
+        }
+    }
+    // 唤醒阻塞在poll/recv上的线程，并让对端看到连接结束
+    ::shutdown(fd_, SHUT_RDWR);
+}
+
+void LocalConnection::fail(const std::string& what) {
+    close();
+    throw std::runtime_error("Local transport error: " + what);
+}
+
+void LocalConnection::socket_send(const char* data, size_t size) {
+    uint32_t length = checked_binary_size(size);
+    iovec iov[2];
+    iov[0].iov_base = &length;
+    iov[0].iov_len = sizeof(length);
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = size;
+    socket_write(iov, size > 0 ? 2 : 1);
+}
+
+void LocalConnection::socket_write(iovec* iov, size_t count) {
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+
+    while (message.msg_iovlen > 0) {
+        ssize_t sent = ::sendmsg(fd_, &message, MSG_NOSIGNAL);
+        count_io(IoCounter::write_calls);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("send failed: " + error_text(errno));
+        }
+        size_t left = static_cast<size_t>(sent);
+        while (message.msg_iovlen > 0 && left >= message.msg_iov->iov_len) {
+            left -= message.msg_iov->iov_len;
+            ++message.msg_iov;
+            --message.msg_iovlen;
+        }
+        if (message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = static_cast<char*>(message.msg_iov->iov_base) + left;
+            message.msg_iov->iov_len -= left;
+        }
+    }
+}
+
+bool LocalConnection::socket_fill(Clock::time_point deadline) {
+    if (inbox_begin_ == inbox_end_) {
+        inbox_begin_ = inbox_end_ = 0;
+    } else if (inbox_end_ == kInboxSize) {
+        std::memmove(inbox_.get(), inbox_.get() + inbox_begin_, inbox_end_ - inbox_begin_);
+        inbox_end_ -= inbox_begin_;
+        inbox_begin_ = 0;
+    }
+
+    while (true) {
+        ssize_t received = ::recv(fd_, inbox_.get() + inbox_end_, kInboxSize - inbox_end_, MSG_DONTWAIT);
+        count_io(IoCounter::read_calls);
+        if (received > 0) {
+            inbox_end_ += static_cast<size_t>(received);
+            return true;
+        }
+        if (received == 0) {
+            fail("connection closed by peer");
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            fail("recv failed: " + error_text(errno));
+        }
+
+        int timeout_ms = -1;
+        if (deadline != Clock::time_point::max()) {
+            Clock::time_point now = Clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+            timeout_ms = static_cast<int>(std::min<int64_t>(left, INT_MAX));
+        }
+        pollfd p;
+        p.fd = fd_;
+        p.events = POLLIN;
+        p.revents = 0;
+        int ready = ::poll(&p, 1, timeout_ms);
+        count_io(IoCounter::wait_calls);
+        if (ready < 0 && errno != EINTR) {
+            fail("poll failed: " + error_text(errno));
+        }
+    }
+}
+
+bool LocalConnection::socket_receive(ScratchBuffer& frame, Clock::time_point deadline) {
+    uint32_t length = 0;
+    while (inbox_end_ - inbox_begin_ < sizeof(length)) {
+        // 帧已开始到达后不再受deadline限制
+        if (!socket_fill(inbox_end_ == inbox_begin_ ? deadline : Clock::time_point::max())) {
+            return false;
+        }
+    }
+    std::memcpy(&length, inbox_.get() + inbox_begin_, sizeof(length));
+    inbox_begin_ += sizeof(length);
+    if (length > kMaxFrameSize) {
+        fail("peer sent a frame of " + std::to_string(length) + " bytes");
+    }
+
+    frame.resize(length);
+    size_t copied = std::min<size_t>(inbox_end_ - inbox_begin_, length);
+    std::memcpy(frame.data(), inbox_.get() + inbox_begin_, copied);
+    inbox_begin_ += copied;
+    while (copied < length) {
+        size_t remaining = length - copied;
+        if (remaining >= kInboxSize / 2) {
+            // 大帧直接读入目标缓冲区，省去一次拷贝
+            ssize_t received = ::recv(fd_, frame.data() + copied, remaining, 0);
+            count_io(IoCounter::read_calls);
+            if (received > 0) {
+                copied += static_cast<size_t>(received);
+            } else if (received == 0) {
+                fail("connection closed by peer");
+            } else if (errno != EINTR) {
+                fail("recv failed: " + error_text(errno));
+            }
+            continue;
+        }
+        socket_fill(Clock::time_point::max());
+        size_t chunk = std::min(inbox_end_ - inbox_begin_, remaining);
+        std::memcpy(frame.data() + copied, inbox_.get() + inbox_begin_, chunk);
+        inbox_begin_ += chunk;
+        copied += chunk;
+    }
+    return true;
+}
+
+void LocalConnection::ring_publish() {
+    RingHeader& header = *out_->header;
+    header.head.store(out_head_, std::memory_order_release);
+    header.data_seq.fetch_add(1, std::memory_order_seq_cst);
+    if (header.consumer_waiting.load(std::memory_order_seq_cst)) {
+        futex_wake(header.data_seq);
+    }
+}
+
+void LocalConnection::ring_send(const char* data, size_t size) {
+    Ring& ring = *out_;
+    RingHeader& header = *ring.header;
+    uint64_t& head = out_head_;
+    auto publish = [this]() { ring_publish(); };
+
+    auto put = [&](const char* src, size_t n) {
+        while (n > 0) {
+            size_t used = static_cast<size_t>(head - header.tail.load(std::memory_order_acquire));
+            size_t space = ring.capacity - used;
+            if (space == 0) {
+                // 环已满：先发布已写入的部分，让对端开始消费
+                publish();
+                WaitResult result = wait_for_peer(
+                    header.space_seq, header.producer_waiting, header.closed, fd_,
+                    Clock::time_point::max(), [&]() {
+                        return head - header.tail.load(std::memory_order_acquire) < ring.capacity;
+                    });
+                if (result != WaitResult::ready) {
+                    fail("connection closed by peer");
+                }
+                continue;
+            }
+            size_t offset = static_cast<size_t>(head) & (ring.capacity - 1);
+            size_t chunk = std::min(std::min(space, n), ring.capacity - offset);
+            std::memcpy(ring.data + offset, src, chunk);
+            head += chunk;
+            src += chunk;
+            n -= chunk;
+        }
+    };
+
+    uint32_t length = checked_binary_size(size);
+    char prefix[sizeof(length)];
+    std::memcpy(prefix, &length, sizeof(length));
+    put(prefix, sizeof(prefix));
+    put(data, size);
+    // 写合并时暂不发布（发布可能需要futex唤醒），由flush()或累积达到上限时发布
+    if (!coalesce_.enabled ||
+        out_head_ - header.head.load(std::memory_order_relaxed) >= coalesce_.max_bytes) {
+        publish();
+    }
+}
+
+bool LocalConnection::ring_receive(ScratchBuffer& frame, Clock::time_point deadline) {
+    Ring& ring = *in_;
+    RingHeader& header = *ring.header;
+    uint64_t tail = header.tail.load(std::memory_order_relaxed);
+    bool started = false;
+
+    auto publish = [&]() {
+        header.tail.store(tail, std::memory_order_release);
+        header.space_seq.fetch_add(1, std::memory_order_seq_cst);
+        if (header.producer_waiting.load(std::memory_order_seq_cst)) {
+            futex_wake(header.space_seq);
+        }
+    };
+
+    auto take = [&](char* dst, size_t n) {
+        while (n > 0) {
+            size_t available = static_cast<size_t>(header.head.load(std::memory_order_acquire) - tail);
+            if (available == 0) {
+                if (started) {
+                    publish();
+                }
+                WaitResult result = wait_for_peer(
+                    header.data_seq, header.consumer_waiting, header.closed, fd_,
+                    started ? Clock::time_point::max() : deadline, [&]() {
+                        return header.head.load(std::memory_order_acquire) != tail;
+                    });
+                if (result == WaitResult::timeout) {
+                    return false;
+                }
+                if (result == WaitResult::closed) {
+                    fail("connection closed by peer");
+                }
+                continue;
+            }
+            started = true;
+            size_t offset = static_cast<size_t>(tail) & (ring.capacity - 1);
+            size_t chunk = std::min(std::min(available, n), ring.capacity - offset);
+            std::memcpy(dst, ring.data + offset, chunk);
+            tail += chunk;
+            dst += chunk;
+            n -= chunk;
+        }
+        return true;
+    };
+
+    uint32_t length = 0;
+    char prefix[sizeof(length)];
+    if (!take(prefix, sizeof(prefix))) {
+        return false;
+    }
+    std::memcpy(&length, prefix, sizeof(length));
+    if (length > kMaxFrameSize) {
+        fail("peer sent a frame of " + std::to_string(length) + " bytes");
+    }
+    frame.resize(length);
+    take(frame.data(), length);
+    publish();
+    return true;
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
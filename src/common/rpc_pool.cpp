@@ -0,0 +1,216 @@
+#include "rpc_pool.h"
+#include "rpc_binary.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace {
+
+struct SpareBuffer {
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+};
+
+std::atomic<size_t> g_max_spare_buffers(PoolOptions().max_spare_buffers);
+std::atomic<size_t> g_max_buffer_capacity(PoolOptions().max_buffer_capacity);
+std::atomic<size_t> g_max_spare_zones(PoolOptions().max_spare_zones);
+
+/**
+ * @brief 单个线程的空闲列表与计数
+ *
+ * 计数只由所属线程写入，pool_stats()在其他线程读取，因此用relaxed原子变量；
+ * 线程退出时计数并入注册表的retired。
+ */
+struct ThreadPool {
+    ThreadPool();
+    ~ThreadPool();
+
+    std::vector<SpareBuffer> buffers;
+    std::vector<std::unique_ptr<RPCLIB_MSGPACK::zone>> zones;
+    std::atomic<uint64_t> buffer_hits;
+    std::atomic<uint64_t> buffer_misses;
+    std::atomic<uint64_t> zone_hits;
+    std::atomic<uint64_t> zone_misses;
+};
+
+struct PoolRegistry {
+    std::mutex mutex;
+    std::vector<ThreadPool*> pools;
+    PoolStats retired;
+};
+
+// 故意不释放：静态对象析构后仍可能有线程退出
+PoolRegistry& registry() {
+    static PoolRegistry* instance = new PoolRegistry();
+    return *instance;
+}
+
+void add_counts(PoolStats& stats, const ThreadPool& pool) {
+    stats.buffer_hits += pool.buffer_hits.load(std::memory_order_relaxed);
+    stats.buffer_misses += pool.buffer_misses.load(std::memory_order_relaxed);
+    stats.zone_hits += pool.zone_hits.load(std::memory_order_relaxed);
+    stats.zone_misses += pool.zone_misses.load(std::memory_order_relaxed);
+}
+
+inline void bump(std::atomic<uint64_t>& counter) {
+    // 只有所属线程写入，读-改-写不需要原子指令
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// 线程退出时其他thread_local对象的析构函数仍可能归还缓冲区，析构后不再使用线程池
+thread_local bool tls_pool_destroyed = false;
+
+ThreadPool::ThreadPool() : buffer_hits(0), buffer_misses(0), zone_hits(0), zone_misses(0) {
+    PoolRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.pools.push_back(this);
+}
+
+ThreadPool::~ThreadPool() {
+    tls_pool_destroyed = true;
+    PoolRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    add_counts(reg.retired, *this);
+    reg.pools.erase(std::remove(reg.pools.begin(), reg.pools.end(), this), reg.pools.end());
+}
+
+ThreadPool* local_pool() {
+    if (tls_pool_destroyed) {
+        return nullptr;
+    }
+    thread_local ThreadPool pool;
+    return &pool;
+}
+
+} // namespace
+
+void set_pool_options(const PoolOptions& options) {
+    g_max_spare_buffers.store(options.max_spare_buffers, std::memory_order_relaxed);
+    g_max_buffer_capacity.store(options.max_buffer_capacity, std::memory_order_relaxed);
+    g_max_spare_zones.store(options.max_spare_zones, std::memory_order_relaxed);
+}
+
+PoolOptions pool_options() {
+    PoolOptions options;
+    options.max_spare_buffers = g_max_spare_buffers.load(std::memory_order_relaxed);
+    options.max_buffer_capacity = g_max_buffer_capacity.load(std::memory_order_relaxed);
+    options.max_spare_zones = g_max_spare_zones.load(std::memory_order_relaxed);
+    return options;
+}
+
+PoolStats pool_stats() {
+    PoolRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    PoolStats stats = reg.retired;
+    for (const ThreadPool* pool : reg.pools) {
+        add_counts(stats, *pool);
+    }
+    return stats;
+}
+
+namespace detail {
+
+ScratchBuffer::ScratchBuffer() : size_(0), capacity_(0) {
+    ThreadPool* pool = local_pool();
+    if (pool == nullptr) {
+        return;
+    }
+    if (pool->buffers.empty()) {
+        bump(pool->buffer_misses);
+        return;
+    }
+    bump(pool->buffer_hits);
+    data_ = std::move(pool->buffers.back().data);
+    capacity_ = pool->buffers.back().capacity;
+    pool->buffers.pop_back();
+}
+
+ScratchBuffer::~ScratchBuffer() {
+    if (!data_ || capacity_ > g_max_buffer_capacity.load(std::memory_order_relaxed)) {
+        return;
+    }
+    ThreadPool* pool = local_pool();
+    if (pool != nullptr && pool->buffers.size() < g_max_spare_buffers.load(std::memory_order_relaxed)) {
+        pool->buffers.push_back(SpareBuffer{std::move(data_), capacity_});
+    }
+}
+
+void ScratchBuffer::grow(size_t min_capacity) {
+    size_t capacity = std::max(min_capacity, std::max<size_t>(capacity_ * 2, 4096));
+    std::unique_ptr<char[]> data(new char[capacity]);
+    if (size_ > 0) {
+        std::memcpy(data.get(), data_.get(), size_);
+    }
+    data_ = std::move(data);
+    capacity_ = capacity;
+}
+
+std::unique_ptr<RPCLIB_MSGPACK::zone> acquire_zone() {
+    ThreadPool* pool = local_pool();
+    if (pool == nullptr) {
+        return std::make_unique<RPCLIB_MSGPACK::zone>();
+    }
+    if (pool->zones.empty()) {
+        bump(pool->zone_misses);
+        return std::make_unique<RPCLIB_MSGPACK::zone>();
+    }
+    bump(pool->zone_hits);
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone = std::move(pool->zones.back());
+    pool->zones.pop_back();
+    return zone;
+}
+
+void recycle_zone(std::unique_ptr<RPCLIB_MSGPACK::zone> zone) {
+    if (!zone) {
+        return;
+    }
+    // 终结器可能释放其他共享对象并递归归还内存区，先清空再取线程池
+    zone->clear();
+    ThreadPool* pool = local_pool();
+    if (pool != nullptr && pool->zones.size() < g_max_spare_zones.load(std::memory_order_relaxed)) {
+        pool->zones.push_back(std::move(zone));
+    }
+}
+
+namespace {
+
+/**
+ * @brief 析构时归还内存区的结果句柄，与控制块一起一次分配
+ */
+struct PooledHandle {
+    PooledHandle(const RPCLIB_MSGPACK::object& object, std::unique_ptr<RPCLIB_MSGPACK::zone> zone)
+        : handle(object, std::move(zone)) {}
+
+    ~PooledHandle() {
+        recycle_zone(std::move(handle.zone()));
+    }
+
+    RPCLIB_MSGPACK::object_handle handle;
+};
+
+} // namespace
+
+SharedObject make_shared_object(const RPCLIB_MSGPACK::object& object,
+                                std::unique_ptr<RPCLIB_MSGPACK::zone> zone) {
+    auto holder = std::make_shared<PooledHandle>(object, std::move(zone));
+    return SharedObject{std::shared_ptr<const RPCLIB_MSGPACK::object_handle>(holder, &holder->handle)};
+}
+
+RPCLIB_MSGPACK::object_handle pooled_unpack(const char* data, size_t size) {
+    PooledZone zone;
+    std::size_t offset = 0;
+    bool referenced = false;
+    RPCLIB_MSGPACK::object result = RPCLIB_MSGPACK::unpack(*zone, data, size, offset, referenced);
+    if (offset != size) {
+        throw std::runtime_error("Malformed msgpack message: trailing bytes after message");
+    }
+    return RPCLIB_MSGPACK::object_handle(result, zone.release());
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,184 @@
+#include "rpc_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace rpc_utils {
+
+// HistogramSnapshot 实现
+HistogramSnapshot::HistogramSnapshot()
+    : buckets_(LatencyHistogram::kBucketCount, 0), count_(0), sum_(0), max_(0) {}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t HistogramSnapshot::percentile(double quantile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    quantile = std::min(1.0, std::max(0.0, quantile));
+    uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+double HistogramSnapshot::mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+// LatencyHistogram 实现
+const size_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram()
+    : buckets_(new std::atomic<uint64_t>[kBucketCount]), sum_(0), max_(0) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::merge_into(HistogramSnapshot& snapshot) const {
+    uint64_t count = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+        snapshot.buckets_[i] += n;
+        count += n;
+    }
+    snapshot.count_ += count;
+    snapshot.sum_ += sum_.load(std::memory_order_relaxed);
+    snapshot.max_ = std::max(snapshot.max_, max_.load(std::memory_order_relaxed));
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot result;
+    merge_into(result);
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    unsigned shift = static_cast<unsigned>(index / kSubBucketCount) - 1;
+    uint64_t sub = index % kSubBucketCount;
+    uint64_t lower = (kSubBucketCount + sub) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+// MethodStats 实现
+struct MethodStats::Shard {
+    LatencyHistogram latency;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> errors{0};
+    // 避免相邻分片的计数器共享缓存行
+    char padding[64];
+};
+
+namespace {
+
+size_t stats_shard_count() {
+    static const size_t count = [] {
+        size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t n = 1;
+        while (n < hw && n < 16) {
+            n <<= 1;
+        }
+        return n;
+    }();
+    return count;
+}
+
+} // namespace
+
+MethodStats::MethodStats() {
+    size_t count = stats_shard_count();
+    shards_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+MethodStats::~MethodStats() = default;
+
+size_t MethodStats::shard_index() {
+    static std::atomic<size_t> next_thread{0};
+    static thread_local size_t index =
+        next_thread.fetch_add(1, std::memory_order_relaxed) % stats_shard_count();
+    return index;
+}
+
+void MethodStats::record(uint64_t latency_ns, bool ok) {
+    Shard& shard = *shards_[shard_index()];
+    shard.calls.fetch_add(1, std::memory_order_relaxed);
+    if (!ok) {
+        shard.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    shard.latency.record(latency_ns);
+}
+
+HistogramSnapshot MethodStats::latency() const {
+    HistogramSnapshot result;
+    for (const auto& shard : shards_) {
+        shard->latency.merge_into(result);
+    }
+    return result;
+}
+
+MethodStatsSnapshot MethodStats::snapshot() const {
+    MethodStatsSnapshot result;
+    for (const auto& shard : shards_) {
+        result.calls += shard->calls.load(std::memory_order_relaxed);
+        result.errors += shard->errors.load(std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot hist = latency();
+    result.mean_us = hist.mean() / 1000.0;
+    result.p50_us = static_cast<double>(hist.percentile(0.50)) / 1000.0;
+    result.p90_us = static_cast<double>(hist.percentile(0.90)) / 1000.0;
+    result.p99_us = static_cast<double>(hist.percentile(0.99)) / 1000.0;
+    result.p999_us = static_cast<double>(hist.percentile(0.999)) / 1000.0;
+    result.max_us = static_cast<double>(hist.max()) / 1000.0;
+    return result;
+}
+
+// StatsRegistry 实现
+MethodStats* StatsRegistry::method(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = methods_[name];
+    if (!entry) {
+        entry = std::make_unique<MethodStats>();
+    }
+    return entry.get();
+}
+
+std::map<std::string, MethodStatsSnapshot> StatsRegistry::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, MethodStatsSnapshot> result;
+    for (const auto& entry : methods_) {
+        result[entry.first] = entry.second->snapshot();
+    }
+    return result;
+}
+
+} // namespace rpc_utils
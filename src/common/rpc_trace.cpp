@@ -0,0 +1,292 @@
+#include "rpc_trace.h"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <unistd.h>
+
+namespace rpc_utils {
+
+namespace {
+
+struct SpanRecord {
+    std::string name;
+    SpanKind kind;
+    uint64_t trace_id;
+    uint64_t span_id;
+    uint64_t parent_id;
+    int64_t start_us;
+    int64_t duration_us;
+    uint32_t tid;
+};
+
+/**
+ * @brief 单个线程的跨度环，写入与导出都很少发生，用各自的互斥锁保护
+ */
+struct ThreadSpans {
+    ThreadSpans();
+    ~ThreadSpans();
+
+    void add(SpanRecord record, size_t capacity);
+
+    std::mutex mutex;
+    std::vector<SpanRecord> ring;
+    size_t next = 0;        // 环满后下一个覆盖的位置
+    uint32_t tid;
+};
+
+struct SpanRegistry {
+    std::mutex mutex;
+    std::vector<ThreadSpans*> threads;
+    std::deque<SpanRecord> retired;     // 已退出线程的跨度，最多保留capacity个
+    uint32_t next_tid = 1;
+};
+
+// 故意不释放：静态对象析构后仍可能有线程退出
+SpanRegistry& registry() {
+    static SpanRegistry* instance = new SpanRegistry();
+    return *instance;
+}
+
+std::atomic<bool> g_enabled(false);
+std::atomic<uint64_t> g_sample_threshold(0);      // 随机数不大于该值时采样
+std::atomic<size_t> g_capacity(TraceOptions().ring_capacity);
+
+thread_local bool tls_spans_destroyed = false;
+
+ThreadSpans::ThreadSpans() {
+    SpanRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    tid = reg.next_tid++;
+    reg.threads.push_back(this);
+}
+
+ThreadSpans::~ThreadSpans() {
+    tls_spans_destroyed = true;
+    SpanRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.threads.erase(std::remove(reg.threads.begin(), reg.threads.end(), this), reg.threads.end());
+    // 按时间顺序并入：环满时从next开始是最早的跨度
+    for (size_t i = 0; i < ring.size(); ++i) {
+        reg.retired.push_back(std::move(ring[(next + i) % ring.size()]));
+    }
+    size_t capacity = g_capacity.load(std::memory_order_relaxed);
+    while (reg.retired.size() > capacity) {
+        reg.retired.pop_front();
+    }
+}
+
+void ThreadSpans::add(SpanRecord record, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ring.size() > capacity) {
+        ring.clear();
+        next = 0;
+    }
+    if (ring.size() < capacity) {
+        ring.push_back(std::move(record));
+        return;
+    }
+    ring[next] = std::move(record);
+    next = (next + 1) % capacity;
+}
+
+uint64_t random_u64() {
+    thread_local std::mt19937_64 engine(std::random_device{}());
+    return engine();
+}
+
+uint64_t new_id() {
+    uint64_t id;
+    do {
+        id = random_u64();
+    } while (id == 0);
+    return id;
+}
+
+bool sampled() {
+    uint64_t threshold = g_sample_threshold.load(std::memory_order_relaxed);
+    return threshold != 0 && random_u64() <= threshold;
+}
+
+int64_t system_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void record_span(SpanRecord record) {
+    if (tls_spans_destroyed) {
+        return;
+    }
+    thread_local ThreadSpans spans;
+    record.tid = spans.tid;
+    spans.add(std::move(record), g_capacity.load(std::memory_order_relaxed));
+}
+
+const char* kind_name(SpanKind kind) {
+    switch (kind) {
+    case SpanKind::client: return "client";
+    case SpanKind::server: return "server";
+    default: return "internal";
+    }
+}
+
+void write_json_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (byte < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+std::string hex_id(uint64_t id) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(id));
+    return text;
+}
+
+} // namespace
+
+void enable_tracing(const TraceOptions& options) {
+    uint64_t threshold = 0;
+    if (options.sample_rate >= 1.0) {
+        threshold = std::numeric_limits<uint64_t>::max();
+    } else if (options.sample_rate > 0.0) {
+        threshold = static_cast<uint64_t>(
+            options.sample_rate * static_cast<double>(std::numeric_limits<uint64_t>::max()));
+    }
+    g_capacity.store(std::max<size_t>(1, options.ring_capacity), std::memory_order_relaxed);
+    g_sample_threshold.store(threshold, std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+void disable_tracing() {
+    g_enabled.store(false, std::memory_order_release);
+    g_sample_threshold.store(0, std::memory_order_relaxed);
+}
+
+bool tracing_enabled() {
+    return g_enabled.load(std::memory_order_acquire);
+}
+
+size_t write_chrome_trace(const std::string& path) {
+    std::vector<SpanRecord> records;
+    {
+        SpanRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        records.assign(reg.retired.begin(), reg.retired.end());
+        for (ThreadSpans* thread : reg.threads) {
+            std::lock_guard<std::mutex> thread_lock(thread->mutex);
+            records.insert(records.end(), thread->ring.begin(), thread->ring.end());
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const SpanRecord& a, const SpanRecord& b) {
+        return a.start_us < b.start_us;
+    });
+
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Failed to open trace file '" + path + "'");
+    }
+    long pid = static_cast<long>(::getpid());
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const SpanRecord& record = records[i];
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, record.name);
+        out << ",\"cat\":\"" << kind_name(record.kind) << "\",\"ph\":\"X\""
+            << ",\"ts\":" << record.start_us << ",\"dur\":" << record.duration_us
+            << ",\"pid\":" << pid << ",\"tid\":" << record.tid
+            << ",\"args\":{\"trace_id\":\"" << hex_id(record.trace_id)
+            << "\",\"span_id\":\"" << hex_id(record.span_id)
+            << "\",\"parent_id\":\"" << hex_id(record.parent_id) << "\"}}";
+    }
+    out << "\n]}\n";
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Failed to write trace file '" + path + "'");
+    }
+    return records.size();
+}
+
+void clear_traces() {
+    SpanRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.retired.clear();
+    for (ThreadSpans* thread : reg.threads) {
+        std::lock_guard<std::mutex> thread_lock(thread->mutex);
+        thread->ring.clear();
+        thread->next = 0;
+    }
+}
+
+TraceSpan::TraceSpan(const std::string& name, SpanKind kind)
+    : recording_(false), kind_(kind), parent_id_(0), start_us_(0) {
+    TraceContext parent = kind == SpanKind::client
+        ? detail::outgoing_trace()
+        : RequestContext::current().trace();
+    context_ = parent;
+    if (!parent.valid() || !tracing_enabled()) {
+        return;
+    }
+    recording_ = true;
+    name_ = name;
+    parent_id_ = parent.span_id;
+    context_.span_id = new_id();
+    if (kind != SpanKind::client) {
+        // 同步调用期间当前线程不会执行别的工作，客户端跨度不必安装为父跨度
+        RequestContext context = RequestContext::current();
+        context.set_trace(context_);
+        scope_.reset(new ContextScope(context));
+    }
+    start_us_ = system_now_us();
+    start_ = RequestContext::Clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+    if (!recording_) {
+        return;
+    }
+    scope_.reset();
+    SpanRecord record;
+    record.name = std::move(name_);
+    record.kind = kind_;
+    record.trace_id = context_.trace_id;
+    record.span_id = context_.span_id;
+    record.parent_id = parent_id_;
+    record.start_us = start_us_;
+    record.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        RequestContext::Clock::now() - start_).count();
+    record.tid = 0;
+    record_span(std::move(record));
+}
+
+namespace detail {
+
+TraceContext outgoing_trace() {
+    const TraceContext& current = RequestContext::current().trace();
+    if (current.valid() || !sampled()) {
+        return current;
+    }
+    TraceContext trace;
+    trace.trace_id = new_id();
+    return trace;
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
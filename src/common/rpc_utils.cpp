@@ -1,13 +1,367 @@
 #include "rpc_utils.h"
 #include <regex>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 
 namespace rpc_utils {
 
 // Logger 实现
-LogLevel Logger::current_level_ = LogLevel::INFO;
+namespace {
+
+// 定长日志记录，异步模式下写入环形缓冲区时无需堆分配
+struct LogRecord {
+    int64_t timestamp_ms;
+    LogLevel level;
+    uint32_t length;
+    char text[512 - sizeof(int64_t) - sizeof(LogLevel) - sizeof(uint32_t)];
+};
+
+const size_t kMaxRecordText = sizeof(LogRecord::text);
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG:   return "DEBUG";
+        case LogLevel::INFO:    return "INFO";
+        case LogLevel::WARNING: return "WARNING";
+        case LogLevel::ERROR:   return "ERROR";
+        default:                return "UNKNOWN";
+    }
+}
+
+int64_t now_epoch_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 按毫秒缓存的时间戳格式化器
+ *
+ * 同一毫秒内直接复用，同一秒内只改写毫秒部分，跨秒时才调用localtime_r。
+ */
+class TimestampCache {
+public:
+    const char* format(int64_t epoch_ms) {
+        if (epoch_ms != cached_ms_) {
+            int64_t sec = epoch_ms / 1000;
+            if (sec != cached_sec_) {
+                std::time_t time = static_cast<std::time_t>(sec);
+                std::tm tm_buf;
+                localtime_r(&time, &tm_buf);
+                std::strftime(buf_, sizeof(buf_), "%Y-%m-%d %H:%M:%S", &tm_buf);
+                cached_sec_ = sec;
+            }
+            int ms = static_cast<int>(epoch_ms % 1000);
+            buf_[19] = '.';
+            buf_[20] = static_cast<char>('0' + ms / 100);
+            buf_[21] = static_cast<char>('0' + ms / 10 % 10);
+            buf_[22] = static_cast<char>('0' + ms % 10);
+            buf_[23] = '\0';
+            cached_ms_ = epoch_ms;
+        }
+        return buf_;
+    }
+
+private:
+    int64_t cached_ms_ = -1;
+    int64_t cached_sec_ = -1;
+    char buf_[32] = {0};
+};
+
+thread_local TimestampCache t_timestamp_cache;
+
+void append_line(std::string& out, int64_t timestamp_ms, LogLevel level,
+                 const char* text, size_t length) {
+    out += '[';
+    out += t_timestamp_cache.format(timestamp_ms);
+    out += "] [";
+    out += level_name(level);
+    out += "] ";
+    out.append(text, length);
+    out += '\n';
+}
+
+/**
+ * @brief 单生产者单消费者日志环形缓冲区
+ *
+ * 每个写日志的线程独占一个，生产者只做一次拷贝和一次release store。
+ */
+class LogRing {
+public:
+    explicit LogRing(size_t capacity) : records_(capacity), mask_(capacity - 1) {}
+
+    /**
+     * @return 写入后的占用记录数，0表示缓冲区已满、记录被丢弃
+     */
+    size_t try_push(LogLevel level, int64_t timestamp_ms, const char* message, size_t length) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        if (tail - head >= records_.size()) {
+            return 0;
+        }
+
+        LogRecord& record = records_[tail & mask_];
+        record.timestamp_ms = timestamp_ms;
+        record.level = level;
+        if (length > kMaxRecordText) {
+            // 超长消息截断并以"..."结尾
+            std::memcpy(record.text, message, kMaxRecordText - 3);
+            std::memcpy(record.text + kMaxRecordText - 3, "...", 3);
+            length = kMaxRecordText;
+        } else {
+            std::memcpy(record.text, message, length);
+        }
+        record.length = static_cast<uint32_t>(length);
+
+        tail_.store(tail + 1, std::memory_order_release);
+        return tail + 1 - head;
+    }
+
+    size_t capacity() const {
+        return records_.size();
+    }
+
+    void drain(std::vector<LogRecord>& batch) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        for (size_t i = head; i != tail; ++i) {
+            batch.push_back(records_[i & mask_]);
+        }
+        head_.store(tail, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    std::atomic<bool> retired{false};
+
+private:
+    std::vector<LogRecord> records_;
+    size_t mask_;
+    char pad0_[64];
+    std::atomic<size_t> head_{0};
+    char pad1_[64];
+    std::atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief 异步日志后端：收集各线程环形缓冲区中的记录，按时间排序后批量写出
+ */
+class AsyncLogBackend {
+public:
+    static AsyncLogBackend& instance() {
+        static AsyncLogBackend backend;
+        return backend;
+    }
+
+    ~AsyncLogBackend() {
+        stop();
+    }
+
+    bool running() const {
+        return running_.load(std::memory_order_acquire);
+    }
+
+    void start() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (running()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> state_lock(mutex_);
+            stop_requested_ = false;
+        }
+        worker_ = std::thread(&AsyncLogBackend::run, this);
+        running_.store(true, std::memory_order_release);
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!running()) {
+            return;
+        }
+        running_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> state_lock(mutex_);
+            stop_requested_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    void push(LogLevel level, const char* message, size_t length) {
+        LogRing& ring = local_ring();
+        size_t used = ring.try_push(level, now_epoch_ms(), message, length);
+        if (used == 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        } else if (used == ring.capacity() / 2) {
+            // 突发写入时提前唤醒后台线程，平时只依赖其周期性轮询
+            cv_.notify_one();
+        }
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = ++flush_requested_;
+        cv_.notify_all();
+        flushed_cv_.wait(lock, [this, target] {
+            return flush_done_ >= target || stop_requested_;
+        });
+    }
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    void set_buffer_size(size_t records) {
+        size_t capacity = 16;
+        while (capacity < records) {
+            capacity <<= 1;
+        }
+        buffer_size_.store(capacity, std::memory_order_relaxed);
+    }
+
+private:
+    struct RingHandle {
+        std::shared_ptr<LogRing> ring;
+        ~RingHandle() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    AsyncLogBackend() = default;
+
+    LogRing& local_ring() {
+        static thread_local RingHandle handle;
+        if (!handle.ring) {
+            handle.ring = std::make_shared<LogRing>(buffer_size_.load(std::memory_order_relaxed));
+            std::lock_guard<std::mutex> lock(mutex_);
+            rings_.push_back(handle.ring);
+        }
+        return *handle.ring;
+    }
+
+    void run() {
+        std::vector<LogRecord> batch;
+        std::vector<const LogRecord*> ordered;
+        std::string out;
+        uint64_t reported_dropped = 0;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait_for(lock, std::chrono::milliseconds(5), [this] {
+                return stop_requested_ || flush_requested_ > flush_done_;
+            });
+            bool stopping = stop_requested_;
+            uint64_t flush_target = flush_requested_;
+
+            batch.clear();
+            for (auto it = rings_.begin(); it != rings_.end();) {
+                // 先读retired再drain，保证线程退出前写入的记录不会丢失
+                bool retired = (*it)->retired.load(std::memory_order_acquire);
+                (*it)->drain(batch);
+                if (retired) {
+                    it = rings_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            lock.unlock();
+
+            out.clear();
+            ordered.clear();
+            for (const auto& record : batch) {
+                ordered.push_back(&record);
+            }
+            std::stable_sort(ordered.begin(), ordered.end(),
+                [](const LogRecord* a, const LogRecord* b) {
+                    return a->timestamp_ms < b->timestamp_ms;
+                });
+            for (const LogRecord* record : ordered) {
+                append_line(out, record->timestamp_ms, record->level, record->text, record->length);
+            }
+
+            uint64_t dropped_total = dropped();
+            if (dropped_total != reported_dropped) {
+                std::string notice = "Logger dropped " +
+                    std::to_string(dropped_total - reported_dropped) +
+                    " message(s): async buffer full";
+                append_line(out, now_epoch_ms(), LogLevel::WARNING, notice.data(), notice.size());
+                reported_dropped = dropped_total;
+            }
+
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                std::fflush(stdout);
+            }
+
+            lock.lock();
+            if (flush_target > flush_done_) {
+                flush_done_ = flush_target;
+            }
+            flushed_cv_.notify_all();
+            if (stopping) {
+                break;
+            }
+        }
+    }
+
+    std::mutex control_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    bool stop_requested_ = false;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<size_t> buffer_size_{512};
+};
+
+std::mutex g_sync_log_mutex;
+
+} // namespace
+
+std::atomic<LogLevel> Logger::current_level_(LogLevel::INFO);
 
 void Logger::set_log_level(LogLevel level) {
-    current_level_ = level;
+    current_level_.store(level, std::memory_order_relaxed);
+}
+
+void Logger::set_log_mode(LogMode mode) {
+    if (mode == LogMode::ASYNC) {
+        AsyncLogBackend::instance().start();
+    } else {
+        AsyncLogBackend::instance().stop();
+    }
+}
+
+void Logger::set_async_buffer_size(size_t records) {
+    AsyncLogBackend::instance().set_buffer_size(records);
+}
+
+void Logger::flush() {
+    if (AsyncLogBackend::instance().running()) {
+        AsyncLogBackend::instance().flush();
+    } else {
+        std::lock_guard<std::mutex> lock(g_sync_log_mutex);
+        std::cout.flush();
+    }
+}
+
+uint64_t Logger::dropped_count() {
+    return AsyncLogBackend::instance().dropped();
 }
 
 void Logger::debug(const std::string& message) {
@@ -26,34 +380,95 @@ void Logger::error(const std::string& message) {
     log(LogLevel::ERROR, message);
 }
 
+void Logger::logf(LogLevel level, const char* format, ...) {
+    if (!is_enabled(level)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vlogf(level, format, args);
+    va_end(args);
+}
+
+void Logger::debugf(const char* format, ...) {
+    if (!is_enabled(LogLevel::DEBUG)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vlogf(LogLevel::DEBUG, format, args);
+    va_end(args);
+}
+
+void Logger::infof(const char* format, ...) {
+    if (!is_enabled(LogLevel::INFO)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vlogf(LogLevel::INFO, format, args);
+    va_end(args);
+}
+
+void Logger::warningf(const char* format, ...) {
+    if (!is_enabled(LogLevel::WARNING)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vlogf(LogLevel::WARNING, format, args);
+    va_end(args);
+}
+
+void Logger::errorf(const char* format, ...) {
+    if (!is_enabled(LogLevel::ERROR)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vlogf(LogLevel::ERROR, format, args);
+    va_end(args);
+}
+
+void Logger::vlogf(LogLevel level, const char* format, va_list args) {
+    // 格式化到线程本地缓冲区，超出记录长度的部分会被截断
+    thread_local char buffer[kMaxRecordText + 1];
+    int written = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    if (written < 0) {
+        return;
+    }
+    size_t length = std::min(static_cast<size_t>(written), sizeof(buffer) - 1);
+    write(level, buffer, length);
+}
+
 void Logger::log(LogLevel level, const std::string& message) {
-    if (level >= current_level_) {
-        std::cout << "[" << get_timestamp() << "] "
-                  << "[" << level_to_string(level) << "] "
-                  << message << std::endl;
+    if (is_enabled(level)) {
+        write(level, message.data(), message.size());
     }
 }
 
+void Logger::write(LogLevel level, const char* message, size_t length) {
+    AsyncLogBackend& backend = AsyncLogBackend::instance();
+    if (backend.running()) {
+        backend.push(level, message, length);
+        return;
+    }
+
+    // 同步模式：整行格式化后一次写出，加锁避免多线程输出交错
+    thread_local std::string line;
+    line.clear();
+    append_line(line, now_epoch_ms(), level, message, length);
+    std::lock_guard<std::mutex> lock(g_sync_log_mutex);
+    std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+    std::cout.flush();
+}
+
 std::string Logger::get_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    return t_timestamp_cache.format(now_epoch_ms());
 }
 
 std::string Logger::level_to_string(LogLevel level) {
-    switch (level) {
-        case LogLevel::DEBUG:   return "DEBUG";
-        case LogLevel::INFO:    return "INFO";
-        case LogLevel::WARNING: return "WARNING";
-        case LogLevel::ERROR:   return "ERROR";
-        default:                return "UNKNOWN";
-    }
+    return level_name(level);
 }
 
 // Timer 实现
@@ -0,0 +1,190 @@
+#include "rpc_cache.h"
+#include <algorithm>
+#include <functional>
+
+namespace rpc_utils {
+
+namespace {
+
+const size_t kShardCount = 16;
+
+// 条目的固定开销：链表节点、哈希表节点和对象句柄的大致大小
+const size_t kEntryOverhead = 128;
+
+/**
+ * @brief 估算msgpack对象树占用的内存
+ */
+size_t object_footprint(const RPCLIB_MSGPACK::object& o) {
+    size_t bytes = sizeof(RPCLIB_MSGPACK::object);
+    switch (o.type) {
+    case RPCLIB_MSGPACK::type::STR:
+        bytes += o.via.str.size;
+        break;
+    case RPCLIB_MSGPACK::type::BIN:
+        bytes += o.via.bin.size;
+        break;
+    case RPCLIB_MSGPACK::type::EXT:
+        bytes += o.via.ext.size;
+        break;
+    case RPCLIB_MSGPACK::type::ARRAY:
+        for (uint32_t i = 0; i < o.via.array.size; ++i) {
+            bytes += object_footprint(o.via.array.ptr[i]);
+        }
+        break;
+    case RPCLIB_MSGPACK::type::MAP:
+        for (uint32_t i = 0; i < o.via.map.size; ++i) {
+            bytes += object_footprint(o.via.map.ptr[i].key);
+            bytes += object_footprint(o.via.map.ptr[i].val);
+        }
+        break;
+    default:
+        break;
+    }
+    return bytes;
+}
+
+} // namespace
+
+ResultCache::ResultCache(size_t capacity, std::chrono::milliseconds ttl, size_t max_bytes)
+    : shard_capacity_(std::max<size_t>(1, (capacity + kShardCount - 1) / kShardCount)),
+      shard_max_bytes_(max_bytes > 0 ? std::max<size_t>(1, max_bytes / kShardCount) : 0),
+      ttl_(ttl) {
+    shards_.reserve(kShardCount);
+    for (size_t i = 0; i < kShardCount; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+ResultCache::Shard& ResultCache::shard_for(const std::string& key) {
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+void ResultCache::erase_locked(Shard& shard, std::list<Entry>::iterator it) {
+    shard.bytes -= it->bytes;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+ResultCache::Value ResultCache::get(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        ++shard.stats.misses;
+        return nullptr;
+    }
+
+    auto it = found->second;
+    if (ttl_.count() > 0 && std::chrono::steady_clock::now() >= it->expires) {
+        erase_locked(shard, it);
+        ++shard.stats.expirations;
+        ++shard.stats.misses;
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    ++shard.stats.hits;
+    return it->value;
+}
+
+void ResultCache::put(std::string key, Value value) {
+    size_t bytes = kEntryOverhead + 2 * key.size() + object_footprint(value->get());
+    if (shard_max_bytes_ > 0 && bytes > shard_max_bytes_) {
+        // 单个结果超过分片内存上限，不缓存
+        return;
+    }
+
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        // 并发未命中时可能已被其他线程写入，以新结果为准
+        erase_locked(shard, found->second);
+    }
+
+    while (!shard.lru.empty() &&
+           (shard.lru.size() >= shard_capacity_ ||
+            (shard_max_bytes_ > 0 && shard.bytes + bytes > shard_max_bytes_))) {
+        erase_locked(shard, std::prev(shard.lru.end()));
+        ++shard.stats.evictions;
+    }
+
+    auto expires = std::chrono::steady_clock::now() + ttl_;
+    shard.lru.push_front(Entry{std::move(key), std::move(value), bytes, expires});
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+    shard.bytes += bytes;
+}
+
+void ResultCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->lru.clear();
+        shard->bytes = 0;
+    }
+}
+
+CacheStats ResultCache::stats() const {
+    CacheStats total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total.hits += shard->stats.hits;
+        total.misses += shard->stats.misses;
+        total.evictions += shard->stats.evictions;
+        total.expirations += shard->stats.expirations;
+        total.entries += shard->lru.size();
+        total.bytes += shard->bytes;
+    }
+    return total;
+}
+
+SingleFlight::Value SingleFlight::run(const std::string& key, const std::function<Value()>& compute) {
+    std::promise<Value> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end()) {
+            std::shared_future<Value> flight = it->second;
+            lock.unlock();
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            return flight.get();
+        }
+        flights_.emplace(key, promise.get_future().share());
+    }
+    executions_.fetch_add(1, std::memory_order_relaxed);
+
+    // 先移除再发布结果：之后到达的请求发起新的执行（或命中缓存），而不是拿到旧结果
+    auto finish = [this, &key]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flights_.erase(key);
+    };
+    try {
+        Value value = compute();
+        finish();
+        promise.set_value(value);
+        return value;
+    } catch (...) {
+        finish();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+namespace detail {
+
+std::string pack_args_key(const RPCLIB_MSGPACK::object* const* args, size_t count) {
+    thread_local RPCLIB_MSGPACK::sbuffer buffer;
+    buffer.clear();
+    RPCLIB_MSGPACK::packer<RPCLIB_MSGPACK::sbuffer> packer(buffer);
+    packer.pack_array(static_cast<uint32_t>(count));
+    for (size_t i = 0; i < count; ++i) {
+        packer.pack(*args[i]);
+    }
+    return std::string(buffer.data(), buffer.size());
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,45 @@
+#include "rpc_handler.h"
+#include "rpc_drain.h"
+#include "rpc_errors.h"
+#include "rpc/this_handler.h"
+#include <stdexcept>
+
+namespace rpc_utils {
+
+namespace detail {
+
+void check_arg_count(const std::string& name, size_t expected, const RPCLIB_MSGPACK::object& args) {
+    if (args.type != RPCLIB_MSGPACK::type::ARRAY) {
+        throw std::runtime_error("Function '" + name + "' was called with malformed arguments");
+    }
+    if (args.via.array.size != expected) {
+        throw std::runtime_error("Function '" + name +
+                                 "' was called with an invalid number of arguments. Expected: " +
+                                 std::to_string(expected) + ", got: " +
+                                 std::to_string(args.via.array.size));
+    }
+}
+
+std::string pool_full_message(const std::string& name, const WorkStealingPool& pool) {
+    return "offload pool '" + pool.name() + "' queue is full (limit " +
+           std::to_string(pool.queue_limit()) + ") while calling '" + name + "'";
+}
+
+void throw_pool_full(const std::string& name, const WorkStealingPool& pool) {
+    respond_overloaded(pool_full_message(name, pool));
+}
+
+void check_queued_deadline(const RequestContext& context, const WorkStealingPool& pool) {
+    if (context.expired()) {
+        respond_error_info(kDeadlineExceededErrorCode,
+                           "request expired while queueing for offload pool '" + pool.name() + "'");
+    }
+}
+
+void reject_draining(const std::string& name) {
+    respond_error_info(kDrainingErrorCode, "server is draining, '" + name + "' was not executed");
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
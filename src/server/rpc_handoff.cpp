@@ -0,0 +1,319 @@
+#include "rpc_handoff.h"
+#include "rpc_utils.h"
+#include "rpc/msgpack.hpp"
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+const int kPollIntervalMs = 100;
+const size_t kMaxHandoffFds = 253;          // SCM_MAX_FD
+const size_t kMaxHandoffMessage = 64 * 1024;
+
+std::string error_text(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+sockaddr_un make_control_address(const std::string& path) {
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::runtime_error("Handoff socket path is too long: " + path);
+    }
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+/**
+ * @brief 等待fd可读
+ * @return 可读（或对端关闭）时返回true，超时返回false
+ */
+bool wait_readable(int fd, int timeout_ms) {
+    pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    p.revents = 0;
+    int ready = ::poll(&p, 1, timeout_ms);
+    return ready > 0;
+}
+
+/**
+ * @brief 发送消息：4字节长度加msgpack编码的键数组，监听套接字随第一个字节发送
+ */
+void send_listeners(int fd, const std::vector<InheritedSocket>& sockets) {
+    if (sockets.size() > kMaxHandoffFds) {
+        throw std::runtime_error("Too many listening sockets to hand off: " + std::to_string(sockets.size()));
+    }
+    std::vector<std::string> keys;
+    keys.reserve(sockets.size());
+    for (const auto& socket : sockets) {
+        keys.push_back(socket.key);
+    }
+    RPCLIB_MSGPACK::sbuffer body;
+    RPCLIB_MSGPACK::pack(body, keys);
+    uint32_t length = static_cast<uint32_t>(body.size());
+    std::vector<char> message(sizeof(length) + body.size());
+    std::memcpy(message.data(), &length, sizeof(length));
+    std::memcpy(message.data() + sizeof(length), body.data(), body.size());
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxHandoffFds));
+    size_t sent = 0;
+    while (sent < message.size()) {
+        iovec iov;
+        iov.iov_base = message.data() + sent;
+        iov.iov_len = message.size() - sent;
+        msghdr header;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        if (sent == 0 && !sockets.empty()) {
+            header.msg_control = control.data();
+            header.msg_controllen = CMSG_SPACE(sizeof(int) * sockets.size());
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * sockets.size());
+            int* fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+            for (size_t i = 0; i < sockets.size(); ++i) {
+                fds[i] = sockets[i].fd;
+            }
+        }
+        ssize_t n = ::sendmsg(fd, &header, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(error_text("Failed to send listening sockets"));
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+void close_all(const std::vector<int>& fds) {
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+HandoffListener::HandoffListener(const std::string& path, Provider provider)
+    : path_(path), provider_(std::move(provider)), listen_fd_(-1), running_(true), handed_off_(false) {
+    sockaddr_un addr = make_control_address(path_);
+    // 上一个进程的控制套接字（交接后它不再使用）或异常退出遗留的文件
+    ::unlink(path_.c_str());
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(error_text("Failed to create handoff socket"));
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 1) != 0) {
+        std::string message = error_text("Failed to listen on handoff socket " + path_);
+        ::close(listen_fd_);
+        throw std::runtime_error(message);
+    }
+    thread_ = std::thread(&HandoffListener::run, this);
+}
+
+HandoffListener::~HandoffListener() {
+    stop();
+}
+
+void HandoffListener::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.store(false, std::memory_order_release);
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        // 交接后路径可能已被新进程的控制套接字占用，不再删除
+        if (!handed_off()) {
+            ::unlink(path_.c_str());
+        }
+    }
+}
+
+bool HandoffListener::wait(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto done = [this] { return handed_off() || !running_.load(std::memory_order_acquire); };
+    if (timeout.count() > 0) {
+        cv_.wait_for(lock, timeout, done);
+    } else {
+        cv_.wait(lock, done);
+    }
+    return handed_off();
+}
+
+void HandoffListener::run() {
+    while (running_.load(std::memory_order_acquire)) {
+        if (!wait_readable(listen_fd_, kPollIntervalMs)) {
+            continue;
+        }
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        bool confirmed = false;
+        try {
+            confirmed = serve(fd);
+        } catch (const std::exception& e) {
+            Logger::warningf("Listener handoff on %s failed: %s", path_.c_str(), e.what());
+        }
+        ::close(fd);
+        if (confirmed) {
+            Logger::infof("Listening sockets handed off through %s", path_.c_str());
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                handed_off_.store(true, std::memory_order_release);
+            }
+            cv_.notify_all();
+            return;
+        }
+    }
+}
+
+bool HandoffListener::serve(int fd) {
+    send_listeners(fd, provider_());
+    // 新进程在开始接受连接时确认，此前本进程继续接受连接
+    while (running_.load(std::memory_order_acquire)) {
+        if (!wait_readable(fd, kPollIntervalMs)) {
+            continue;
+        }
+        char ack = 0;
+        ssize_t n = ::read(fd, &ack, 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 1) {
+            return true;
+        }
+        Logger::warningf("New process closed %s before taking over, keep serving", path_.c_str());
+        return false;
+    }
+    return false;
+}
+
+std::vector<InheritedSocket> receive_listeners(const std::string& path, std::chrono::milliseconds timeout,
+                                               int& control_fd) {
+    sockaddr_un addr = make_control_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(error_text("Failed to create handoff socket"));
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::string message = error_text("Failed to connect to handoff socket " + path);
+        ::close(fd);
+        throw std::runtime_error(message);
+    }
+
+    std::vector<char> message;
+    std::vector<int> fds;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxHandoffFds));
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t expected = sizeof(uint32_t);
+    try {
+        while (message.size() < expected) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0 || !wait_readable(fd, static_cast<int>(left))) {
+                throw std::runtime_error("Timed out waiting for listening sockets on " + path);
+            }
+            char buffer[4096];
+            iovec iov;
+            iov.iov_base = buffer;
+            iov.iov_len = sizeof(buffer);
+            msghdr header;
+            std::memset(&header, 0, sizeof(header));
+            header.msg_iov = &iov;
+            header.msg_iovlen = 1;
+            header.msg_control = control.data();
+            header.msg_controllen = control.size();
+#ifdef MSG_CMSG_CLOEXEC
+            ssize_t n = ::recvmsg(fd, &header, MSG_CMSG_CLOEXEC);
+#else
+            ssize_t n = ::recvmsg(fd, &header, 0);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Handoff socket " + path + " closed before sending listening sockets");
+            }
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                    continue;
+                }
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int* received = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+                for (size_t i = 0; i < count; ++i) {
+#ifndef MSG_CMSG_CLOEXEC
+                    ::fcntl(received[i], F_SETFD, FD_CLOEXEC);
+#endif
+                    fds.push_back(received[i]);
+                }
+            }
+            if (header.msg_flags & MSG_CTRUNC) {
+                throw std::runtime_error("Too many listening sockets received on " + path);
+            }
+            message.insert(message.end(), buffer, buffer + n);
+            if (expected == sizeof(uint32_t) && message.size() >= sizeof(uint32_t)) {
+                uint32_t length = 0;
+                std::memcpy(&length, message.data(), sizeof(length));
+                if (length > kMaxHandoffMessage) {
+                    throw std::runtime_error("Malformed handoff message on " + path);
+                }
+                expected += length;
+            }
+        }
+
+        std::vector<std::string> keys;
+        RPCLIB_MSGPACK::object_handle handle = RPCLIB_MSGPACK::unpack(
+            message.data() + sizeof(uint32_t), expected - sizeof(uint32_t));
+        handle.get().convert(keys);
+        if (keys.size() != fds.size()) {
+            throw std::runtime_error("Handoff message on " + path + " lists " + std::to_string(keys.size()) +
+                                     " sockets but carries " + std::to_string(fds.size()));
+        }
+        std::vector<InheritedSocket> sockets(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            sockets[i].key = std::move(keys[i]);
+            sockets[i].fd = fds[i];
+        }
+        control_fd = fd;
+        return sockets;
+    } catch (...) {
+        close_all(fds);
+        ::close(fd);
+        throw;
+    }
+}
+
+void confirm_handoff(int control_fd) {
+    char ack = 1;
+    if (::send(control_fd, &ack, 1, MSG_NOSIGNAL) != 1) {
+        Logger::warning(error_text("Failed to confirm listener handoff"));
+    }
+    ::close(control_fd);
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,158 @@
+#include "rpc_limiter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace rpc_utils {
+
+namespace {
+
+// 梯度的下限：单个窗口内上限最多收缩一半
+const double kMinGradient = 0.5;
+
+// 长期耗时是短期耗时的这么多倍以上时，说明排队已经消散，加速长期值回落
+const double kDrainRatio = 2.0;
+const double kDrainDecay = 0.95;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ConcurrencyLimiter::ConcurrencyLimiter(const LimiterOptions& options)
+    : options_(options),
+      limit_(0),
+      in_flight_(0),
+      accepted_(0),
+      rejected_(0),
+      window_start_ns_(now_ns()),
+      window_sum_ns_(0),
+      window_count_(0),
+      window_max_in_flight_(0),
+      retry_after_ms_(0),
+      seeded_(options.initial_limit != 0),
+      short_rtt_ns_(0),
+      long_rtt_ns_(0) {
+    options_.min_limit = std::max<size_t>(1, options_.min_limit);
+    options_.max_limit = std::max(options_.min_limit, options_.max_limit);
+    options_.long_window = std::max<size_t>(1, options_.long_window);
+    size_t initial = std::min(std::max(options_.initial_limit, options_.min_limit), options_.max_limit);
+    estimated_limit_ = static_cast<double>(initial);
+    limit_.store(initial, std::memory_order_relaxed);
+}
+
+void ConcurrencyLimiter::seed(size_t concurrency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (seeded_) {
+        return;
+    }
+    seeded_ = true;
+    size_t initial = std::min(std::max(concurrency, options_.min_limit), options_.max_limit);
+    estimated_limit_ = static_cast<double>(initial);
+    limit_.store(initial, std::memory_order_relaxed);
+}
+
+bool ConcurrencyLimiter::try_acquire() {
+    size_t current = in_flight_.load(std::memory_order_relaxed);
+    do {
+        if (current >= limit_.load(std::memory_order_relaxed)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!in_flight_.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ConcurrencyLimiter::abandon() {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ConcurrencyLimiter::release(uint64_t latency_ns) {
+    size_t in_flight = in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    if (options_.min_limit == options_.max_limit) {
+        // 固定上限
+        return;
+    }
+
+    window_sum_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+    window_count_.fetch_add(1, std::memory_order_relaxed);
+    size_t prev = window_max_in_flight_.load(std::memory_order_relaxed);
+    while (in_flight > prev &&
+           !window_max_in_flight_.compare_exchange_weak(prev, in_flight, std::memory_order_relaxed)) {
+    }
+
+    int64_t now = now_ns();
+    int64_t window_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.window).count();
+    if (now - window_start_ns_.load(std::memory_order_relaxed) >= window_ns) {
+        close_window(now);
+    }
+}
+
+void ConcurrencyLimiter::close_window(int64_t now_ns) {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // 其他线程正在结算这个窗口
+        return;
+    }
+    window_start_ns_.store(now_ns, std::memory_order_relaxed);
+    uint64_t count = window_count_.exchange(0, std::memory_order_relaxed);
+    uint64_t sum = window_sum_ns_.exchange(0, std::memory_order_relaxed);
+    size_t max_in_flight = window_max_in_flight_.exchange(0, std::memory_order_relaxed);
+    if (count == 0) {
+        return;
+    }
+
+    double short_rtt = static_cast<double>(sum) / static_cast<double>(count);
+    short_rtt_ns_ = short_rtt;
+    if (long_rtt_ns_ <= 0) {
+        long_rtt_ns_ = short_rtt;
+    } else {
+        double alpha = 2.0 / (static_cast<double>(options_.long_window) + 1.0);
+        long_rtt_ns_ += alpha * (short_rtt - long_rtt_ns_);
+    }
+    if (long_rtt_ns_ > kDrainRatio * short_rtt) {
+        long_rtt_ns_ *= kDrainDecay;
+    }
+    retry_after_ms_.store(static_cast<int64_t>(std::ceil(long_rtt_ns_ / 1e6)), std::memory_order_relaxed);
+
+    // 耗时升高时总是按梯度收缩；只有并发接近上限时才继续探测更高的上限，
+    // 并发远未达到上限时耗时平稳不能说明更高的上限也合适，避免上限无限增长
+    double gradient = std::max(kMinGradient, std::min(1.0, options_.tolerance * long_rtt_ns_ / short_rtt));
+    double target = estimated_limit_ * gradient;
+    if (static_cast<double>(max_in_flight) >= estimated_limit_ / 2) {
+        target += std::sqrt(estimated_limit_);
+    }
+    double updated = estimated_limit_ * (1.0 - options_.smoothing) + target * options_.smoothing;
+    estimated_limit_ = std::min(static_cast<double>(options_.max_limit),
+                                std::max(static_cast<double>(options_.min_limit), updated));
+    limit_.store(static_cast<size_t>(estimated_limit_), std::memory_order_relaxed);
+}
+
+std::chrono::milliseconds ConcurrencyLimiter::retry_after() const {
+    return std::chrono::milliseconds(retry_after_ms_.load(std::memory_order_relaxed));
+}
+
+LimiterStats ConcurrencyLimiter::stats() const {
+    LimiterStats stats;
+    stats.limit = limit_.load(std::memory_order_relaxed);
+    stats.in_flight = in_flight_.load(std::memory_order_relaxed);
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.short_rtt_us = short_rtt_ns_ / 1000.0;
+    stats.long_rtt_us = long_rtt_ns_ / 1000.0;
+    return stats;
+}
+
+namespace detail {
+
+void reject_overloaded(const std::string& name, const ConcurrencyLimiter& limiter, const char* scope) {
+    respond_overloaded("concurrency limit " + std::to_string(limiter.limit()) + " (" + scope +
+                       ") reached for '" + name + "'", limiter.retry_after());
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
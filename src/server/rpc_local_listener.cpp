@@ -0,0 +1,265 @@
+#include "rpc_local_transport.h"
+#include "rpc_utils.h"
+#include "rpc_context.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+const int kPollIntervalMs = 100;
+
+sockaddr_un make_unix_address(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+/**
+ * @brief 检查套接字文件上是否已有服务器在监听
+ */
+bool socket_in_use(const sockaddr_un& addr) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    bool in_use = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(fd);
+    return in_use;
+}
+
+} // namespace
+
+/**
+ * @brief 连接的响应出口：连接线程与工作线程的发送都经mutex串行（LocalConnection同时只允许一个发送方）
+ */
+class LocalListener::Channel : public ReplyChannel {
+public:
+    Channel() : connection(nullptr) {}
+
+    void post(const char* data, size_t size) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (connection == nullptr) {
+            return;
+        }
+        try {
+            connection->send(data, size);
+            connection->flush();
+        } catch (const std::exception&) {
+            // 发送失败时连接已被关闭，连接线程随之退出
+        }
+    }
+
+    std::mutex mutex;
+    LocalConnection* connection;    // 连接线程退出前置空
+};
+
+LocalListener::LocalListener(const TransportAddress& address, Handler handler, SessionClosed on_close,
+                             const CoalesceOptions& coalesce, int inherited_fd)
+    : address_(address),
+      handler_(std::move(handler)),
+      on_close_(std::move(on_close)),
+      coalesce_(coalesce),
+      listen_fd_(inherited_fd),
+      owns_path_(true),
+      running_(false),
+      accepting_(true) {
+    if (address_.kind == TransportKind::tcp) {
+        if (inherited_fd >= 0) {
+            ::close(inherited_fd);
+        }
+        throw std::invalid_argument("LocalListener does not handle tcp endpoints");
+    }
+    if (inherited_fd >= 0) {
+        // 套接字文件仍指向该套接字，旧进程排队中的连接由本进程接受
+        Logger::infof("Took over %s", address_.to_string().c_str());
+        return;
+    }
+
+    sockaddr_un addr = make_unix_address(address_.path);
+    if (socket_in_use(addr)) {
+        throw std::runtime_error("Address already in use: " + address_.to_string());
+    }
+    // 清理上次异常退出遗留的套接字文件
+    ::unlink(address_.path.c_str());
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create unix socket: " + std::string(std::strerror(errno)));
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        int error = errno;
+        ::close(listen_fd_);
+        throw std::runtime_error("Failed to listen on " + address_.to_string() + ": " + std::strerror(error));
+    }
+    Logger::infof("Listening on %s", address_.to_string().c_str());
+}
+
+LocalListener::~LocalListener() {
+    stop();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+    }
+    if (owns_path_) {
+        ::unlink(address_.path.c_str());
+    }
+}
+
+void LocalListener::start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    if (accepting_.load(std::memory_order_acquire)) {
+        acceptor_ = std::thread(&LocalListener::accept_loop, this);
+    }
+}
+
+void LocalListener::stop_accepting() {
+    accepting_.store(false, std::memory_order_release);
+    if (acceptor_.joinable()) {
+        acceptor_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void LocalListener::stop() {
+    running_.store(false, std::memory_order_release);
+    if (acceptor_.joinable()) {
+        acceptor_.join();
+    }
+
+    std::list<std::unique_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 关闭连接以唤醒阻塞在发送上的处理线程
+        for (auto& session : sessions_) {
+            if (session->connection) {
+                session->connection->close();
+            }
+        }
+        sessions.swap(sessions_);
+    }
+    for (auto& session : sessions) {
+        if (session->thread.joinable()) {
+            session->thread.join();
+        }
+    }
+}
+
+void LocalListener::accept_loop() {
+    while (running_.load(std::memory_order_acquire) && accepting_.load(std::memory_order_acquire)) {
+        pollfd p;
+        p.fd = listen_fd_;
+        p.events = POLLIN;
+        p.revents = 0;
+        int ready = ::poll(&p, 1, kPollIntervalMs);
+        reap_sessions();
+        if (ready <= 0) {
+            continue;
+        }
+
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                Logger::warningf("Accept failed on %s: %s", address_.to_string().c_str(), std::strerror(errno));
+            }
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.push_back(std::unique_ptr<Session>(new Session(fd)));
+        Session* session = sessions_.back().get();
+        session->thread = std::thread(&LocalListener::serve, this, session);
+    }
+}
+
+void LocalListener::serve(Session* session) {
+    try {
+        std::unique_ptr<LocalConnection> connection = LocalConnection::accept(session->fd, address_.kind);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session->connection = connection.get();
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            connection->close();
+        }
+        connection->set_coalescing(coalesce_);
+        auto channel = std::make_shared<Channel>();
+        channel->connection = connection.get();
+
+        ScratchBuffer frame;
+        ScratchBuffer reply;
+        RequestOrigin origin;
+        origin.session = new_session_id();
+        try {
+            while (running_.load(std::memory_order_acquire)) {
+                if (!connection->receive(frame, LocalConnection::Clock::now() +
+                                                std::chrono::milliseconds(kPollIntervalMs))) {
+                    continue;
+                }
+                origin.arrival = RequestContext::Clock::now();
+                reply.clear();
+                bool respond;
+                {
+                    OriginScope scope(origin);
+                    respond = handler_(frame.data(), frame.size(), reply, channel);
+                }
+                std::lock_guard<std::mutex> lock(channel->mutex);
+                if (respond) {
+                    connection->send(reply.data(), reply.size());
+                }
+                if (!connection->has_buffered_frame()) {
+                    // 已读入的请求都处理完了，等待新请求前写出累积的响应
+                    connection->flush();
+                }
+            }
+        } catch (const std::exception&) {
+            // 客户端断开或连接被关闭
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            channel->connection = nullptr;
+        }
+        if (on_close_) {
+            on_close_(origin.session);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        session->connection = nullptr;
+    } catch (const std::exception& e) {
+        Logger::warningf("Local connection on %s failed: %s", address_.to_string().c_str(), e.what());
+    }
+    session->done.store(true, std::memory_order_release);
+}
+
+void LocalListener::reap_sessions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if ((*it)->done.load(std::memory_order_acquire)) {
+            (*it)->thread.join();
+            it = sessions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
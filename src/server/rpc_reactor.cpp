@@ -0,0 +1,632 @@
+#include "rpc_reactor.h"
+#include "rpc_utils.h"
+#include "rpc_context.h"
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#endif
+#include <unistd.h>
+
+namespace rpc_utils {
+
+namespace detail {
+
+#ifdef __linux__
+
+namespace {
+
+const size_t kReadSize = 64 * 1024;                 // 每次读取预留的空间
+const size_t kMaxPendingOutput = 4 * 1024 * 1024;   // 未发出的响应超过该值时暂停读取
+const int kMaxReadsPerEvent = 4;                    // 一次可读事件最多连续读取的次数
+const int kMaxEvents = 256;
+const int kListenBacklog = 1024;
+
+std::string error_text(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+void close_fd(int fd) {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+/**
+ * @brief 进程允许运行的CPU列表（考虑taskset与cgroup cpuset）
+ */
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief 监听套接字绑定的端口
+ */
+uint16_t socket_port(int fd) {
+    sockaddr_storage local;
+    socklen_t length = sizeof(local);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) != 0) {
+        throw std::runtime_error(error_text("Failed to read reactor port"));
+    }
+    return local.ss_family == AF_INET6
+        ? ntohs(reinterpret_cast<const sockaddr_in6*>(&local)->sin6_port)
+        : ntohs(reinterpret_cast<const sockaddr_in*>(&local)->sin_port);
+}
+
+/**
+ * @brief 创建一个SO_REUSEPORT监听套接字
+ * @return 文件描述符，bound_port中写入实际绑定的端口（port为0时由系统分配）
+ */
+int open_listener(const std::string& address, uint16_t port, uint16_t& bound_port) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    int rc = getaddrinfo(address.empty() ? nullptr : address.c_str(), service.c_str(), &hints, &result);
+    if (rc != 0) {
+        throw std::runtime_error("Failed to resolve reactor address '" + address + "': " + gai_strerror(rc));
+    }
+    std::unique_ptr<addrinfo, void (*)(addrinfo*)> guard(result, freeaddrinfo);
+
+    int fd = ::socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      result->ai_protocol);
+    if (fd < 0) {
+        throw std::runtime_error(error_text("Failed to create reactor socket"));
+    }
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        std::string message = error_text("Failed to enable SO_REUSEPORT");
+        ::close(fd);
+        throw std::runtime_error(message);
+    }
+    if (::bind(fd, result->ai_addr, result->ai_addrlen) != 0 || ::listen(fd, kListenBacklog) != 0) {
+        std::string message = error_text("Failed to listen on reactor port " + std::to_string(port));
+        ::close(fd);
+        throw std::runtime_error(message);
+    }
+    try {
+        bound_port = socket_port(fd);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    return fd;
+}
+
+void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        Logger::warningf("Failed to pin reactor thread to CPU %d: %s", cpu, std::strerror(rc));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief 工作线程交回的响应，由循环线程追加到所属连接
+ */
+struct ReactorGroup::Completions {
+    Completions() : wake_fd(-1) {}
+
+    std::mutex mutex;
+    std::vector<std::pair<uint64_t, std::string>> replies;  // 连接ID与响应帧
+    int wake_fd;    // 循环未运行时为-1，此时交回的响应被丢弃
+};
+
+class ReactorGroup::SessionChannel : public ReplyChannel {
+public:
+    SessionChannel(std::shared_ptr<Completions> completions, uint64_t session)
+        : completions_(std::move(completions)), session_(session) {}
+
+    void post(const char* data, size_t size) override {
+        std::lock_guard<std::mutex> lock(completions_->mutex);
+        if (completions_->wake_fd < 0) {
+            return;
+        }
+        // 队列由空变为非空时才唤醒，循环取走整个队列后下一个响应会再次唤醒
+        bool idle = completions_->replies.empty();
+        completions_->replies.emplace_back(session_, std::string(data, size));
+        uint64_t one = 1;
+        if (idle && ::write(completions_->wake_fd, &one, sizeof(one)) < 0) {
+            Logger::warning(error_text("Failed to wake reactor thread"));
+        }
+    }
+
+private:
+    std::shared_ptr<Completions> completions_;
+    uint64_t session_;
+};
+
+struct ReactorGroup::Session {
+    Session(int session_fd, uint64_t session_id) : fd(session_fd), id(session_id), sent(0), events(EPOLLIN) {}
+
+    int fd;
+    uint64_t id;                // 在所属循环内唯一，交回的响应据此找到连接
+    std::shared_ptr<ReplyChannel> channel;
+    RPCLIB_MSGPACK::unpacker unpacker;
+    ScratchBuffer out;          // 待发送的响应，在所属循环的线程上创建，取自该线程的池
+    size_t sent;                // out中已发出的字节数
+    uint32_t events;            // 当前注册的epoll事件
+};
+
+struct ReactorGroup::Shard {
+    Shard() : cpu(-1), listen_fd(-1), epoll_fd(-1), wake_fd(-1),
+              completions(std::make_shared<Completions>()),
+              connections(0), accepted(0), requests(0) {}
+
+    ~Shard() {
+        close_fd(listen_fd);
+        close_fd(epoll_fd);
+        close_fd(wake_fd);
+    }
+
+    int cpu;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;
+    std::thread thread;
+    std::unordered_map<Session*, std::unique_ptr<Session>> sessions;   // 只由循环线程访问
+    std::unordered_map<uint64_t, Session*> session_ids;                // 只由循环线程访问
+    std::shared_ptr<Completions> completions;   // 由交出的响应出口共享，可能比Shard活得更久
+    std::atomic<uint64_t> connections;
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> requests;
+};
+
+ReactorGroup::ReactorGroup(const std::string& address, uint16_t port, const ReactorOptions& options,
+                           Handler handler, SessionClosed on_close, const std::vector<int>& inherited)
+    : address_(address), port_(port), options_(options), handler_(std::move(handler)),
+      on_close_(std::move(on_close)), running_(false), accepting_(true) {
+    std::vector<int> cpus = allowed_cpus();
+    size_t count = options_.threads > 0 ? options_.threads : cpus.size();
+    // 先接管全部套接字，构造中途失败时随shards_一起关闭；每个套接字都要有事件循环，
+    // 否则内核分给它的连接无人接受
+    count = std::max(count, inherited.size());
+    for (size_t i = 0; i < count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+        if (i < inherited.size()) {
+            shards_.back()->listen_fd = inherited[i];
+        }
+    }
+    if (!inherited.empty()) {
+        uint16_t inherited_port = socket_port(inherited.front());
+        if (port_ != 0 && port_ != inherited_port) {
+            throw std::runtime_error("Inherited reactor sockets listen on port " + std::to_string(inherited_port) +
+                                     ", not " + std::to_string(port_));
+        }
+        port_ = inherited_port;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        Shard* shard = shards_[i].get();
+        if (options_.pin_threads) {
+            shard->cpu = cpus[i % cpus.size()];
+        }
+        if (shard->listen_fd >= 0) {
+            int flags = fcntl(shard->listen_fd, F_GETFL, 0);
+            if (flags < 0 || fcntl(shard->listen_fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+                throw std::runtime_error(error_text("Failed to configure inherited reactor socket"));
+            }
+        } else {
+            // 端口为0时第一个套接字由系统分配端口，其余复用该端口
+            shard->listen_fd = open_listener(address_, port_, port_);
+        }
+        shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (shard->epoll_fd < 0) {
+            throw std::runtime_error(error_text("Failed to create epoll instance"));
+        }
+        shard->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (shard->wake_fd < 0) {
+            throw std::runtime_error(error_text("Failed to create eventfd"));
+        }
+        // 监听套接字与唤醒fd以空指针和Shard指针区分，会话以Session指针区分
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->listen_fd, &event) != 0) {
+            throw std::runtime_error(error_text("Failed to watch reactor socket"));
+        }
+        event.data.ptr = shard;
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->wake_fd, &event) != 0) {
+            throw std::runtime_error(error_text("Failed to watch eventfd"));
+        }
+    }
+}
+
+ReactorGroup::~ReactorGroup() {
+    stop();
+}
+
+void ReactorGroup::start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    for (auto& shard : shards_) {
+        uint64_t drain = 0;
+        while (::read(shard->wake_fd, &drain, sizeof(drain)) > 0) {
+        }
+        {
+            std::lock_guard<std::mutex> lock(shard->completions->mutex);
+            shard->completions->wake_fd = shard->wake_fd;
+        }
+        Shard* raw = shard.get();
+        shard->thread = std::thread([this, raw]() { run_shard(raw); });
+    }
+}
+
+void ReactorGroup::stop() {
+    bool expected = true;
+    if (!running_.compare_exchange_strong(expected, false)) {
+        return;
+    }
+    for (auto& shard : shards_) {
+        uint64_t one = 1;
+        if (::write(shard->wake_fd, &one, sizeof(one)) < 0) {
+            Logger::warning(error_text("Failed to wake reactor thread"));
+        }
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+        // 连接都已关闭，仍在线程池中执行的请求完成后不再有人发送其响应
+        std::lock_guard<std::mutex> lock(shard->completions->mutex);
+        shard->completions->wake_fd = -1;
+        shard->completions->replies.clear();
+    }
+}
+
+void ReactorGroup::stop_accepting() {
+    accepting_.store(false, std::memory_order_release);
+    if (!running_.load(std::memory_order_acquire)) {
+        for (auto& shard : shards_) {
+            close_listener(shard.get());
+        }
+        return;
+    }
+    // 监听套接字只由所属循环访问，唤醒后由循环自己关闭
+    for (auto& shard : shards_) {
+        uint64_t one = 1;
+        if (::write(shard->wake_fd, &one, sizeof(one)) < 0) {
+            Logger::warning(error_text("Failed to wake reactor thread"));
+        }
+    }
+}
+
+std::vector<int> ReactorGroup::listen_fds() const {
+    std::vector<int> fds;
+    for (const auto& shard : shards_) {
+        if (shard->listen_fd >= 0) {
+            fds.push_back(shard->listen_fd);
+        }
+    }
+    return fds;
+}
+
+std::vector<ReactorStats> ReactorGroup::stats() const {
+    std::vector<ReactorStats> result;
+    result.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        ReactorStats stats;
+        stats.cpu = shard->cpu;
+        stats.connections = shard->connections.load(std::memory_order_relaxed);
+        stats.accepted = shard->accepted.load(std::memory_order_relaxed);
+        stats.requests = shard->requests.load(std::memory_order_relaxed);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void ReactorGroup::run_shard(Shard* shard) {
+    if (shard->cpu >= 0) {
+        pin_to_cpu(shard->cpu);
+    }
+    epoll_event events[kMaxEvents];
+    while (running_.load(std::memory_order_acquire)) {
+        int count = epoll_wait(shard->epoll_fd, events, kMaxEvents, -1);
+        count_io(IoCounter::wait_calls);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::error(error_text("Reactor epoll_wait failed"));
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == nullptr) {
+                accept_all(shard);
+                continue;
+            }
+            if (tag == shard) {
+                // 唤醒：发送线程池交回的响应；停止接受连接时关闭监听套接字，
+                // 停止时回到循环开头检查running_
+                uint64_t drain = 0;
+                while (::read(shard->wake_fd, &drain, sizeof(drain)) > 0) {
+                }
+                if (!accepting_.load(std::memory_order_acquire)) {
+                    close_listener(shard);
+                }
+                deliver_replies(shard);
+                continue;
+            }
+            Session* session = static_cast<Session*>(tag);
+            uint32_t ready = events[i].events;
+            bool alive = true;
+            if (ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = read_session(shard, session);
+            }
+            if (alive && (ready & EPOLLOUT)) {
+                alive = flush_session(shard, session);
+            }
+            if (!alive) {
+                close_session(shard, session);
+            }
+        }
+    }
+    // 连接只由本线程访问，在这里关闭，ScratchBuffer也归还到本线程的池
+    while (!shard->sessions.empty()) {
+        close_session(shard, shard->sessions.begin()->first);
+    }
+}
+
+void ReactorGroup::accept_all(Shard* shard) {
+    for (;;) {
+        int fd = accept4(shard->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Logger::warning(error_text("Reactor accept failed"));
+            }
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::unique_ptr<Session> session = std::make_unique<Session>(fd, new_session_id());
+        session->channel = std::make_shared<SessionChannel>(shard->completions, session->id);
+        epoll_event event;
+        event.events = session->events;
+        event.data.ptr = session.get();
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            Logger::warning(error_text("Failed to watch reactor connection"));
+            ::close(fd);
+            continue;
+        }
+        Session* key = session.get();
+        shard->session_ids.emplace(key->id, key);
+        shard->sessions.emplace(key, std::move(session));
+        shard->connections.fetch_add(1, std::memory_order_relaxed);
+        shard->accepted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ReactorGroup::read_session(Shard* shard, Session* session) {
+    // 读满缓冲区说明内核中可能还有数据，接着读，不必先回到epoll_wait；
+    // 这些读取中的所有请求处理完后响应一起发送
+    for (int reads = 0; reads < kMaxReadsPerEvent; ++reads) {
+        session->unpacker.reserve_buffer(kReadSize);
+        size_t capacity = session->unpacker.buffer_capacity();
+        ssize_t n = ::read(session->fd, session->unpacker.buffer(), capacity);
+        count_io(IoCounter::read_calls);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                return false;
+            }
+            break;
+        }
+        session->unpacker.buffer_consumed(static_cast<size_t>(n));
+        if (!handle_requests(shard, session)) {
+            return false;
+        }
+        if (session->unpacker.nonparsed_size() > kMaxFrameSize) {
+            Logger::warningf("Closing reactor connection after a request larger than %zu bytes", kMaxFrameSize);
+            return false;
+        }
+        if (static_cast<size_t>(n) < capacity) {
+            break;
+        }
+    }
+    return flush_session(shard, session);
+}
+
+bool ReactorGroup::handle_requests(Shard* shard, Session* session) {
+    RPCLIB_MSGPACK::object_handle request;
+    uint64_t frames_in = 0;
+    uint64_t frames_out = 0;
+    bool valid = true;
+    // 同一次读取中的请求共用到达时间，截止时间与延迟统计从这里起算
+    RequestOrigin origin;
+    origin.session = session->id;
+    origin.arrival = RequestContext::Clock::now();
+    OriginScope scope(origin);
+    try {
+        while (session->unpacker.next(request)) {
+            ++frames_in;
+            if (handler_(request.get(), session->out, session->channel)) {
+                ++frames_out;
+            }
+        }
+    } catch (const std::exception& e) {
+        Logger::warningf("Closing reactor connection after malformed request: %s", e.what());
+        valid = false;
+    }
+    shard->requests.fetch_add(frames_in, std::memory_order_relaxed);
+    count_io(IoCounter::frames_in, frames_in);
+    count_io(IoCounter::frames_out, frames_out);
+    return valid;
+}
+
+void ReactorGroup::deliver_replies(Shard* shard) {
+    std::vector<std::pair<uint64_t, std::string>> replies;
+    {
+        std::lock_guard<std::mutex> lock(shard->completions->mutex);
+        replies.swap(shard->completions->replies);
+    }
+    if (replies.empty()) {
+        return;
+    }
+
+    std::vector<Session*> touched;
+    for (const auto& reply : replies) {
+        auto it = shard->session_ids.find(reply.first);
+        if (it == shard->session_ids.end()) {
+            // 连接在请求执行期间已关闭
+            continue;
+        }
+        it->second->out.write(reply.second.data(), reply.second.size());
+        touched.push_back(it->second);
+    }
+    count_io(IoCounter::frames_out, touched.size());
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (Session* session : touched) {
+        if (!flush_session(shard, session)) {
+            // 同一批事件中可能还有该连接的事件，不能在这里释放；关闭读写两端，
+            // 由随后的EPOLLHUP事件照常关闭连接
+            ::shutdown(session->fd, SHUT_RDWR);
+        }
+    }
+}
+
+bool ReactorGroup::flush_session(Shard* shard, Session* session) {
+    while (session->sent < session->out.size()) {
+        ssize_t n = ::send(session->fd, session->out.data() + session->sent,
+                           session->out.size() - session->sent, MSG_NOSIGNAL);
+        count_io(IoCounter::write_calls);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        session->sent += static_cast<size_t>(n);
+    }
+    size_t pending = session->out.size() - session->sent;
+    if (pending == 0) {
+        session->out.clear();
+        session->sent = 0;
+    }
+
+    // 有未发出的数据时等待可写；积压过多时暂停读取，由对端的TCP窗口施加背压
+    uint32_t events = 0;
+    if (pending < kMaxPendingOutput) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != session->events) {
+        epoll_event event;
+        event.events = events;
+        event.data.ptr = session;
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_MOD, session->fd, &event) != 0) {
+            return false;
+        }
+        session->events = events;
+    }
+    return true;
+}
+
+void ReactorGroup::close_listener(Shard* shard) {
+    if (shard->listen_fd < 0) {
+        return;
+    }
+    epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, shard->listen_fd, nullptr);
+    ::close(shard->listen_fd);
+    shard->listen_fd = -1;
+}
+
+void ReactorGroup::close_session(Shard* shard, Session* session) {
+    shard->connections.fetch_sub(1, std::memory_order_relaxed);
+    epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, session->fd, nullptr);
+    ::close(session->fd);
+    shard->session_ids.erase(session->id);
+    uint64_t id = session->id;
+    shard->sessions.erase(session);
+    if (on_close_) {
+        on_close_(id);
+    }
+}
+
+#else
+
+struct ReactorGroup::Session {};
+struct ReactorGroup::Shard {};
+
+ReactorGroup::ReactorGroup(const std::string& address, uint16_t port, const ReactorOptions& options,
+                           Handler handler, SessionClosed on_close, const std::vector<int>& inherited)
+    : address_(address), port_(port), options_(options), handler_(std::move(handler)),
+      on_close_(std::move(on_close)), running_(false), accepting_(true) {
+    for (int fd : inherited) {
+        ::close(fd);
+    }
+    throw std::runtime_error("Reactor mode requires Linux (epoll and SO_REUSEPORT)");
+}
+
+ReactorGroup::~ReactorGroup() {}
+
+void ReactorGroup::start() {}
+
+void ReactorGroup::stop() {}
+
+void ReactorGroup::stop_accepting() {}
+
+std::vector<int> ReactorGroup::listen_fds() const {
+    return std::vector<int>();
+}
+
+std::vector<ReactorStats> ReactorGroup::stats() const {
+    return std::vector<ReactorStats>();
+}
+
+#endif
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -1,25 +1,62 @@
 #include "rpc_server_wrapper.h"
+#include "rpc_utils.h"
+#include "rpc/this_handler.h"
 #include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unistd.h>
 
 namespace rpc_utils {
 
+namespace {
+
+// 执行多事件循环端口与同主机端点上会阻塞的请求的线程池
+const char* const kBlockingPoolName = "__blocking";
+const size_t kMinBlockingThreads = 8;
+const size_t kBlockingQueueLimit = 4096;
+
+// 并行执行批量调用的线程池
+const char* const kBatchPoolName = "__batch";
+const size_t kBatchQueuePerThread = 4;
+
+/**
+ * @brief 打包错误响应：[1, id, error, nil]
+ */
+template<typename E>
+void pack_reply(detail::ScratchBuffer& reply, uint32_t id, const E& error) {
+    RPCLIB_MSGPACK::packer<detail::ScratchBuffer> packer(reply);
+    packer.pack_array(4);
+    packer.pack(static_cast<uint8_t>(1));
+    packer.pack(id);
+    packer.pack(error);
+    packer.pack_nil();
+}
+
+} // namespace
+
 RPCServerWrapper::RPCServerWrapper(uint16_t port)
-    : port_(port), is_running_(false) {
+    : blocking_pool_(nullptr), batch_parallelism_(0), batch_pool_(nullptr), is_running_(false),
+      expired_requests_(0), trust_client_clock_(false), port_(port), handoff_control_fd_(-1) {
     try {
         server_ = std::make_unique<rpc::server>(port);
         // 默认启用异常抑制，这样服务器不会因为处理函数的异常而崩溃
         server_->suppress_exceptions(true);
+        register_builtin_methods();
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to create RPC server: " + std::string(e.what()));
     }
 }
 
 RPCServerWrapper::RPCServerWrapper(const std::string& address, uint16_t port)
-    : address_(address), port_(port), is_running_(false) {
+    : blocking_pool_(nullptr), batch_parallelism_(0), batch_pool_(nullptr), is_running_(false),
+      expired_requests_(0), trust_client_clock_(false), address_(address), port_(port), handoff_control_fd_(-1) {
     try {
         server_ = std::make_unique<rpc::server>(address, port);
         // 默认启用异常抑制
         server_->suppress_exceptions(true);
+        register_builtin_methods();
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to create RPC server: " + std::string(e.what()));
     }
@@ -29,26 +66,774 @@ RPCServerWrapper::~RPCServerWrapper() {
     if (is_running_) {
         stop();
     }
+    stop_handoff();
+    // 未开始运行就退出：关闭接管的套接字，旧进程收不到确认会继续服务
+    for (const auto& socket : inherited_) {
+        ::close(socket.fd);
+    }
+    if (handoff_control_fd_ >= 0) {
+        ::close(handoff_control_fd_);
+    }
+    streams_.cancel_all();
+    // 线程池中排队的请求还会用到统计、限制器等后声明的成员，先执行完并退出
+    offload_pools_.clear();
+}
+
+void RPCServerWrapper::listen(const std::string& endpoint) {
+    detail::TransportAddress address = detail::TransportAddress::parse(endpoint);
+    if (address.kind == detail::TransportKind::tcp) {
+        throw std::invalid_argument("TCP endpoint is set by the constructor: " + endpoint);
+    }
+    create_blocking_pool();
+    std::vector<int> inherited = take_inherited(address.to_string());
+    for (size_t i = 1; i < inherited.size(); ++i) {
+        ::close(inherited[i]);
+    }
+    local_listeners_.push_back(std::make_unique<detail::LocalListener>(
+        address, [this](const char* data, size_t size, detail::ScratchBuffer& reply,
+                        const std::shared_ptr<detail::ReplyChannel>& channel) {
+            return handle_local_frame(data, size, reply, channel);
+        }, [this](uint64_t session) {
+            streams_.cancel_session(session);
+        }, coalesce_, inherited.empty() ? -1 : inherited.front()));
+    if (is_running_) {
+        local_listeners_.back()->start();
+    }
+}
+
+void RPCServerWrapper::set_write_coalescing(const CoalesceOptions& options) {
+    coalesce_ = options;
+}
+
+void RPCServerWrapper::listen_reactors(const std::string& address, uint16_t port,
+                                       const ReactorOptions& options) {
+    if (reactors_) {
+        throw std::runtime_error("Reactor mode is already enabled on port " + std::to_string(reactors_->port()));
+    }
+    create_blocking_pool();
+    reactors_ = std::make_unique<detail::ReactorGroup>(
+        address, port, options, [this](const RPCLIB_MSGPACK::object& request, detail::ScratchBuffer& reply,
+                                       const std::shared_ptr<detail::ReplyChannel>& channel) {
+            return handle_request(request, reply, channel);
+        }, [this](uint64_t session) {
+            streams_.cancel_session(session);
+        }, take_inherited(detail::kReactorSocketKey));
+    if (is_running_) {
+        reactors_->start();
+    }
+}
+
+uint16_t RPCServerWrapper::reactor_port() const {
+    return reactors_ ? reactors_->port() : 0;
+}
+
+std::vector<ReactorStats> RPCServerWrapper::reactor_stats() const {
+    return reactors_ ? reactors_->stats() : std::vector<ReactorStats>();
+}
+
+void RPCServerWrapper::start_listeners() {
+    if (!offloaded_methods_.empty() && !reactors_ && local_listeners_.empty()) {
+        Logger::warningf("%zu offloaded methods run on rpclib I/O threads: "
+                         "offloading needs listen_reactors or listen", offloaded_methods_.size());
+    }
+    for (auto& listener : local_listeners_) {
+        listener->start();
+    }
+    if (reactors_) {
+        reactors_->start();
+    }
+    if (handoff_control_fd_ < 0) {
+        return;
+    }
+    for (const auto& socket : inherited_) {
+        Logger::warningf("Closing inherited listening socket %s: no matching listen call", socket.key.c_str());
+        ::close(socket.fd);
+    }
+    inherited_.clear();
+    detail::confirm_handoff(handoff_control_fd_);
+    handoff_control_fd_ = -1;
+}
+
+void RPCServerWrapper::stop_accepting() {
+    stop_handoff();
+    for (auto& listener : local_listeners_) {
+        listener->stop_accepting();
+    }
+    if (reactors_) {
+        reactors_->stop_accepting();
+    }
+}
+
+void RPCServerWrapper::stop_handoff() {
+    if (!handoff_) {
+        return;
+    }
+    // 先停止交接线程，之后才能关闭它可能正在发送的监听套接字
+    handoff_->stop();
+    if (handoff_->handed_off()) {
+        for (auto& listener : local_listeners_) {
+            listener->release_path();
+        }
+    }
+}
+
+std::vector<detail::InheritedSocket> RPCServerWrapper::handoff_sockets() const {
+    std::vector<detail::InheritedSocket> sockets;
+    if (reactors_) {
+        for (int fd : reactors_->listen_fds()) {
+            detail::InheritedSocket socket;
+            socket.key = detail::kReactorSocketKey;
+            socket.fd = fd;
+            sockets.push_back(socket);
+        }
+    }
+    for (const auto& listener : local_listeners_) {
+        if (listener->listen_fd() >= 0) {
+            detail::InheritedSocket socket;
+            socket.key = listener->address().to_string();
+            socket.fd = listener->listen_fd();
+            sockets.push_back(socket);
+        }
+    }
+    return sockets;
+}
+
+std::vector<int> RPCServerWrapper::take_inherited(const std::string& key) {
+    std::vector<int> fds;
+    for (auto it = inherited_.begin(); it != inherited_.end();) {
+        if (it->key == key) {
+            fds.push_back(it->fd);
+            it = inherited_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return fds;
+}
+
+void RPCServerWrapper::enable_handoff(const std::string& path) {
+    if (handoff_) {
+        throw std::runtime_error("Listener handoff is already enabled");
+    }
+    handoff_ = std::make_unique<detail::HandoffListener>(path, [this]() {
+        return handoff_sockets();
+    });
+}
+
+bool RPCServerWrapper::wait_handoff(std::chrono::milliseconds timeout) {
+    if (!handoff_) {
+        throw std::runtime_error("Listener handoff is not enabled");
+    }
+    return handoff_->wait(timeout);
+}
+
+size_t RPCServerWrapper::take_over(const std::string& path, std::chrono::milliseconds timeout) {
+    if (handoff_control_fd_ >= 0 || is_running_) {
+        throw std::runtime_error("take_over must be called once, before the server starts");
+    }
+    inherited_ = detail::receive_listeners(path, timeout, handoff_control_fd_);
+    Logger::infof("Received %zu listening sockets through %s", inherited_.size(), path.c_str());
+    return inherited_.size();
 }
 
 void RPCServerWrapper::run() {
+    seed_limiters(1);
     is_running_ = true;
+    start_listeners();
     server_->run();
     is_running_ = false;
 }
 
 void RPCServerWrapper::async_run(size_t worker_threads) {
+    seed_limiters(worker_threads);
     is_running_ = true;
+    start_listeners();
     server_->async_run(worker_threads);
 }
 
+bool RPCServerWrapper::drain(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    gate_.close();
+    stop_accepting();
+
+    // 执行中的请求不多且很快结束，轮询即可，不给每次调用增加通知开销
+    bool idle = false;
+    for (;;) {
+        idle = gate_.in_flight() == 0 && streams_.size() == 0;
+        if (idle || std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!idle) {
+        Logger::warningf("Drain timed out with %zu requests in flight and %zu open streams",
+                         gate_.in_flight(), streams_.size());
+    }
+    if (is_running_) {
+        // 先关闭连接，使客户端立即看到断开并重新建连
+        server_->close_sessions();
+    }
+    stop();
+    return idle;
+}
+
+bool RPCServerWrapper::draining() const {
+    return gate_.draining();
+}
+
 void RPCServerWrapper::stop() {
+    stop_handoff();
     if (is_running_) {
         server_->stop();
+        for (auto& listener : local_listeners_) {
+            listener->stop();
+        }
+        if (reactors_) {
+            reactors_->stop();
+        }
         is_running_ = false;
     }
 }
 
+void RPCServerWrapper::enable_stats() {
+    if (stats_) {
+        return;
+    }
+    stats_ = std::make_unique<StatsRegistry>();
+    install_handler("__stats", [this]() {
+        return stats_->snapshot();
+    });
+    install_handler("__cache_stats", [this]() {
+        return cache_stats();
+    });
+    install_handler("__limit_stats", [this]() {
+        return limiter_stats();
+    });
+    install_handler("__compression_stats", [this]() {
+        return compression_stats();
+    });
+    install_handler("__pool_stats", []() {
+        return pool_stats();
+    });
+    install_handler("__reactor_stats", [this]() {
+        return reactor_stats();
+    });
+    install_handler("__io_stats", []() {
+        return io_stats();
+    });
+}
+
+void RPCServerWrapper::enable_concurrency_limit(const LimiterOptions& options) {
+    limiter_ = std::make_shared<ConcurrencyLimiter>(options);
+}
+
+void RPCServerWrapper::set_method_limit(const std::string& name, size_t max_in_flight) {
+    LimiterOptions options;
+    options.initial_limit = max_in_flight;
+    options.min_limit = max_in_flight;
+    options.max_limit = max_in_flight;
+    set_method_limit(name, options);
+}
+
+void RPCServerWrapper::set_method_limit(const std::string& name, const LimiterOptions& options) {
+    method_limiters_[name] = std::make_shared<ConcurrencyLimiter>(options);
+}
+
+std::shared_ptr<ConcurrencyLimiter> RPCServerWrapper::method_limiter(const std::string& name) const {
+    auto it = method_limiters_.find(name);
+    return it == method_limiters_.end() ? nullptr : it->second;
+}
+
+void RPCServerWrapper::seed_limiters(size_t worker_threads) {
+    // 直接执行处理函数的线程：rpclib工作线程与事件循环线程
+    size_t inline_threads = std::max<size_t>(1, worker_threads) + (reactors_ ? reactors_->stats().size() : 0);
+    // 卸载线程池只服务多事件循环端口与同主机端点，rpclib端口上的卸载方法在I/O线程上执行
+    bool offloading = reactors_ || !local_listeners_.empty();
+    size_t offloaded_threads = 0;
+    if (offloading) {
+        for (const auto& entry : offload_pools_) {
+            if (entry.first != kBlockingPoolName && entry.first != kBatchPoolName) {
+                offloaded_threads += entry.second->threads();
+            }
+        }
+    }
+    if (limiter_) {
+        limiter_->seed(inline_threads + offloaded_threads);
+    }
+    for (const auto& entry : method_limiters_) {
+        auto offloaded = offloaded_methods_.find(entry.first);
+        entry.second->seed(offloading && offloaded != offloaded_methods_.end() ? offloaded->second->threads()
+                                                                               : inline_threads);
+    }
+}
+
+std::map<std::string, LimiterStats> RPCServerWrapper::limiter_stats() const {
+    std::map<std::string, LimiterStats> result;
+    if (limiter_) {
+        result["*"] = limiter_->stats();
+    }
+    for (const auto& entry : method_limiters_) {
+        result[entry.first] = entry.second->stats();
+    }
+    return result;
+}
+
+std::map<std::string, MethodStatsSnapshot> RPCServerWrapper::stats() const {
+    if (!stats_) {
+        return {};
+    }
+    return stats_->snapshot();
+}
+
+std::map<std::string, CacheStats> RPCServerWrapper::cache_stats() const {
+    std::map<std::string, CacheStats> result;
+    for (const auto& entry : caches_) {
+        result[entry.first] = entry.second->stats();
+    }
+    for (const auto& entry : flights_) {
+        CacheStats& stats = result[entry.first];
+        stats.coalesced = entry.second->coalesced();
+        if (caches_.count(entry.first) == 0) {
+            stats.misses = entry.second->executions();
+        }
+    }
+    return result;
+}
+
+void RPCServerWrapper::clear_cache(const std::string& name) {
+    auto it = caches_.find(name);
+    if (it == caches_.end()) {
+        throw std::runtime_error("Function '" + name + "' is not bound with a cache");
+    }
+    it->second->clear();
+}
+
+void RPCServerWrapper::set_batch_parallelism(size_t max_threads) {
+    batch_parallelism_ = max_threads;
+}
+
+WorkStealingPool* RPCServerWrapper::offload_pool(const ExecutorOptions& options) {
+    auto& pool = offload_pools_[options.name];
+    if (!pool) {
+        pool = std::make_unique<WorkStealingPool>(options);
+    }
+    return pool.get();
+}
+
+void RPCServerWrapper::create_blocking_pool() {
+    if (blocking_pool_ != nullptr) {
+        return;
+    }
+    // 流式保留方法每次最多等待100ms，线程数按同时等待的请求数而不是CPU数设置
+    ExecutorOptions options;
+    options.name = kBlockingPoolName;
+    options.threads = std::max<size_t>(kMinBlockingThreads, 2 * std::thread::hardware_concurrency());
+    options.queue_limit = kBlockingQueueLimit;
+    blocking_pool_ = offload_pool(options);
+}
+
+WorkStealingPool* RPCServerWrapper::dispatch_pool(const std::string& name,
+                                                  const RPCLIB_MSGPACK::object& args) const {
+    auto offloaded = offloaded_methods_.find(name);
+    if (offloaded != offloaded_methods_.end()) {
+        return offloaded->second;
+    }
+    if (blocking_methods_.count(name) > 0) {
+        return blocking_pool_;
+    }
+    if (name.compare(0, 2, "__") != 0) {
+        return nullptr;
+    }
+
+    // 信封按内层方法判断
+    const RPCLIB_MSGPACK::object* items = args.type == RPCLIB_MSGPACK::type::ARRAY ? args.via.array.ptr : nullptr;
+    uint32_t count = items != nullptr ? args.via.array.size : 0;
+    if (name == detail::kContextMethod) {
+        return count == 3 && items[1].type == RPCLIB_MSGPACK::type::STR
+            ? dispatch_pool(items[1].as<std::string>(), items[2])
+            : nullptr;
+    }
+    if (name == detail::kCompressedMethod) {
+        if (count != 1 || items[0].type != RPCLIB_MSGPACK::type::ARRAY || items[0].via.array.size == 0 ||
+            items[0].via.array.ptr[0].type != RPCLIB_MSGPACK::type::STR) {
+            return nullptr;
+        }
+        // 压缩的参数在这里无法查看，内层为批量调用时按需要等待处理
+        std::string method = items[0].via.array.ptr[0].as<std::string>();
+        return method == detail::kBatchMethod ? blocking_pool_ : dispatch_pool(method, RPCLIB_MSGPACK::object());
+    }
+    if (name == detail::kBatchMethod) {
+        // 并行批量等待其他线程执行各项；顺序批量中有需要交出的方法时整批交出
+        if (count == 2 && items[1].type == RPCLIB_MSGPACK::type::BOOLEAN && items[1].via.boolean) {
+            return blocking_pool_;
+        }
+        if (count == 0 || items[0].type != RPCLIB_MSGPACK::type::ARRAY) {
+            return nullptr;
+        }
+        const RPCLIB_MSGPACK::object_array& batch = items[0].via.array;
+        for (uint32_t i = 0; i < batch.size; ++i) {
+            const RPCLIB_MSGPACK::object& item = batch.ptr[i];
+            if (item.type == RPCLIB_MSGPACK::type::ARRAY && item.via.array.size == 2 &&
+                item.via.array.ptr[0].type == RPCLIB_MSGPACK::type::STR &&
+                dispatch_pool(item.via.array.ptr[0].as<std::string>(), item.via.array.ptr[1]) != nullptr) {
+                return blocking_pool_;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool RPCServerWrapper::defer_request(WorkStealingPool* pool, const RPCLIB_MSGPACK::object& request,
+                                     const std::shared_ptr<detail::ReplyChannel>& channel) {
+    // 请求对象引用连接的接收缓冲区，交给其他线程前深拷贝；排队期间计入执行中的请求，drain会等待它
+    auto copy = std::make_shared<RPCLIB_MSGPACK::object_handle>(RPCLIB_MSGPACK::clone(request));
+    detail::RequestOrigin origin = detail::current_origin();
+    gate_.hold();
+    bool accepted = pool->try_submit([this, copy, channel, origin]() {
+        // 保留到达时间，截止时间与延迟统计都计入在线程池中排队的时间
+        detail::OriginScope scope(origin);
+        detail::ScratchBuffer reply;
+        try {
+            if (handle_request(copy->get(), reply, nullptr)) {
+                channel->post(reply.data(), reply.size());
+            }
+        } catch (const std::exception& e) {
+            Logger::warningf("Deferred request failed: %s", e.what());
+        }
+        gate_.leave();
+    });
+    if (!accepted) {
+        gate_.leave();
+    }
+    return accepted;
+}
+
+void RPCServerWrapper::register_method(const std::string& name, detail::RawMethod method) {
+    uint64_t id = detail::method_id(name);
+    auto existing = method_ids_.find(id);
+    if (existing != method_ids_.end() && existing->second->first != name) {
+        throw std::runtime_error("Method id of '" + name + "' collides with '" +
+                                 existing->second->first + "'");
+    }
+    auto it = methods_.find(name);
+    if (it == methods_.end()) {
+        it = methods_.emplace(name, std::move(method)).first;
+    } else {
+        it->second = std::move(method);
+    }
+    method_ids_[id] = &*it;
+}
+
+const detail::RawMethod* RPCServerWrapper::find_method(const std::string& name) const {
+    auto it = methods_.find(name);
+    return it == methods_.end() ? nullptr : &it->second;
+}
+
+const RPCServerWrapper::MethodEntry* RPCServerWrapper::find_method_by_id(uint64_t id) const {
+    auto it = method_ids_.find(id);
+    return it == method_ids_.end() ? nullptr : it->second;
+}
+
+void RPCServerWrapper::register_builtin_methods() {
+    // 同时登记到内部方法表，同主机传输与多事件循环端口上也可以调用
+    install_handler(detail::kBatchMethod,
+        [this](const std::vector<detail::BatchRequestItem>& items, bool parallel) {
+            return run_batch(items, parallel);
+        });
+
+    install_handler(detail::kContextMethod,
+        [this](const detail::WireContext& wire, const std::string& name,
+               const RPCLIB_MSGPACK::object& args) {
+            return dispatch_with_context(wire, name, args);
+        });
+
+    install_handler(detail::kCompressedMethod, [this](const detail::CompressedRequest& request) {
+        return dispatch_compressed(request);
+    });
+
+    install_handler(detail::kStreamNextMethod, [this](uint64_t id) {
+        return streams_.next(id);
+    });
+    install_handler(detail::kStreamPushMethod,
+        [this](uint64_t id, const BinaryView& data, uint32_t count) {
+            return streams_.push(id, data, count);
+        });
+    install_handler(detail::kStreamFinishMethod, [this](uint64_t id) {
+        return streams_.finish(id);
+    });
+    install_handler(detail::kStreamCancelMethod, [this](uint64_t id) {
+        streams_.cancel(id);
+    });
+}
+
+RequestContext RPCServerWrapper::accept_context(const detail::WireContext& wire, const std::string& name) {
+    // 多事件循环端口与同主机端点在读到请求时记下到达时间；rpclib端口的请求在其内部排队，
+    // 只能从处理函数开始时起算，此前的排队耗时由按客户端的时钟差估计扣除
+    const detail::RequestOrigin& origin = detail::current_origin();
+    RequestContext context = detail::make_request_context(
+        wire, origin.has_arrival() ? origin.arrival : RequestContext::Clock::now(),
+        &clock_offsets_, trust_client_clock_);
+    if (context.expired()) {
+        // 调用方已经放弃等待，不再执行
+        expired_requests_.fetch_add(1, std::memory_order_relaxed);
+        detail::respond_error_info(kDeadlineExceededErrorCode,
+                                   "request for '" + name + "' expired before dispatch");
+    }
+    return context;
+}
+
+const detail::RawMethod& RPCServerWrapper::require_method(const std::string& name) const {
+    const detail::RawMethod* method = find_method(name);
+    if (method == nullptr) {
+        throw std::runtime_error("Function '" + name + "' is not bound");
+    }
+    return *method;
+}
+
+detail::SharedObject RPCServerWrapper::dispatch_with_context(const detail::WireContext& wire,
+                                                            const std::string& name,
+                                                            const RPCLIB_MSGPACK::object& args) {
+    RequestContext context = accept_context(wire, name);
+    const detail::RawMethod& method = require_method(name);
+
+    ContextScope scope(context);
+    TraceSpan span(name, SpanKind::server);
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone = detail::acquire_zone();
+    RPCLIB_MSGPACK::object result = method(args, *zone);
+    return detail::make_shared_object(result, std::move(zone));
+}
+
+detail::SharedObject RPCServerWrapper::dispatch_compressed(const detail::CompressedRequest& request) {
+    RequestContext context = accept_context(request.context, request.method);
+    const detail::RawMethod& method = require_method(request.method);
+    compression_counters_.record_request(request.args);
+
+    // 参数解压到线程内复用的缓冲区，解包结果引用其中的数据，处理函数返回前保持有效
+    detail::ScratchBuffer scratch;
+    std::unique_ptr<RPCLIB_MSGPACK::zone> zone = detail::acquire_zone();
+    RPCLIB_MSGPACK::object args = detail::open_payload(request.args, scratch, *zone);
+
+    ContextScope scope(context);
+    TraceSpan span(request.method, SpanKind::server);
+    RPCLIB_MSGPACK::object result = method(args, *zone);
+    return detail::make_compressed_reply(request, result, std::move(zone), compression_counters_);
+}
+
+detail::BatchReply RPCServerWrapper::run_batch(const std::vector<detail::BatchRequestItem>& items,
+                                               bool parallel) {
+    detail::BatchReply reply;
+    reply.items.resize(items.size());
+
+    size_t threads = batch_parallelism_ > 0
+        ? batch_parallelism_
+        : std::max<size_t>(1, std::thread::hardware_concurrency());
+    threads = std::min(threads, items.size());
+
+    // 嵌套在批量线程池中的批量调用依次执行，避免等待排在自己之后的辅助任务
+    WorkStealingPool* pool = parallel && threads > 1 ? batch_pool() : nullptr;
+    if (pool == nullptr || WorkStealingPool::current() == pool) {
+        auto zone = std::make_shared<RPCLIB_MSGPACK::zone>();
+        for (size_t i = 0; i < items.size(); ++i) {
+            run_batch_item(items[i], *zone, reply.items[i]);
+        }
+        reply.zones.push_back(std::move(zone));
+        return reply;
+    }
+
+    // 并行执行：每个线程使用独立的内存区，按原子序号领取调用项
+    std::atomic<size_t> next(0);
+    reply.zones.resize(threads);
+    auto worker = [&](size_t slot) {
+        reply.zones[slot] = std::make_shared<RPCLIB_MSGPACK::zone>();
+        for (size_t i = next.fetch_add(1); i < items.size(); i = next.fetch_add(1)) {
+            run_batch_item(items[i], *reply.zones[slot], reply.items[i]);
+        }
+    };
+
+    // 辅助任务在批量线程池中继承本请求的上下文与来源（流ID按来源的连接校验）
+    RequestContext context = RequestContext::current();
+    detail::RequestOrigin origin = detail::current_origin();
+    origin.session = detail::current_session();
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t running = 0;
+    for (size_t slot = 1; slot < threads; ++slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++running;
+        }
+        bool accepted = pool->try_submit([&, slot]() {
+            ContextScope context_scope(context);
+            detail::OriginScope origin_scope(origin);
+            worker(slot);
+            // 在锁内通知：发起线程拿到锁之前不会返回，局部变量在此之前一直有效
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) {
+                finished.notify_all();
+            }
+        });
+        if (!accepted) {
+            // 线程池繁忙：剩余调用项由已经开始的线程领取
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            break;
+        }
+    }
+    worker(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&running] { return running == 0; });
+    return reply;
+}
+
+WorkStealingPool* RPCServerWrapper::batch_pool() {
+    std::call_once(batch_pool_once_, [this]() {
+        ExecutorOptions options;
+        options.name = kBatchPoolName;
+        options.threads = batch_parallelism_ > 0
+            ? batch_parallelism_
+            : std::max<size_t>(1, std::thread::hardware_concurrency());
+        options.queue_limit = options.threads * kBatchQueuePerThread;
+        batch_pool_ = offload_pool(options);
+    });
+    return batch_pool_;
+}
+
+void RPCServerWrapper::run_batch_item(const detail::BatchRequestItem& item,
+                                      RPCLIB_MSGPACK::zone& zone,
+                                      detail::BatchResultItem& result) const {
+    const detail::RawMethod* method = find_method(item.method);
+    if (method == nullptr) {
+        result.ok = false;
+        result.error = "Function '" + item.method + "' is not bound";
+        return;
+    }
+
+    ErrorInfo info;
+    detail::take_responded_error(info);     // 丢弃之前遗留的错误，以免附加到本项上
+    try {
+        result.value = (*method)(item.args, zone);
+        result.ok = true;
+    } catch (const std::exception& e) {
+        result.ok = false;
+        result.error = "Function '" + item.method + "' threw an exception: " + e.what();
+    } catch (...) {
+        result.ok = false;
+        result.error = "Function '" + item.method + "' responded with an error";
+    }
+
+    if (!result.ok) {
+        // 过载、超过截止时间等结构化错误随该项返回，客户端按项转换为对应的异常
+        if (detail::take_responded_error(info)) {
+            result.error = "Function '" + item.method + "' responded with an error: " + info.message;
+            result.info = std::move(info);
+        }
+        // 清除处理函数经this_handler()设置的错误，以免整个批量响应被当作错误返回
+        rpc::this_handler().clear();
+    }
+}
+
+bool RPCServerWrapper::handle_local_frame(const char* data, size_t size, detail::ScratchBuffer& reply,
+                                          const std::shared_ptr<detail::ReplyChannel>& channel) {
+    detail::PooledZone request_zone;
+    return handle_request(detail::unpack_referenced(*request_zone, data, size), reply, channel);
+}
+
+bool RPCServerWrapper::handle_request(const RPCLIB_MSGPACK::object& request, detail::ScratchBuffer& reply,
+                                      const std::shared_ptr<detail::ReplyChannel>& channel) {
+    // 请求：[0, id, name, args]；通知：[2, name, args]
+    if (request.type != RPCLIB_MSGPACK::type::ARRAY || request.via.array.size < 3) {
+        throw std::runtime_error("Malformed request frame");
+    }
+    const RPCLIB_MSGPACK::object* items = request.via.array.ptr;
+    bool is_call = items[0].as<int>() == 0;
+    if (is_call && request.via.array.size != 4) {
+        throw std::runtime_error("Malformed request frame");
+    }
+    uint32_t id = is_call ? items[1].as<uint32_t>() : 0;
+    const RPCLIB_MSGPACK::object& method_ref = items[is_call ? 2 : 1];
+    const RPCLIB_MSGPACK::object& args = items[is_call ? 3 : 2];
+
+    // 方法名位置为整数时是类型化句柄发来的方法ID
+    const MethodEntry* entry = nullptr;
+    std::string name;
+    if (method_ref.type == RPCLIB_MSGPACK::type::POSITIVE_INTEGER) {
+        uint64_t method_id = method_ref.as<uint64_t>();
+        entry = find_method_by_id(method_id);
+        if (entry == nullptr) {
+            name = "#" + std::to_string(method_id);
+        }
+    } else {
+        name = method_ref.as<std::string>();
+        auto it = methods_.find(name);
+        if (it != methods_.end()) {
+            entry = &*it;
+        }
+    }
+    const std::string& method_name = entry != nullptr ? entry->first : name;
+
+    ErrorInfo info;
+    WorkStealingPool* pool = channel && entry != nullptr ? dispatch_pool(method_name, args) : nullptr;
+    if (pool != nullptr) {
+        // 会阻塞的请求交给线程池，事件循环或连接线程继续处理后续请求
+        if (defer_request(pool, request, channel) || !is_call) {
+            return false;
+        }
+        info.code = kOverloadedErrorCode;
+        info.message = detail::pool_full_message(method_name, *pool);
+        pack_reply(reply, id, info);
+        return true;
+    }
+
+    detail::take_responded_error(info);     // 丢弃之前遗留的错误
+    detail::PooledZone zone;
+    RPCLIB_MSGPACK::object result;
+    std::string error;
+    if (entry == nullptr) {
+        error = "Function '" + method_name + "' is not bound";
+    } else {
+        try {
+            result = entry->second(args, *zone);
+        } catch (const std::exception& e) {
+            error = "Function '" + method_name + "' threw an exception: " + e.what();
+        } catch (...) {
+            error = "Function '" + method_name + "' threw an unknown exception";
+        }
+    }
+    bool structured = !error.empty() && detail::take_responded_error(info);
+    if (!error.empty()) {
+        rpc::this_handler().clear();
+    }
+    if (!is_call) {
+        return false;
+    }
+
+    if (error.empty()) {
+        RPCLIB_MSGPACK::packer<detail::ScratchBuffer> packer(reply);
+        packer.pack_array(4);
+        packer.pack(static_cast<uint8_t>(1));
+        packer.pack(id);
+        packer.pack_nil();
+        packer.pack(result);
+    } else if (structured) {
+        pack_reply(reply, id, info);
+    } else {
+        pack_reply(reply, id, error);
+    }
+    return true;
+}
+
+void RPCServerWrapper::set_trust_client_clock(bool trust) {
+    trust_client_clock_ = trust;
+}
+
+uint64_t RPCServerWrapper::expired_requests() const {
+    return expired_requests_.load(std::memory_order_relaxed);
+}
+
+CompressionStats RPCServerWrapper::compression_stats() const {
+    return compression_counters_.snapshot();
+}
+
 void RPCServerWrapper::suppress_exceptions(bool suppress) {
     server_->suppress_exceptions(suppress);
 }
@@ -0,0 +1,312 @@
+#include "rpc_stream.h"
+#include <algorithm>
+
+namespace rpc_utils {
+
+namespace detail {
+
+namespace {
+
+// 保留方法在I/O线程中等待数据或窗口额度的最长时间，超时后由客户端重试
+const std::chrono::milliseconds kStreamPollTimeout(100);
+
+// 回收线程检查无活动流的最短间隔
+const std::chrono::milliseconds kMinReapInterval(10);
+
+} // namespace
+
+// StreamState 实现
+StreamState::StreamState(uint64_t id, uint64_t session, bool inbound, size_t window_items,
+                         size_t window_bytes)
+    : id_(id),
+      session_(session),
+      inbound_(inbound),
+      window_items_(std::max<size_t>(1, window_items)),
+      window_bytes_(std::max<size_t>(1, window_bytes)),
+      count_(0),
+      closed_(false),
+      completed_(false),
+      cancelled_(false),
+      last_active_(std::chrono::steady_clock::now()) {}
+
+template<typename Pred>
+bool StreamState::wait(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds timeout, Pred pred) {
+    if (timeout.count() < 0) {
+        cv_.wait(lock, pred);
+        return true;
+    }
+    return cv_.wait_for(lock, timeout, pred);
+}
+
+bool StreamState::put(const char* data, size_t size, size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 缓冲区为空时总是接受，避免单个超过窗口的元素永远无法写入
+    bool ready = wait(lock, timeout, [&] {
+        return cancelled_ || completed_ || count_ == 0 ||
+               (count_ + count <= window_items_ && buffer_.size() + size <= window_bytes_);
+    });
+    if (!ready || cancelled_) {
+        return false;
+    }
+    if (completed_) {
+        // 处理函数已结束，丢弃多余的输入，结果由finish返回
+        return true;
+    }
+    buffer_.append(data, size);
+    count_ += count;
+    cv_.notify_all();
+    return true;
+}
+
+size_t StreamState::take(std::string& data, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait(lock, timeout, [this] {
+        return count_ > 0 || closed_ || cancelled_;
+    });
+    if (count_ == 0) {
+        return 0;
+    }
+    data.clear();
+    data.swap(buffer_);
+    size_t count = count_;
+    count_ = 0;
+    cv_.notify_all();
+    return count;
+}
+
+void StreamState::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    cv_.notify_all();
+}
+
+void StreamState::complete(std::string result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    result_ = std::move(result);
+    completed_ = true;
+    closed_ = true;
+    cv_.notify_all();
+}
+
+void StreamState::fail(const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = error.empty() ? "Stream handler failed" : error;
+    completed_ = true;
+    closed_ = true;
+    cv_.notify_all();
+}
+
+void StreamState::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    cv_.notify_all();
+}
+
+bool StreamState::wait_completed(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return wait(lock, timeout, [this] { return completed_ || cancelled_; }) && completed_;
+}
+
+bool StreamState::finished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (closed_ || cancelled_) && count_ == 0;
+}
+
+bool StreamState::completed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+}
+
+bool StreamState::cancelled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cancelled_;
+}
+
+std::string StreamState::error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+std::string StreamState::take_result() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::move(result_);
+}
+
+void StreamState::touch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_active_ = std::chrono::steady_clock::now();
+}
+
+bool StreamState::idle_for(std::chrono::steady_clock::time_point now,
+                           std::chrono::milliseconds timeout) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return now - last_active_ > timeout;
+}
+
+// StreamRegistry 实现
+StreamRegistry::StreamRegistry(std::chrono::milliseconds idle_timeout)
+    : idle_timeout_(idle_timeout), stopping_(false) {}
+
+StreamRegistry::~StreamRegistry() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    reaper_cv_.notify_all();
+    if (reaper_.joinable()) {
+        reaper_.join();
+    }
+    cancel_all();
+}
+
+uint64_t StreamRegistry::new_id() {
+    for (;;) {
+        uint64_t id = (static_cast<uint64_t>(random_()) << 32) | random_();
+        if (id != 0 && streams_.count(id) == 0) {
+            return id;
+        }
+    }
+}
+
+std::shared_ptr<StreamState> StreamRegistry::open(bool inbound, size_t window_items, size_t window_bytes) {
+    uint64_t session = current_session();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!reaper_.joinable()) {
+        reaper_ = std::thread(&StreamRegistry::reap_loop, this);
+    }
+    auto state = std::make_shared<StreamState>(new_id(), session, inbound, window_items, window_bytes);
+    streams_[state->id()] = state;
+    return state;
+}
+
+void StreamRegistry::reap_loop() {
+    auto interval = std::max(kMinReapInterval, idle_timeout_ / 4);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!reaper_cv_.wait_for(lock, interval, [this] { return stopping_; })) {
+        // 回收对端已消失的流，唤醒仍在等待窗口额度或数据的处理函数
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = streams_.begin(); it != streams_.end();) {
+            if (it->second->idle_for(now, idle_timeout_)) {
+                it->second->cancel();
+                it = streams_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+std::shared_ptr<StreamState> StreamRegistry::find(uint64_t id, bool inbound) const {
+    std::shared_ptr<StreamState> state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = streams_.find(id);
+        if (it != streams_.end()) {
+            state = it->second;
+        }
+    }
+    // 其他连接上的流与不存在的流不加区分，不泄露其存在
+    if (!state || state->session() != current_session()) {
+        throw std::runtime_error("Unknown or expired stream " + std::to_string(id));
+    }
+    if (state->inbound() != inbound) {
+        throw std::runtime_error(std::string("Stream ") + std::to_string(id) +
+                                 (inbound ? " is a server stream and cannot be written"
+                                          : " is a client stream and cannot be read"));
+    }
+    state->touch();
+    return state;
+}
+
+void StreamRegistry::erase(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(id);
+}
+
+void StreamRegistry::cancel_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : streams_) {
+        entry.second->cancel();
+    }
+    streams_.clear();
+}
+
+void StreamRegistry::cancel_session(uint64_t session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        if (it->second->session() == session) {
+            it->second->cancel();
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t StreamRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streams_.size();
+}
+
+StreamChunk StreamRegistry::next(uint64_t id) {
+    std::shared_ptr<StreamState> state = find(id, false);
+
+    StreamChunk chunk;
+    std::string data;
+    chunk.count = static_cast<uint32_t>(state->take(data, kStreamPollTimeout));
+    if (chunk.count > 0) {
+        // 数据以Blob引用的方式挂到响应对象上，写入发送缓冲区之前不再复制
+        chunk.data = Blob(std::move(data)).view();
+    } else if (state->finished()) {
+        chunk.done = true;
+        chunk.error = state->error();
+        erase(id);
+    }
+    return chunk;
+}
+
+bool StreamRegistry::push(uint64_t id, const BinaryView& data, uint32_t count) {
+    std::shared_ptr<StreamState> state = find(id, true);
+    if (state->put(data.data(), data.size(), count, kStreamPollTimeout)) {
+        return true;
+    }
+    if (state->cancelled()) {
+        throw std::runtime_error("Stream " + std::to_string(id) + " was cancelled");
+    }
+    return false;
+}
+
+StreamResult StreamRegistry::finish(uint64_t id) {
+    std::shared_ptr<StreamState> state = find(id, true);
+    state->close();
+
+    StreamResult result;
+    if (!state->wait_completed(kStreamPollTimeout)) {
+        return result;
+    }
+    result.done = true;
+    result.error = state->error();
+    if (result.error.empty()) {
+        result.value = Blob(state->take_result()).view();
+    }
+    erase(id);
+    return result;
+}
+
+void StreamRegistry::cancel(uint64_t id) {
+    std::shared_ptr<StreamState> state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = streams_.find(id);
+        if (it == streams_.end() || it->second->session() != current_session()) {
+            return;
+        }
+        state = it->second;
+        streams_.erase(it);
+    }
+    state->cancel();
+}
+
+} // namespace detail
+
+} // namespace rpc_utils
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <iostream>
+
+/**
+ * @brief 极简测试框架
+ *
+ * 每个测试文件编译为一个可执行文件，由ctest运行；任何检查失败时进程返回非零。
+ */
+namespace rpc_utils {
+namespace test {
+
+struct TestCase {
+    const char* name;
+    std::function<void()> body;
+};
+
+/**
+ * @brief 检查失败时抛出，结束当前测试
+ */
+struct CheckFailure {
+    std::string message;
+};
+
+inline std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) {
+        registry().push_back(TestCase{name, std::move(body)});
+    }
+};
+
+[[noreturn]] inline void fail(const char* file, int line, const std::string& message) {
+    throw CheckFailure{std::string(file) + ":" + std::to_string(line) + ": " + message};
+}
+
+/**
+ * @brief 运行全部测试
+ * @return 失败的测试数
+ */
+inline int run_all() {
+    int failed = 0;
+    for (const TestCase& test : registry()) {
+        try {
+            test.body();
+            std::cout << "[  OK  ] " << test.name << std::endl;
+        } catch (const CheckFailure& e) {
+            ++failed;
+            std::cout << "[ FAIL ] " << test.name << ": " << e.message << std::endl;
+        } catch (const std::exception& e) {
+            ++failed;
+            std::cout << "[ FAIL ] " << test.name << ": unexpected exception: " << e.what() << std::endl;
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief 等待条件成立，最多等待timeout
+ * @return 条件是否成立
+ */
+inline bool eventually(const std::function<bool()>& condition,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * @brief 让处理函数停在已知位置：enter()记录进入并等待open()
+ */
+class Latch {
+public:
+    void enter() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++entered_;
+        changed_.notify_all();
+        changed_.wait(lock, [this] { return open_; });
+    }
+
+    bool wait_entered(size_t count, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, timeout, [this, count] { return entered_ >= count; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    size_t entered_ = 0;
+    bool open_ = false;
+};
+
+/**
+ * @brief 离开作用域时打开Latch；声明在服务器之后，服务器停止前释放停住的处理函数
+ */
+class OpenOnExit {
+public:
+    explicit OpenOnExit(Latch& latch) : latch_(latch) {}
+    ~OpenOnExit() { latch_.open(); }
+    OpenOnExit(const OpenOnExit&) = delete;
+    OpenOnExit& operator=(const OpenOnExit&) = delete;
+
+private:
+    Latch& latch_;
+};
+
+} // namespace test
+} // namespace rpc_utils
+
+#define RPC_TEST_CONCAT_(a, b) a##b
+#define RPC_TEST_CONCAT(a, b) RPC_TEST_CONCAT_(a, b)
+
+#define RPC_TEST(name)                                                                   \
+    static void name();                                                                  \
+    static ::rpc_utils::test::Registrar RPC_TEST_CONCAT(name, _registrar)(#name, &name); \
+    static void name()
+
+#define EXPECT_TRUE(cond)                                                   \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            ::rpc_utils::test::fail(__FILE__, __LINE__, "expected " #cond); \
+        }                                                                   \
+    } while (0)
+
+#define EXPECT_EQ(expected, actual)                                                      \
+    do {                                                                                 \
+        if (!((expected) == (actual))) {                                                 \
+            ::rpc_utils::test::fail(__FILE__, __LINE__, "expected " #actual " == " #expected); \
+        }                                                                                \
+    } while (0)
+
+#define EXPECT_THROWS(expr, type)                                                              \
+    do {                                                                                       \
+        bool thrown_ = false;                                                                  \
+        try {                                                                                  \
+            (void)(expr);                                                                      \
+        } catch (const type&) {                                                                \
+            thrown_ = true;                                                                    \
+        } catch (const std::exception& e_) {                                                   \
+            ::rpc_utils::test::fail(__FILE__, __LINE__,                                        \
+                                    std::string(#expr " threw another exception: ") + e_.what()); \
+        }                                                                                      \
+        if (!thrown_) {                                                                        \
+            ::rpc_utils::test::fail(__FILE__, __LINE__, #expr " did not throw " #type);        \
+        }                                                                                      \
+    } while (0)
+
+#define RPC_TEST_MAIN()                            \
+    int main() {                                   \
+        return ::rpc_utils::test::run_all() == 0 ? 0 : 1; \
+    }
@@ -0,0 +1,64 @@
+// RPCBalancedClient：异步调用在响应到达时归还端点的在途计数
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_balanced_client.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+size_t total_in_flight(const RPCBalancedClient& client) {
+    size_t total = 0;
+    for (const EndpointStats& stats : client.endpoint_stats()) {
+        total += stats.in_flight;
+    }
+    return total;
+}
+
+} // namespace
+
+RPC_TEST(async_call_future_can_be_polled) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCBalancedClient client({Endpoint("127.0.0.1", server.port())});
+    auto result = client.async_call("slow_add", 1, 2);
+    EXPECT_TRUE(latch.wait_entered(1));
+    EXPECT_TRUE(result.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+    latch.open();
+    EXPECT_TRUE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    EXPECT_EQ(3, result.get().get().as<int>());
+    EXPECT_EQ(size_t(0), total_in_flight(client));
+}
+
+RPC_TEST(dropped_future_releases_endpoint) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCBalancedClient client({Endpoint("127.0.0.1", server.port())});
+    {
+        auto dropped = client.async_call("slow_add", 1, 2);
+        EXPECT_TRUE(latch.wait_entered(1));
+    }
+    EXPECT_EQ(size_t(1), total_in_flight(client));
+
+    latch.open();
+    EXPECT_TRUE(eventually([&client] { return total_in_flight(client) == 0; }));
+    EXPECT_EQ(uint64_t(1), client.endpoint_stats()[0].calls);
+}
+
+RPC_TEST_MAIN()
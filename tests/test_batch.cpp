@@ -0,0 +1,87 @@
+// 批量调用：按项返回的结构化错误与异步批量的future
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+void bind_error_methods(RPCServerWrapper& server) {
+    server.bind("reject", []() -> int {
+        detail::respond_error_info(kOverloadedErrorCode, "busy", std::chrono::milliseconds(50));
+    });
+    server.bind("fail", []() -> int {
+        throw std::runtime_error("plain failure");
+    });
+}
+
+} // namespace
+
+RPC_TEST(batch_item_keeps_structured_error) {
+    RPCServerWrapper server(0);
+    bind_error_methods(server);
+    server.async_run(1);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    RPCBatch batch;
+    batch.add("reject").add("fail");
+    BatchResults results = client.call_batch(batch);
+
+    EXPECT_EQ(size_t(2), results.size());
+    EXPECT_EQ(std::string(kOverloadedErrorCode), results.error_info(0).code);
+    EXPECT_EQ(uint64_t(50), results.error_info(0).retry_after_ms);
+    EXPECT_THROWS(results.get<int>(0), OverloadedError);
+    EXPECT_TRUE(results.error_info(1).code.empty());
+}
+
+RPC_TEST(batch_error_after_rejected_call_is_not_structured) {
+    // 单个线程：被拒绝的单次调用与之后的批量在同一线程上执行
+    RPCServerWrapper server(0);
+    bind_error_methods(server);
+    server.async_run(1);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    EXPECT_THROWS(client.call<int>("reject"), OverloadedError);
+
+    RPCBatch batch;
+    batch.add("fail");
+    BatchResults results = client.call_batch(batch);
+    EXPECT_TRUE(!results.ok(0));
+    EXPECT_TRUE(results.error_info(0).code.empty());
+    bool overloaded = false;
+    try {
+        results.get<int>(0);
+    } catch (const OverloadedError&) {
+        overloaded = true;
+    } catch (const std::runtime_error&) {
+    }
+    EXPECT_TRUE(!overloaded);
+}
+
+RPC_TEST(async_batch_future_can_be_polled) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    RPCBatch batch;
+    batch.add("slow_add", 1, 2).add("slow_add", 3, 4);
+    auto results = client.async_call_batch(batch, /*parallel=*/true);
+    EXPECT_TRUE(latch.wait_entered(1));
+    EXPECT_TRUE(results.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+    latch.open();
+    EXPECT_TRUE(results.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    BatchResults values = results.get();
+    EXPECT_EQ(3, values.get<int>(0));
+    EXPECT_EQ(7, values.get<int>(1));
+}
+
+RPC_TEST_MAIN()
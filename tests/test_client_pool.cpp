@@ -0,0 +1,71 @@
+// RPCClientPool：异步调用的future、在途计数与错误类型
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_pool.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+RPC_TEST(async_call_future_can_be_polled) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientPool pool("127.0.0.1", server.port(), 2);
+    auto result = pool.async_call("slow_add", 1, 2);
+    EXPECT_TRUE(latch.wait_entered(1));
+    EXPECT_TRUE(result.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+    EXPECT_EQ(size_t(1), pool.in_flight());
+
+    latch.open();
+    EXPECT_TRUE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    EXPECT_EQ(3, result.get().get().as<int>());
+    EXPECT_EQ(size_t(0), pool.in_flight());
+}
+
+RPC_TEST(dropped_future_releases_connection) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientPool pool("127.0.0.1", server.port(), 2);
+    {
+        auto dropped = pool.async_call("slow_add", 1, 2);
+        EXPECT_TRUE(latch.wait_entered(1));
+    }
+    EXPECT_EQ(size_t(1), pool.in_flight());
+    latch.open();
+    EXPECT_TRUE(eventually([&pool] { return pool.in_flight() == 0; }));
+}
+
+RPC_TEST(call_keeps_overloaded_error_type) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.set_method_limit("slow_add", 1);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientPool pool("127.0.0.1", server.port(), 2);
+    auto first = pool.async_call("slow_add", 1, 2);
+    EXPECT_TRUE(latch.wait_entered(1));
+    EXPECT_THROWS(pool.call<int>("slow_add", 3, 4), OverloadedError);
+
+    latch.open();
+    EXPECT_EQ(3, first.get().get().as<int>());
+}
+
+RPC_TEST_MAIN()
@@ -0,0 +1,60 @@
+// 负载压缩：压缩后的异步调用在完成线程上解压，future照常可以轮询
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+CompressionOptions always_compress() {
+    CompressionOptions options;
+    options.min_size = 0;
+    return options;
+}
+
+} // namespace
+
+RPC_TEST(compressed_call_round_trips) {
+    RPCServerWrapper server(0);
+    server.bind("repeat", [](const std::string& text, int times) {
+        std::string result;
+        for (int i = 0; i < times; ++i) {
+            result += text;
+        }
+        return result;
+    });
+    server.async_run(2);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    client.enable_compression(always_compress());
+    EXPECT_EQ(std::string(10000, 'a'), client.call<std::string>("repeat", std::string(100, 'a'), 100));
+}
+
+RPC_TEST(compressed_async_future_can_be_polled) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind("slow_repeat", [&latch](const std::string& text, int times) {
+        latch.enter();
+        std::string result;
+        for (int i = 0; i < times; ++i) {
+            result += text;
+        }
+        return result;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    client.enable_compression(always_compress());
+    auto result = client.async_call("slow_repeat", std::string(100, 'b'), 100);
+    EXPECT_TRUE(latch.wait_entered(1));
+    EXPECT_TRUE(result.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+    latch.open();
+    EXPECT_TRUE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    EXPECT_EQ(std::string(10000, 'b'), result.get().get().as<std::string>());
+}
+
+RPC_TEST_MAIN()
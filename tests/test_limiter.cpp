@@ -0,0 +1,101 @@
+// 并发限制：上限内准入、超出时拒绝，耗时升高时收缩
+#include "rpc_test.h"
+#include "rpc_limiter.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+LimiterOptions fixed_limit(size_t limit) {
+    LimiterOptions options;
+    options.initial_limit = limit;
+    options.min_limit = limit;
+    options.max_limit = limit;
+    return options;
+}
+
+const uint64_t kMillisecond = 1000 * 1000;
+
+} // namespace
+
+RPC_TEST(accepts_up_to_limit_and_rejects_beyond) {
+    ConcurrencyLimiter limiter(fixed_limit(2));
+    EXPECT_TRUE(limiter.try_acquire());
+    EXPECT_TRUE(limiter.try_acquire());
+    EXPECT_TRUE(!limiter.try_acquire());
+
+    limiter.release(kMillisecond);
+    EXPECT_TRUE(limiter.try_acquire());
+
+    LimiterStats stats = limiter.stats();
+    EXPECT_EQ(uint64_t(3), stats.accepted);
+    EXPECT_EQ(uint64_t(1), stats.rejected);
+    EXPECT_EQ(uint64_t(2), stats.in_flight);
+}
+
+RPC_TEST(seed_sets_unconfigured_initial_limit_once) {
+    LimiterOptions options;
+    options.max_limit = 100;
+    ConcurrencyLimiter limiter(options);
+    limiter.seed(8);
+    EXPECT_EQ(size_t(8), limiter.limit());
+    limiter.seed(32);
+    EXPECT_EQ(size_t(8), limiter.limit());
+
+    ConcurrencyLimiter configured(fixed_limit(4));
+    configured.seed(8);
+    EXPECT_EQ(size_t(4), configured.limit());
+}
+
+RPC_TEST(limit_shrinks_when_latency_rises) {
+    LimiterOptions options;
+    options.initial_limit = 32;
+    options.window = std::chrono::milliseconds(10);
+    ConcurrencyLimiter limiter(options);
+
+    auto run_for = [&limiter](std::chrono::milliseconds duration, uint64_t latency_ns) {
+        auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end) {
+            if (limiter.try_acquire()) {
+                limiter.release(latency_ns);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    run_for(std::chrono::milliseconds(100), kMillisecond);
+    size_t steady = limiter.limit();
+    run_for(std::chrono::milliseconds(100), 20 * kMillisecond);
+    EXPECT_TRUE(limiter.limit() < steady);
+}
+
+RPC_TEST(server_rejects_beyond_method_limit) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.set_method_limit("slow_add", 1);
+    server.bind("slow_add", [&latch](int a, int b) {
+        latch.enter();
+        return a + b;
+    });
+    server.async_run(2);
+    OpenOnExit release(latch);
+
+    RPCClientWrapper first_client("127.0.0.1", server.port());
+    auto first = first_client.async_call("slow_add", 1, 2);
+    EXPECT_TRUE(latch.wait_entered(1));
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    EXPECT_THROWS(client.call<int>("slow_add", 3, 4), OverloadedError);
+
+    latch.open();
+    EXPECT_EQ(3, first.get().get().as<int>());
+    EXPECT_EQ(7, client.call<int>("slow_add", 3, 4));
+
+    LimiterStats stats = server.limiter_stats().at("slow_add");
+    EXPECT_EQ(uint64_t(2), stats.accepted);
+    EXPECT_EQ(uint64_t(1), stats.rejected);
+}
+
+RPC_TEST_MAIN()
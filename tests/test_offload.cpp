@@ -0,0 +1,54 @@
+// bind_offloaded：多事件循环端口上交给线程池执行，rpclib端口上直接执行
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+ReactorOptions single_loop() {
+    ReactorOptions options;
+    options.threads = 1;
+    options.pin_threads = false;
+    return options;
+}
+
+} // namespace
+
+RPC_TEST(offloaded_method_runs_inline_on_rpclib_port) {
+    RPCServerWrapper server(0);
+    server.bind_offloaded("on_pool", []() { return WorkStealingPool::current() != nullptr; });
+    server.async_run(1);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    EXPECT_TRUE(!client.call<bool>("on_pool"));
+}
+
+RPC_TEST(offloaded_method_frees_the_event_loop) {
+    Latch latch;
+    RPCServerWrapper server(0);
+    server.bind_offloaded("slow_on_pool", [&latch]() {
+        latch.enter();
+        return WorkStealingPool::current() != nullptr;
+    });
+    server.bind("ping", []() { return 1; });
+    server.listen_reactors("127.0.0.1", 0, single_loop());
+    server.async_run(1);
+    OpenOnExit release(latch);
+
+    RPCClientWrapper slow_client("127.0.0.1", server.reactor_port());
+    auto slow = slow_client.async_call("slow_on_pool");
+    EXPECT_TRUE(latch.wait_entered(1));
+
+    // 唯一的事件循环没有等待卸载的请求，其他连接照常得到响应
+    RPCClientWrapper client("127.0.0.1", server.reactor_port());
+    client.set_timeout(2000);
+    EXPECT_EQ(1, client.call<int>("ping"));
+
+    latch.open();
+    EXPECT_TRUE(slow.get().get().as<bool>());
+}
+
+RPC_TEST_MAIN()
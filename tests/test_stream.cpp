@@ -0,0 +1,91 @@
+// 流式调用：窗口限制生产方，客户端取消后处理函数停止
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+
+#include <atomic>
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+namespace {
+
+const int kItems = 100;
+const size_t kWindow = 4;
+
+StreamOptions small_window() {
+    StreamOptions options;
+    options.window_items = kWindow;
+    options.executor.threads = 2;
+    return options;
+}
+
+} // namespace
+
+RPC_TEST(window_bounds_unread_items) {
+    std::atomic<int> written(0);
+    RPCServerWrapper server(0);
+    server.bind_stream("count", [&written](StreamWriter<int>& out, int n) {
+        for (int i = 0; i < n && out.write(i); ++i) {
+            written.fetch_add(1);
+        }
+    }, small_window());
+    server.async_run(2);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    auto stream = client.open_stream<int>("count", kItems);
+
+    // 客户端不读取时，生产方最多填满服务端窗口与客户端预取的一批
+    EXPECT_TRUE(eventually([&written] { return written.load() > 0; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_TRUE(written.load() <= static_cast<int>(2 * kWindow));
+
+    int expected = 0;
+    int value = 0;
+    while (stream.next(value)) {
+        EXPECT_EQ(expected, value);
+        ++expected;
+    }
+    EXPECT_EQ(kItems, expected);
+}
+
+RPC_TEST(cancel_stops_producer) {
+    std::atomic<bool> stopped(false);
+    RPCServerWrapper server(0);
+    server.bind_stream("endless", [&stopped](StreamWriter<int>& out) {
+        for (int i = 0; out.write(i); ++i) {
+        }
+        stopped = true;
+    }, small_window());
+    server.async_run(2);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    auto stream = client.open_stream<int>("endless");
+    int value = 0;
+    EXPECT_TRUE(stream.next(value));
+    EXPECT_TRUE(!stopped.load());
+
+    stream.cancel();
+    EXPECT_TRUE(eventually([&stopped] { return stopped.load(); }));
+}
+
+RPC_TEST(dropped_stream_is_cancelled) {
+    std::atomic<bool> stopped(false);
+    RPCServerWrapper server(0);
+    server.bind_stream("endless", [&stopped](StreamWriter<int>& out) {
+        for (int i = 0; out.write(i); ++i) {
+        }
+        stopped = true;
+    }, small_window());
+    server.async_run(2);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    {
+        auto stream = client.open_stream<int>("endless");
+        int value = 0;
+        EXPECT_TRUE(stream.next(value));
+    }
+    EXPECT_TRUE(eventually([&stopped] { return stopped.load(); }));
+}
+
+RPC_TEST_MAIN()
@@ -0,0 +1,37 @@
+// 类型化调用句柄：TCP上按方法名调用，同主机传输上按方法ID分派
+#include "rpc_test.h"
+#include "rpc_server_wrapper.h"
+#include "rpc_client_wrapper.h"
+#include "rpc/server.h"
+
+#include <unistd.h>
+
+using namespace rpc_utils;
+using namespace rpc_utils::test;
+
+RPC_TEST(tcp_stub_works_with_plain_rpclib_server) {
+    rpc::server server(0);
+    server.bind("add", [](double a, double b) { return a + b; });
+    server.async_run(1);
+
+    RPCClientWrapper client("127.0.0.1", server.port());
+    auto add = client.stub<double(double, double)>("add");
+    EXPECT_EQ(4.0, add(1.5, 2.5));
+    EXPECT_EQ(7.0, add.async(3.0, 4.0).get().get().as<double>());
+    server.stop();
+}
+
+RPC_TEST(local_stub_dispatches_by_id) {
+    std::string endpoint = "unix:///tmp/rpc_utils_test_stub_" + std::to_string(::getpid()) + ".sock";
+    RPCServerWrapper server(0);
+    server.bind("add", [](double a, double b) { return a + b; });
+    server.listen(endpoint);
+    server.async_run(1);
+
+    RPCClientWrapper client(endpoint);
+    auto add = client.stub<double(double, double)>("add");
+    EXPECT_EQ(4.0, add(1.5, 2.5));
+    EXPECT_EQ(7.0, add.async(3.0, 4.0).get().get().as<double>());
+}
+
+RPC_TEST_MAIN()